@@ -0,0 +1,1713 @@
+/**
+ * Benchmarks.cpp
+ * Implementation of the headless benchmarks
+ */
+
+#include "Benchmarks.h"
+#include "../Data/SubtreeSharing.h"
+#include "../Data/Traversal.h"
+#include "../Data/TreeLayout.h"
+#include "../IO/BinaryTreeView.h"
+#include "../IO/DocumentBinary.h"
+#include "../IO/DocumentCsv.h"
+#include "../IO/DocumentJson.h"
+#include "../IO/FileTask.h"
+#include "../IO/Journal.h"
+#include "../IO/SubtreePager.h"
+#include "../Editor/Animator.h"
+#include "../Editor/History.h"
+#include "../Eval/Batch.h"
+#include "../Eval/CodeGen.h"
+#include "../Eval/Compiler.h"
+#include "../Eval/Expression.h"
+#include "../Eval/HitCounter.h"
+#include "../Eval/Scoring.h"
+#include "../Eval/Validator.h"
+#include "../Core/ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Bench {
+
+    namespace {
+
+        using Clock = std::chrono::steady_clock;
+
+        double SecondsSince(Clock::time_point start) {
+            return std::chrono::duration<double>(Clock::now() - start).count();
+        }
+
+        double Megabytes(uint64_t bytes) {
+            return double(bytes) / (1024.0 * 1024.0);
+        }
+
+        double Percentile(std::vector<double>& samples, double fraction) {
+            size_t index = std::min(samples.size() - 1, static_cast<size_t>(fraction * samples.size()));
+            std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+            return samples[index];
+        }
+
+        int RunJson(uint32_t nodeCount) {
+            std::string path = (std::filesystem::temp_directory_path() / "DecisionTreeBench.json").string();
+            std::string error;
+
+            Data::Document source;
+            Clock::time_point start = Clock::now();
+            GenerateTree(source, nodeCount);
+            std::printf("Generated %u nodes in %.3f s\n", source.GetNodes().GetLiveCount(), SecondsSince(start));
+
+            start = Clock::now();
+            if (!IO::SaveJson(path, source, error)) {
+                std::fprintf(stderr, "Save failed: %s\n", error.c_str());
+                return 1;
+            }
+            double saveSeconds = SecondsSince(start);
+            uint64_t fileBytes = std::filesystem::file_size(path);
+            std::printf("Save: %.1f MB in %.3f s (%.1f MB/s)\n", Megabytes(fileBytes), saveSeconds, Megabytes(fileBytes) / saveSeconds);
+
+            Data::Document loaded;
+            start = Clock::now();
+            if (!IO::LoadJson(path, loaded, error)) {
+                std::fprintf(stderr, "Load failed: %s\n", error.c_str());
+                return 1;
+            }
+            double loadSeconds = SecondsSince(start);
+            uint32_t loadedCount = loaded.GetNodes().GetLiveCount();
+            std::printf("Load: %.1f MB in %.3f s (%.1f MB/s, %.2f M nodes/s)\n", Megabytes(fileBytes), loadSeconds,
+                        Megabytes(fileBytes) / loadSeconds, loadedCount / loadSeconds / 1e6);
+            std::printf("Loaded document footprint: %.1f MB for %u nodes\n", Megabytes(loaded.GetNodes().GetMemoryFootprint()), loadedCount);
+
+            std::filesystem::remove(path);
+            return loadedCount == nodeCount ? 0 : 1;
+        }
+
+        int RunBinary(uint32_t nodeCount) {
+            std::filesystem::path directory = std::filesystem::temp_directory_path();
+            std::string jsonPath = (directory / "DecisionTreeBench.json").string();
+            std::string binaryPath = (directory / "DecisionTreeBench.dtb").string();
+            std::string error;
+
+            Data::Document source;
+            GenerateTree(source, nodeCount);
+            if (!IO::SaveJson(jsonPath, source, error) || !IO::SaveBinary(binaryPath, source, error)) {
+                std::fprintf(stderr, "Save failed: %s\n", error.c_str());
+                return 1;
+            }
+            std::printf("Wrote %u nodes: JSON %.1f MB, binary %.1f MB\n", nodeCount,
+                        Megabytes(std::filesystem::file_size(jsonPath)), Megabytes(std::filesystem::file_size(binaryPath)));
+
+            // JSON: nothing can be shown before the whole file is parsed
+            Data::Document fromJson;
+            Clock::time_point start = Clock::now();
+            if (!IO::LoadJson(jsonPath, fromJson, error)) {
+                std::fprintf(stderr, "JSON load failed: %s\n", error.c_str());
+                return 1;
+            }
+            double jsonSeconds = SecondsSince(start);
+            std::printf("JSON open (full parse):          %8.3f ms\n", jsonSeconds * 1000.0);
+
+            // Binary: map, then one render-like pass over labels, edges and positions
+            IO::BinaryTreeView view;
+            start = Clock::now();
+            if (!view.Open(binaryPath, error)) {
+                std::fprintf(stderr, "Binary open failed: %s\n", error.c_str());
+                return 1;
+            }
+            double openSeconds = SecondsSince(start);
+            uint64_t checksum = 0;
+            float extent = 0.0f;
+            for (uint32_t i = 0; i < view.GetNodeCount(); ++i) {
+                checksum += view.GetLabel(i).size();
+                for (uint32_t slot = 0, n = view.GetChildCount(i); slot < n; ++slot) checksum += view.GetEdgeLabel(i, slot).size();
+                extent = std::max(extent, view.GetX(i) + view.GetY(i));
+            }
+            double passSeconds = SecondsSince(start) - openSeconds;
+            std::printf("Binary open (mmap + header):     %8.3f ms\n", openSeconds * 1000.0);
+            std::printf("Binary first pass over all nodes:%8.3f ms (checksum %llu, extent %.0f)\n", passSeconds * 1000.0,
+                        static_cast<unsigned long long>(checksum), double(extent));
+
+            Data::Document fromBinary;
+            start = Clock::now();
+            if (!view.Materialize(fromBinary, error)) {
+                std::fprintf(stderr, "Materialize failed: %s\n", error.c_str());
+                return 1;
+            }
+            double materializeSeconds = SecondsSince(start);
+            std::printf("Binary materialize (on edit):    %8.3f ms\n", materializeSeconds * 1000.0);
+            std::printf("Time to first frame: %.0fx faster than JSON; full load %.1fx faster\n",
+                        jsonSeconds / (openSeconds + passSeconds), jsonSeconds / (openSeconds + materializeSeconds));
+
+            bool same = fromBinary.GetRoot() == source.GetRoot() && fromBinary.GetNodes().GetLiveCount() == nodeCount;
+            view.Close();
+            std::filesystem::remove(jsonPath);
+            std::filesystem::remove(binaryPath);
+            return same ? 0 : 1;
+        }
+
+        int RunJournal(uint32_t nodeCount) {
+            std::string path = (std::filesystem::temp_directory_path() / "DecisionTreeBench.journal").string();
+            const uint32_t editCount = 200000;
+
+            Data::Document document;
+            GenerateTree(document, nodeCount);
+            Data::NodeStore& nodes = document.GetNodes();
+
+            // Same edit sequence with and without a journal attached
+            auto runEdits = [&](IO::Journal* journal) {
+                Editor::History history(document);
+                history.SetJournal(journal);
+                std::mt19937 rng(7);
+                std::string label;
+                Clock::time_point start = Clock::now();
+                for (uint32_t i = 0; i < editCount; ++i) {
+                    Data::NodeId node = rng() % nodes.GetCapacity();
+                    if (!nodes.IsLive(node)) continue;
+                    if (i % 2 == 0) {
+                        document.MoveSubtree(node, 1.0f, 0.0f);
+                        history.RecordMove(node, 1.0f, 0.0f);
+                    } else {
+                        label = "edit " + std::to_string(i);
+                        history.Relabel(node, label);
+                        history.Seal();
+                    }
+                }
+                return SecondsSince(start);
+            };
+
+            double plainSeconds = runEdits(nullptr);
+
+            // The editor builds the first snapshot on the loader thread; from
+            // then on each edit also copies its path into the next version
+            Clock::time_point start = Clock::now();
+            document.TakeSnapshot();
+            std::printf("First snapshot of %u nodes (loader thread): %.3f ms\n", nodeCount, SecondsSince(start) * 1000.0);
+            double trackedSeconds = runEdits(nullptr);
+
+            IO::Journal journal;
+            std::filesystem::remove(path);
+            start = Clock::now();
+            journal.Start(path, document.TakeSnapshot());
+            std::printf("Journal start: %.3f ms\n", SecondsSince(start) * 1000.0);
+
+            // The first checkpoint is written before the edits are timed, as it would be before a user's first edit
+            while (!std::filesystem::exists(path)) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            double journalSeconds = runEdits(&journal);
+            std::printf("%u edits: %.3f us/edit without snapshots, %.3f us/edit with snapshots, %.3f us/edit with journal\n", editCount,
+                        plainSeconds * 1e6 / editCount, trackedSeconds * 1e6 / editCount, journalSeconds * 1e6 / editCount);
+
+            start = Clock::now();
+            journal.Compact(document.TakeSnapshot());
+            std::printf("Compaction hand-off (incremental snapshot): %.3f ms\n", SecondsSince(start) * 1000.0);
+
+            start = Clock::now();
+            journal.Stop(false);
+            std::printf("Background writer drained in %.3f s, journal %.1f MB\n", SecondsSince(start), Megabytes(std::filesystem::file_size(path)));
+
+            Data::Document recovered;
+            std::string error;
+            uint32_t replayed = 0;
+            start = Clock::now();
+            bool ok = IO::Journal::Recover(path, recovered, error, &replayed);
+            std::printf("Recovery: %.3f s (%u records replayed)\n", SecondsSince(start), replayed);
+            std::filesystem::remove(path);
+            return ok && recovered.GetNodes().GetLiveCount() == nodes.GetLiveCount() ? 0 : 1;
+        }
+
+        int RunLazy(uint32_t nodeCount) {
+            std::string path = (std::filesystem::temp_directory_path() / "DecisionTreeBench.dtb").string();
+            std::string error;
+            {
+                Data::Document source;
+                GenerateTree(source, nodeCount);
+                if (!IO::SaveBinary(path, source, error)) {
+                    std::fprintf(stderr, "Save failed: %s\n", error.c_str());
+                    return 1;
+                }
+            }
+
+            Data::Document document;
+            IO::SubtreePager pager(document);
+            Clock::time_point start = Clock::now();
+            if (!pager.Open(path, error)) {
+                std::fprintf(stderr, "Open failed: %s\n", error.c_str());
+                return 1;
+            }
+            std::printf("Lazy open: %.3f ms, %u of %u nodes loaded, %zu placeholders\n", SecondsSince(start) * 1000.0,
+                        pager.GetLoadedCount(), nodeCount, pager.GetPlaceholders().size());
+
+            // Expand placeholders the way a user drills down, with a budget
+            // small enough that eviction kicks in; frames keep running while
+            // each expansion loads in the background
+            pager.SetMemoryBudget(pager.GetMemoryUsage() * 4);
+            std::mt19937 rng(11);
+            const uint32_t expansions = 500;
+            double totalLatency = 0.0;
+            double worstFrame = 0.0;
+            uint32_t frames = 0;
+            uint32_t peakLoaded = 0;
+            for (uint32_t i = 0; i < expansions && !pager.GetPlaceholders().empty(); ++i) {
+                const auto& placeholders = pager.GetPlaceholders();
+                auto it = placeholders.begin();
+                std::advance(it, rng() % placeholders.size());
+                Data::NodeId node = it->first;
+                start = Clock::now();
+                pager.Expand(node);
+                while (pager.GetPlaceholder(node) && pager.GetPlaceholder(node)->Loading) {
+                    std::this_thread::yield();
+                    Clock::time_point frameStart = Clock::now();
+                    pager.Touch(node);
+                    pager.Update();
+                    worstFrame = std::max(worstFrame, SecondsSince(frameStart));
+                    ++frames;
+                }
+                totalLatency += SecondsSince(start);
+                peakLoaded = std::max(peakLoaded, pager.GetLoadedCount());
+            }
+            std::printf("%u expansions: %.3f ms average until drawn, worst frame %.3f ms over %u frames\n", expansions,
+                        totalLatency * 1000.0 / expansions, worstFrame * 1000.0, frames);
+            std::printf("Peak %u nodes loaded (%.1f MB, budget %.1f MB; full tree %.1f MB)\n", peakLoaded,
+                        Megabytes(uint64_t(peakLoaded) * Data::NodeStore::BytesPerNode), Megabytes(pager.GetMemoryBudget()),
+                        Megabytes(uint64_t(nodeCount) * Data::NodeStore::BytesPerNode));
+
+            start = Clock::now();
+            pager.LoadAll();
+            std::printf("Load remaining subtrees: %.3f s\n", SecondsSince(start));
+            bool complete = document.GetNodes().GetLiveCount() == nodeCount;
+            std::filesystem::remove(path);
+            return complete ? 0 : 1;
+        }
+
+
+        /**
+         * @brief Run 60 Hz frames that edit the document until a task finishes
+         * @param cancelAt Cancel once this fraction is reached (negative: never)
+         */
+        void RunFrames(IO::FileTask& task, Data::Document& document, const char* name, float cancelAt = -1.0f) {
+            const std::chrono::microseconds budget(16667);
+            Data::NodeStore& nodes = document.GetNodes();
+            std::mt19937 rng(5);
+            uint32_t frames = 0, late = 0;
+            double worst = 0.0;
+            Clock::time_point start = Clock::now();
+            Clock::time_point deadline = start + budget;
+            while (!task.IsFinished()) {
+                Clock::time_point frameStart = Clock::now();
+                Data::NodeId node = rng() % nodes.GetCapacity();
+                if (nodes.IsLive(node)) document.MoveSubtree(node, 1.0f, 0.0f);
+                if (cancelAt >= 0.0f && task.GetProgress() >= cancelAt) task.Cancel();
+
+                double frameSeconds = SecondsSince(frameStart);
+                worst = std::max(worst, frameSeconds);
+                if (Clock::now() > deadline) ++late;
+                ++frames;
+                std::this_thread::sleep_until(deadline);
+                deadline += budget;
+            }
+            task.Wait();
+            std::printf("%-10s %7.3f s, %u frames, worst frame work %.3f ms, %u frames over budget: %s\n", name, SecondsSince(start), frames,
+                        worst * 1000.0, late, task.Succeeded() ? "ok" : task.GetError().c_str());
+        }
+
+        int RunAsync(uint32_t nodeCount) {
+            std::filesystem::path directory = std::filesystem::temp_directory_path();
+            std::string jsonPath = (directory / "DecisionTreeBench.json").string();
+            std::string binaryPath = (directory / "DecisionTreeBench.dtb").string();
+
+            Data::Document document;
+            GenerateTree(document, nodeCount);
+            Clock::time_point start = Clock::now();
+            Data::Snapshot snapshot = document.TakeSnapshot();
+            std::printf("Snapshot of %u nodes: %.3f s (taken once when the journal starts)\n", nodeCount, SecondsSince(start));
+
+            // Saves run while the frame loop keeps editing the document
+            std::unique_ptr<IO::FileTask> task = IO::FileTask::Save(jsonPath, snapshot);
+            RunFrames(*task, document, "Save JSON");
+            bool ok = task->Succeeded();
+            uint64_t jsonBytes = std::filesystem::file_size(jsonPath);
+            task = IO::FileTask::Save(binaryPath, document.TakeSnapshot());
+            RunFrames(*task, document, "Save DTB");
+            ok = ok && task->Succeeded();
+            std::printf("Files: JSON %.1f MB, binary %.1f MB\n", Megabytes(jsonBytes), Megabytes(std::filesystem::file_size(binaryPath)));
+
+            // A cancelled save leaves the previous file in place
+            task = IO::FileTask::Save(jsonPath, document.TakeSnapshot());
+            RunFrames(*task, document, "Cancel", 0.5f);
+            ok = ok && task->WasCancelled() && std::filesystem::file_size(jsonPath) == jsonBytes && !std::filesystem::exists(jsonPath + ".tmp");
+
+            task = IO::FileTask::Load(jsonPath);
+            RunFrames(*task, document, "Load");
+            std::unique_ptr<Data::Document> loaded = task->TakeDocument();
+            ok = ok && task->Succeeded() && loaded->GetNodes().GetLiveCount() == nodeCount;
+
+            std::filesystem::remove(jsonPath);
+            std::filesystem::remove(binaryPath);
+            return ok ? 0 : 1;
+        }
+
+        bool WriteRuleTable(const std::string& path, uint32_t rowCount) {
+            // Few values near the root and more further down, so early columns share branches
+            static const uint32_t valueCounts[] = { 3, 4, 6, 8, 12, 16, 24, 32 };
+            constexpr size_t columnCount = sizeof(valueCounts) / sizeof(valueCounts[0]);
+            std::FILE* file = std::fopen(path.c_str(), "wb");
+            if (!file) {
+                std::fprintf(stderr, "Cannot create %s\n", path.c_str());
+                return false;
+            }
+            std::mt19937 rng(1);
+            for (size_t column = 0; column < columnCount; ++column) std::fprintf(file, "feature_%zu,", column);
+            std::fprintf(file, "Outcome\n");
+            for (uint32_t row = 0; row < rowCount; ++row) {
+                for (size_t column = 0; column < columnCount; ++column) {
+                    uint32_t value = rng() % valueCounts[column];
+                    // Some cells need quoting to exercise the slow path
+                    if (value == 0) std::fprintf(file, "\"< %zu, \"\"low\"\"\",", column);
+                    else std::fprintf(file, "%u..%u,", value * 10, value * 10 + 9);
+                }
+                std::fprintf(file, "Action %u\n", unsigned(rng() % 100));
+            }
+            std::fclose(file);
+            return true;
+        }
+
+        int RunCsv(uint32_t rowCount) {
+            std::string path = (std::filesystem::temp_directory_path() / "DecisionTreeBench.csv").string();
+            if (!WriteRuleTable(path, rowCount)) return 1;
+            uint64_t fileBytes = std::filesystem::file_size(path);
+
+            Data::Document document;
+            IO::CsvImportStats stats;
+            std::string error;
+            if (!IO::ImportCsv(path, document, error, nullptr, &stats)) {
+                std::fprintf(stderr, "Import failed: %s\n", error.c_str());
+                std::filesystem::remove(path);
+                return 1;
+            }
+            std::printf("Import: %.1f MB, %llu rules in %.3f s (%.2f M rows/s, %.1f MB/s)\n", Megabytes(fileBytes),
+                        static_cast<unsigned long long>(stats.Rows), stats.Seconds, stats.GetRowsPerSecond() / 1e6, Megabytes(fileBytes) / stats.Seconds);
+            std::printf("Tree: %u nodes (%.2f per rule), %llu duplicate and %llu conflicting rules\n", stats.Nodes, double(stats.Nodes) / stats.Rows,
+                        static_cast<unsigned long long>(stats.DuplicateRules), static_cast<unsigned long long>(stats.ConflictingRules));
+            std::printf("Document footprint: %.1f MB\n", Megabytes(document.GetNodes().GetMemoryFootprint()));
+
+            std::filesystem::remove(path);
+            return stats.Rows == rowCount && document.GetNodes().GetLiveCount() == stats.Nodes ? 0 : 1;
+        }
+
+        bool RunEvalSize(uint32_t nodeCount) {
+            Data::Document document;
+            GenerateTree(document, nodeCount);
+            Eval::Compiler compiler;
+            Eval::Program program;
+            Clock::time_point start = Clock::now();
+            if (!compiler.Compile(document, program)) {
+                const Eval::Diagnostic& first = compiler.GetDiagnostics().front();
+                std::fprintf(stderr, "Compile failed: %s: %s\n", first.Label.c_str(), first.Message.c_str());
+                return false;
+            }
+            double compileSeconds = SecondsSince(start);
+
+            // Uniform features in [0, 1), the range the generated thresholds are drawn from
+            constexpr uint32_t recordCount = 1 << 20;
+            uint32_t width = std::max(program.GetFeatureCount(), 1u);
+            std::vector<float> records(size_t(recordCount) * width);
+            std::mt19937 rng(7);
+            std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+            for (float& value : records) value = uniform(rng);
+
+            start = Clock::now();
+            uint64_t checksum = 0;
+            for (uint32_t i = 0; i < recordCount; ++i) checksum += program.Evaluate(&records[size_t(i) * width]);
+            double throughputSeconds = SecondsSince(start);
+
+            // Per-record latency, less the cost of reading the clock twice
+            std::vector<double> overhead(4096);
+            for (double& sample : overhead) {
+                Clock::time_point before = Clock::now();
+                sample = std::chrono::duration<double, std::nano>(Clock::now() - before).count();
+            }
+            double clockCost = Percentile(overhead, 0.5);
+            std::vector<double> latency(recordCount);
+            for (uint32_t i = 0; i < recordCount; ++i) {
+                Clock::time_point before = Clock::now();
+                checksum += program.Evaluate(&records[size_t(i) * width]);
+                latency[i] = std::max(0.0, std::chrono::duration<double, std::nano>(Clock::now() - before).count() - clockCost);
+            }
+
+            std::printf("%9u nodes: compiled in %7.3f ms to %u instructions (%.1f KB), %u features | %6.1f M records/s | "
+                        "p50 %5.0f ns, p99 %5.0f ns, p99.9 %5.0f ns (checksum %llu)\n",
+                        nodeCount, compileSeconds * 1000.0, static_cast<uint32_t>(program.GetCode().size()),
+                        program.GetCode().size() * sizeof(Eval::Instruction) / 1024.0, program.GetFeatureCount(),
+                        recordCount / throughputSeconds / 1e6, Percentile(latency, 0.5), Percentile(latency, 0.99),
+                        Percentile(latency, 0.999), static_cast<unsigned long long>(checksum));
+            return true;
+        }
+
+        int RunEval(uint32_t nodeCount) {
+            // Small trees stay in L1, the requested size shows the cost of cache misses
+            bool ok = true;
+            for (uint32_t size : { 1000u, 100000u }) {
+                if (size < nodeCount) ok = RunEvalSize(size) && ok;
+            }
+            return RunEvalSize(nodeCount) && ok ? 0 : 1;
+        }
+
+        int RunBatch(uint32_t recordCount) {
+            constexpr uint32_t featureCount = 16;
+            std::vector<float> columns(size_t(recordCount) * featureCount);
+            std::mt19937 rng(7);
+            std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+            for (uint32_t record = 0; record < recordCount; ++record) {
+                for (uint32_t feature = 0; feature < featureCount; ++feature) {
+                    columns[size_t(feature) * recordCount + record] = uniform(rng);
+                }
+            }
+            std::vector<uint32_t> expected(recordCount), outcomes(recordCount);
+            std::printf("%u records, single core, SIMD support: %s\n", recordCount, Eval::GetSimdLevelName(Eval::GetSimdLevel()));
+
+            bool ok = true;
+            for (uint32_t depth : { 8u, 12u, 16u, 24u, 32u }) {
+                Data::Document document;
+                GenerateDeepTree(document, depth, featureCount);
+                Eval::Compiler compiler;
+                Eval::Program program;
+                if (!compiler.Compile(document, program)) return 1;
+
+                // Records are laid out by feature in the order the compiler numbered them
+                std::vector<const float*> featureColumns(program.GetFeatureCount());
+                std::vector<float> ordered(size_t(recordCount) * program.GetFeatureCount());
+                for (uint32_t feature = 0; feature < program.GetFeatureCount(); ++feature) {
+                    uint32_t source = static_cast<uint32_t>(std::strtoul(program.GetFeatureName(feature).c_str() + 8, nullptr, 10));
+                    std::copy_n(&columns[size_t(source) * recordCount], recordCount, &ordered[size_t(feature) * recordCount]);
+                }
+                uint32_t width = std::max(program.GetFeatureCount(), 1u);
+                std::vector<float> orderedRows(size_t(recordCount) * width);
+                for (uint32_t record = 0; record < recordCount; ++record) {
+                    for (uint32_t feature = 0; feature < program.GetFeatureCount(); ++feature) {
+                        orderedRows[size_t(record) * width + feature] = ordered[size_t(feature) * recordCount + record];
+                    }
+                }
+
+                Clock::time_point start = Clock::now();
+                for (uint32_t record = 0; record < recordCount; ++record) {
+                    expected[record] = program.Evaluate(&orderedRows[size_t(record) * width]);
+                }
+                double singleSeconds = SecondsSince(start);
+                std::printf("depth %2u, %6u nodes: one at a time %6.1f M/s", depth, document.GetNodes().GetLiveCount(), recordCount / singleSeconds / 1e6);
+
+                Eval::ColumnBlock block = { ordered.data(), recordCount, recordCount };
+                for (Eval::SimdLevel level : { Eval::SimdLevel::Scalar, Eval::SimdLevel::Sse2, Eval::SimdLevel::Avx2 }) {
+                    if (level > Eval::GetSimdLevel()) continue;
+                    std::fill(outcomes.begin(), outcomes.end(), Eval::NoOutcome - 1);
+                    start = Clock::now();
+                    Eval::EvaluateBatch(program, block, outcomes.data(), level);
+                    double seconds = SecondsSince(start);
+                    bool same = outcomes == expected;
+                    ok = ok && same;
+                    std::printf(" | %s %6.1f M/s%s", Eval::GetSimdLevelName(level), recordCount / seconds / 1e6, same ? "" : " MISMATCH");
+                }
+                std::printf("\n");
+            }
+            return ok ? 0 : 1;
+        }
+
+        /// Reads records from a file, evaluates them with the generated header and writes the outcomes back
+        const char* CodeGenDriver = R"(#include "Tree.h"
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) return 2;
+    std::FILE* in = std::fopen(argv[1], "rb");
+    uint32_t count = 0, width = 0;
+    if (!in || std::fread(&count, 4, 1, in) != 1 || std::fread(&width, 4, 1, in) != 1) return 2;
+    std::vector<float> records(size_t(count) * width);
+    if (std::fread(records.data(), sizeof(float), records.size(), in) != records.size()) return 2;
+    std::fclose(in);
+
+    std::vector<uint32_t> outcomes(count);
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < count; ++i) outcomes[i] = DecisionTree::Evaluate(&records[size_t(i) * width]);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::FILE* out = std::fopen(argv[2], "wb");
+    if (!out || std::fwrite(outcomes.data(), 4, count, out) != count) return 2;
+    std::fclose(out);
+    std::printf("%.9f\n", seconds);
+    return 0;
+}
+)";
+
+        bool WriteText(const std::filesystem::path& path, const std::string& text) {
+            std::FILE* file = std::fopen(path.string().c_str(), "wb");
+            if (!file) return false;
+            bool ok = std::fwrite(text.data(), 1, text.size(), file) == text.size();
+            return std::fclose(file) == 0 && ok;
+        }
+
+        /**
+         * @brief Replace every Condition label with a random compound expression over "feature_<n>"
+         */
+        void UseExpressionLabels(Data::Document& document, uint32_t featureCount, uint32_t seed) {
+            Data::NodeStore& nodes = document.GetNodes();
+            std::mt19937 rng(seed);
+            auto feature = [&] { return unsigned(rng() % featureCount); };
+            auto threshold = [&] { return double(rng() % 100) / 100.0; };
+            char label[160];
+            for (Data::NodeId node = 0; node < nodes.GetCapacity(); ++node) {
+                if (!nodes.IsLive(node) || nodes.GetType(node) != Data::NodeType::Condition) continue;
+                double low = threshold(), high = std::min(low + 0.3, 0.99);
+                switch (rng() % 5) {
+                    case 0:
+                        std::snprintf(label, sizeof(label), "feature_%u < %.2f", feature(), low);
+                        break;
+                    case 1:
+                        std::snprintf(label, sizeof(label), "feature_%u < %.2f and feature_%u >= %.2f", feature(), high, feature(), low);
+                        break;
+                    case 2:
+                        std::snprintf(label, sizeof(label), "feature_%u in [%.2f, %.2f) or feature_%u > %.2f", feature(), low, high, feature(), high);
+                        break;
+                    case 3:
+                        std::snprintf(label, sizeof(label), "not (feature_%u >= %.2f) and (feature_%u < %.2f or feature_%u < %.2f)",
+                                      feature(), high, feature(), high, feature(), low);
+                        break;
+                    default:
+                        std::snprintf(label, sizeof(label), "%.2f <= feature_%u < %.2f", low, feature(), high);
+                        break;
+                }
+                nodes.SetLabel(node, label);
+            }
+        }
+
+        /// Generate, build and run one tree; false on a build failure or any disagreement
+        bool RunCodeGenTree(const char* name, Data::Document& document, uint32_t recordCount, const std::string& compiler,
+                            const std::filesystem::path& directory) {
+            Eval::Compiler treeCompiler;
+            Eval::Program program;
+            if (!treeCompiler.Compile(document, program)) return false;
+
+            // Uniform features around the thresholds, with some NaN and exact threshold hits mixed in
+            uint32_t width = std::max(program.GetFeatureCount(), 1u);
+            std::vector<float> thresholds;
+            for (const Eval::Instruction& instruction : program.GetCode()) {
+                if (instruction.Op == Eval::Opcode::Test) thresholds.push_back(instruction.Value);
+            }
+            std::vector<float> records(size_t(recordCount) * width);
+            std::mt19937 rng(11);
+            std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+            for (float& value : records) {
+                float pick = uniform(rng);
+                if (pick < 0.01f) value = std::numeric_limits<float>::quiet_NaN();
+                else if (pick < 0.05f && !thresholds.empty()) value = thresholds[rng() % thresholds.size()];
+                else value = uniform(rng);
+            }
+
+            std::vector<uint32_t> expected(recordCount);
+            Clock::time_point start = Clock::now();
+            for (uint32_t i = 0; i < recordCount; ++i) expected[i] = program.Evaluate(&records[size_t(i) * width]);
+            double interpretedSeconds = SecondsSince(start);
+
+            Eval::CodeGenOptions options;
+            options.SourceName = name;
+            std::string header = Eval::GenerateCpp(program, options);
+            std::filesystem::path recordsPath = directory / "records.bin", outcomesPath = directory / "outcomes.bin";
+            std::filesystem::path executable = directory / "tree_driver", timingPath = directory / "timing.txt";
+            std::FILE* file = std::fopen(recordsPath.string().c_str(), "wb");
+            if (!file) return false;
+            std::fwrite(&recordCount, 4, 1, file);
+            std::fwrite(&width, 4, 1, file);
+            std::fwrite(records.data(), sizeof(float), records.size(), file);
+            std::fclose(file);
+            if (!WriteText(directory / "Tree.h", header) || !WriteText(directory / "Driver.cpp", CodeGenDriver)) return false;
+
+            start = Clock::now();
+            std::string build = compiler + " -std=c++17 -O2 -Wall -Wextra -Werror -o \"" + executable.string() + "\" \"" +
+                                (directory / "Driver.cpp").string() + "\"";
+            if (std::system(build.c_str()) != 0) {
+                std::fprintf(stderr, "%s: generated header did not compile\n", name);
+                return false;
+            }
+            double buildSeconds = SecondsSince(start);
+            std::string command = "\"" + executable.string() + "\" \"" + recordsPath.string() + "\" \"" + outcomesPath.string() +
+                                  "\" > \"" + timingPath.string() + "\"";
+            if (std::system(command.c_str()) != 0) {
+                std::fprintf(stderr, "%s: generated program failed\n", name);
+                return false;
+            }
+
+            std::vector<uint32_t> outcomes(recordCount);
+            double generatedSeconds = 0.0;
+            file = std::fopen(outcomesPath.string().c_str(), "rb");
+            bool read = file && std::fread(outcomes.data(), 4, recordCount, file) == recordCount;
+            if (file) std::fclose(file);
+            file = std::fopen(timingPath.string().c_str(), "rb");
+            read = read && file && std::fscanf(file, "%lf", &generatedSeconds) == 1;
+            if (file) std::fclose(file);
+            if (!read) return false;
+
+            uint32_t mismatches = 0;
+            for (uint32_t i = 0; i < recordCount; ++i) mismatches += outcomes[i] != expected[i];
+            std::printf("%-14s %7u nodes, %7u instructions, %6.0f KB source, built in %5.2f s | interpreted %6.1f M/s | "
+                        "generated %6.1f M/s | %u mismatches\n",
+                        name, document.GetNodes().GetLiveCount(), static_cast<uint32_t>(program.GetCode().size()),
+                        header.size() / 1024.0, buildSeconds, recordCount / interpretedSeconds / 1e6,
+                        recordCount / std::max(generatedSeconds, 1e-9) / 1e6, mismatches);
+            return mismatches == 0;
+        }
+
+        int RunCodeGen(uint32_t recordCount) {
+            // The system compiler builds the generated code; without one there is nothing to compare
+            const char* compilerVariable = std::getenv("CXX");
+            std::string compiler = compilerVariable && *compilerVariable ? compilerVariable : "c++";
+            if (std::system((compiler + " --version > /dev/null 2>&1").c_str()) != 0) {
+                std::printf("codegen: no C++ compiler found as '%s' (set CXX to one), skipped\n", compiler.c_str());
+                return 0;
+            }
+            std::printf("Building generated headers with %s -O2\n", compiler.c_str());
+            std::filesystem::path directory = std::filesystem::temp_directory_path() / "tree_codegen_bench";
+            std::filesystem::create_directories(directory);
+
+            // Trees stay small enough to build in about a second each; depth 12
+            // is still split into several functions (CodeGenOptions::MaxFunctionSize)
+            bool ok = true;
+            Data::Document document;
+            GenerateTree(document, 4000);
+            ok = RunCodeGenTree("random 4k", document, recordCount, compiler, directory) && ok;
+            GenerateDeepTree(document, 12, 16);
+            ok = RunCodeGenTree("depth 12", document, recordCount, compiler, directory) && ok;
+            GenerateTree(document, 4000);
+            UseExpressionLabels(document, 64, 3);
+            ok = RunCodeGenTree("expressions", document, recordCount, compiler, directory) && ok;
+            std::filesystem::remove_all(directory);
+            return ok ? 0 : 1;
+        }
+
+        /**
+         * @brief Write random records for a program, features shuffled among an unused column
+         * @param expected Receives the outcome of each record
+         */
+        bool WriteBenchRecords(const Eval::Program& program, const std::string& path, uint32_t recordCount, std::vector<uint32_t>& expected) {
+            std::vector<std::string> columns = { "id" };
+            for (uint32_t feature = 0; feature < program.GetFeatureCount(); ++feature) columns.push_back(program.GetFeatureName(feature));
+            std::mt19937 rng(5);
+            std::shuffle(columns.begin(), columns.end(), rng);
+            std::vector<int> programFeature(columns.size(), -1);
+            for (size_t column = 0; column < columns.size(); ++column) {
+                uint32_t feature = program.FindFeature(columns[column]);
+                if (feature != Eval::NoFeature) programFeature[column] = static_cast<int>(feature);
+            }
+
+            std::FILE* file = std::fopen(path.c_str(), "wb");
+            if (!file) return false;
+            std::string header = Eval::EncodeRecordHeader(columns);
+            bool ok = std::fwrite(header.data(), 1, header.size(), file) == header.size();
+            expected.resize(recordCount);
+            std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+            std::vector<float> rows, features(program.GetFeatureCount());
+            for (uint32_t first = 0; ok && first < recordCount; first += 65536) {
+                uint32_t count = std::min(recordCount - first, 65536u);
+                rows.resize(size_t(count) * columns.size());
+                for (uint32_t record = 0; record < count; ++record) {
+                    float* row = &rows[size_t(record) * columns.size()];
+                    for (size_t column = 0; column < columns.size(); ++column) {
+                        row[column] = programFeature[column] >= 0 ? uniform(rng) : float(first + record);
+                        if (programFeature[column] >= 0) features[programFeature[column]] = row[column];
+                    }
+                    expected[first + record] = program.Evaluate(features.data());
+                }
+                ok = std::fwrite(rows.data(), sizeof(float), rows.size(), file) == rows.size();
+            }
+            return std::fclose(file) == 0 && ok;
+        }
+
+        int RunScore(uint32_t recordCount) {
+            Data::Document document;
+            GenerateDeepTree(document, 16, 16);
+            Eval::Compiler compiler;
+            Eval::Program program;
+            if (!compiler.Compile(document, program)) return 1;
+
+            std::filesystem::path directory = std::filesystem::temp_directory_path();
+            std::string inputPath = (directory / "bench_records.dtr").string();
+            std::string outputPath = (directory / "bench_outcomes.bin").string();
+            std::vector<uint32_t> expected;
+            if (!WriteBenchRecords(program, inputPath, recordCount, expected)) return 1;
+            uint64_t fileSize = std::filesystem::file_size(inputPath);
+
+            // Reading alone is the ceiling for the pipeline
+            std::FILE* file = std::fopen(inputPath.c_str(), "rb");
+            std::vector<char> buffer(1 << 22);
+            Clock::time_point start = Clock::now();
+            while (file && std::fread(buffer.data(), 1, buffer.size(), file) == buffer.size()) {}
+            double readSeconds = SecondsSince(start);
+            if (file) std::fclose(file);
+            uint32_t hardware = Core::ThreadPool::GetHardwareThreads();
+            std::printf("%u records of %u columns (%.1f MB), depth 16 tree, %u hardware threads, SIMD %s | read alone %.0f MB/s\n",
+                        recordCount, program.GetFeatureCount() + 1, Megabytes(fileSize), hardware, Eval::GetSimdLevelName(Eval::GetSimdLevel()),
+                        Megabytes(fileSize) / readSeconds);
+
+            std::vector<uint32_t> threadCounts;
+            for (uint32_t threads = 1; threads < hardware; threads *= 2) threadCounts.push_back(threads);
+            threadCounts.push_back(hardware);
+
+            bool ok = true;
+            double baseline = 0.0;
+            std::vector<uint32_t> outcomes(recordCount);
+            for (uint32_t threads : threadCounts) {
+                Eval::ScoreOptions options;
+                options.Threads = threads;
+                Eval::ScoreStats stats;
+                std::string error;
+                if (!Eval::ScoreFile(program, inputPath, outputPath, error, options, &stats)) {
+                    std::fprintf(stderr, "Scoring failed: %s\n", error.c_str());
+                    ok = false;
+                    break;
+                }
+                file = std::fopen(outputPath.c_str(), "rb");
+                bool same = file && std::fread(outcomes.data(), sizeof(uint32_t), recordCount, file) == recordCount && outcomes == expected;
+                if (file) std::fclose(file);
+                ok = ok && same;
+                if (baseline == 0.0) baseline = stats.Seconds;
+                std::printf("%3u threads: %7.3f s | %6.1f M records/s | %7.0f MB/s | speedup %5.2fx%s\n", threads, stats.Seconds,
+                            stats.GetRecordsPerSecond() / 1e6, Megabytes(stats.InputBytes) / stats.Seconds, baseline / stats.Seconds,
+                            same ? "" : " | MISMATCH");
+            }
+            std::filesystem::remove(inputPath);
+            std::filesystem::remove(outputPath);
+            return ok ? 0 : 1;
+        }
+
+        int RunHeatmap(uint32_t recordCount) {
+            Data::Document document;
+            GenerateDeepTree(document, 16, 16);
+            Eval::Compiler compiler;
+            Eval::Program program;
+            if (!compiler.Compile(document, program)) return 1;
+            std::string inputPath = (std::filesystem::temp_directory_path() / "bench_heatmap.dtr").string();
+            std::vector<uint32_t> expected;
+            if (!WriteBenchRecords(program, inputPath, recordCount, expected)) return 1;
+
+            bool ok = true;
+            Eval::HitCounter hits;
+            uint32_t hardware = Core::ThreadPool::GetHardwareThreads();
+            std::printf("%u records, depth 16 tree (%u nodes), %u hardware threads\n", recordCount, document.GetNodes().GetLiveCount(), hardware);
+            for (uint32_t threads : { 1u, hardware }) {
+                // Best of three, alternating, so both runs see the same page cache and clock
+                double plain = 1e30, counted = 1e30;
+                for (int round = 0; round < 3 && ok; ++round) {
+                    for (bool count : { false, true }) {
+                        Eval::ScoreOptions options;
+                        options.Threads = threads;
+                        if (count) {
+                            hits.Reset(program);
+                            options.Hits = &hits;
+                        }
+                        Eval::ScoreStats stats;
+                        std::string error;
+                        ok = Eval::ScoreFile(program, inputPath, "", error, options, &stats);
+                        if (!ok) std::fprintf(stderr, "Scoring failed: %s\n", error.c_str());
+                        (count ? counted : plain) = std::min(count ? counted : plain, stats.Seconds);
+                    }
+                }
+                if (!ok) break;
+                std::printf("%3u threads: %6.1f M records/s plain, %6.1f M records/s counting hits | overhead %+.1f%%\n", threads,
+                            recordCount / plain / 1e6, recordCount / counted / 1e6, (counted / plain - 1.0) * 100.0);
+                if (hardware == 1) break;
+            }
+
+            // Every record ends at exactly one exit: group the counts by outcome and compare
+            std::vector<uint64_t> exits = hits.GetExitCounts();
+            std::vector<uint64_t> byOutcome(program.GetOutcomeCount() + 1, 0), wanted(program.GetOutcomeCount() + 1, 0);
+            for (size_t pc = 0; pc < exits.size(); ++pc) {
+                uint32_t outcome = program.GetCode()[pc].Operand;
+                if (program.GetCode()[pc].Op == Eval::Opcode::Emit) byOutcome[std::min(outcome, program.GetOutcomeCount())] += exits[pc];
+            }
+            for (uint32_t outcome : expected) wanted[std::min(outcome, program.GetOutcomeCount())]++;
+            std::vector<uint64_t> nodeHits = hits.GetNodeHits(program, document.GetNodes(), document.GetRoot());
+            bool counted = ok && byOutcome == wanted && nodeHits[document.GetRoot()] == recordCount;
+            std::printf("Counts %s: root reached by %llu records\n", counted ? "match evaluation" : "MISMATCH",
+                        static_cast<unsigned long long>(nodeHits[document.GetRoot()]));
+            std::filesystem::remove(inputPath);
+            return counted ? 0 : 1;
+        }
+
+        /// Outcome label a record reaches, walking the document and evaluating each condition directly
+        std::string_view WalkTree(const Data::NodeStore& nodes, Data::NodeId root, const std::vector<Eval::Expression>& conditions,
+                                  const std::vector<std::vector<uint32_t>>& featureMaps, const float* record) {
+            std::vector<float> values;
+            Data::NodeId node = root;
+            while (nodes.GetChildCount(node) > 0) {
+                if (nodes.GetType(node) != Data::NodeType::Condition) {
+                    node = nodes.GetChild(node, 0);
+                    continue;
+                }
+                values.clear();
+                for (uint32_t feature : featureMaps[node]) values.push_back(record[feature]);
+                std::string_view edge = conditions[node].Evaluate(values.data()) ? "Yes" : "No";
+                Data::NodeId next = Data::InvalidNode;
+                for (uint32_t slot = 0; slot < nodes.GetChildCount(node); ++slot) {
+                    if (nodes.GetEdgeLabel(node, slot) == edge) next = nodes.GetChild(node, slot);
+                }
+                if (next == Data::InvalidNode) return std::string_view();
+                node = next;
+            }
+            return nodes.GetLabel(node);
+        }
+
+        int RunExpressions(uint32_t recordCount) {
+            constexpr uint32_t NodeCount = 200000;
+            Data::Document document;
+            GenerateTree(document, NodeCount);
+            UseExpressionLabels(document, 64, 3);
+            const Data::NodeStore& nodes = document.GetNodes();
+
+            // Cold: every label parsed; warm: the same compiler again, as after an edit
+            Eval::Compiler compiler;
+            Eval::Program program;
+            Clock::time_point start = Clock::now();
+            if (!compiler.Compile(document, program)) return 1;
+            double coldSeconds = SecondsSince(start);
+            start = Clock::now();
+            if (!compiler.Compile(document, program)) return 1;
+            double warmSeconds = SecondsSince(start);
+            uint32_t conditions = 0;
+            for (Data::NodeId node = 0; node < nodes.GetCapacity(); ++node) {
+                conditions += nodes.IsLive(node) && nodes.GetType(node) == Data::NodeType::Condition && nodes.GetChildCount(node) > 0;
+            }
+            std::printf("%u nodes, %u compound conditions: compiled in %.1f ms cold, %.1f ms with labels cached | %u instructions (%.2f tests per condition)\n",
+                        NodeCount, conditions, coldSeconds * 1000.0, warmSeconds * 1000.0, static_cast<uint32_t>(program.GetCode().size()),
+                        double(program.GetCode().size() - program.GetOutcomeCount()) / std::max(conditions, 1u));
+
+            uint32_t width = std::max(program.GetFeatureCount(), 1u);
+            std::vector<float> rows(size_t(recordCount) * width), columns(size_t(recordCount) * width);
+            std::mt19937 rng(7);
+            std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+            for (uint32_t record = 0; record < recordCount; ++record) {
+                for (uint32_t feature = 0; feature < width; ++feature) {
+                    // A few missing values exercise the NaN rules of negated tests
+                    float value = rng() % 64 == 0 ? std::numeric_limits<float>::quiet_NaN() : uniform(rng);
+                    rows[size_t(record) * width + feature] = value;
+                    columns[size_t(feature) * recordCount + record] = value;
+                }
+            }
+
+            std::vector<uint32_t> expected(recordCount), outcomes(recordCount);
+            start = Clock::now();
+            for (uint32_t record = 0; record < recordCount; ++record) expected[record] = program.Evaluate(&rows[size_t(record) * width]);
+            double singleSeconds = SecondsSince(start);
+            Eval::ColumnBlock block = { columns.data(), recordCount, recordCount };
+            start = Clock::now();
+            Eval::EvaluateBatch(program, block, outcomes.data());
+            double batchSeconds = SecondsSince(start);
+            bool same = outcomes == expected;
+
+            // The reference walk is slow; a prefix of the records is enough to catch lowering errors
+            std::vector<Eval::Expression> parsed(nodes.GetCapacity());
+            std::vector<std::vector<uint32_t>> featureMaps(nodes.GetCapacity());
+            for (Data::NodeId node = 0; node < nodes.GetCapacity(); ++node) {
+                if (!nodes.IsLive(node) || nodes.GetType(node) != Data::NodeType::Condition) continue;
+                std::string error;
+                parsed[node].Parse(nodes.GetLabel(node), error);
+                for (const std::string& name : parsed[node].GetFeatures()) featureMaps[node].push_back(program.FindFeature(name));
+            }
+            uint32_t walked = std::min(recordCount, 100000u), mismatches = 0;
+            for (uint32_t record = 0; record < walked; ++record) {
+                std::string_view reached = WalkTree(nodes, document.GetRoot(), parsed, featureMaps, &rows[size_t(record) * width]);
+                mismatches += reached != program.GetOutcomeLabel(expected[record]);
+            }
+
+            std::printf("one at a time %.1f M records/s | %s batch %.1f M records/s%s | %u of %u records disagree with direct evaluation\n",
+                        recordCount / singleSeconds / 1e6, Eval::GetSimdLevelName(Eval::GetSimdLevel()), recordCount / batchSeconds / 1e6,
+                        same ? "" : " MISMATCH", mismatches, walked);
+            return same && mismatches == 0 ? 0 : 1;
+        }
+
+        int RunValidate(uint32_t nodeCount) {
+            constexpr uint32_t EditCount = 20000;
+            Data::Document document;
+            GenerateTree(document, nodeCount);
+            Data::NodeStore& nodes = document.GetNodes();
+            Editor::History history(document);
+
+            // Spread over frames as in the editor, at the default budget
+            Eval::Validator validator(document);
+            uint32_t frames = 1;
+            Clock::time_point start = Clock::now();
+            while (!validator.Update()) ++frames;
+            double initialSeconds = SecondsSince(start);
+            std::printf("Initial check of %u nodes: %.3f s over %u frames (%.2f M nodes/s) | %u issues\n", nodeCount, initialSeconds, frames,
+                        nodeCount / initialSeconds / 1e6, validator.GetIssueCount());
+
+            // Edits as the editor makes them, each followed by the Update() of its frame
+            static const char* labels[] = { "feature_3 < 0.5 and feature_9 >= 0.25", "0.1 < feature_7 <= 0.9", "feature_2 in {1, 2, 3",
+                                            "feature_11", "feature_5 <", "not (feature_1 > 0.5 or feature_8 < 0.1)" };
+            std::mt19937 rng(5);
+            std::vector<double> samples;
+            samples.reserve(EditCount);
+            uint32_t edits = 0;
+            while (edits < EditCount) {
+                Data::NodeId node = rng() % nodes.GetCapacity();
+                if (!nodes.IsLive(node)) continue;
+                uint32_t kind = rng() % 8;
+                if (kind < 4) {
+                    if (nodes.GetType(node) != Data::NodeType::Condition) continue;
+                    history.Relabel(node, labels[rng() % 6]);
+                    history.Seal();
+                } else if (kind < 6) {
+                    static const Data::NodeType types[] = { Data::NodeType::End, Data::NodeType::Action, Data::NodeType::Start };
+                    Data::NodeId child = document.CreateNode("New", types[rng() % 3]);
+                    // Reuses the first edge label, so some children end up duplicating it
+                    std::string edge(nodes.GetChildCount(node) > 0 ? nodes.GetEdgeLabel(node, 0) : "Yes");
+                    nodes.AddChild(node, child, edge);
+                    history.RecordCreate(child);
+                } else if (kind == 6) {
+                    if (node == document.GetRoot()) continue;
+                    history.DeleteSubtree(node);
+                } else if (!history.Undo()) {
+                    continue;
+                }
+                start = Clock::now();
+                validator.Update();
+                samples.push_back(SecondsSince(start));
+                ++edits;
+            }
+            double p50 = Percentile(samples, 0.5), p99 = Percentile(samples, 0.99);
+
+            // The incremental results must match checking the edited tree from scratch
+            Eval::Validator fresh(document);
+            while (!fresh.Update(std::numeric_limits<uint32_t>::max())) {}
+            uint32_t mismatches = 0;
+            for (Data::NodeId id = 0; id < nodes.GetCapacity(); ++id) {
+                if (!nodes.IsAlive(id)) continue;
+                mismatches += validator.GetIssues(id) != fresh.GetIssues(id) || validator.GetSubtreeIssueCount(id) != fresh.GetSubtreeIssueCount(id);
+            }
+            std::printf("%u edits: Update() p50 %.1f us, p99 %.1f us (%.0fx less than a full check) | %u issues, %u nodes differ from a fresh check\n",
+                        EditCount, p50 * 1e6, p99 * 1e6, initialSeconds / p50, validator.GetIssueCount(), mismatches);
+            return mismatches == 0 && validator.GetIssueCount() == fresh.GetIssueCount() ? 0 : 1;
+        }
+
+        /// Whether two versions spell out the same tree when every shared node is expanded
+        bool SameTree(const Data::Snapshot& left, const Data::Snapshot& right) {
+            std::vector<std::pair<const Data::SnapshotNode*, const Data::SnapshotNode*>> stack = { { left.GetRoot(), right.GetRoot() } };
+            while (!stack.empty()) {
+                auto [a, b] = stack.back();
+                stack.pop_back();
+                if (a->Type != b->Type || a->Label != b->Label || a->SubtreeSize != b->SubtreeSize || a->Children.size() != b->Children.size()) return false;
+                for (size_t i = 0; i < a->Children.size(); ++i) {
+                    if (a->Children[i].Label != b->Children[i].Label) return false;
+                    stack.push_back({ a->Children[i].Target, b->Children[i].Target });
+                }
+            }
+            return true;
+        }
+
+        bool RunShareTree(const char* name, Data::Document& document, bool compile) {
+            Data::Snapshot tree = document.TakeSnapshot();
+            Data::SharingStats stats;
+            Data::Snapshot shared = Data::ShareSubtrees(tree, &stats);
+            std::printf("%-10s %8u nodes -> %8u shared (%5.1f%% fewer) | %7.1f MB -> %6.1f MB (document %.1f MB) | %.3f s\n", name, stats.TreeNodes,
+                        stats.SharedNodes, 100.0 * (1.0 - double(stats.SharedNodes) / stats.TreeNodes), Megabytes(stats.TreeBytes),
+                        Megabytes(stats.SharedBytes), Megabytes(document.GetNodes().GetMemoryFootprint()), stats.Seconds);
+            bool ok = SameTree(tree, shared) && Data::GetMemoryFootprint(shared) == stats.SharedBytes;
+            if (!compile) return ok;
+
+            // Shared subtrees are compiled once; both programs must agree on every record
+            Eval::Compiler compiler;
+            Eval::Program treeProgram, sharedProgram;
+            if (!compiler.Compile(tree, treeProgram) || !compiler.Compile(shared, sharedProgram)) return false;
+            uint32_t width = std::max(treeProgram.GetFeatureCount(), 1u);
+            std::vector<float> record(width);
+            std::vector<uint32_t> map(width);
+            for (uint32_t feature = 0; feature < width; ++feature) {
+                map[feature] = feature < treeProgram.GetFeatureCount() ? sharedProgram.FindFeature(treeProgram.GetFeatureName(feature)) : 0;
+            }
+            std::vector<float> sharedRecord(std::max(sharedProgram.GetFeatureCount(), 1u));
+            std::mt19937 rng(11);
+            std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+            uint32_t mismatches = 0;
+            constexpr uint32_t RecordCount = 200000;
+            for (uint32_t i = 0; i < RecordCount; ++i) {
+                for (uint32_t feature = 0; feature < width; ++feature) {
+                    record[feature] = uniform(rng);
+                    if (map[feature] < sharedRecord.size()) sharedRecord[map[feature]] = record[feature];
+                }
+                mismatches += treeProgram.GetOutcomeLabel(treeProgram.Evaluate(record.data())) !=
+                              sharedProgram.GetOutcomeLabel(sharedProgram.Evaluate(sharedRecord.data()));
+            }
+            std::printf("%-10s program %zu -> %zu instructions | %u of %u records disagree\n", "", treeProgram.GetCode().size(),
+                        sharedProgram.GetCode().size(), mismatches, RecordCount);
+            return ok && mismatches == 0;
+        }
+
+        /// Replace every leaf with a copy of one of a few fallback chains of tests
+        void AddFallbackChains(Data::Document& document, uint32_t chainCount, uint32_t chainLength) {
+            Data::NodeStore& nodes = document.GetNodes();
+            std::vector<Data::NodeId> leaves;
+            Data::PreOrder(nodes, document.GetRoot(), [&](Data::NodeId node, uint32_t) {
+                if (nodes.GetChildCount(node) == 0) leaves.push_back(node);
+            });
+            char label[64];
+            for (size_t i = 0; i < leaves.size(); ++i) {
+                uint32_t chain = static_cast<uint32_t>(i % chainCount);
+                Data::NodeId at = leaves[i];
+                nodes.SetType(at, Data::NodeType::Condition);
+                for (uint32_t step = 0; step < chainLength; ++step) {
+                    std::snprintf(label, sizeof(label), "feature_%u < %.2f", (chain * 7 + step) % 64, 0.1 + 0.1 * ((chain + step) % 8));
+                    nodes.SetLabel(at, label);
+                    std::snprintf(label, sizeof(label), "Fallback %u.%u", chain, step);
+                    nodes.AddChild(at, nodes.Create(label, Data::NodeType::Action), "Yes");
+                    Data::NodeType type = step + 1 < chainLength ? Data::NodeType::Condition : Data::NodeType::Action;
+                    Data::NodeId next = nodes.Create(step + 1 < chainLength ? "" : "Default", type);
+                    nodes.AddChild(at, next, "No");
+                    at = next;
+                }
+            }
+        }
+
+        int RunShare(uint32_t nodeCount) {
+            Data::Document generated, chains, deep, rules;
+            GenerateTree(generated, nodeCount);
+            bool ok = RunShareTree("generated", generated, true);
+
+            // The same chains of tests repeated under every branch of a smaller tree
+            GenerateTree(chains, std::max(nodeCount / 32, 1u));
+            AddFallbackChains(chains, 8, 8);
+            ok = RunShareTree("chains", chains, true) && ok;
+
+            GenerateDeepTree(deep, 24, 64);
+            ok = RunShareTree("deep", deep, true) && ok;
+
+            // A rule table repeats the same lower columns under many prefixes
+            std::string path = (std::filesystem::temp_directory_path() / "DecisionTreeBench.csv").string();
+            std::string error;
+            if (!WriteRuleTable(path, std::max(nodeCount / 4, 1u)) || !IO::ImportCsv(path, rules, error)) {
+                std::fprintf(stderr, "Import failed: %s\n", error.c_str());
+                return 1;
+            }
+            std::filesystem::remove(path);
+            ok = RunShareTree("rules", rules, false) && ok;
+            return ok ? 0 : 1;
+        }
+
+
+        /// Pairs of nodes of a level closer than their half widths, and the width of the widest level
+        uint32_t CountOverlaps(const Data::NodeStore& nodes, Data::NodeId root, double& width) {
+            struct Box {
+                float X, HalfWidth;
+            };
+            std::vector<std::vector<Box>> levels;
+            Data::PreOrder(nodes, root, [&](Data::NodeId node, uint32_t depth) {
+                if (depth >= levels.size()) levels.resize(depth + 1);
+                levels[depth].push_back({ nodes.GetX(node), Data::GetLayoutWidth(nodes, node) * 0.5f });
+            });
+            uint32_t overlaps = 0;
+            width = 0.0;
+            for (std::vector<Box>& level : levels) {
+                std::sort(level.begin(), level.end(), [](const Box& a, const Box& b) { return a.X < b.X; });
+                for (size_t i = 1; i < level.size(); ++i) overlaps += level[i].X - level[i - 1].X < level[i].HalfWidth + level[i - 1].HalfWidth;
+                width = std::max(width, double(level.back().X + level.back().HalfWidth) - double(level.front().X - level.front().HalfWidth));
+            }
+            return overlaps;
+        }
+
+        bool RunLayoutTree(const char* name, Data::Document& document) {
+            Data::NodeStore& nodes = document.GetNodes();
+            Data::TreeLayout layout(nodes);
+            Clock::time_point start = Clock::now();
+            layout.Compute(document.GetRoot());
+            double computeSeconds = SecondsSince(start);
+            start = Clock::now();
+            layout.Place(document.GetRoot(), 0.0f, 0.0f);
+            double placeSeconds = SecondsSince(start);
+
+            double width;
+            uint32_t overlaps = CountOverlaps(nodes, document.GetRoot(), width);
+            uint32_t count = nodes.GetLiveCount();
+            std::printf("%-10s %8u nodes: compute %.3f s (%.1f M nodes/s), place %.3f s | widest level %.0f px | %u overlapping pairs\n", name, count,
+                        computeSeconds, count / computeSeconds / 1e6, placeSeconds, width, overlaps);
+            return overlaps == 0;
+        }
+
+        int RunLayout(uint32_t nodeCount) {
+            Data::Document generated, chains, deep, spine;
+            GenerateTree(generated, nodeCount);
+            bool ok = RunLayoutTree("generated", generated);
+
+            GenerateTree(chains, std::max(nodeCount / 32, 1u));
+            AddFallbackChains(chains, 8, 8);
+            ok = RunLayoutTree("chains", chains) && ok;
+
+            GenerateDeepTree(deep, 24, 64);
+            ok = RunLayoutTree("deep", deep) && ok;
+
+            // One path as deep as the tree is large, with a leaf on alternate sides of every node
+            Data::NodeStore& nodes = spine.GetNodes();
+            Data::NodeId at = spine.CreateNode("Start", Data::NodeType::Start);
+            spine.SetRoot(at);
+            for (uint32_t count = 1; count + 2 <= nodeCount; count += 2) {
+                Data::NodeId next = nodes.Create("feature_1 < 0.5", Data::NodeType::Condition);
+                Data::NodeId leaf = nodes.Create("End", Data::NodeType::End);
+                nodes.AddChild(at, count % 4 == 1 ? next : leaf, "Yes");
+                nodes.AddChild(at, count % 4 == 1 ? leaf : next, "No");
+                at = next;
+            }
+            ok = RunLayoutTree("spine", spine) && ok;
+            return ok ? 0 : 1;
+        }
+
+        int RunRelayout(uint32_t nodeCount) {
+            constexpr uint32_t EditCount = 5000;
+            static const char* labels[] = { "Go", "feature_12 < 0.25", "Wait for the next record", "x" };
+            bool ok = true;
+            for (uint32_t size : { std::max(nodeCount / 100, 1u), std::max(nodeCount / 10, 1u), nodeCount }) {
+                Data::Document document;
+                GenerateTree(document, size);
+                Data::NodeStore& nodes = document.GetNodes();
+                Editor::History history(document);
+                Data::TreeLayout layout(nodes);
+                Clock::time_point start = Clock::now();
+                layout.Apply(document.GetRoot(), 0.0f, 0.0f);
+                double fullSeconds = SecondsSince(start);
+
+                // Edits as the editor makes them, each laid out before the next
+                // and, as if each were a frame of its own, resolved before it is drawn
+                std::mt19937 rng(3);
+                std::vector<double> samples, resolveSamples;
+                samples.reserve(EditCount);
+                resolveSamples.reserve(EditCount);
+                uint64_t moved = 0, merged = 0, resolved = 0;
+                while (samples.size() < EditCount) {
+                    Data::NodeId node = rng() % nodes.GetCapacity();
+                    if (!nodes.IsLive(node)) continue;
+                    uint32_t kind = rng() % 6;
+                    if (kind < 3) {
+                        Data::NodeId child = document.CreateNode(labels[rng() % 4], Data::NodeType::Action);
+                        nodes.AddChild(node, child, "Yes");
+                        history.RecordCreate(child);
+                    } else if (kind == 3) {
+                        if (node == document.GetRoot()) continue;
+                        history.DeleteSubtree(node);
+                    } else if (kind == 4) {
+                        history.Relabel(node, labels[rng() % 4]);
+                        history.Seal();
+                    } else if (!history.Undo()) {
+                        continue;
+                    }
+                    merged += layout.GetPendingCount();
+                    start = Clock::now();
+                    moved += layout.Update();
+                    samples.push_back(SecondsSince(start));
+                    start = Clock::now();
+                    resolved += layout.Resolve();
+                    resolveSamples.push_back(SecondsSince(start));
+                }
+                double p50 = Percentile(samples, 0.5), p99 = Percentile(samples, 0.99);
+                double resolveP50 = Percentile(resolveSamples, 0.5), resolveP99 = Percentile(resolveSamples, 0.99);
+
+                // Offsets must match a layout of the edited tree from scratch, bit for bit
+                Data::TreeLayout fresh(nodes);
+                fresh.Compute(document.GetRoot());
+                uint32_t mismatches = 0;
+                float drift = 0.0f;
+                Data::PreOrder(nodes, document.GetRoot(), [&](Data::NodeId id, uint32_t depth) {
+                    if (depth == 0) return;
+                    mismatches += layout.GetOffset(id) != fresh.GetOffset(id);
+                    float offset = nodes.GetX(id) - nodes.GetX(nodes.GetParent(id));
+                    drift = std::max(drift, std::abs(offset - float(fresh.GetOffset(id))));
+                });
+                double width;
+                uint32_t overlaps = CountOverlaps(nodes, document.GetRoot(), width);
+                std::printf("%8u nodes: full layout %.3f s | %u edits: Update() p50 %.1f us, p99 %.1f us, %.1f nodes merged and %.1f written per edit | "
+                            "Resolve() p50 %.1f us, p99 %.1f us, %.1f subtrees moved per edit | "
+                            "%u offsets differ from a fresh layout, positions within %.1f px, %u overlapping pairs\n", size, fullSeconds, EditCount,
+                            p50 * 1e6, p99 * 1e6, double(merged) / EditCount, double(moved) / EditCount,
+                            resolveP50 * 1e6, resolveP99 * 1e6, double(resolved) / EditCount, mismatches, drift, overlaps);
+                ok = ok && mismatches == 0 && overlaps == 0;
+            }
+            return ok ? 0 : 1;
+        }
+
+        bool RunParallelLayoutTree(const char* name, Data::Document& document, const std::vector<uint32_t>& threadCounts) {
+            Data::NodeStore& nodes = document.GetNodes();
+            Data::TreeLayout serial(nodes);
+            Clock::time_point start = Clock::now();
+            serial.Compute(document.GetRoot());
+            double baseline = SecondsSince(start);
+            std::printf("%-10s %8u nodes: 1 thread %.3f s\n", name, nodes.GetLiveCount(), baseline);
+
+            bool ok = true;
+            for (uint32_t threads : threadCounts) {
+                Core::ThreadPool pool(threads);
+                Data::TreeLayout layout(nodes, &pool);
+                start = Clock::now();
+                layout.Compute(document.GetRoot());
+                double seconds = SecondsSince(start);
+                // Laid out again, the split reuses the sizes the merges kept
+                start = Clock::now();
+                layout.Compute(document.GetRoot());
+                double againSeconds = SecondsSince(start);
+
+                // Workers only change who merges a subtree, never its offsets
+                uint32_t mismatches = 0;
+                Data::PreOrder(nodes, document.GetRoot(), [&](Data::NodeId id, uint32_t depth) {
+                    if (depth > 0) mismatches += layout.GetOffset(id) != serial.GetOffset(id);
+                });
+                std::printf("%22u threads: %.3f s, again %.3f s | speedup %5.2fx, again %5.2fx | %u offsets differ from 1 thread\n",
+                            threads, seconds, againSeconds, baseline / seconds, baseline / againSeconds, mismatches);
+                ok = ok && mismatches == 0;
+            }
+            return ok;
+        }
+
+        int RunParallelLayout(uint32_t nodeCount) {
+            uint32_t hardware = Core::ThreadPool::GetHardwareThreads();
+            std::vector<uint32_t> threadCounts;
+            for (uint32_t threads = 2; threads < hardware; threads *= 2) threadCounts.push_back(threads);
+            // Two workers at least, so that the split is checked even on one hardware thread
+            threadCounts.push_back(std::max(hardware, 2u));
+            std::printf("%u hardware threads, split from %u nodes\n", hardware, Data::TreeLayout::ParallelThreshold);
+
+            Data::Document generated, deep;
+            GenerateTree(generated, std::max(nodeCount, Data::TreeLayout::ParallelThreshold));
+            bool ok = RunParallelLayoutTree("generated", generated, threadCounts);
+
+            GenerateDeepTree(deep, 24, 64);
+            AddFallbackChains(deep, 8, 8);
+            ok = RunParallelLayoutTree("deep", deep, threadCounts) && ok;
+            return ok ? 0 : 1;
+        }
+
+        int RunAnimate(uint32_t nodeCount) {
+            constexpr uint32_t FrameCount = 3000;
+            constexpr float FrameTime = 1.0f / 60.0f;
+            bool ok = true;
+            for (uint32_t size : { std::max(nodeCount / 100, 1u), std::max(nodeCount / 10, 1u), nodeCount }) {
+                Data::Document document;
+                GenerateTree(document, size);
+                Data::NodeStore& nodes = document.GetNodes();
+                Editor::History history(document);
+                Data::TreeLayout layout(nodes);
+                layout.Apply(document.GetRoot(), 0.0f, 0.0f);
+
+                // What every frame cost before: retarget and step the whole scale column
+                std::vector<double> fullSamples;
+                for (uint32_t frame = 0; frame < 100; ++frame) {
+                    Clock::time_point start = Clock::now();
+                    float* scale = nodes.GetScaleData();
+                    float* targetScale = nodes.GetTargetScaleData();
+                    std::fill(targetScale, targetScale + nodes.GetCapacity(), 1.0f);
+                    for (uint32_t i = 0, n = nodes.GetCapacity(); i < n; ++i) scale[i] += (targetScale[i] - scale[i]) * 0.1f;
+                    fullSamples.push_back(SecondsSince(start));
+                }
+
+                // Every node pops in once, then the tree is at rest
+                Editor::Animator animator(nodes);
+                Clock::time_point start = Clock::now();
+                animator.Update(FrameTime);
+                double popSeconds = SecondsSince(start);
+                while (animator.GetActiveCount() > 0) animator.Update(1.0f);
+
+                // The hover wanders every few frames; a creation and a deletion, laid out with transitions, every second
+                std::mt19937 rng(5);
+                std::vector<double> samples;
+                samples.reserve(FrameCount);
+                uint64_t active = 0;
+                Data::NodeId hovered = Data::InvalidNode, selected = Data::InvalidNode;
+                for (uint32_t frame = 0; frame < FrameCount; ++frame) {
+                    if (frame % 60 == 30) {
+                        Data::NodeId parent;
+                        do parent = rng() % nodes.GetCapacity(); while (!nodes.IsLive(parent));
+                        Data::NodeId child = document.CreateNode("Go", Data::NodeType::Action);
+                        nodes.AddChild(parent, child, "Yes");
+                        animator.BeginTransition();
+                        layout.Update();
+                        animator.EndTransition();
+                        history.RecordCreate(child);
+                        selected = child;
+                    } else if (frame % 60 == 45) {
+                        // Mostly small subtrees near the leaves; the deleted nodes leave ghosts
+                        Data::NodeId node = rng() % nodes.GetCapacity();
+                        if (nodes.IsLive(node) && node != document.GetRoot() && node != selected) {
+                            animator.AddExit(node);
+                            history.DeleteSubtree(node);
+                            animator.BeginTransition();
+                            layout.Update();
+                            animator.EndTransition();
+                        }
+                    }
+                    if (frame % 4 == 0) hovered = rng() % nodes.GetCapacity();
+                    start = Clock::now();
+                    animator.SetFocus(nodes.IsLive(hovered) ? hovered : Data::InvalidNode, selected);
+                    animator.Update(FrameTime);
+                    samples.push_back(SecondsSince(start));
+                    active += animator.GetActiveCount();
+                }
+
+                // Once settled, every node must rest at its target with no offset left
+                while (animator.GetActiveCount() > 0) animator.Update(1.0f);
+                uint32_t unsettled = 0;
+                for (Data::NodeId id = 0; id < nodes.GetCapacity(); ++id) {
+                    if (!nodes.IsLive(id)) continue;
+                    float x = nodes.GetX(id), y = nodes.GetY(id);
+                    animator.GetDrawnPosition(id, x, y);
+                    float rest = id == hovered ? Editor::Animator::HoverScale : id == selected ? Editor::Animator::SelectedScale : 1.0f;
+                    unsettled += nodes.GetScale(id) != rest || x != nodes.GetX(id) || y != nodes.GetY(id);
+                }
+                std::printf("%8u nodes: whole column %.1f us per frame | pop-in of every node %.1f us | %u frames: p50 %.1f us, p99 %.1f us, "
+                            "%.1f animations per frame | %u nodes unsettled\n", size, Percentile(fullSamples, 0.5) * 1e6, popSeconds * 1e6,
+                            FrameCount, Percentile(samples, 0.5) * 1e6, Percentile(samples, 0.99) * 1e6, double(active) / FrameCount, unsettled);
+                ok = ok && unsettled == 0;
+            }
+            return ok ? 0 : 1;
+        }
+
+        /// Live nodes whose child links and parent/slot links disagree, plus live nodes the root does not reach
+        uint32_t CountBrokenLinks(const Data::Document& document) {
+            const Data::NodeStore& nodes = document.GetNodes();
+            uint32_t broken = 0, reached = 0;
+            Data::PreOrder(nodes, document.GetRoot(), [&](Data::NodeId node, uint32_t) {
+                ++reached;
+                for (uint32_t slot = 0; slot < nodes.GetChildCount(node); ++slot) {
+                    Data::NodeId child = nodes.GetChild(node, slot);
+                    broken += !nodes.IsLive(child) || nodes.GetParent(child) != node || nodes.GetSlot(child) != slot;
+                }
+            });
+            return broken + (nodes.GetLiveCount() - reached);
+        }
+
+        int RunDelete(uint32_t nodeCount) {
+            constexpr uint32_t DeleteCount = 10000;
+            constexpr double TotalBudget = 1.0;        // Seconds for every deletion together
+            constexpr double PerDeleteBudget = 0.05;   // Seconds for any one deletion, subtree freeing included
+
+            Data::Document document;
+            GenerateTree(document, nodeCount);
+            Data::NodeStore& nodes = document.GetNodes();
+
+            // Random non-root nodes; most are near the leaves, a few take large subtrees with them
+            std::mt19937 rng(7);
+            std::vector<double> samples;
+            samples.reserve(DeleteCount);
+            uint64_t freed = 0;
+            uint32_t wrongCounts = 0;
+            double total = 0.0;
+            while (samples.size() < DeleteCount && nodes.GetLiveCount() > 1) {
+                Data::NodeId node = rng() % nodes.GetCapacity();
+                if (!nodes.IsLive(node) || node == document.GetRoot()) continue;
+                uint32_t size = 0;
+                Data::PreOrder(nodes, node, [&](Data::NodeId, uint32_t) { ++size; });
+                uint32_t before = nodes.GetLiveCount();
+
+                Clock::time_point start = Clock::now();
+                document.DeleteSubtree(node);
+                samples.push_back(SecondsSince(start));
+                total += samples.back();
+                freed += size;
+                wrongCounts += nodes.GetLiveCount() != before - size;
+            }
+            double worst = *std::max_element(samples.begin(), samples.end());
+            double p50 = Percentile(samples, 0.5), p99 = Percentile(samples, 0.99);
+            uint32_t broken = CountBrokenLinks(document);
+
+            std::printf("%u nodes: %zu deletions freed %llu nodes in %.3f s (budget %.3f s) | p50 %.2f us, p99 %.2f us, worst %.3f ms (budget %.0f ms) | "
+                        "%u live nodes, %u wrong live counts, %u broken links\n", nodeCount, samples.size(), static_cast<unsigned long long>(freed),
+                        total, TotalBudget, p50 * 1e6, p99 * 1e6, worst * 1e3, PerDeleteBudget * 1e3, nodes.GetLiveCount(), wrongCounts, broken);
+            bool ok = wrongCounts == 0 && broken == 0;
+            if (total > TotalBudget) std::printf("Over the total time budget\n");
+            if (worst > PerDeleteBudget) std::printf("Over the per-deletion time budget\n");
+            return ok && total <= TotalBudget && worst <= PerDeleteBudget ? 0 : 1;
+        }
+
+        /// The plain recursive walks the traversal templates replaced, kept as a reference
+        void RecursivePreOrder(const Data::NodeStore& nodes, Data::NodeId node, uint32_t depth, std::vector<std::pair<Data::NodeId, uint32_t>>& order) {
+            order.push_back({ node, depth });
+            for (uint32_t i = 0; i < nodes.GetChildCount(node); ++i) RecursivePreOrder(nodes, nodes.GetChild(node, i), depth + 1, order);
+        }
+
+        void RecursivePostOrder(const Data::NodeStore& nodes, Data::NodeId node, uint32_t depth, std::vector<std::pair<Data::NodeId, uint32_t>>& order) {
+            for (uint32_t i = 0; i < nodes.GetChildCount(node); ++i) RecursivePostOrder(nodes, nodes.GetChild(node, i), depth + 1, order);
+            order.push_back({ node, depth });
+        }
+
+        bool RecursiveFind(const Data::NodeStore& nodes, Data::NodeId node, Data::NodeId target, Data::NodeId& found) {
+            if (node == target) {
+                found = node;
+                return true;
+            }
+            for (uint32_t i = 0; i < nodes.GetChildCount(node); ++i) {
+                if (RecursiveFind(nodes, nodes.GetChild(node, i), target, found)) return true;
+            }
+            return false;
+        }
+
+        /// Time a walk 'Repeats' times and keep the fastest
+        template<typename Walk>
+        double TimeWalk(Walk&& walk) {
+            constexpr int Repeats = 5;
+            double best = std::numeric_limits<double>::max();
+            for (int i = 0; i < Repeats; ++i) {
+                Clock::time_point start = Clock::now();
+                walk();
+                best = std::min(best, SecondsSince(start));
+            }
+            return best;
+        }
+
+        int RunTraverse(uint32_t nodeCount) {
+            using Order = std::vector<std::pair<Data::NodeId, uint32_t>>;
+            bool ok = true;
+
+            // Wide: each template against its recursive reference, in time and in visiting order
+            Data::Document wide;
+            GenerateTree(wide, nodeCount);
+            const Data::NodeStore& nodes = wide.GetNodes();
+            Data::NodeId root = wide.GetRoot();
+            Order reference, walked;
+            reference.reserve(nodes.GetLiveCount());
+            walked.reserve(nodes.GetLiveCount());
+            auto record = [&](Data::NodeId node, uint32_t depth) { walked.push_back({ node, depth }); };
+            auto report = [&](const char* name, double recursive, double iterative, bool same, const char* compared = "order") {
+                std::printf("wide %8u nodes | %-13s recursive %7.2f ms, template %7.2f ms (%.2fx) | %s %s\n", nodes.GetLiveCount(), name,
+                            recursive * 1e3, iterative * 1e3, recursive / iterative, same ? "same" : "DIFFERENT", compared);
+                ok = ok && same;
+            };
+
+            double recursive = TimeWalk([&] { reference.clear(); RecursivePreOrder(nodes, root, 0, reference); });
+            double iterative = TimeWalk([&] { walked.clear(); Data::PreOrder(nodes, root, record); });
+            report("pre-order", recursive, iterative, walked == reference);
+
+            recursive = TimeWalk([&] { reference.clear(); RecursivePostOrder(nodes, root, 0, reference); });
+            iterative = TimeWalk([&] { walked.clear(); Data::PostOrder(nodes, root, record); });
+            report("post-order", recursive, iterative, walked == reference);
+
+            // Level order is pre-order stably sorted by depth (the sort is timed with the recursion)
+            recursive = TimeWalk([&] {
+                reference.clear();
+                RecursivePreOrder(nodes, root, 0, reference);
+                std::stable_sort(reference.begin(), reference.end(), [](const auto& a, const auto& b) { return a.second < b.second; });
+            });
+            iterative = TimeWalk([&] { walked.clear(); Data::BreadthFirst(nodes, root, record); });
+            report("breadth-first", recursive, iterative, walked == reference);
+
+            // Search for the last node in pre-order, so that both searches walk the whole tree
+            reference.clear();
+            RecursivePreOrder(nodes, root, 0, reference);
+            Data::NodeId target = reference.back().first;
+            Data::NodeId foundRecursive = Data::InvalidNode, foundIterative = Data::InvalidNode;
+            recursive = TimeWalk([&] { RecursiveFind(nodes, root, target, foundRecursive); });
+            iterative = TimeWalk([&] {
+                foundIterative = Data::FindFirst(Data::StoreAccess{ nodes }, root, [&](Data::NodeId node) { return node == target; }, Data::InvalidNode);
+            });
+            report("find-first", recursive, iterative, foundRecursive == target && foundIterative == target, "node");
+
+            // Deep: a single chain far deeper than the call stack allows recursing; only the templates run
+            constexpr uint32_t ChainDepth = 100000;
+            Data::Document deep;
+            Data::NodeStore& chain = deep.GetNodes();
+            Data::NodeId at = deep.CreateNode("Start", Data::NodeType::Start);
+            deep.SetRoot(at);
+            for (uint32_t depth = 1; depth < ChainDepth; ++depth) {
+                Data::NodeId next = chain.Create("Go", Data::NodeType::Action);
+                chain.AddChild(at, next, "Yes");
+                at = next;
+            }
+            Data::NodeId bottom = at;
+            uint32_t deepest = 0, visited = 0;
+            auto measure = [&](Data::NodeId, uint32_t depth) {
+                deepest = std::max(deepest, depth);
+                ++visited;
+            };
+            auto check = [&](const char* name, double seconds, bool found) {
+                bool complete = visited == ChainDepth && deepest == ChainDepth - 1 && found;
+                std::printf("deep %8u levels | %-13s template %7.2f ms | %u nodes visited, deepest level %u%s\n", ChainDepth, name, seconds * 1e3, visited,
+                            deepest, complete ? "" : " | INCOMPLETE");
+                ok = ok && complete;
+                visited = deepest = 0;
+            };
+            Data::NodeId deepRoot = deep.GetRoot();
+            Clock::time_point start = Clock::now();
+            Data::PreOrder(chain, deepRoot, measure);
+            check("pre-order", SecondsSince(start), true);
+            start = Clock::now();
+            Data::PostOrder(chain, deepRoot, measure);
+            check("post-order", SecondsSince(start), true);
+            start = Clock::now();
+            Data::BreadthFirst(chain, deepRoot, measure);
+            check("breadth-first", SecondsSince(start), true);
+            start = Clock::now();
+            Data::NodeId found = Data::FindFirst(Data::StoreAccess{ chain }, deepRoot, [&](Data::NodeId node) {
+                // In a chain, the n-th node visited is at depth n
+                measure(node, visited);
+                return node == bottom;
+            }, Data::InvalidNode);
+            check("find-first", SecondsSince(start), found == bottom);
+            return ok ? 0 : 1;
+        }
+
+        /// Bytes of a std::string holding 'text': the object itself plus its heap buffer, if any
+        uint64_t StringBytes(const std::string& text) {
+            return sizeof(std::string) + (text.capacity() > std::string().capacity() ? text.capacity() + 1 : 0);
+        }
+
+        int RunLabels(uint32_t nodeCount) {
+            Data::Document document;
+            GenerateTree(document, nodeCount);
+            const Data::NodeStore& nodes = document.GetNodes();
+            const Data::StringTable& strings = nodes.GetStrings();
+
+            // The same labels held the way they were before interning: one std::string per node and per edge
+            std::vector<std::string> nodeLabels, edgeLabels;
+            nodeLabels.reserve(nodes.GetLiveCount());
+            edgeLabels.reserve(nodes.GetLiveCount());
+            Data::PreOrder(nodes, document.GetRoot(), [&](Data::NodeId node, uint32_t) {
+                nodeLabels.emplace_back(nodes.GetLabel(node));
+                for (uint32_t i = 0; i < nodes.GetChildCount(node); ++i) edgeLabels.emplace_back(nodes.GetEdgeLabel(node, i));
+            });
+            uint64_t stringBytes = 0;
+            for (const std::string& label : nodeLabels) stringBytes += StringBytes(label);
+            for (const std::string& label : edgeLabels) stringBytes += StringBytes(label);
+
+            // Interned: one id per node and per edge, plus the table behind them
+            uint64_t idBytes = (nodeLabels.size() + edgeLabels.size()) * sizeof(Data::StringId);
+            uint64_t internedBytes = idBytes + strings.GetMemoryFootprint();
+            uint64_t storeBytes = nodes.GetMemoryFootprint();
+            std::printf("%u nodes, %zu edges, %zu distinct labels\n", nodes.GetLiveCount(), edgeLabels.size(), strings.GetUniqueCount());
+            std::printf("labels as std::string: %8.1f MB (%zu bytes per string object)\n", Megabytes(stringBytes), sizeof(std::string));
+            std::printf("labels interned:       %8.1f MB (%.1f MB of ids, %.1f MB string table) | %.1fx smaller\n", Megabytes(internedBytes),
+                        Megabytes(idBytes), Megabytes(strings.GetMemoryFootprint()), double(stringBytes) / double(internedBytes));
+            std::printf("node store:            %8.1f MB interned (GetMemoryFootprint), %.1f MB with std::string labels\n", Megabytes(storeBytes),
+                        Megabytes(storeBytes - internedBytes + stringBytes));
+            return 0;
+        }
+    }
+
+    int Run(int argc, char* argv[]) {
+        if (argc < 3 || std::strcmp(argv[1], "--bench") != 0) return -1;
+
+        const char* name = argv[2];
+        uint32_t nodeCount = argc > 3 ? static_cast<uint32_t>(std::strtoul(argv[3], nullptr, 10)) : 2000000;
+        if (nodeCount == 0) nodeCount = 1;
+
+        if (std::strcmp(name, "json") == 0) return RunJson(nodeCount);
+        if (std::strcmp(name, "binary") == 0) return RunBinary(nodeCount);
+        if (std::strcmp(name, "journal") == 0) return RunJournal(nodeCount);
+        if (std::strcmp(name, "lazy") == 0) return RunLazy(nodeCount);
+        if (std::strcmp(name, "async") == 0) return RunAsync(nodeCount);
+        if (std::strcmp(name, "csv") == 0) return RunCsv(nodeCount);
+        if (std::strcmp(name, "eval") == 0) return RunEval(nodeCount);
+        if (std::strcmp(name, "batch") == 0) return RunBatch(nodeCount);
+        if (std::strcmp(name, "codegen") == 0) return RunCodeGen(nodeCount);
+        if (std::strcmp(name, "score") == 0) return RunScore(nodeCount);
+        if (std::strcmp(name, "heatmap") == 0) return RunHeatmap(nodeCount);
+        if (std::strcmp(name, "expr") == 0) return RunExpressions(nodeCount);
+        if (std::strcmp(name, "validate") == 0) return RunValidate(nodeCount);
+        if (std::strcmp(name, "share") == 0) return RunShare(nodeCount);
+        if (std::strcmp(name, "layout") == 0) return RunLayout(nodeCount);
+        if (std::strcmp(name, "relayout") == 0) return RunRelayout(nodeCount);
+        if (std::strcmp(name, "parlayout") == 0) return RunParallelLayout(nodeCount);
+        if (std::strcmp(name, "animate") == 0) return RunAnimate(nodeCount);
+        if (std::strcmp(name, "delete") == 0) return RunDelete(nodeCount);
+        if (std::strcmp(name, "traverse") == 0) return RunTraverse(nodeCount);
+        if (std::strcmp(name, "labels") == 0) return RunLabels(argc > 3 ? nodeCount : 500000);
+
+        std::fprintf(stderr, "Unknown benchmark '%s'. Available: json, binary, journal, lazy, async, csv, eval, batch, codegen, score, heatmap, expr, validate, share, layout, relayout, parlayout, animate, delete, traverse, labels\n", name);
+        return 1;
+    }
+
+    void GenerateTree(Data::Document& document, uint32_t nodeCount, uint32_t seed) {
+        document.Clear();
+        Data::NodeStore& nodes = document.GetNodes();
+        nodes.Reserve(nodeCount);
+        std::mt19937 rng(seed);
+        char label[64];
+
+        auto makeNode = [&](Data::NodeType type, uint32_t depth) {
+            if (type == Data::NodeType::Condition) {
+                std::snprintf(label, sizeof(label), "feature_%u < %.2f", unsigned(rng() % 64), double(rng() % 100) / 100.0);
+            } else {
+                std::snprintf(label, sizeof(label), "Action %u", unsigned(rng() % 100));
+            }
+            Data::NodeId id = nodes.Create(label, type);
+            nodes.SetPosition(id, float(rng() % 4000), float(depth) * 150.0f);
+            return id;
+        };
+
+        // Grow a binary tree by splitting randomly chosen open conditions
+        struct Open {
+            Data::NodeId Node;
+            uint32_t Depth;
+        };
+        std::vector<Open> open;
+        Data::NodeId root = makeNode(Data::NodeType::Condition, 0);
+        document.SetRoot(root);
+        open.push_back({ root, 0 });
+        uint32_t count = 1;
+
+        while (count < nodeCount && !open.empty()) {
+            size_t index = rng() % open.size();
+            Open parent = open[index];
+            open[index] = open.back();
+            open.pop_back();
+
+            const char* edges[2] = { "Yes", "No" };
+            for (const char* edge : edges) {
+                if (count >= nodeCount) break;
+                bool split = open.empty() || (rng() % 3 != 0 && count + open.size() * 2 < nodeCount);
+                Data::NodeType type = split ? Data::NodeType::Condition : Data::NodeType::Action;
+                Data::NodeId child = makeNode(type, parent.Depth + 1);
+                nodes.AddChild(parent.Node, child, edge);
+                ++count;
+                if (split) open.push_back({ child, parent.Depth + 1 });
+            }
+        }
+    }
+
+    void GenerateDeepTree(Data::Document& document, uint32_t depth, uint32_t featureCount, uint32_t seed) {
+        document.Clear();
+        Data::NodeStore& nodes = document.GetNodes();
+        std::mt19937 rng(seed);
+        char label[64];
+
+        // Complete down to FullLevels, then every test continues with high probability
+        // and otherwise exits to a leaf, so most records travel close to 'depth'
+        constexpr uint32_t FullLevels = 12;
+        auto makeNode = [&](uint32_t level, bool leaf) {
+            if (leaf) {
+                std::snprintf(label, sizeof(label), "Action %u", unsigned(rng() % 100));
+                return nodes.Create(label, Data::NodeType::Action);
+            }
+            float threshold = level < FullLevels ? 0.3f + float(rng() % 41) / 100.0f : 0.95f;
+            std::snprintf(label, sizeof(label), "feature_%u < %.2f", unsigned(rng() % featureCount), threshold);
+            return nodes.Create(label, Data::NodeType::Condition);
+        };
+
+        struct Open {
+            Data::NodeId Node;
+            uint32_t Level;
+        };
+        std::vector<Open> open;
+        Data::NodeId root = makeNode(0, depth == 0);
+        document.SetRoot(root);
+        if (depth > 0) open.push_back({ root, 0 });
+        while (!open.empty()) {
+            Open parent = open.back();
+            open.pop_back();
+            uint32_t level = parent.Level + 1;
+            Data::NodeId yes = makeNode(level, level == depth);
+            Data::NodeId no = makeNode(level, level == depth || parent.Level >= FullLevels);
+            nodes.AddChild(parent.Node, yes, "Yes");
+            nodes.AddChild(parent.Node, no, "No");
+            if (nodes.GetType(yes) == Data::NodeType::Condition) open.push_back({ yes, level });
+            if (nodes.GetType(no) == Data::NodeType::Condition) open.push_back({ no, level });
+        }
+    }
+
+}
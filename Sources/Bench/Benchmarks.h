@@ -0,0 +1,49 @@
+/**
+ * Benchmarks.h
+ * Headless performance benchmarks
+ *
+ * Benchmarks run from the command line before any window is created:
+ *   RihenNatural --bench <name> [node count]
+ * Each one generates a reproducible synthetic tree, times the operation
+ * under test and prints throughput figures to stdout. The csv benchmark
+ * takes a rule count instead and generates a rule table; the batch
+ * benchmark takes a record count and runs trees of fixed depth. The
+ * codegen benchmark also takes a record count; it builds generated
+ * headers with the compiler named by $CXX (default c++) and is skipped
+ * when none is found.
+ */
+
+#pragma once
+
+#include "../Data/Document.h"
+#include <cstdint>
+
+namespace Bench {
+
+    /**
+     * @brief Run the benchmark requested on the command line, if any
+     * @return Process exit code, or -1 if the arguments do not request a benchmark
+     */
+    int Run(int argc, char* argv[]);
+
+    /**
+     * @brief Fill a document with a reproducible binary decision tree
+     * @param document Document to fill (cleared first)
+     * @param nodeCount Number of nodes to create
+     * @param seed Random seed; equal seeds give identical trees
+     */
+    void GenerateTree(Data::Document& document, uint32_t nodeCount, uint32_t seed = 1);
+
+    /**
+     * @brief Fill a document with a reproducible binary tree of a given depth
+     * @param document Document to fill (cleared first)
+     * @param depth Length of the longest root-to-leaf path
+     * @param featureCount Conditions test features "feature_0" to "feature_<featureCount - 1>"
+     * @param seed Random seed; equal seeds give identical trees
+     *
+     * The first 12 levels are complete; below them every test continues with
+     * probability 0.95 on uniform [0, 1) features, so most paths are long.
+     */
+    void GenerateDeepTree(Data::Document& document, uint32_t depth, uint32_t featureCount, uint32_t seed = 1);
+
+}
@@ -0,0 +1,103 @@
+/**
+ * ThreadPool.cpp
+ * Implementation of the work-stealing pool
+ */
+
+#include "ThreadPool.h"
+
+namespace Core {
+
+    namespace {
+        // Lets Submit() find the queue of the worker it is called from
+        thread_local const ThreadPool* CurrentPool = nullptr;
+        thread_local uint32_t CurrentWorker = 0;
+    }
+
+    ThreadPool::ThreadPool(uint32_t threadCount)
+        : m_NextWorker(0), m_Queued(0), m_Unfinished(0), m_Stop(false) {
+        if (threadCount == 0) threadCount = GetHardwareThreads();
+        for (uint32_t i = 0; i < threadCount; ++i) m_Workers.push_back(std::make_unique<Worker>());
+        for (uint32_t i = 0; i < threadCount; ++i) m_Threads.emplace_back(&ThreadPool::Run, this, i);
+    }
+
+    ThreadPool::~ThreadPool() {
+        Wait();
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Stop = true;
+        }
+        m_WorkReady.notify_all();
+        for (std::thread& thread : m_Threads) thread.join();
+    }
+
+    void ThreadPool::Submit(Task task) {
+        uint32_t index = CurrentPool == this ? CurrentWorker
+                                             : m_NextWorker.fetch_add(1, std::memory_order_relaxed) % GetThreadCount();
+        m_Unfinished.fetch_add(1, std::memory_order_acq_rel);
+        {
+            std::lock_guard<std::mutex> lock(m_Workers[index]->Mutex);
+            m_Workers[index]->Tasks.push_back(std::move(task));
+        }
+        {
+            // Counted under the sleep mutex so a worker about to sleep cannot miss it
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Queued.fetch_add(1, std::memory_order_acq_rel);
+        }
+        m_WorkReady.notify_one();
+    }
+
+    void ThreadPool::Wait() {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        m_AllDone.wait(lock, [this]() { return m_Unfinished.load(std::memory_order_acquire) == 0; });
+    }
+
+    uint32_t ThreadPool::GetHardwareThreads() {
+        unsigned count = std::thread::hardware_concurrency();
+        return count > 0 ? count : 1;
+    }
+
+    void ThreadPool::Run(uint32_t index) {
+        CurrentPool = this;
+        CurrentWorker = index;
+        while (true) {
+            if (TryRunOne(index)) continue;
+
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            // m_Queued lags the queues while a Submit() is under way; a wrong guess only costs a retry
+            m_WorkReady.wait(lock, [this]() { return m_Queued.load(std::memory_order_acquire) > 0 || m_Stop; });
+            if (m_Stop && m_Queued.load(std::memory_order_acquire) == 0) return;
+        }
+    }
+
+    bool ThreadPool::TryRunOne(uint32_t index) {
+        Task task;
+        {
+            // Own queue newest first
+            Worker& own = *m_Workers[index];
+            std::lock_guard<std::mutex> lock(own.Mutex);
+            if (!own.Tasks.empty()) {
+                task = std::move(own.Tasks.back());
+                own.Tasks.pop_back();
+            }
+        }
+        for (uint32_t offset = 1; !task && offset < GetThreadCount(); ++offset) {
+            // Steal oldest first
+            Worker& victim = *m_Workers[(index + offset) % GetThreadCount()];
+            std::lock_guard<std::mutex> lock(victim.Mutex);
+            if (!victim.Tasks.empty()) {
+                task = std::move(victim.Tasks.front());
+                victim.Tasks.pop_front();
+            }
+        }
+        if (!task) return false;
+
+        m_Queued.fetch_sub(1, std::memory_order_acq_rel);
+        task();
+        if (m_Unfinished.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_AllDone.notify_all();
+        }
+        return true;
+    }
+
+}
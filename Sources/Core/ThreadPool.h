@@ -0,0 +1,84 @@
+/**
+ * ThreadPool.h
+ * Work-stealing pool of worker threads
+ *
+ * Every worker owns a queue. Tasks submitted from a worker go to the back
+ * of its own queue and it runs them newest first, which keeps the data of a
+ * task that split itself up in that worker's cache. A worker whose queue is
+ * empty steals the oldest task of another, normally the largest piece of
+ * work left. Tasks submitted from other threads are dealt out round-robin.
+ * Idle workers sleep until new work arrives.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Core {
+
+    /**
+     * @class ThreadPool
+     * @brief Fixed set of workers running submitted tasks
+     *
+     * Submit() may be called from any thread, including from inside a task.
+     * Destroying the pool runs every task already submitted, then joins.
+     */
+    class ThreadPool {
+    public:
+        using Task = std::function<void()>;
+
+        /**
+         * @param threadCount Workers to start; 0 starts one per hardware thread
+         */
+        explicit ThreadPool(uint32_t threadCount = 0);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        void Submit(Task task);
+
+        /**
+         * @brief Block until every task submitted so far, and the tasks they submitted, has run
+         *
+         * Must not be called from a task.
+         */
+        void Wait();
+
+        uint32_t GetThreadCount() const { return static_cast<uint32_t>(m_Workers.size()); }
+
+        /**
+         * @brief Hardware threads of this machine (at least 1)
+         */
+        static uint32_t GetHardwareThreads();
+
+    private:
+        struct Worker {
+            std::mutex Mutex;
+            std::deque<Task> Tasks;
+        };
+
+        void Run(uint32_t index);
+        bool TryRunOne(uint32_t index);
+
+        std::vector<std::unique_ptr<Worker>> m_Workers;   ///< Complete before any thread starts
+        std::vector<std::thread> m_Threads;
+        std::atomic<uint32_t> m_NextWorker;   ///< Round-robin queue for outside submissions
+
+        std::mutex m_Mutex;                   ///< Guards sleeping, waking and m_Stop
+        std::condition_variable m_WorkReady;
+        std::condition_variable m_AllDone;
+        std::atomic<uint64_t> m_Queued;       ///< Tasks in any queue
+        std::atomic<uint64_t> m_Unfinished;   ///< Tasks submitted and not yet finished
+        bool m_Stop;
+    };
+
+}
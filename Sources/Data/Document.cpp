@@ -0,0 +1,61 @@
+/**
+ * Document.cpp
+ * Implementation of the Document class
+ */
+
+#include "Document.h"
+#include "Traversal.h"
+
+namespace Data {
+
+    Document::Document() : m_Root(InvalidNode), m_Snapshots(m_Nodes) {
+        m_Nodes.AddObserver(&m_Snapshots);
+    }
+
+    Document::~Document() {
+        // Node store releases its columns when it goes out of scope
+        m_Nodes.RemoveObserver(&m_Snapshots);
+    }
+
+    NodeId Document::CreateNode(const std::string& label, NodeType type) {
+        return m_Nodes.Create(label, type);
+    }
+
+    bool Document::DeleteSubtree(NodeId node) {
+        if (!m_Nodes.IsAlive(node)) return false;
+        m_Nodes.Detach(node);
+        if (node == m_Root) m_Root = InvalidNode;
+
+        // Children-first walk so each node is freed after its descendants
+        PostOrder(m_Nodes, node, [&](NodeId id, uint32_t) { m_Nodes.Destroy(id); });
+        return true;
+    }
+
+    void Document::MoveSubtree(NodeId node, float dx, float dy) {
+        m_Nodes.TranslateSubtree(node, dx, dy);
+    }
+
+    uint32_t Document::StashSubtree(NodeId node) {
+        if (!m_Nodes.IsLive(node)) return 0;
+        m_Nodes.Detach(node);
+        if (node == m_Root) m_Root = InvalidNode;
+
+        uint32_t count = 0;
+        PreOrder(m_Nodes, node, [&](NodeId id, uint32_t) {
+            m_Nodes.SetStashed(id, true);
+            ++count;
+        });
+        return count;
+    }
+
+    void Document::RestoreSubtree(NodeId node, NodeId parent, uint32_t slot, StringId edgeLabel) {
+        PreOrder(m_Nodes, node, [&](NodeId id, uint32_t) { m_Nodes.SetStashed(id, false); });
+        m_Nodes.InsertChildWithLabelId(parent, node, slot, edgeLabel);
+    }
+
+    void Document::Clear() {
+        m_Nodes.Clear();
+        m_Root = InvalidNode;
+    }
+
+}
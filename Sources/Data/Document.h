@@ -0,0 +1,105 @@
+/**
+ * Document.h
+ * Decision tree document owning all of its nodes
+ *
+ * A Document holds the root of a decision tree together with the node
+ * store that every node of that tree lives in. Creating and deleting
+ * nodes goes through the document so that node data stays in contiguous
+ * columns and closing a document releases it in one pass.
+ */
+
+#pragma once
+
+#include "NodeStore.h"
+#include "Snapshot.h"
+#include <string>
+
+namespace Data {
+
+    /**
+     * @class Document
+     * @brief Owner of a decision tree and its node storage
+     */
+    class Document {
+    public:
+        Document();
+        ~Document();
+
+        Document(const Document&) = delete;
+        Document& operator=(const Document&) = delete;
+
+        NodeId GetRoot() const { return m_Root; }
+        void SetRoot(NodeId root) { m_Root = root; }
+
+        NodeStore& GetNodes() { return m_Nodes; }
+        const NodeStore& GetNodes() const { return m_Nodes; }
+
+        /**
+         * @brief Allocate a new detached node in this document
+         * @param label Display label for the node
+         * @param type Semantic type of the node
+         * @return Handle to the new node
+         */
+        NodeId CreateNode(const std::string& label, NodeType type = NodeType::Action);
+
+        /**
+         * @brief Detach a node from its parent and free its whole subtree
+         * @param node Node to delete
+         * @return true if the node was alive and deleted
+         *
+         * The parent link makes the detach constant-time; the remaining cost
+         * is proportional to the size of the freed subtree.
+         */
+        bool DeleteSubtree(NodeId node);
+
+        /**
+         * @brief Translate a node and all of its descendants
+         * @param node Root of the subtree to move
+         * @param dx Horizontal offset
+         * @param dy Vertical offset
+         */
+        void MoveSubtree(NodeId node, float dx, float dy);
+
+        /**
+         * @brief Detach a subtree but keep its nodes alive outside the document
+         * @param node Root of the subtree to stash
+         * @return Number of nodes in the stashed subtree
+         *
+         * Stashed nodes keep their ids and data (no copy is made) and are
+         * skipped by every pass over the document. They are brought back by
+         * RestoreSubtree() or released with DeleteSubtree().
+         */
+        uint32_t StashSubtree(NodeId node);
+
+        /**
+         * @brief Re-attach a stashed subtree at a given child slot
+         * @param node Root of the stashed subtree
+         * @param parent Parent to attach to
+         * @param slot Position in the parent's child range
+         * @param edgeLabel Interned label for the restored edge
+         */
+        void RestoreSubtree(NodeId node, NodeId parent, uint32_t slot, StringId edgeLabel);
+
+        /**
+         * @brief Capture the current tree as an immutable, shareable version
+         * @return Snapshot of the tree under the root (empty if there is no root)
+         *
+         * Unchanged subtrees are shared with earlier snapshots. Edits copy their
+         * paths as they are made, so after the first call, which builds the
+         * whole tree, this is O(1). The result can be handed to another thread
+         * and read while editing continues.
+         */
+        Snapshot TakeSnapshot() { return m_Snapshots.Take(m_Root); }
+
+        /**
+         * @brief Free every node and reset the document to an empty tree
+         */
+        void Clear();
+
+    private:
+        NodeStore m_Nodes;   ///< Column storage for every node of the tree
+        NodeId m_Root;       ///< Root node of the tree (can be InvalidNode)
+        SnapshotCache m_Snapshots;   ///< Newest persistent version, updated as the store changes
+    };
+
+}
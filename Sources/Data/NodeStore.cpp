@@ -0,0 +1,331 @@
+/**
+ * NodeStore.cpp
+ * Implementation of the NodeStore class
+ */
+
+#include "NodeStore.h"
+#include <algorithm>
+#include <utility>
+
+namespace Data {
+
+    void NodeObserver::OnSubtreeMoved(const NodeStore& nodes, NodeId root, float dx, float dy) {
+        std::vector<NodeId> stack = { root };
+        while (!stack.empty()) {
+            NodeId id = stack.back();
+            stack.pop_back();
+            OnNodeMoved(id, nodes.GetX(id) - dx, nodes.GetY(id) - dy);
+            const NodeId* children = nodes.GetChildren(id);
+            stack.insert(stack.end(), children, children + nodes.GetChildCount(id));
+        }
+    }
+
+    NodeStore::NodeStore() : m_ChildGarbage(0), m_LiveCount(0) {
+    }
+
+    NodeId NodeStore::Create(std::string_view label, NodeType type) {
+        // Ids taken by CreateWithId() stay in the free list; drop them lazily
+        while (!m_FreeIds.empty() && m_State[m_FreeIds.back()] != NodeFree) m_FreeIds.pop_back();
+
+        NodeId id;
+        if (!m_FreeIds.empty()) {
+            id = m_FreeIds.back();
+            m_FreeIds.pop_back();
+        } else {
+            id = static_cast<NodeId>(m_State.size());
+            AppendSlot();
+        }
+        InitNode(id, label, type);
+        return id;
+    }
+
+    NodeId NodeStore::CreateWithId(NodeId id, std::string_view label, NodeType type) {
+        if (id == InvalidNode) return InvalidNode;
+        if (id < m_State.size()) {
+            if (m_State[id] != NodeFree) return InvalidNode;
+        } else {
+            // Slots skipped over become free ids for later creations
+            while (m_State.size() < id) {
+                m_FreeIds.push_back(static_cast<NodeId>(m_State.size()));
+                AppendSlot();
+            }
+            AppendSlot();
+        }
+        InitNode(id, label, type);
+        return id;
+    }
+
+    void NodeStore::AppendSlot() {
+        m_X.push_back(0); m_Y.push_back(0);
+        m_Scale.push_back(0); m_TargetScale.push_back(0);
+        m_Color.push_back({ 0, 0, 0 });
+        m_Type.push_back(NodeType::Action);
+        m_Shape.push_back(ShapeType::Rectangle);
+        m_State.push_back(NodeFree);
+        m_Labels.push_back(EmptyString);
+        m_Parent.push_back(InvalidNode);
+        m_Slot.push_back(0);
+        m_FirstChild.push_back(0);
+        m_ChildCount.push_back(0);
+        m_ChildCapacity.push_back(0);
+    }
+
+    void NodeStore::InitNode(NodeId id, std::string_view label, NodeType type) {
+        Color color;
+        GetDefaultStyle(type, m_Shape[id], color.R, color.G, color.B);
+        m_Color[id] = color;
+        m_Type[id] = type;
+        m_Labels[id] = m_Strings.Intern(label);
+        m_Parent[id] = InvalidNode;
+        m_Slot[id] = 0;
+        m_X[id] = 0; m_Y[id] = 0;
+        m_Scale[id] = 0.0f;          // Pop-in animation starts from zero
+        m_TargetScale[id] = 1.0f;
+        m_FirstChild[id] = 0;
+        m_ChildCount[id] = 0;
+        m_ChildCapacity[id] = 0;
+        m_State[id] = NodeLive;
+        ++m_LiveCount;
+        NotifyChanged(id);
+    }
+
+    void NodeStore::Destroy(NodeId id) {
+        if (!IsAlive(id)) return;
+
+        // Drop the references held by this node's label and child edge labels
+        uint32_t first = m_FirstChild[id];
+        for (uint32_t i = 0; i < m_ChildCount[id]; ++i) {
+            m_Strings.Release(m_EdgeLabels[first + i]);
+            m_EdgeLabels[first + i] = EmptyString;
+        }
+        m_Strings.Release(m_Labels[id]);
+        m_Labels[id] = EmptyString;
+
+        m_ChildGarbage += m_ChildCapacity[id];
+        m_ChildCount[id] = 0;
+        m_ChildCapacity[id] = 0;
+        m_Parent[id] = InvalidNode;
+        m_State[id] = NodeFree;
+        m_FreeIds.push_back(id);
+        --m_LiveCount;
+        for (NodeObserver* observer : m_Observers) observer->OnNodeDestroyed(id);
+    }
+
+    void NodeStore::AddChild(NodeId parent, NodeId child, std::string_view edgeLabel) {
+        PlaceChild(parent, child, m_ChildCount[parent], m_Strings.Intern(edgeLabel));
+    }
+
+    void NodeStore::InsertChild(NodeId parent, NodeId child, uint32_t slot, std::string_view edgeLabel) {
+        PlaceChild(parent, child, slot, m_Strings.Intern(edgeLabel));
+    }
+
+    void NodeStore::InsertChildWithLabelId(NodeId parent, NodeId child, uint32_t slot, StringId edgeLabel) {
+        m_Strings.Retain(edgeLabel);
+        PlaceChild(parent, child, slot, edgeLabel);
+    }
+
+    void NodeStore::PlaceChild(NodeId parent, NodeId child, uint32_t slot, StringId edgeLabel) {
+        uint32_t count = m_ChildCount[parent];
+        if (slot > count) slot = count;
+        if (count == m_ChildCapacity[parent]) GrowChildRange(parent, count ? count * 2 : 2);
+
+        // Shift later siblings up by one, keeping their slot indices in sync
+        uint32_t first = m_FirstChild[parent];
+        for (uint32_t i = count; i > slot; --i) {
+            m_Children[first + i] = m_Children[first + i - 1];
+            m_EdgeLabels[first + i] = m_EdgeLabels[first + i - 1];
+            m_Slot[m_Children[first + i]] = i;
+        }
+        m_Children[first + slot] = child;
+        m_EdgeLabels[first + slot] = edgeLabel;
+        m_Parent[child] = parent;
+        m_Slot[child] = slot;
+        ++m_ChildCount[parent];
+        NotifyChanged(parent);
+    }
+
+    bool NodeStore::Detach(NodeId id) {
+        NodeId parent = m_Parent[id];
+        if (parent == InvalidNode) return false;
+        RemoveSlot(parent, m_Slot[id]);
+        m_Parent[id] = InvalidNode;
+        m_Slot[id] = 0;
+        return true;
+    }
+
+    void NodeStore::Reparent(NodeId id, NodeId newParent, uint32_t slot) {
+        StringId edgeLabel = EmptyString;
+        if (m_Parent[id] != InvalidNode) {
+            // Keep the edge label alive across the detach
+            edgeLabel = m_EdgeLabels[m_FirstChild[m_Parent[id]] + m_Slot[id]];
+            m_Strings.Retain(edgeLabel);
+            Detach(id);
+        }
+        PlaceChild(newParent, id, slot, edgeLabel);
+    }
+
+    void NodeStore::SetLabel(NodeId id, std::string_view label) {
+        // Copy-on-edit: intern the new text first, then drop the old reference
+        StringId newLabel = m_Strings.Intern(label);
+        m_Strings.Release(m_Labels[id]);
+        m_Labels[id] = newLabel;
+        NotifyChanged(id);
+    }
+
+    void NodeStore::SetLabelId(NodeId id, StringId label) {
+        m_Strings.Retain(label);
+        m_Strings.Release(m_Labels[id]);
+        m_Labels[id] = label;
+        NotifyChanged(id);
+    }
+
+    void NodeStore::SetEdgeLabel(NodeId id, uint32_t slot, std::string_view label) {
+        StringId& edgeLabel = m_EdgeLabels[m_FirstChild[id] + slot];
+        StringId newLabel = m_Strings.Intern(label);
+        m_Strings.Release(edgeLabel);
+        edgeLabel = newLabel;
+        NotifyChanged(id);
+    }
+
+    void NodeStore::TranslateSubtree(NodeId root, float dx, float dy) {
+        if (!IsAlive(root)) return;
+        std::vector<NodeId> stack = { root };
+        while (!stack.empty()) {
+            NodeId id = stack.back();
+            stack.pop_back();
+            m_X[id] += dx;
+            m_Y[id] += dy;
+            const NodeId* children = GetChildren(id);
+            stack.insert(stack.end(), children, children + m_ChildCount[id]);
+        }
+        for (NodeObserver* observer : m_Observers) observer->OnSubtreeMoved(*this, root, dx, dy);
+    }
+
+    bool NodeStore::SwapSiblings(NodeId a, NodeId b) {
+        NodeId parent = m_Parent[a];
+        if (parent == InvalidNode || parent != m_Parent[b]) return false;
+
+        size_t first = m_FirstChild[parent];
+        uint32_t slotA = m_Slot[a];
+        uint32_t slotB = m_Slot[b];
+        std::swap(m_Children[first + slotA], m_Children[first + slotB]);
+        std::swap(m_EdgeLabels[first + slotA], m_EdgeLabels[first + slotB]);
+        m_Slot[a] = slotB;
+        m_Slot[b] = slotA;
+        NotifyChanged(parent);
+        return true;
+    }
+
+    void NodeStore::RemoveSlot(NodeId parent, uint32_t slot) {
+        uint32_t first = m_FirstChild[parent];
+        uint32_t count = m_ChildCount[parent];
+
+        // Shift the remaining siblings down to keep edge order intact
+        m_Strings.Release(m_EdgeLabels[first + slot]);
+        for (uint32_t j = slot + 1; j < count; ++j) {
+            m_Children[first + j - 1] = m_Children[first + j];
+            m_EdgeLabels[first + j - 1] = m_EdgeLabels[first + j];
+            m_Slot[m_Children[first + j - 1]] = j - 1;
+        }
+        m_EdgeLabels[first + count - 1] = EmptyString;
+        --m_ChildCount[parent];
+        NotifyChanged(parent);
+    }
+
+    void NodeStore::Clear() {
+        m_X.clear(); m_Y.clear();
+        m_Scale.clear(); m_TargetScale.clear();
+        m_Color.clear(); m_Type.clear(); m_Shape.clear();
+        m_State.clear(); m_Labels.clear();
+        m_Parent.clear(); m_Slot.clear();
+        m_FirstChild.clear(); m_ChildCount.clear(); m_ChildCapacity.clear();
+        m_Children.clear(); m_EdgeLabels.clear();
+        m_Strings.Clear();
+        m_FreeIds.clear();
+        m_ChildGarbage = 0;
+        m_LiveCount = 0;
+        for (NodeObserver* observer : m_Observers) observer->OnStoreCleared();
+    }
+
+    void NodeStore::AddObserver(NodeObserver* observer) {
+        m_Observers.push_back(observer);
+    }
+
+    void NodeStore::RemoveObserver(NodeObserver* observer) {
+        m_Observers.erase(std::remove(m_Observers.begin(), m_Observers.end(), observer), m_Observers.end());
+    }
+
+    void NodeStore::Reserve(size_t nodeCount) {
+        m_X.reserve(nodeCount); m_Y.reserve(nodeCount);
+        m_Scale.reserve(nodeCount); m_TargetScale.reserve(nodeCount);
+        m_Color.reserve(nodeCount); m_Type.reserve(nodeCount); m_Shape.reserve(nodeCount);
+        m_State.reserve(nodeCount); m_Labels.reserve(nodeCount);
+        m_Parent.reserve(nodeCount); m_Slot.reserve(nodeCount);
+        m_FirstChild.reserve(nodeCount); m_ChildCount.reserve(nodeCount); m_ChildCapacity.reserve(nodeCount);
+        m_Children.reserve(nodeCount); m_EdgeLabels.reserve(nodeCount);
+    }
+
+    size_t NodeStore::GetMemoryFootprint() const {
+        size_t perChild = sizeof(NodeId) + sizeof(StringId);
+        return m_State.capacity() * BytesPerNode
+             + m_Children.capacity() * perChild
+             + m_FreeIds.capacity() * sizeof(NodeId)
+             + m_Strings.GetMemoryFootprint();
+    }
+
+    void NodeStore::ReserveChildren(NodeId id, uint32_t count) {
+        if (count > m_ChildCapacity[id]) GrowChildRange(id, count);
+    }
+
+    void NodeStore::GrowChildRange(NodeId id, uint32_t newCapacity) {
+        uint32_t first = m_FirstChild[id];
+        uint32_t count = m_ChildCount[id];
+        uint32_t capacity = m_ChildCapacity[id];
+
+        if (capacity > 0 && first + capacity == m_Children.size()) {
+            // Range sits at the end of the array: extend it in place
+            m_Children.resize(first + newCapacity, InvalidNode);
+            m_EdgeLabels.resize(first + newCapacity, EmptyString);
+        } else {
+            if (m_ChildGarbage > 1024 && m_ChildGarbage * 2 > m_Children.size()) {
+                CompactChildren();
+                first = m_FirstChild[id];
+            }
+
+            // Relocate the range to the end of the array
+            uint32_t newFirst = static_cast<uint32_t>(m_Children.size());
+            m_Children.resize(newFirst + newCapacity, InvalidNode);
+            m_EdgeLabels.resize(newFirst + newCapacity, EmptyString);
+            for (uint32_t i = 0; i < count; ++i) {
+                m_Children[newFirst + i] = m_Children[first + i];
+                m_EdgeLabels[newFirst + i] = m_EdgeLabels[first + i];
+            }
+            m_ChildGarbage += capacity;
+            m_FirstChild[id] = newFirst;
+        }
+        m_ChildCapacity[id] = newCapacity;
+    }
+
+    void NodeStore::CompactChildren() {
+        // Rebuild the child array with live ranges packed in id order
+        std::vector<NodeId> children;
+        std::vector<StringId> edgeLabels;
+        children.reserve(m_Children.size() - m_ChildGarbage);
+        edgeLabels.reserve(m_Children.size() - m_ChildGarbage);
+
+        for (NodeId id = 0; id < GetCapacity(); ++id) {
+            uint32_t first = m_FirstChild[id];
+            uint32_t capacity = m_ChildCapacity[id];
+            m_FirstChild[id] = static_cast<uint32_t>(children.size());
+            for (uint32_t i = 0; i < capacity; ++i) {
+                children.push_back(m_Children[first + i]);
+                edgeLabels.push_back(m_EdgeLabels[first + i]);
+            }
+        }
+
+        m_Children = std::move(children);
+        m_EdgeLabels = std::move(edgeLabels);
+        m_ChildGarbage = 0;
+    }
+
+}
@@ -0,0 +1,296 @@
+/**
+ * NodeStore.h
+ * Struct-of-arrays storage for decision tree nodes
+ *
+ * Stores every node of a document in parallel contiguous arrays addressed
+ * by a 32-bit NodeId. Fields touched every frame (position, scale) live in
+ * their own arrays so that per-frame passes stream through tightly packed
+ * floats instead of dragging labels and child lists through the cache.
+ */
+
+#pragma once
+
+#include "TreeNode.h"
+#include "StringTable.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Data {
+
+    using NodeId = uint32_t;                       ///< Stable handle to a node in a NodeStore
+    constexpr NodeId InvalidNode = 0xFFFFFFFFu;    ///< Handle value meaning "no node"
+
+    /**
+     * @brief Lifecycle state of a node slot (values of the state column)
+     */
+    enum NodeState : uint8_t {
+        NodeFree = 0,      ///< Slot is unused and its id can be recycled
+        NodeLive = 1,      ///< Node is part of the document
+        NodeStashed = 2    ///< Node is alive but held outside the document (e.g. by undo history)
+    };
+
+    /**
+     * @struct Color
+     * @brief Packed RGB node color
+     */
+    struct Color {
+        uint8_t R, G, B;
+    };
+
+    /**
+     * @class NodeObserver
+     * @brief Receives notifications about changes made through a NodeStore
+     *
+     * Observers are called synchronously from the mutating call. Writes made
+     * through the raw column pointers and scale (animation) changes are not
+     * reported.
+     */
+    class NodeStore;
+
+    class NodeObserver {
+    public:
+        virtual ~NodeObserver() = default;
+
+        /// A node was created, or its data, edge labels or child list changed
+        virtual void OnNodeChanged(NodeId) {}
+        /// Only a node's position changed, from (oldX, oldY); observers that do not tell moves apart get OnNodeChanged()
+        virtual void OnNodeMoved(NodeId id, float /*oldX*/, float /*oldY*/) { OnNodeChanged(id); }
+        /// A node and its whole subtree moved by (dx, dy); by default reported as an OnNodeMoved() per node
+        virtual void OnSubtreeMoved(const NodeStore& nodes, NodeId root, float dx, float dy);
+        /// A node was destroyed; its id may be reused by a later creation
+        virtual void OnNodeDestroyed(NodeId) {}
+        /// Every node of the store was dropped
+        virtual void OnStoreCleared() {}
+    };
+
+    /**
+     * @class NodeStore
+     * @brief Column-oriented container of tree nodes
+     *
+     * Each node occupies one index in every column. Children of a node are a
+     * contiguous range [first, first + count) of a shared child array, with
+     * the edge labels in a parallel array. NodeIds stay valid for the whole
+     * lifetime of a node; destroyed ids are recycled by later creations.
+     * Node and edge labels are StringIds into the store's StringTable, so
+     * repeated labels share one copy and editing a label re-interns it.
+     *
+     * Pointers returned by the column accessors are invalidated by any call
+     * that creates nodes or adds children.
+     */
+    class NodeStore {
+    public:
+        /// Bytes of column storage used by one node slot
+        static constexpr size_t BytesPerNode = sizeof(float) * 4 + sizeof(Color) + sizeof(NodeType) + sizeof(ShapeType)
+                                             + sizeof(uint8_t) + sizeof(StringId) + sizeof(NodeId) + sizeof(uint32_t) * 4;
+
+        NodeStore();
+
+        /**
+         * @brief Create a new node with type-specific default style
+         * @param label Display label for the node
+         * @param type Semantic type of the node
+         * @return Handle to the new, detached node
+         */
+        NodeId Create(std::string_view label, NodeType type = NodeType::Action);
+
+        /**
+         * @brief Create a node with a specific id (used to restore saved ids)
+         * @param id Requested id; must not belong to an alive node
+         * @return id, or InvalidNode if it is already taken
+         */
+        NodeId CreateWithId(NodeId id, std::string_view label, NodeType type = NodeType::Action);
+
+        /**
+         * @brief Destroy a single node (its children are left untouched)
+         * @param id Node to destroy
+         */
+        void Destroy(NodeId id);
+
+        /**
+         * @brief Append a child to a node's child range
+         * @param parent Parent node
+         * @param child Child node (must be detached)
+         * @param edgeLabel Label displayed on the connecting edge
+         */
+        void AddChild(NodeId parent, NodeId child, std::string_view edgeLabel = {});
+
+        /**
+         * @brief Insert a child at a given slot of a node's child range
+         * @param parent Parent node
+         * @param child Child node (must be detached)
+         * @param slot Position in the child range (clamped to the child count)
+         * @param edgeLabel Label displayed on the connecting edge
+         *
+         * Later siblings shift up by one; cost is proportional to their count.
+         */
+        void InsertChild(NodeId parent, NodeId child, uint32_t slot, std::string_view edgeLabel = {});
+
+        /**
+         * @brief Insert a child whose edge label is already interned
+         * @param edgeLabel Interned edge label (a new reference is taken)
+         */
+        void InsertChildWithLabelId(NodeId parent, NodeId child, uint32_t slot, StringId edgeLabel);
+
+        /**
+         * @brief Detach a node from its parent (the node is not destroyed)
+         * @param id Node to detach
+         * @return true if the node had a parent
+         *
+         * Uses the stored parent link and slot index, so no search is needed.
+         * Later siblings shift down by one to keep their order; cost is
+         * proportional to their count.
+         */
+        bool Detach(NodeId id);
+
+        /**
+         * @brief Move a node (and its subtree) under a new parent
+         * @param id Node to move; its edge label moves with it
+         * @param newParent New parent node (must not be inside the subtree of id)
+         * @param slot Position in the new parent's child range
+         *
+         * A Detach() followed by an InsertChild(): costs the later siblings
+         * at both ends.
+         */
+        void Reparent(NodeId id, NodeId newParent, uint32_t slot);
+
+        /**
+         * @brief Move a node and its whole subtree by (dx, dy)
+         *
+         * Observers get a single OnSubtreeMoved() for the subtree.
+         */
+        void TranslateSubtree(NodeId root, float dx, float dy);
+
+        /**
+         * @brief Exchange the positions of two children of the same parent
+         * @return false if the nodes are not siblings
+         */
+        bool SwapSiblings(NodeId a, NodeId b);
+
+        /**
+         * @brief Destroy every node and release the child array
+         */
+        void Clear();
+
+        /**
+         * @brief Pre-allocate room for a number of nodes
+         */
+        void Reserve(size_t nodeCount);
+
+        /**
+         * @brief Make room for a number of children without further relocation
+         * @param id Parent node
+         * @param count Total number of children the range must hold
+         */
+        void ReserveChildren(NodeId id, uint32_t count);
+
+        /**
+         * @brief Register an observer (not owned; must outlive its registration)
+         */
+        void AddObserver(NodeObserver* observer);
+        void RemoveObserver(NodeObserver* observer);
+
+        bool IsAlive(NodeId id) const { return id < m_State.size() && m_State[id] != NodeFree; }  ///< Live or stashed
+        bool IsLive(NodeId id) const { return id < m_State.size() && m_State[id] == NodeLive; }   ///< Part of the document
+        void SetStashed(NodeId id, bool stashed) { m_State[id] = stashed ? NodeStashed : NodeLive; }
+        uint32_t GetCapacity() const { return static_cast<uint32_t>(m_State.size()); } ///< Upper bound of issued ids
+        uint32_t GetLiveCount() const { return m_LiveCount; }                            ///< Number of live nodes
+
+        // Hot per-frame columns (indexed by NodeId, GetCapacity() entries)
+        float* GetXData() { return m_X.data(); }
+        float* GetYData() { return m_Y.data(); }
+        float* GetScaleData() { return m_Scale.data(); }
+        float* GetTargetScaleData() { return m_TargetScale.data(); }
+        const float* GetXData() const { return m_X.data(); }
+        const float* GetYData() const { return m_Y.data(); }
+        const float* GetScaleData() const { return m_Scale.data(); }
+        const float* GetTargetScaleData() const { return m_TargetScale.data(); }
+        const uint8_t* GetStateData() const { return m_State.data(); }   ///< NodeState per id
+
+        // Per-node accessors
+        float GetX(NodeId id) const { return m_X[id]; }
+        float GetY(NodeId id) const { return m_Y[id]; }
+        void SetPosition(NodeId id, float x, float y) {
+            float oldX = m_X[id], oldY = m_Y[id];
+            m_X[id] = x; m_Y[id] = y;
+            NotifyMoved(id, oldX, oldY);
+        }
+        float GetScale(NodeId id) const { return m_Scale[id]; }
+        void SetScale(NodeId id, float scale) { m_Scale[id] = scale; }
+
+        NodeType GetType(NodeId id) const { return m_Type[id]; }
+        void SetType(NodeId id, NodeType type) { m_Type[id] = type; NotifyChanged(id); }
+        ShapeType GetShape(NodeId id) const { return m_Shape[id]; }
+        void SetShape(NodeId id, ShapeType shape) { m_Shape[id] = shape; NotifyChanged(id); }
+        Color GetColor(NodeId id) const { return m_Color[id]; }
+        void SetColor(NodeId id, Color color) { m_Color[id] = color; NotifyChanged(id); }
+
+        std::string_view GetLabel(NodeId id) const { return m_Strings.Get(m_Labels[id]); }
+        StringId GetLabelId(NodeId id) const { return m_Labels[id]; }
+        void SetLabel(NodeId id, std::string_view label);
+        void SetLabelId(NodeId id, StringId label);   ///< Takes a new reference to label
+
+        // Child ranges
+        uint32_t GetChildCount(NodeId id) const { return m_ChildCount[id]; }
+        NodeId GetChild(NodeId id, uint32_t slot) const { return m_Children[m_FirstChild[id] + slot]; }
+        const NodeId* GetChildren(NodeId id) const { return m_Children.data() + m_FirstChild[id]; }
+        std::string_view GetEdgeLabel(NodeId id, uint32_t slot) const { return m_Strings.Get(m_EdgeLabels[m_FirstChild[id] + slot]); }
+        StringId GetEdgeLabelId(NodeId id, uint32_t slot) const { return m_EdgeLabels[m_FirstChild[id] + slot]; }
+        void SetEdgeLabel(NodeId id, uint32_t slot, std::string_view label);
+
+        StringTable& GetStrings() { return m_Strings; }
+        const StringTable& GetStrings() const { return m_Strings; }
+
+        /**
+         * @brief Approximate heap bytes used by all columns and the string table
+         */
+        size_t GetMemoryFootprint() const;
+
+        NodeId GetParent(NodeId id) const { return m_Parent[id]; }   ///< InvalidNode for roots and detached nodes
+        uint32_t GetSlot(NodeId id) const { return m_Slot[id]; }     ///< Index in the parent's child range
+
+    private:
+        // Hot columns
+        std::vector<float> m_X, m_Y;
+        std::vector<float> m_Scale, m_TargetScale;
+
+        // Cold columns
+        std::vector<Color> m_Color;
+        std::vector<NodeType> m_Type;
+        std::vector<ShapeType> m_Shape;
+        std::vector<uint8_t> m_State;
+        std::vector<StringId> m_Labels;
+
+        // Parent links: parent handle and index in the parent's child range
+        std::vector<NodeId> m_Parent;
+        std::vector<uint32_t> m_Slot;
+
+        // Child ranges into the shared child array
+        std::vector<uint32_t> m_FirstChild;
+        std::vector<uint32_t> m_ChildCount;
+        std::vector<uint32_t> m_ChildCapacity;
+        std::vector<NodeId> m_Children;
+        std::vector<StringId> m_EdgeLabels;
+        size_t m_ChildGarbage;            ///< Child slots abandoned by relocated or freed ranges
+
+        StringTable m_Strings;            ///< Interned node and edge labels
+        std::vector<NodeId> m_FreeIds;    ///< Destroyed ids available for reuse
+        uint32_t m_LiveCount;
+        std::vector<NodeObserver*> m_Observers;
+
+        void NotifyChanged(NodeId id) {
+            for (NodeObserver* observer : m_Observers) observer->OnNodeChanged(id);
+        }
+        void NotifyMoved(NodeId id, float oldX, float oldY) {
+            for (NodeObserver* observer : m_Observers) observer->OnNodeMoved(id, oldX, oldY);
+        }
+        void AppendSlot();
+        void InitNode(NodeId id, std::string_view label, NodeType type);
+        void GrowChildRange(NodeId id, uint32_t newCapacity);
+        void RemoveSlot(NodeId parent, uint32_t slot);
+        void PlaceChild(NodeId parent, NodeId child, uint32_t slot, StringId edgeLabel);
+        void CompactChildren();
+    };
+
+}
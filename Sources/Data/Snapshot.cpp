@@ -0,0 +1,255 @@
+/**
+ * Snapshot.cpp
+ * Implementation of the Snapshot and SnapshotCache classes
+ */
+
+#include "Snapshot.h"
+#include <utility>
+
+namespace Data {
+
+    Snapshot::Snapshot(const Snapshot& other) : m_Root(other.m_Root) {
+        Retain(m_Root);
+    }
+
+    Snapshot& Snapshot::operator=(Snapshot other) noexcept {
+        std::swap(m_Root, other.m_Root);
+        return *this;
+    }
+
+    Snapshot::~Snapshot() {
+        Release(m_Root);
+    }
+
+    Snapshot Snapshot::FromNode(const SnapshotNode* root) {
+        Snapshot snapshot;
+        Retain(root);
+        snapshot.m_Root = root;
+        return snapshot;
+    }
+
+    void Snapshot::Retain(const SnapshotNode* node) {
+        if (node) node->RefCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void Snapshot::Release(const SnapshotNode* node) {
+        if (!node || node->RefCount.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+
+        // Unreferenced nodes go on an explicit stack so deep trees cannot overflow
+        std::vector<const SnapshotNode*> stack;
+        stack.push_back(node);
+        while (!stack.empty()) {
+            const SnapshotNode* dead = stack.back();
+            stack.pop_back();
+            for (const SnapshotEdge& edge : dead->Children) {
+                if (edge.Target->RefCount.fetch_sub(1, std::memory_order_acq_rel) == 1) stack.push_back(edge.Target);
+            }
+            delete dead;
+        }
+    }
+
+    SnapshotCache::SnapshotCache(const NodeStore& nodes) : m_Nodes(nodes), m_Generation(0), m_Tracking(false) {
+    }
+
+    SnapshotCache::~SnapshotCache() {
+        Reset();
+    }
+
+    Snapshot SnapshotCache::Take(NodeId root) {
+        if (!m_Nodes.IsAlive(root)) return Snapshot();
+        m_Tracking = true;
+        Grow();
+        if (m_Cache[root]) SetOffset(root);   // A former child made the root keeps an offset
+        else Build(root);
+
+        // Nodes handed out from here on are shared: later changes copy them
+        ++m_Generation;
+        return Snapshot::FromNode(m_Cache[root]);
+    }
+
+    void SnapshotCache::Reset() {
+        for (const SnapshotNode* node : m_Cache) Snapshot::Release(node);
+        m_Cache.clear();
+        m_Built.clear();
+        m_Tracking = false;
+    }
+
+    void SnapshotCache::OnNodeChanged(NodeId id) {
+        if (!m_Tracking) return;
+        if (id >= m_Cache.size()) Grow();
+
+        // Nodes under a subtree that was never built are built when it is
+        NodeId parent = m_Nodes.GetParent(id);
+        if (!m_Cache[id] && parent != InvalidNode && !m_Cache[parent]) return;
+        int64_t oldSize = m_Cache[id] ? m_Cache[id]->SubtreeSize : 0;
+        Refresh(id);
+        Propagate(id, int64_t(m_Cache[id]->SubtreeSize) - oldSize);
+    }
+
+    void SnapshotCache::OnNodeMoved(NodeId id, float, float) {
+        if (!m_Tracking || id >= m_Cache.size() || !m_Cache[id]) return;
+
+        // The children stayed where they were, so their offsets changed too
+        SetOffset(id);
+        for (uint32_t slot = 0, count = m_Nodes.GetChildCount(id); slot < count; ++slot) {
+            NodeId child = m_Nodes.GetChild(id, slot);
+            if (!m_Cache[child]) continue;
+            SetOffset(child);
+            if (slot < m_Cache[id]->Children.size() && m_Cache[id]->Children[slot].Target != m_Cache[child]) {
+                SnapshotEdge& edge = Own(id)->Children[slot];
+                Snapshot::Retain(m_Cache[child]);
+                Snapshot::Release(edge.Target);
+                edge.Target = m_Cache[child];
+            }
+        }
+        Propagate(id, 0);
+    }
+
+    void SnapshotCache::OnSubtreeMoved(const NodeStore&, NodeId root, float, float) {
+        // Offsets within the subtree are unchanged: only its root's moves
+        if (!m_Tracking || root >= m_Cache.size() || !m_Cache[root]) return;
+        SetOffset(root);
+        Propagate(root, 0);
+    }
+
+    void SnapshotCache::OnNodeDestroyed(NodeId id) {
+        if (id >= m_Cache.size()) return;
+        Snapshot::Release(m_Cache[id]);
+        m_Cache[id] = nullptr;
+    }
+
+    void SnapshotCache::OnStoreCleared() {
+        Reset();
+    }
+
+    void SnapshotCache::Grow() {
+        m_Cache.resize(m_Nodes.GetCapacity(), nullptr);
+        m_Built.resize(m_Nodes.GetCapacity(), 0);
+    }
+
+    SnapshotNode* SnapshotCache::Own(NodeId id) {
+        if (IsFresh(id)) return const_cast<SnapshotNode*>(m_Cache[id]);
+
+        // Shared by a version already handed out: the copy takes its place
+        const SnapshotNode* shared = m_Cache[id];
+        SnapshotNode* node = new SnapshotNode();
+        node->RefCount.store(1, std::memory_order_relaxed);
+        node->Id = shared->Id;
+        node->Type = shared->Type;
+        node->Shape = shared->Shape;
+        node->Color = shared->Color;
+        node->X = shared->X;
+        node->Y = shared->Y;
+        node->SubtreeSize = shared->SubtreeSize;
+        node->Label = shared->Label;
+        node->Children = shared->Children;
+        for (const SnapshotEdge& edge : node->Children) Snapshot::Retain(edge.Target);
+        Snapshot::Release(shared);
+        m_Cache[id] = node;
+        m_Built[id] = m_Generation;
+        return node;
+    }
+
+    void SnapshotCache::Build(NodeId root) {
+        struct Frame {
+            NodeId Node;
+            uint32_t NextChild;
+        };
+        std::vector<Frame> stack = { { root, 0 } };
+        while (!stack.empty()) {
+            Frame& top = stack.back();
+            if (top.NextChild < m_Nodes.GetChildCount(top.Node)) {
+                NodeId child = m_Nodes.GetChild(top.Node, top.NextChild++);
+                if (!m_Cache[child]) stack.push_back({ child, 0 });
+                continue;
+            }
+            NodeId id = top.Node;
+            stack.pop_back();
+            Refresh(id);
+        }
+    }
+
+    void SnapshotCache::Refresh(NodeId id) {
+        // A node seen before is patched (in its copy unless fresh), so edges
+        // that did not change are neither relinked nor relabelled
+        SnapshotNode* node;
+        if (m_Cache[id]) {
+            node = Own(id);
+        } else {
+            node = new SnapshotNode();
+            node->RefCount.store(1, std::memory_order_relaxed);
+            m_Cache[id] = node;
+            m_Built[id] = m_Generation;
+        }
+        node->Id = id;
+        node->Type = m_Nodes.GetType(id);
+        node->Shape = m_Nodes.GetShape(id);
+        node->Color = m_Nodes.GetColor(id);
+        std::string_view label = m_Nodes.GetLabel(id);
+        if (node->Label != label) node->Label = std::string(label);
+        NodeId parent = m_Nodes.GetParent(id);
+        node->X = double(m_Nodes.GetX(id)) - (parent != InvalidNode ? m_Nodes.GetX(parent) : 0.0f);
+        node->Y = double(m_Nodes.GetY(id)) - (parent != InvalidNode ? m_Nodes.GetY(parent) : 0.0f);
+
+        // Children are brought up to date first, then shared
+        uint32_t count = m_Nodes.GetChildCount(id);
+        std::vector<SnapshotEdge>& edges = node->Children;
+        for (uint32_t slot = count; slot < edges.size(); ++slot) Snapshot::Release(edges[slot].Target);
+        if (edges.size() > count) edges.resize(count);
+        node->SubtreeSize = 1;
+        for (uint32_t slot = 0; slot < count; ++slot) {
+            NodeId child = m_Nodes.GetChild(id, slot);
+            if (m_Cache[child]) SetOffset(child);
+            else Build(child);
+            const SnapshotNode* target = m_Cache[child];
+            std::string_view edgeLabel = m_Nodes.GetEdgeLabel(id, slot);
+            if (slot == edges.size()) {
+                Snapshot::Retain(target);
+                edges.push_back({ target, std::string(edgeLabel) });
+            } else {
+                if (edges[slot].Target != target) {
+                    Snapshot::Retain(target);
+                    Snapshot::Release(edges[slot].Target);
+                    edges[slot].Target = target;
+                }
+                if (edges[slot].Label != edgeLabel) edges[slot].Label = std::string(edgeLabel);
+            }
+            node->SubtreeSize += target->SubtreeSize;
+        }
+    }
+
+    void SnapshotCache::SetOffset(NodeId id) {
+        NodeId parent = m_Nodes.GetParent(id);
+        double x = double(m_Nodes.GetX(id)) - (parent != InvalidNode ? m_Nodes.GetX(parent) : 0.0f);
+        double y = double(m_Nodes.GetY(id)) - (parent != InvalidNode ? m_Nodes.GetY(parent) : 0.0f);
+        if (m_Cache[id]->X == x && m_Cache[id]->Y == y) return;
+        SnapshotNode* node = Own(id);
+        node->X = x;
+        node->Y = y;
+    }
+
+    void SnapshotCache::Propagate(NodeId id, int64_t sizeChange) {
+        // Each ancestor is copied once per version; one that already was
+        // only has the edge or size updated, and the climb stops there when
+        // the size did not change
+        for (NodeId child = id, parent = m_Nodes.GetParent(child); parent != InvalidNode; child = parent, parent = m_Nodes.GetParent(child)) {
+            const SnapshotNode* current = m_Cache[parent];
+            uint32_t slot = m_Nodes.GetSlot(child);
+            // Not listed yet: the parent is rebuilt when the child is attached
+            if (!current || slot >= current->Children.size() || current->Children[slot].Target->Id != child) return;
+            bool fresh = IsFresh(parent);
+            if (fresh && sizeChange == 0 && current->Children[slot].Target == m_Cache[child]) return;
+
+            SnapshotNode* node = Own(parent);
+            SnapshotEdge& edge = node->Children[slot];
+            if (edge.Target != m_Cache[child]) {
+                Snapshot::Retain(m_Cache[child]);
+                Snapshot::Release(edge.Target);
+                edge.Target = m_Cache[child];
+            }
+            node->SubtreeSize = static_cast<uint32_t>(int64_t(node->SubtreeSize) + sizeChange);
+            if (fresh && sizeChange == 0) return;
+        }
+    }
+
+}
@@ -0,0 +1,151 @@
+/**
+ * Snapshot.h
+ * Persistent, structurally shared versions of a document tree
+ *
+ * A Snapshot is an immutable copy of a tree that background jobs (saving,
+ * evaluation, export) can read while the document keeps changing. Versions
+ * share every unchanged subtree: an edit only causes the nodes on the path
+ * from the edited node up to the root to be copied into the next version.
+ * Positions are kept relative to the parent, so moving a subtree copies
+ * the same path and none of the nodes it moved.
+ */
+
+#pragma once
+
+#include "NodeStore.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Data {
+
+    struct SnapshotNode;
+
+    /**
+     * @struct SnapshotEdge
+     * @brief Connection from a snapshot node to one of its children
+     */
+    struct SnapshotEdge {
+        const SnapshotNode* Target;
+        std::string Label;
+    };
+
+    /**
+     * @struct SnapshotNode
+     * @brief Immutable node shared by every version that contains it
+     *
+     * Mirrors the fields of TreeNode. Nodes carry no parent pointer, which
+     * is what allows a subtree to be shared between versions.
+     */
+    struct SnapshotNode {
+        mutable std::atomic<uint32_t> RefCount;
+        NodeId Id;                   ///< Handle of the node in the document it was taken from
+        NodeType Type;
+        ShapeType Shape;
+        Data::Color Color;
+        bool IsShared = false;       ///< Child of several nodes of this version (see SubtreeSharing.h)
+        double X, Y;                 ///< Offset from the parent (exact: summed along a path it gives the stored float); position of a version's root
+        uint32_t SubtreeSize;        ///< Nodes in this subtree, including this one
+        std::string Label;
+        std::vector<SnapshotEdge> Children;
+    };
+
+    /**
+     * @class Snapshot
+     * @brief Reference-counted handle to one version of a tree
+     *
+     * Copying a handle is O(1). The nodes of a version are freed when the
+     * last handle referencing them is released; handles may be copied and
+     * released from any thread.
+     */
+    class Snapshot {
+    public:
+        Snapshot() : m_Root(nullptr) {}
+        Snapshot(const Snapshot& other);
+        Snapshot(Snapshot&& other) noexcept : m_Root(other.m_Root) { other.m_Root = nullptr; }
+        Snapshot& operator=(Snapshot other) noexcept;
+        ~Snapshot();
+
+        /**
+         * @brief Wrap a node, taking a new reference to it
+         */
+        static Snapshot FromNode(const SnapshotNode* root);
+
+        const SnapshotNode* GetRoot() const { return m_Root; }
+        bool IsEmpty() const { return m_Root == nullptr; }
+        uint32_t GetNodeCount() const { return m_Root ? m_Root->SubtreeSize : 0; }
+
+        static void Retain(const SnapshotNode* node);
+        static void Release(const SnapshotNode* node);   ///< Frees iteratively, never recurses
+
+    private:
+        const SnapshotNode* m_Root;
+    };
+
+    /**
+     * @struct SnapshotAccess
+     * @brief Tree adapter for the traversal templates
+     */
+    struct SnapshotAccess {
+        using Node = const SnapshotNode*;
+
+        uint32_t ChildCount(const SnapshotNode* node) const { return static_cast<uint32_t>(node->Children.size()); }
+        const SnapshotNode* Child(const SnapshotNode* node, uint32_t slot) const { return node->Children[slot].Target; }
+    };
+
+    /**
+     * @class SnapshotCache
+     * @brief Keeps the newest persistent version of a NodeStore up to date
+     *
+     * Observes the store and copies the path from each changed node up to
+     * the root as the change is reported, reusing every other node of the
+     * previous version; Take() only hands out the newest root, in O(1).
+     * Nodes copied since the last Take() are not shared yet and are updated
+     * in place, so a burst of edits copies each path once. Moving a subtree
+     * updates its root's offset; moving a single node also updates its
+     * children's. Tracking starts with the first Take(), which builds the
+     * whole tree. Must be used from the thread that edits the store.
+     */
+    class SnapshotCache : public NodeObserver {
+    public:
+        explicit SnapshotCache(const NodeStore& nodes);
+        ~SnapshotCache() override;
+
+        SnapshotCache(const SnapshotCache&) = delete;
+        SnapshotCache& operator=(const SnapshotCache&) = delete;
+
+        /**
+         * @brief Get a version of the subtree rooted at a node
+         * @param root Root of the tree to capture (InvalidNode gives an empty snapshot)
+         */
+        Snapshot Take(NodeId root);
+
+        /**
+         * @brief Drop every cached node (held snapshots stay valid)
+         */
+        void Reset();
+
+        void OnNodeChanged(NodeId id) override;
+        void OnNodeMoved(NodeId id, float oldX, float oldY) override;
+        void OnSubtreeMoved(const NodeStore& nodes, NodeId root, float dx, float dy) override;
+        void OnNodeDestroyed(NodeId id) override;
+        void OnStoreCleared() override;
+
+    private:
+        const NodeStore& m_Nodes;
+        std::vector<const SnapshotNode*> m_Cache;   ///< Newest node per NodeId (referenced)
+        std::vector<uint32_t> m_Built;              ///< Per NodeId: m_Generation when its node was built
+        uint32_t m_Generation;                      ///< Taken versions so far; nodes built since are not shared
+        bool m_Tracking;                            ///< Set once the first snapshot has been taken
+
+        void Grow();
+        bool IsFresh(NodeId id) const { return m_Cache[id] && m_Built[id] == m_Generation; }
+        SnapshotNode* Own(NodeId id);   ///< The node of id, copied first unless fresh
+        void Build(NodeId root);        ///< Nodes of a subtree not built yet, children first
+        void Refresh(NodeId id);        ///< Every field and child edge of a node, from the store
+        void SetOffset(NodeId id);      ///< Position of a node relative to its parent
+        void Propagate(NodeId id, int64_t sizeChange);   ///< Relinks a node into its ancestors
+    };
+
+}
@@ -0,0 +1,119 @@
+/**
+ * StringTable.cpp
+ * Implementation of the StringTable class
+ */
+
+#include "StringTable.h"
+#include <algorithm>
+#include <cstring>
+
+namespace Data {
+
+    StringTable::StringTable() : m_BlockUsed(PoolBlockSize), m_PoolBytes(0), m_DeadBytes(0) {
+        m_Entries.push_back({ "", 0, 1 }); // EmptyString, never released
+    }
+
+    StringId StringTable::Intern(std::string_view text) {
+        if (text.empty()) return EmptyString;
+
+        auto it = m_Lookup.find(text);
+        if (it != m_Lookup.end()) {
+            ++m_Entries[it->second].RefCount;
+            return it->second;
+        }
+
+        const char* data = Store(text);
+        StringId id;
+        if (!m_FreeIds.empty()) {
+            id = m_FreeIds.back();
+            m_FreeIds.pop_back();
+            m_Entries[id] = { data, static_cast<uint32_t>(text.size()), 1 };
+        } else {
+            id = static_cast<StringId>(m_Entries.size());
+            m_Entries.push_back({ data, static_cast<uint32_t>(text.size()), 1 });
+        }
+        m_Lookup.emplace(std::string_view(data, text.size()), id);
+        return id;
+    }
+
+    void StringTable::Retain(StringId id) {
+        if (id != EmptyString) ++m_Entries[id].RefCount;
+    }
+
+    void StringTable::Release(StringId id) {
+        if (id == EmptyString) return;
+
+        Entry& entry = m_Entries[id];
+        if (--entry.RefCount > 0) return;
+
+        m_Lookup.erase(std::string_view(entry.Data, entry.Length));
+        m_DeadBytes += entry.Length;
+        entry = { "", 0, 0 };
+        m_FreeIds.push_back(id);
+
+        // Reclaim the pool once most of it is held by released strings
+        if (m_DeadBytes > PoolBlockSize && m_DeadBytes * 2 > m_PoolBytes) Compact();
+    }
+
+    void StringTable::Clear() {
+        m_Entries.resize(1);
+        m_FreeIds.clear();
+        m_Lookup.clear();
+        m_Blocks.clear();
+        m_BlockUsed = PoolBlockSize;
+        m_PoolBytes = 0;
+        m_DeadBytes = 0;
+    }
+
+    size_t StringTable::GetMemoryFootprint() const {
+        // Pool + entry array + free list + approximate unordered_map node and bucket cost
+        size_t lookupBytes = m_Lookup.size() * (sizeof(std::string_view) + sizeof(StringId) + 2 * sizeof(void*))
+                           + m_Lookup.bucket_count() * sizeof(void*);
+        return m_PoolBytes
+             + m_Entries.capacity() * sizeof(Entry)
+             + m_FreeIds.capacity() * sizeof(StringId)
+             + lookupBytes;
+    }
+
+    const char* StringTable::Store(std::string_view text) {
+        if (text.size() > PoolBlockSize / 4) {
+            // Oversized strings get a dedicated block
+            m_Blocks.push_back(std::make_unique<char[]>(text.size()));
+            m_PoolBytes += text.size();
+            std::memcpy(m_Blocks.back().get(), text.data(), text.size());
+            const char* data = m_Blocks.back().get();
+
+            // Keep filling the previous shared block if there is one
+            if (m_Blocks.size() > 1) std::swap(m_Blocks[m_Blocks.size() - 1], m_Blocks[m_Blocks.size() - 2]);
+            return data;
+        }
+
+        if (m_BlockUsed + text.size() > PoolBlockSize) {
+            m_Blocks.push_back(std::make_unique<char[]>(PoolBlockSize));
+            m_PoolBytes += PoolBlockSize;
+            m_BlockUsed = 0;
+        }
+        char* data = m_Blocks.back().get() + m_BlockUsed;
+        std::memcpy(data, text.data(), text.size());
+        m_BlockUsed += text.size();
+        return data;
+    }
+
+    void StringTable::Compact() {
+        std::vector<std::unique_ptr<char[]>> oldBlocks = std::move(m_Blocks);
+        m_Blocks.clear();
+        m_BlockUsed = PoolBlockSize;
+        m_PoolBytes = 0;
+        m_DeadBytes = 0;
+        m_Lookup.clear();
+
+        // Copy every live string into fresh blocks, then rebuild the lookup map
+        for (StringId id = 1; id < m_Entries.size(); ++id) {
+            Entry& entry = m_Entries[id];
+            if (entry.RefCount == 0) continue;
+            entry.Data = Store(std::string_view(entry.Data, entry.Length));
+            m_Lookup.emplace(std::string_view(entry.Data, entry.Length), id);
+        }
+    }
+
+}
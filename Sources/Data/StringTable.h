@@ -0,0 +1,100 @@
+/**
+ * StringTable.h
+ * Document-wide interned string storage
+ *
+ * Node labels and edge labels repeat heavily ("Yes"/"No", recurring action
+ * names). The StringTable stores each distinct string once in a packed
+ * character pool and hands out compact 32-bit ids with reference counts.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace Data {
+
+    using StringId = uint32_t;             ///< Handle to an interned string
+    constexpr StringId EmptyString = 0;    ///< Id of the empty string (always present)
+
+    /**
+     * @class StringTable
+     * @brief Reference-counted intern table backed by a character pool
+     *
+     * Interning an existing string only bumps its reference count. Strings
+     * whose count drops to zero are removed from the lookup map and their id
+     * is recycled; their bytes are reclaimed by a compaction once enough of
+     * the pool is dead. Views returned by Get() stay valid until the next
+     * Intern() or Release() call.
+     */
+    class StringTable {
+    public:
+        StringTable();
+
+        StringTable(const StringTable&) = delete;
+        StringTable& operator=(const StringTable&) = delete;
+
+        /**
+         * @brief Intern a string and take a reference to it
+         * @param text String contents
+         * @return Id of the (possibly pre-existing) interned string
+         */
+        StringId Intern(std::string_view text);
+
+        /**
+         * @brief Take an additional reference to an interned string
+         */
+        void Retain(StringId id);
+
+        /**
+         * @brief Drop a reference; the string is freed when none remain
+         */
+        void Release(StringId id);
+
+        /**
+         * @brief Get the contents of an interned string
+         */
+        std::string_view Get(StringId id) const {
+            const Entry& entry = m_Entries[id];
+            return std::string_view(entry.Data, entry.Length);
+        }
+
+        /**
+         * @brief Drop every string except the empty one
+         */
+        void Clear();
+
+        size_t GetUniqueCount() const { return m_Lookup.size() + 1; }   ///< Distinct live strings
+
+        /**
+         * @brief Approximate heap bytes used by the pool, entries and lookup map
+         */
+        size_t GetMemoryFootprint() const;
+
+    private:
+        static constexpr size_t PoolBlockSize = 64 * 1024;
+
+        struct Entry {
+            const char* Data;
+            uint32_t Length;
+            uint32_t RefCount;
+        };
+
+        std::vector<Entry> m_Entries;                             ///< Indexed by StringId
+        std::vector<StringId> m_FreeIds;                          ///< Released ids available for reuse
+        std::unordered_map<std::string_view, StringId> m_Lookup;  ///< Contents to id (views into the pool)
+
+        std::vector<std::unique_ptr<char[]>> m_Blocks;            ///< Character pool
+        size_t m_BlockUsed;                                       ///< Bytes used in the last block
+        size_t m_PoolBytes;                                       ///< Total bytes allocated for the pool
+        size_t m_DeadBytes;                                       ///< Pool bytes held by released strings
+
+        const char* Store(std::string_view text);
+        void Compact();
+    };
+
+}
@@ -0,0 +1,221 @@
+/**
+ * SubtreeSharing.cpp
+ * Implementation of subtree sharing
+ */
+
+#include "SubtreeSharing.h"
+#include <chrono>
+#include <functional>
+#include <string_view>
+#include <unordered_map>
+
+namespace Data {
+
+    namespace {
+
+        /// Heap bytes behind a string (none while it fits the small-string buffer)
+        uint64_t HeapBytes(const std::string& text) {
+            return text.capacity() > std::string().capacity() ? text.capacity() + 1 : 0;
+        }
+
+        uint64_t NodeBytes(const SnapshotNode* node) {
+            uint64_t bytes = sizeof(SnapshotNode) + HeapBytes(node->Label) + node->Children.capacity() * sizeof(SnapshotEdge);
+            for (const SnapshotEdge& edge : node->Children) bytes += HeapBytes(edge.Label);
+            return bytes;
+        }
+
+        uint64_t Mix(uint64_t hash, uint64_t value) {
+            hash ^= value + 0x9E3779B97F4A7C15ull + (hash << 6) + (hash >> 2);
+            return hash;
+        }
+
+        /**
+         * Open-addressed set of the shared nodes built so far, keyed by
+         * content. Probing compares a source node with its children already
+         * replaced by their shared versions against the stored nodes.
+         */
+        class NodeTable {
+        public:
+            NodeTable() : m_Count(0) { m_Slots.resize(1024); }
+
+            /// Shared node equal to 'source' with children 'children', or nullptr; 'slot' receives where to insert
+            SnapshotNode* Find(const SnapshotNode* source, const std::vector<const SnapshotNode*>& children, uint64_t hash, size_t& slot) const {
+                size_t mask = m_Slots.size() - 1;
+                for (slot = hash & mask; m_Slots[slot].Node; slot = (slot + 1) & mask) {
+                    if (m_Slots[slot].Hash == hash && Equal(m_Slots[slot].Node, source, children)) return m_Slots[slot].Node;
+                }
+                return nullptr;
+            }
+
+            /// Add a node at the slot returned by a failed Find()
+            void Insert(size_t slot, SnapshotNode* node, uint64_t hash) {
+                m_Slots[slot] = { node, hash };
+                // Kept at most half full
+                if (++m_Count * 2 > m_Slots.size()) Grow();
+            }
+
+            template<typename Visitor>
+            void ForEach(Visitor&& visit) const {
+                for (const Slot& entry : m_Slots) {
+                    if (entry.Node) visit(entry.Node);
+                }
+            }
+
+        private:
+            /// Nodes are still being linked, and so mutable, while the table exists
+            struct Slot {
+                SnapshotNode* Node = nullptr;
+                uint64_t Hash = 0;
+            };
+
+            static bool Equal(const SnapshotNode* shared, const SnapshotNode* source, const std::vector<const SnapshotNode*>& children) {
+                if (shared->Type != source->Type || shared->Shape != source->Shape || shared->Color.R != source->Color.R ||
+                    shared->Color.G != source->Color.G || shared->Color.B != source->Color.B || shared->Label != source->Label ||
+                    shared->Children.size() != children.size()) {
+                    return false;
+                }
+                for (size_t i = 0; i < children.size(); ++i) {
+                    if (shared->Children[i].Target != children[i] || shared->Children[i].Label != source->Children[i].Label) return false;
+                }
+                return true;
+            }
+
+            void Grow() {
+                std::vector<Slot> old(m_Slots.size() * 2);
+                old.swap(m_Slots);
+                size_t mask = m_Slots.size() - 1;
+                for (const Slot& entry : old) {
+                    if (!entry.Node) continue;
+                    size_t slot = entry.Hash & mask;
+                    while (m_Slots[slot].Node) slot = (slot + 1) & mask;
+                    m_Slots[slot] = entry;
+                }
+            }
+
+            std::vector<Slot> m_Slots;
+            size_t m_Count;
+        };
+
+    }
+
+    Snapshot ShareSubtrees(const Snapshot& tree, SharingStats* stats) {
+        auto start = std::chrono::steady_clock::now();
+        if (tree.IsEmpty()) {
+            if (stats) *stats = SharingStats();
+            return Snapshot();
+        }
+
+        // Shared version of each source node, so that a source that is
+        // already a DAG is still walked once per distinct node
+        std::unordered_map<const SnapshotNode*, const SnapshotNode*> shared;
+        NodeTable table;
+        std::hash<std::string_view> hashText;
+        std::vector<const SnapshotNode*> children;
+        uint32_t sharedCount = 0;
+        uint64_t sourceBytes = 0, sharedBytes = 0;
+
+        // Children before parents: a node is hashed from its children's shared versions
+        struct Frame {
+            const SnapshotNode* Node;
+            uint32_t NextChild;
+        };
+        std::vector<Frame> stack;
+        stack.push_back({ tree.GetRoot(), 0 });
+        shared.reserve(tree.GetNodeCount());
+        while (!stack.empty()) {
+            Frame& top = stack.back();
+            if (top.NextChild < top.Node->Children.size()) {
+                const SnapshotNode* child = top.Node->Children[top.NextChild++].Target;
+                if (!shared.count(child)) stack.push_back({ child, 0 });
+                continue;
+            }
+            const SnapshotNode* source = top.Node;
+            stack.pop_back();
+            sourceBytes += NodeBytes(source);
+
+            uint64_t hash = Mix(Mix(uint64_t(source->Type), uint64_t(source->Shape)),
+                                (uint64_t(source->Color.R) << 16) | (uint64_t(source->Color.G) << 8) | source->Color.B);
+            hash = Mix(hash, hashText(source->Label));
+            children.clear();
+            for (const SnapshotEdge& edge : source->Children) {
+                const SnapshotNode* child = shared[edge.Target];
+                children.push_back(child);
+                hash = Mix(Mix(hash, std::hash<const void*>()(child)), hashText(edge.Label));
+            }
+
+            size_t slot;
+            SnapshotNode* node = table.Find(source, children, hash, slot);
+            if (!node) {
+                SnapshotNode* created = new SnapshotNode();
+                created->RefCount.store(0, std::memory_order_relaxed);
+                created->Id = source->Id;
+                created->Type = source->Type;
+                created->Shape = source->Shape;
+                created->Color = source->Color;
+                created->X = source->X;
+                created->Y = source->Y;
+                created->Label = source->Label;
+                created->SubtreeSize = source->SubtreeSize;
+                created->Children.reserve(children.size());
+                // Every edge to a shared node holds a reference to it
+                for (size_t i = 0; i < children.size(); ++i) {
+                    Snapshot::Retain(children[i]);
+                    created->Children.push_back({ children[i], source->Children[i].Label });
+                }
+                table.Insert(slot, created, hash);
+                node = created;
+                ++sharedCount;
+                sharedBytes += NodeBytes(created);
+            }
+            shared[source] = node;
+        }
+
+        // Every edge holds a reference, so a node with more than one has several parents
+        table.ForEach([](SnapshotNode* node) { node->IsShared = node->RefCount.load(std::memory_order_relaxed) > 1; });
+        Snapshot result = Snapshot::FromNode(shared[tree.GetRoot()]);
+
+        if (stats) {
+            stats->TreeNodes = tree.GetNodeCount();
+            stats->SharedNodes = sharedCount;
+            stats->TreeBytes = sourceBytes;
+            stats->SharedBytes = sharedBytes;
+            stats->Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+        return result;
+    }
+
+    std::vector<SharedNodeUse> ListDistinctNodes(const Snapshot& tree) {
+        std::vector<SharedNodeUse> list;
+        if (tree.IsEmpty()) return list;
+
+        // Only shared nodes can be reached twice
+        std::unordered_map<const SnapshotNode*, uint32_t> index;   // Position in 'list'
+        const SnapshotNode* root = tree.GetRoot();
+        std::vector<uint32_t> stack = { 0 };   // Positions in 'list'
+        list.push_back({ root, 0, root->X, root->Y });
+        while (!stack.empty()) {
+            SharedNodeUse use = list[stack.back()];
+            stack.pop_back();
+            for (size_t i = use.Node->Children.size(); i-- > 0;) {
+                const SnapshotNode* child = use.Node->Children[i].Target;
+                if (child->IsShared) {
+                    auto [found, added] = index.try_emplace(child, static_cast<uint32_t>(list.size()));
+                    if (!added) {
+                        ++list[found->second].Parents;
+                        continue;
+                    }
+                }
+                stack.push_back(static_cast<uint32_t>(list.size()));
+                list.push_back({ child, 1, use.X + child->X, use.Y + child->Y });
+            }
+        }
+        return list;
+    }
+
+    uint64_t GetMemoryFootprint(const Snapshot& tree) {
+        uint64_t bytes = 0;
+        for (const SharedNodeUse& use : ListDistinctNodes(tree)) bytes += NodeBytes(use.Node);
+        return bytes;
+    }
+
+}
@@ -0,0 +1,67 @@
+/**
+ * SubtreeSharing.h
+ * Merging of identical subtrees into a shared DAG
+ *
+ * Generated and imported trees repeat the same subtrees many times (the
+ * same fallback chain under dozens of branches). ShareSubtrees() hashes a
+ * snapshot bottom-up and builds a version in which structurally identical
+ * subtrees are one reference-counted SnapshotNode with several parents.
+ *
+ * Two subtrees are identical when their roots have the same type, shape,
+ * color and label and their children are identical, with the same edge
+ * labels, in the same order. Positions and document ids are not compared:
+ * a shared node keeps those of the first occurrence reached in pre-order, so
+ * a shared version is meant for evaluation and display, not for saving.
+ */
+
+#pragma once
+
+#include "Snapshot.h"
+#include <cstdint>
+#include <vector>
+
+namespace Data {
+
+    /**
+     * @struct SharingStats
+     * @brief Size of a tree before and after sharing
+     */
+    struct SharingStats {
+        uint32_t TreeNodes = 0;        ///< Nodes of the tree, every occurrence counted
+        uint32_t SharedNodes = 0;      ///< Distinct nodes after sharing
+        uint64_t TreeBytes = 0;        ///< Footprint of the snapshot before sharing
+        uint64_t SharedBytes = 0;      ///< Footprint after sharing
+        double Seconds = 0.0;
+    };
+
+    /**
+     * @brief Build a version of a tree with identical subtrees merged
+     * @param tree Snapshot to compact (may already share subtrees)
+     * @param stats Receives node counts and footprints (optional)
+     *
+     * Runs in time linear in the distinct nodes of the input. SubtreeSize
+     * still counts every occurrence, so GetNodeCount() is unchanged.
+     */
+    Snapshot ShareSubtrees(const Snapshot& tree, SharingStats* stats = nullptr);
+
+    /**
+     * @struct SharedNodeUse
+     * @brief A distinct node of a snapshot and how many edges lead to it
+     */
+    struct SharedNodeUse {
+        const SnapshotNode* Node;
+        uint32_t Parents;
+        double X, Y;   ///< Position of its first occurrence
+    };
+
+    /**
+     * @brief Each distinct node of a snapshot once, the root first and every node after a parent of it
+     */
+    std::vector<SharedNodeUse> ListDistinctNodes(const Snapshot& tree);
+
+    /**
+     * @brief Bytes held by the distinct nodes of a snapshot, labels included
+     */
+    uint64_t GetMemoryFootprint(const Snapshot& tree);
+
+}
@@ -0,0 +1,195 @@
+/**
+ * Traversal.h
+ * Non-recursive tree traversal templates
+ *
+ * Provides pre-order, post-order and breadth-first walks driven by an
+ * explicit stack or queue, so that arbitrarily deep trees never overflow
+ * the call stack. Visitors are template parameters and are inlined into
+ * the traversal loop.
+ */
+
+#pragma once
+
+#include "NodeStore.h"
+#include "TreeNode.h"
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Data {
+
+    /**
+     * @enum VisitResult
+     * @brief Value returned by a visitor to steer the traversal
+     */
+    enum class VisitResult {
+        Continue,      ///< Keep walking, including this node's children
+        SkipChildren,  ///< Do not descend below this node (pre-order / breadth-first only)
+        Stop           ///< Abort the whole traversal
+    };
+
+    /**
+     * @struct StoreAccess
+     * @brief Tree adapter for nodes held in a NodeStore
+     */
+    struct StoreAccess {
+        using Node = NodeId;
+        const NodeStore& Nodes;
+
+        uint32_t ChildCount(NodeId node) const { return Nodes.GetChildCount(node); }
+        NodeId Child(NodeId node, uint32_t slot) const { return Nodes.GetChild(node, slot); }
+    };
+
+    /**
+     * @struct TreeNodeAccess
+     * @brief Tree adapter for pointer-linked TreeNode hierarchies
+     */
+    struct TreeNodeAccess {
+        using Node = TreeNode*;
+
+        uint32_t ChildCount(TreeNode* node) const { return static_cast<uint32_t>(node->Connections.size()); }
+        TreeNode* Child(TreeNode* node, uint32_t slot) const { return node->Connections[slot].Target; }
+    };
+
+    namespace Detail {
+        /// Invoke a visitor that may return either void or VisitResult
+        template<typename Visitor, typename Node>
+        inline VisitResult Visit(Visitor& visit, Node node, uint32_t depth) {
+            if constexpr (std::is_void_v<decltype(visit(node, depth))>) {
+                visit(node, depth);
+                return VisitResult::Continue;
+            } else {
+                return visit(node, depth);
+            }
+        }
+    }
+
+    /**
+     * @brief Visit a subtree parents-first, children in slot order
+     * @param access Tree adapter (StoreAccess or TreeNodeAccess)
+     * @param root Root of the subtree to walk
+     * @param visit Callable (node, depth) returning void or VisitResult
+     * @return false if the visitor stopped the traversal early
+     */
+    template<typename Access, typename Visitor>
+    bool PreOrder(const Access& access, typename Access::Node root, Visitor&& visit) {
+        std::vector<std::pair<typename Access::Node, uint32_t>> stack;
+        stack.push_back({ root, 0 });
+        while (!stack.empty()) {
+            auto [node, depth] = stack.back();
+            stack.pop_back();
+
+            VisitResult result = Detail::Visit(visit, node, depth);
+            if (result == VisitResult::Stop) return false;
+            if (result == VisitResult::SkipChildren) continue;
+
+            // Push in reverse so that the first child is visited first
+            for (uint32_t i = access.ChildCount(node); i-- > 0;) {
+                stack.push_back({ access.Child(node, i), depth + 1 });
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Visit a subtree children-first (each node after all of its descendants)
+     * @param access Tree adapter (StoreAccess or TreeNodeAccess)
+     * @param root Root of the subtree to walk
+     * @param visit Callable (node, depth) returning void or VisitResult
+     * @return false if the visitor stopped the traversal early
+     *
+     * The visitor may destroy the node it is given: the node's children have
+     * all been visited and are no longer referenced by the traversal.
+     */
+    template<typename Access, typename Visitor>
+    bool PostOrder(const Access& access, typename Access::Node root, Visitor&& visit) {
+        struct Frame {
+            typename Access::Node Node;
+            uint32_t Depth;
+            bool Expanded;
+        };
+        std::vector<Frame> stack;
+        stack.push_back({ root, 0, false });
+        while (!stack.empty()) {
+            Frame& top = stack.back();
+            if (!top.Expanded) {
+                // Read the child range once: the node stays below its children,
+                // which are pushed in reverse so the first child is visited first
+                top.Expanded = true;
+                typename Access::Node node = top.Node;
+                uint32_t depth = top.Depth + 1;
+                for (uint32_t i = access.ChildCount(node); i-- > 0;) {
+                    stack.push_back({ access.Child(node, i), depth, false });
+                }
+                continue;
+            }
+
+            Frame done = top;
+            stack.pop_back();
+            if (Detail::Visit(visit, done.Node, done.Depth) == VisitResult::Stop) return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Visit a subtree level by level
+     * @param access Tree adapter (StoreAccess or TreeNodeAccess)
+     * @param root Root of the subtree to walk
+     * @param visit Callable (node, depth) returning void or VisitResult
+     * @return false if the visitor stopped the traversal early
+     */
+    template<typename Access, typename Visitor>
+    bool BreadthFirst(const Access& access, typename Access::Node root, Visitor&& visit) {
+        std::vector<std::pair<typename Access::Node, uint32_t>> queue;
+        queue.push_back({ root, 0 });
+        for (size_t head = 0; head < queue.size(); ++head) {
+            auto [node, depth] = queue[head];
+
+            VisitResult result = Detail::Visit(visit, node, depth);
+            if (result == VisitResult::Stop) return false;
+            if (result == VisitResult::SkipChildren) continue;
+
+            for (uint32_t i = 0; i < access.ChildCount(node); ++i) {
+                queue.push_back({ access.Child(node, i), depth + 1 });
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Find the first node (in pre-order) matching a predicate
+     * @param access Tree adapter (StoreAccess or TreeNodeAccess)
+     * @param root Root of the subtree to search
+     * @param predicate Callable (node) returning true for a match
+     * @param notFound Value returned when nothing matches
+     */
+    template<typename Access, typename Predicate>
+    typename Access::Node FindFirst(const Access& access, typename Access::Node root, Predicate&& predicate, typename Access::Node notFound) {
+        typename Access::Node found = notFound;
+        PreOrder(access, root, [&](typename Access::Node node, uint32_t) {
+            if (!predicate(node)) return VisitResult::Continue;
+            found = node;
+            return VisitResult::Stop;
+        });
+        return found;
+    }
+
+    // Convenience overloads for documents stored in a NodeStore
+
+    template<typename Visitor>
+    bool PreOrder(const NodeStore& nodes, NodeId root, Visitor&& visit) {
+        return PreOrder(StoreAccess{ nodes }, root, std::forward<Visitor>(visit));
+    }
+
+    template<typename Visitor>
+    bool PostOrder(const NodeStore& nodes, NodeId root, Visitor&& visit) {
+        return PostOrder(StoreAccess{ nodes }, root, std::forward<Visitor>(visit));
+    }
+
+    template<typename Visitor>
+    bool BreadthFirst(const NodeStore& nodes, NodeId root, Visitor&& visit) {
+        return BreadthFirst(StoreAccess{ nodes }, root, std::forward<Visitor>(visit));
+    }
+
+}
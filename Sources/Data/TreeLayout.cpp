@@ -0,0 +1,405 @@
+/**
+ * TreeLayout.cpp
+ * Implementation of the TreeLayout class
+ */
+
+#include "TreeLayout.h"
+#include "../Core/ThreadPool.h"
+#include <algorithm>
+
+namespace Data {
+
+    namespace {
+
+        constexpr float NodeSize = 50.0f;    ///< Drawn size of a node at scale 1 (see Renderer::DrawStyledNode)
+        constexpr float CharWidth = 8.0f;    ///< Advance of one label character at text scale 1
+
+        constexpr uint8_t Stale = 1;     ///< Subtree must be merged again
+        constexpr uint8_t Edited = 2;    ///< Subtree changed since the layout was created: its nodes move
+        constexpr uint8_t Merged = 4;    ///< Stale, but merged since it was marked
+        constexpr uint8_t Top = 8;       ///< Listed as a top by the running Update()
+        constexpr uint8_t Split = 16;    ///< Root of a subtree merged by a worker of the running Compute()
+        constexpr uint8_t Shifted = 32;  ///< Subtree waits for Resolve() to move it by its shift
+
+        constexpr uint32_t TasksPerThread = 16;   ///< Subtrees per worker a parallel layout aims for
+
+    }
+
+    float GetLayoutWidth(const NodeStore& nodes, NodeId id) {
+        // Capsules are drawn twice as wide as they are tall
+        float shape = nodes.GetShape(id) == ShapeType::Capsule ? NodeSize * 2.0f : NodeSize;
+        return std::max(shape, float(nodes.GetLabel(id).size()) * CharWidth);
+    }
+
+    TreeLayout::TreeLayout(NodeStore& nodes, Core::ThreadPool* pool) : m_Nodes(nodes), m_Pool(pool) {
+        m_Nodes.AddObserver(this);
+        Grow();
+        for (NodeId id = 0; id < m_Nodes.GetCapacity(); ++id) {
+            if (!m_Nodes.IsAlive(id)) continue;
+            m_Flags[id] = Stale;
+            m_Stale.push_back(id);
+        }
+    }
+
+    TreeLayout::~TreeLayout() {
+        m_Nodes.RemoveObserver(this);
+    }
+
+    uint32_t TreeLayout::Apply(NodeId root, float x, float y) {
+        if (!m_Nodes.IsAlive(root)) return 0;
+        Compute(root);
+        Update();
+        return Place(root, x, y);
+    }
+
+    uint32_t TreeLayout::Update() {
+        if (m_Stale.empty()) return 0;
+        Grow();
+
+        // Threads set by the merges about to be redone no longer hold, even
+        // where the walks of the merges below them would meet them first
+        for (NodeId id : m_Stale) {
+            if (!(m_Flags[id] & Merged)) ++m_Generation[id];
+        }
+
+        // Marked nodes form paths up to the tops of their trees; each top is
+        // merged again bottom-up, descending only into marked children.
+        // Marking every node (a new layout) is a whole layout, which workers share
+        bool whole = m_Pool && m_Stale.size() >= ParallelThreshold;
+        std::vector<NodeId> tops;
+        for (NodeId top : m_Stale) {
+            if ((m_Flags[top] & (Stale | Top)) != Stale || !m_Nodes.IsAlive(top)) continue;
+            NodeId parent = m_Nodes.GetParent(top);
+            if (parent != InvalidNode && (m_Flags[parent] & Stale)) continue;
+
+            m_Flags[top] |= Top;
+            tops.push_back(top);
+            if (m_Flags[top] & Merged) continue;
+            if (whole) Compute(top);
+            else MergeSubtree(top, Stale | Merged, Stale);
+        }
+
+        // Edited trees are moved into place around their roots; trees only
+        // marked since the layout was created keep the positions they had
+        uint32_t moved = 0;
+        for (NodeId top : tops) {
+            if ((m_Flags[top] & Edited) && m_Nodes.IsLive(top)) moved += PlaceEdited(top);
+        }
+        for (NodeId id : m_Stale) m_Flags[id] &= Shifted;
+        m_Stale.clear();
+        return moved;
+    }
+
+    uint32_t TreeLayout::Resolve() {
+        uint32_t moved = 0;
+        for (NodeId node : m_Shifted) {
+            if (!(m_Flags[node] & Shifted)) continue;
+            m_Flags[node] &= ~Shifted;
+            // Deleted subtrees are placed again if they come back
+            if (!m_Nodes.IsLive(node)) continue;
+            m_Nodes.TranslateSubtree(node, m_ShiftX[node], m_ShiftY[node]);
+            ++moved;
+        }
+        m_Shifted.clear();
+        return moved;
+    }
+
+    void TreeLayout::Compute(NodeId root) {
+        if (!m_Nodes.IsAlive(root)) return;
+        Grow();
+        if (!m_Pool || m_Pool->GetThreadCount() < 2) {
+            MergeSubtree(root, 0, 0);
+            return;
+        }
+
+        // Every merge keeps its subtree's size; a tree marked since it was
+        // last merged is counted first
+        if ((m_Flags[root] & (Stale | Merged)) == Stale || m_Size[root] == 0) Count(root);
+        if (m_Size[root] < ParallelThreshold) {
+            MergeSubtree(root, 0, 0);
+            return;
+        }
+
+        // Cut off the largest subtrees below a share of the whole, so that
+        // there are enough to keep every worker busy however unbalanced the
+        // tree. A merge only reads and writes nodes of its own subtree, so the
+        // subtrees are merged independently and the result does not depend
+        // on which worker merged what, or when
+        uint32_t cut = std::max<uint32_t>(m_Size[root] / (m_Pool->GetThreadCount() * TasksPerThread), 1);
+        std::vector<NodeId> split, stack = { root };
+        while (!stack.empty()) {
+            NodeId node = stack.back();
+            stack.pop_back();
+            uint32_t count = m_Nodes.GetChildCount(node);
+            if (count == 0) continue;
+            if (m_Size[node] <= cut) {
+                split.push_back(node);
+                continue;
+            }
+            const NodeId* children = m_Nodes.GetChildren(node);
+            stack.insert(stack.end(), children, children + count);
+        }
+        for (NodeId subtree : split) {
+            m_Flags[subtree] |= Split;
+            m_Pool->Submit([this, subtree]() { MergeSubtree(subtree, 0, 0); });
+        }
+        m_Pool->Wait();
+
+        // Then the nodes above them, leaves between them included
+        MergeSubtree(root, Split, 0);
+        for (NodeId subtree : split) m_Flags[subtree] &= ~Split;
+    }
+
+    void TreeLayout::Count(NodeId root) {
+        // Parents come before their children breadth-first, so a reverse
+        // sweep adds each node's count into its parent's
+        std::vector<NodeId>& order = m_Order;
+        order.assign(1, root);
+        m_Size[root] = 1;
+        for (size_t i = 0; i < order.size(); ++i) {
+            const NodeId* children = m_Nodes.GetChildren(order[i]);
+            for (uint32_t slot = 0, count = m_Nodes.GetChildCount(order[i]); slot < count; ++slot) {
+                m_Size[children[slot]] = 1;
+                order.push_back(children[slot]);
+            }
+        }
+        for (size_t i = order.size(); i-- > 1;) m_Size[m_Nodes.GetParent(order[i])] += m_Size[order[i]];
+    }
+
+    void TreeLayout::MergeSubtree(NodeId root, uint8_t mask, uint8_t value) {
+        // Children before parents: a parent is placed from its children's contours
+        struct Frame {
+            NodeId Node;
+            uint32_t Slot;
+        };
+        std::vector<Frame> stack;
+        stack.push_back({ root, 0 });
+        while (!stack.empty()) {
+            Frame& frame = stack.back();
+            if (frame.Slot < m_Nodes.GetChildCount(frame.Node)) {
+                NodeId child = m_Nodes.GetChild(frame.Node, frame.Slot++);
+                if ((m_Flags[child] & mask) == value) stack.push_back({ child, 0 });
+                continue;
+            }
+            NodeId node = frame.Node;
+            stack.pop_back();
+            Merge(node);
+        }
+    }
+
+    uint32_t TreeLayout::Place(NodeId root, float x, float y) {
+        if (!m_Nodes.IsAlive(root)) return 0;
+        struct Frame {
+            NodeId Node;
+            double X;
+            float Y;
+        };
+        uint32_t moved = 0;
+        std::vector<Frame> stack;
+        stack.push_back({ root, double(x), y });
+        while (!stack.empty()) {
+            Frame frame = stack.back();
+            stack.pop_back();
+            m_Flags[frame.Node] &= ~Shifted;
+            float nodeX = float(frame.X);
+            if (m_Nodes.GetX(frame.Node) != nodeX || m_Nodes.GetY(frame.Node) != frame.Y) {
+                m_Nodes.SetPosition(frame.Node, nodeX, frame.Y);
+                ++moved;
+            }
+            const NodeId* children = m_Nodes.GetChildren(frame.Node);
+            for (uint32_t slot = m_Nodes.GetChildCount(frame.Node); slot-- > 0;) {
+                stack.push_back({ children[slot], frame.X + m_Offset[children[slot]], frame.Y + LevelSpacing });
+            }
+        }
+        return moved;
+    }
+
+    void TreeLayout::OnNodeChanged(NodeId id) {
+        Grow();
+        // Every subtree containing the node must be merged again, including
+        // ones Compute() merged since they were marked
+        for (NodeId node = id; node != InvalidNode && (m_Flags[node] & (Edited | Merged)) != Edited; node = m_Nodes.GetParent(node)) {
+            if (!(m_Flags[node] & Stale)) m_Stale.push_back(node);
+            m_Flags[node] = (m_Flags[node] & ~Merged) | Stale | Edited;
+        }
+    }
+
+    void TreeLayout::OnNodeDestroyed(NodeId id) {
+        if (id >= m_Flags.size()) return;
+        // The id may come back as another node: it must not look marked or counted, nor own threads
+        m_Flags[id] = 0;
+        m_Size[id] = 0;
+        m_ShiftX[id] = m_ShiftY[id] = 0.0f;
+        ++m_Generation[id];
+    }
+
+    void TreeLayout::OnStoreCleared() {
+        m_Offset.clear();
+        m_HalfWidth.clear();
+        m_LeftThread.clear();
+        m_RightThread.clear();
+        m_Extent.clear();
+        m_Generation.clear();
+        m_Flags.clear();
+        m_Size.clear();
+        m_ShiftX.clear();
+        m_ShiftY.clear();
+        m_Stale.clear();
+        m_Shifted.clear();
+    }
+
+    void TreeLayout::Grow() {
+        size_t capacity = m_Nodes.GetCapacity();
+        if (m_Offset.size() >= capacity) return;
+        m_Offset.resize(capacity, 0.0);
+        m_HalfWidth.resize(capacity, 0.0f);
+        m_LeftThread.resize(capacity);
+        m_RightThread.resize(capacity);
+        m_Extent.resize(capacity);
+        m_Generation.resize(capacity, 0);
+        m_Flags.resize(capacity, 0);
+        m_Size.resize(capacity, 0);
+        m_ShiftX.resize(capacity, 0.0f);
+        m_ShiftY.resize(capacity, 0.0f);
+    }
+
+    NodeId TreeLayout::Follow(const Thread& thread, double& x) const {
+        // A thread dies with the merge that set it
+        if (thread.Node == InvalidNode || m_Generation[thread.Owner] != thread.Generation) return InvalidNode;
+        x += thread.Offset;
+        return thread.Node;
+    }
+
+    NodeId TreeLayout::NextLeft(NodeId node, double& x) const {
+        if (m_Nodes.GetChildCount(node) > 0) {
+            NodeId child = m_Nodes.GetChild(node, 0);
+            x += m_Offset[child];
+            return child;
+        }
+        return Follow(m_LeftThread[node], x);
+    }
+
+    NodeId TreeLayout::NextRight(NodeId node, double& x) const {
+        uint32_t count = m_Nodes.GetChildCount(node);
+        if (count > 0) {
+            NodeId child = m_Nodes.GetChild(node, count - 1);
+            x += m_Offset[child];
+            return child;
+        }
+        return Follow(m_RightThread[node], x);
+    }
+
+    void TreeLayout::Merge(NodeId parent) {
+        // Threads of this subtree are only ever set by its ancestors' merges,
+        // and the ones this node set before are dropped with its generation
+        ++m_Generation[parent];
+        if (m_Flags[parent] & Stale) m_Flags[parent] |= Merged;
+        m_HalfWidth[parent] = GetLayoutWidth(m_Nodes, parent) * 0.5f;
+        m_LeftThread[parent] = Thread();
+        m_RightThread[parent] = Thread();
+
+        uint32_t count = m_Nodes.GetChildCount(parent);
+        if (count == 0) {
+            m_Extent[parent] = { 0, parent, parent, 0.0, 0.0 };
+            m_Size[parent] = 1;
+            return;
+        }
+
+        // Children are placed left to right in the frame of the first one;
+        // 'forest' is the extent of those placed so far
+        const NodeId* children = m_Nodes.GetChildren(parent);
+        m_Offset[children[0]] = 0.0;
+        Extent forest = m_Extent[children[0]];
+        for (uint32_t slot = 1; slot < count; ++slot) {
+            NodeId subtree = children[slot];
+            const Extent& extent = m_Extent[subtree];
+
+            // Right contour of the forest against the left contour of the
+            // subtree, level by level until one of them ends
+            NodeId right = children[slot - 1], left = subtree;
+            double rightX = m_Offset[right], leftX = 0.0;
+            double shift = rightX + m_HalfWidth[right] + NodeGap + m_HalfWidth[left] - leftX;
+            NodeId nextRight, nextLeft;
+            for (;;) {
+                nextRight = NextRight(right, rightX);
+                nextLeft = NextLeft(left, leftX);
+                if (nextRight == InvalidNode || nextLeft == InvalidNode) break;
+                right = nextRight;
+                left = nextLeft;
+                shift = std::max(shift, rightX + m_HalfWidth[right] + NodeGap + m_HalfWidth[left] - leftX);
+            }
+            m_Offset[subtree] = shift;
+
+            // The shallower side's contour continues into the deeper one's,
+            // from the level where the walk stopped
+            if (extent.Height > forest.Height) {
+                m_LeftThread[forest.Left] = { nextLeft, parent, m_Generation[parent], shift + leftX - forest.LeftX };
+                forest = { extent.Height, extent.Left, extent.Right, shift + extent.LeftX, shift + extent.RightX };
+            } else if (extent.Height < forest.Height) {
+                m_RightThread[extent.Right] = { nextRight, parent, m_Generation[parent], rightX - (shift + extent.RightX) };
+            } else {
+                forest.Right = extent.Right;
+                forest.RightX = shift + extent.RightX;
+            }
+        }
+
+        // Center the parent over its outermost children
+        double middle = m_Offset[children[count - 1]] * 0.5;
+        uint32_t size = 1;
+        for (uint32_t slot = 0; slot < count; ++slot) {
+            m_Offset[children[slot]] -= middle;
+            size += m_Size[children[slot]];
+        }
+        m_Size[parent] = size;
+        m_Extent[parent] = { forest.Height + 1, forest.Left, forest.Right, forest.LeftX - middle, forest.RightX - middle };
+    }
+
+    uint32_t TreeLayout::PlaceEdited(NodeId top) {
+        // The top is where the edited paths start from: it must be in place
+        if (m_Flags[top] & Shifted) {
+            m_Flags[top] &= ~Shifted;
+            m_Nodes.TranslateSubtree(top, m_ShiftX[top], m_ShiftY[top]);
+        }
+
+        // Edited nodes go where their parent's merge put them. The subtrees
+        // of their other children would move rigidly along: they are only
+        // given the shift that takes their root into place, which replaces
+        // any shift still pending, and Resolve() moves them
+        uint32_t moved = 0;
+        std::vector<NodeId> stack = { top };
+        while (!stack.empty()) {
+            NodeId node = stack.back();
+            stack.pop_back();
+            double x = m_Nodes.GetX(node);
+            float y = m_Nodes.GetY(node) + LevelSpacing;
+            const NodeId* children = m_Nodes.GetChildren(node);
+            for (uint32_t slot = 0, count = m_Nodes.GetChildCount(node); slot < count; ++slot) {
+                NodeId child = children[slot];
+                float childX = float(x + m_Offset[child]);
+                if (m_Flags[child] & Edited) {
+                    // Written where it belongs: a shift it was waiting for no longer applies
+                    m_Flags[child] &= ~Shifted;
+                    if (m_Nodes.GetX(child) != childX || m_Nodes.GetY(child) != y) {
+                        m_Nodes.SetPosition(child, childX, y);
+                        ++moved;
+                    }
+                    stack.push_back(child);
+                    continue;
+                }
+                float dx = childX - m_Nodes.GetX(child), dy = y - m_Nodes.GetY(child);
+                if (dx == 0.0f && dy == 0.0f) {
+                    m_Flags[child] &= ~Shifted;
+                    continue;
+                }
+                if (!(m_Flags[child] & Shifted)) {
+                    m_Flags[child] |= Shifted;
+                    m_Shifted.push_back(child);
+                }
+                m_ShiftX[child] = dx;
+                m_ShiftY[child] = dy;
+            }
+        }
+        return moved;
+    }
+
+}
@@ -0,0 +1,179 @@
+/**
+ * TreeLayout.h
+ * Tidy placement of a tree's nodes
+ *
+ * Places every node so that nothing overlaps, parents are centered over
+ * their children and each level is as narrow as the drawn node widths
+ * allow (Reingold-Tilford). Subtrees are laid out bottom-up: each child
+ * subtree is pushed right of its left siblings just far enough that, at
+ * every level they share, their contours are NodeGap apart. Contours are
+ * followed through the children of contour nodes and through threads, links
+ * from the last node of a contour to where the contour continues in a deeper
+ * sibling subtree, so a merge only walks the levels the two sides share and
+ * a whole layout is linear in the number of nodes.
+ *
+ * Horizontal offsets are kept relative to the parent and only turned into
+ * positions by a final pre-order pass, in doubles so that the sums along
+ * deep paths of very wide trees stay exact to the pixel.
+ *
+ * The layout observes the store and keeps every subtree's offsets, contour
+ * threads and extent between edits. An edit only marks the path from the
+ * edited node to its root; Update() merges again just the nodes of that
+ * path, each from its children's cached contours, then moves the path's
+ * nodes into place. Their other children's subtrees only record the shift
+ * that takes them into place, so an edit writes no more than its paths;
+ * Resolve() moves the shifted subtrees, each as one translation the store's
+ * observers see once. Threads are stamped with the generation of the merge
+ * that set them, so re-merging a node drops its old threads without
+ * visiting them.
+ *
+ * Given a thread pool, a whole layout of a large tree is split by subtree
+ * size: the largest subtrees under a fixed share of its nodes go to workers,
+ * which merge them independently, and the nodes above them are merged last.
+ * Merges keep subtree sizes, so only a tree never laid out is counted
+ * first. Every merge reads only its own subtree, so the result is
+ * bit-identical to a layout on one thread.
+ */
+
+#pragma once
+
+#include "NodeStore.h"
+#include <cstdint>
+#include <vector>
+
+namespace Core {
+    class ThreadPool;
+}
+
+namespace Data {
+
+    /**
+     * @brief Width a node is drawn at (scale 1): its shape or its label, whichever is wider
+     */
+    float GetLayoutWidth(const NodeStore& nodes, NodeId id);
+
+    /**
+     * @class TreeLayout
+     * @brief Tidy positions for the nodes of a NodeStore, kept up to date as it is edited
+     *
+     * Used from the thread that edits the store. Moving nodes does not
+     * invalidate the layout; nodes moved by hand keep their place until an
+     * edit below their parent lays that parent's children out again.
+     */
+    class TreeLayout : public NodeObserver {
+    public:
+        static constexpr float NodeGap = 20.0f;          ///< Least horizontal space between two nodes of a level
+        static constexpr float LevelSpacing = 150.0f;    ///< Vertical distance from a parent to its children
+        static constexpr uint32_t ParallelThreshold = 100000;   ///< Subtree size from which a whole layout uses the pool
+
+        /**
+         * @param nodes Store to observe; every node in it starts out to be laid out
+         * @param pool Workers for whole layouts of large trees (optional; must outlive the layout)
+         *
+         * Nothing moves until Apply(), or Update() after an edit.
+         */
+        explicit TreeLayout(NodeStore& nodes, Core::ThreadPool* pool = nullptr);
+        ~TreeLayout() override;
+
+        TreeLayout(const TreeLayout&) = delete;
+        TreeLayout& operator=(const TreeLayout&) = delete;
+
+        /**
+         * @brief Lay out a whole subtree with its root at (x, y)
+         * @return Number of nodes whose position changed
+         */
+        uint32_t Apply(NodeId root, float x, float y);
+
+        /**
+         * @brief Lay out again the paths edited since the last call
+         * @return Number of nodes whose position changed
+         *
+         * The root of each edited tree stays where it is. Costs the merges of
+         * the edited paths' nodes plus one write per path node that moves;
+         * the subtrees beside the paths are left to Resolve().
+         */
+        uint32_t Update();
+
+        /**
+         * @brief Move the subtrees Update() shifted since the last call into place
+         * @return Number of subtrees moved
+         *
+         * Call before positions are read. A subtree shifted by several
+         * updates is moved once, by the sum of its shifts.
+         */
+        uint32_t Resolve();
+
+        /**
+         * @brief Compute the relative placement of a subtree from scratch, without moving any node
+         *
+         * Split over the pool when there is one with two workers or more and
+         * the subtree holds ParallelThreshold nodes or more.
+         */
+        void Compute(NodeId root);
+
+        /**
+         * @brief Move the nodes of a laid out subtree into place
+         * @return Number of nodes whose position changed
+         *
+         * Only nodes that actually move are written, and so reported to the
+         * store's observers.
+         */
+        uint32_t Place(NodeId root, float x, float y);
+
+        /**
+         * @brief Offset of a laid out node from its parent
+         */
+        double GetOffset(NodeId node) const { return m_Offset[node]; }
+
+        size_t GetPendingCount() const { return m_Stale.size(); }   ///< Nodes marked since the last Update()
+        size_t GetShiftedCount() const { return m_Shifted.size(); }  ///< Subtrees shifted since the last Resolve()
+
+        void OnNodeChanged(NodeId id) override;
+        void OnNodeMoved(NodeId, float, float) override {}
+        void OnSubtreeMoved(const NodeStore&, NodeId, float, float) override {}
+        void OnNodeDestroyed(NodeId id) override;
+        void OnStoreCleared() override;
+
+    private:
+        /// Where a contour continues below a leaf, relative to the leaf
+        struct Thread {
+            NodeId Node = InvalidNode;
+            NodeId Owner = InvalidNode;   ///< Node whose merge set the thread
+            uint32_t Generation = 0;      ///< Owner's generation at that merge
+            double Offset = 0.0;
+        };
+
+        /// Deepest level of a subtree and its outermost nodes there, relative to the subtree root
+        struct Extent {
+            uint32_t Height;
+            NodeId Left, Right;
+            double LeftX, RightX;
+        };
+
+        void Grow();
+        void Merge(NodeId parent);
+        void Count(NodeId root);   ///< Sets m_Size throughout a subtree
+        void MergeSubtree(NodeId root, uint8_t mask, uint8_t value);   ///< Descends into children whose flags & mask == value
+        NodeId Follow(const Thread& thread, double& x) const;
+        NodeId NextLeft(NodeId node, double& x) const;
+        NodeId NextRight(NodeId node, double& x) const;
+        uint32_t PlaceEdited(NodeId top);
+
+        NodeStore& m_Nodes;
+        Core::ThreadPool* m_Pool;
+        std::vector<double> m_Offset;          ///< X relative to the parent, by NodeId
+        std::vector<float> m_HalfWidth;        ///< Half of GetLayoutWidth(), by NodeId
+        std::vector<Thread> m_LeftThread;      ///< Continuation of the left contour below a leaf
+        std::vector<Thread> m_RightThread;     ///< Continuation of the right contour below a leaf
+        std::vector<Extent> m_Extent;          ///< Of each laid out subtree, by root NodeId
+        std::vector<uint32_t> m_Generation;    ///< Merges of each node so far
+        std::vector<uint8_t> m_Flags;          ///< Stale / edited / merged / shifted, by NodeId
+        std::vector<NodeId> m_Stale;           ///< Nodes to merge again (and their ancestors)
+        std::vector<uint32_t> m_Size;          ///< Nodes of each merged or counted subtree, by root NodeId
+        std::vector<NodeId> m_Order;           ///< Nodes being counted, breadth-first
+        std::vector<float> m_ShiftX;           ///< Pending move of each shifted subtree, by root NodeId
+        std::vector<float> m_ShiftY;
+        std::vector<NodeId> m_Shifted;         ///< Roots of subtrees to move at Resolve()
+    };
+
+}
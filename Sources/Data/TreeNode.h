@@ -5,6 +5,10 @@
  * Defines the data model for decision tree nodes, including node types,
  * visual shapes, connections between nodes, and all associated properties
  * for layout, animation, and rendering.
+ *
+ * Documents store their nodes in a Data::NodeStore; TreeNode remains as a
+ * self-contained pointer-linked form of a tree, which Eval::Compiler also
+ * accepts.
  */
 
 #pragma once
@@ -41,6 +45,29 @@ namespace Data {
         Capsule     ///< Rounded capsule shape
     };
 
+    /**
+     * @brief Get the default shape and color for a node type
+     * @param type Semantic type of the node
+     * @param shape Receives the default shape
+     * @param r Receives the red component
+     * @param g Receives the green component
+     * @param b Receives the blue component
+     *
+     * - Start: Green capsule
+     * - Action: Blue rectangle
+     * - Condition: Orange diamond
+     * - End: Red capsule
+     */
+    inline void GetDefaultStyle(NodeType type, ShapeType& shape, uint8_t& r, uint8_t& g, uint8_t& b) {
+        switch (type) {
+            case NodeType::Start: shape = ShapeType::Capsule; r = 50; g = 200; b = 50; break;
+            case NodeType::Action: shape = ShapeType::Rectangle; r = 50; g = 100; b = 200; break;
+            case NodeType::Condition: shape = ShapeType::Diamond; r = 200; g = 150; b = 50; break;
+            case NodeType::End: shape = ShapeType::Capsule; r = 200; g = 50; b = 50; break;
+            default: shape = ShapeType::Rectangle; r = 100; g = 100; b = 100; break;
+        }
+    }
+
     struct TreeNode; // Forward declaration
 
     /**
@@ -58,7 +85,8 @@ namespace Data {
      * 
      * Contains all data for a single node including its label, type, visual properties,
      * layout position, animation state, and connections to child nodes.
-     * Manages ownership of child nodes through the Connections vector.
+     * A node does not own its children; Connections only links them, and
+     * whoever builds a hierarchy frees it.
      */
     struct TreeNode {
         // Core data
@@ -83,45 +111,23 @@ namespace Data {
          * @param label Display label for the node
          * @param type Semantic type (determines default shape and color)
          * 
-         * Initializes a new node with type-specific defaults:
-         * - Start: Green capsule
-         * - Action: Blue rectangle
-         * - Condition: Orange diamond
-         * - End: Red capsule
+         * Initializes a new node with the type-specific defaults
+         * returned by GetDefaultStyle().
          */
         TreeNode(const std::string& label, NodeType type = NodeType::Action) 
             : Label(label), IsLeaf(true), Type(type), X(0), Y(0), Scale(0.0f), TargetScale(1.0f) {
-            
-            // Set default shape and color based on node type
-            switch (type) {
-                case NodeType::Start: Shape = ShapeType::Capsule; R = 50; G = 200; B = 50; break;
-                case NodeType::Action: Shape = ShapeType::Rectangle; R = 50; G = 100; B = 200; break;
-                case NodeType::Condition: Shape = ShapeType::Diamond; R = 200; G = 150; B = 50; break;
-                case NodeType::End: Shape = ShapeType::Capsule; R = 200; G = 50; B = 50; break;
-                default: Shape = ShapeType::Rectangle; R = 100; G = 100; B = 100; break;
-            }
+            GetDefaultStyle(type, Shape, R, G, B);
         }
 
         /**
          * @brief Add a child node with an optional edge label
-         * @param child Pointer to the child node (ownership transferred)
+         * @param child Pointer to the child node (not owned)
          * @param connectionLabel Label to display on the connecting edge
          */
         void AddChild(TreeNode* child, const std::string& connectionLabel = "") {
             Connections.push_back({ child, connectionLabel });
             IsLeaf = false;
         }
-
-        /**
-         * @brief Destructor - recursively deletes all child nodes
-         * 
-         * Ensures proper cleanup of the entire subtree.
-         */
-        ~TreeNode() {
-            for (auto& conn : Connections) {
-                delete conn.Target;
-            }
-        }
     };
 
 }
@@ -0,0 +1,351 @@
+/**
+ * Animator.cpp
+ * Implementation of the Animator class
+ */
+
+#include "Animator.h"
+#include <algorithm>
+#include <cmath>
+
+namespace Editor {
+
+    namespace {
+
+        // Ages of a node as seen by the animator
+        constexpr uint8_t Unknown = 0;   ///< Not created, or not yet reported
+        constexpr uint8_t Born = 1;      ///< Created since the last Update(); placed without sliding
+        constexpr uint8_t Known = 2;
+
+        constexpr float ScaleEpsilon = 0.002f;   ///< Closer than this to its target, a scale snaps to it
+        constexpr float MoveEpsilon = 0.25f;     ///< Pixels
+        constexpr float GhostEpsilon = 0.05f;    ///< Scale below which a ghost is dropped
+
+    }
+
+    Animator::Animator(Data::NodeStore& nodes) : m_Nodes(nodes), m_Hovered(Data::InvalidNode), m_Selected(Data::InvalidNode), m_InTransition(false),
+        m_ScaleDense(false), m_MoveDense(false), m_ScaleActive(0), m_MoveActive(0) {
+        Grow();
+        const float* scale = m_Nodes.GetScaleData();
+        for (Data::NodeId id = 0, n = m_Nodes.GetCapacity(); id < n; ++id) {
+            if (!m_Nodes.IsAlive(id)) continue;
+            m_Age[id] = Known;
+            if (scale[id] != GetRestScale(id)) Retarget(id);
+        }
+        m_Nodes.AddObserver(this);
+    }
+
+    Animator::~Animator() {
+        m_Nodes.RemoveObserver(this);
+    }
+
+    void Animator::Update(float deltaTime) {
+        // The same fraction of the remaining gap per second whatever the frame rate
+        float approach = 1.0f - std::exp(-ScaleRate * deltaTime);
+        float decay = std::exp(-MoveRate * deltaTime);
+
+        UpdateScales(approach);
+        UpdateMoves(decay);
+
+        for (Ghost& ghost : m_Ghosts) ghost.Scale -= ghost.Scale * approach;
+        m_Ghosts.erase(std::remove_if(m_Ghosts.begin(), m_Ghosts.end(), [](const Ghost& ghost) { return ghost.Scale < GhostEpsilon; }), m_Ghosts.end());
+
+        for (Data::NodeId node : m_Born) {
+            if (m_Age[node] == Born) m_Age[node] = Known;
+        }
+        m_Born.clear();
+    }
+
+    void Animator::UpdateScales(float approach) {
+        float* scale = m_Nodes.GetScaleData();
+        const float* targetScale = m_Nodes.GetTargetScaleData();
+        size_t capacity = m_Nodes.GetCapacity();
+        if (m_ScaleDense) {
+            // Nodes at rest sit at their target and stay there, so every node
+            // is stepped alike, without branches
+            size_t active = 0;
+            for (size_t i = 0; i < capacity; ++i) {
+                float value = scale[i] + (targetScale[i] - scale[i]) * approach;
+                value = std::abs(targetScale[i] - value) < ScaleEpsilon ? targetScale[i] : value;
+                scale[i] = value;
+                active += value != targetScale[i];
+            }
+            m_ScaleActive = active;
+            if (active * DenseShare * 2 >= m_Nodes.GetLiveCount()) return;
+
+            // Few enough left to pack again
+            m_ScaleDense = false;
+            for (Data::NodeId id = 0; id < capacity; ++id) {
+                if (scale[id] == targetScale[id] || !m_Nodes.IsAlive(id)) continue;
+                m_ScaleSlot[id] = static_cast<uint32_t>(m_ScaleNodes.size());
+                m_ScaleNodes.push_back(id);
+                m_ScaleValues.push_back(scale[id]);
+                m_ScaleTargets.push_back(targetScale[id]);
+            }
+            return;
+        }
+
+        // Stepped as one pass over the packed arrays, then written back and
+        // compacted in a second pass
+        size_t count = m_ScaleNodes.size();
+        float* values = m_ScaleValues.data();
+        const float* targets = m_ScaleTargets.data();
+        for (size_t i = 0; i < count; ++i) values[i] += (targets[i] - values[i]) * approach;
+
+        size_t kept = 0;
+        for (size_t i = 0; i < count; ++i) {
+            Data::NodeId node = m_ScaleNodes[i];
+            float value = std::abs(targets[i] - values[i]) < ScaleEpsilon ? targets[i] : values[i];
+            scale[node] = value;
+            if (value == targets[i]) {
+                m_ScaleSlot[node] = NoSlot;
+                continue;
+            }
+            // Entries before the first finished one stay where they are
+            if (kept != i) {
+                m_ScaleNodes[kept] = node;
+                m_ScaleTargets[kept] = targets[i];
+                m_ScaleSlot[node] = static_cast<uint32_t>(kept);
+            }
+            m_ScaleValues[kept++] = value;
+        }
+        m_ScaleNodes.resize(kept);
+        m_ScaleValues.resize(kept);
+        m_ScaleTargets.resize(kept);
+    }
+
+    void Animator::UpdateMoves(float decay) {
+        size_t capacity = m_Nodes.GetCapacity();
+        if (m_MoveDense) {
+            float* xs = m_OffsetX.data();
+            float* ys = m_OffsetY.data();
+            size_t active = 0;
+            for (size_t i = 0; i < capacity; ++i) {
+                float x = xs[i] * decay, y = ys[i] * decay;
+                bool rest = std::abs(x) < MoveEpsilon && std::abs(y) < MoveEpsilon;
+                xs[i] = rest ? 0.0f : x;
+                ys[i] = rest ? 0.0f : y;
+                active += !rest;
+            }
+            m_MoveActive = active;
+            if (active * DenseShare * 2 >= m_Nodes.GetLiveCount()) return;
+
+            m_MoveDense = false;
+            for (Data::NodeId id = 0; id < capacity; ++id) {
+                if (xs[id] != 0.0f || ys[id] != 0.0f) AddMove(id, xs[id], ys[id]);
+            }
+            return;
+        }
+
+        size_t count = m_MoveNodes.size();
+        float* xs = m_MoveX.data();
+        float* ys = m_MoveY.data();
+        for (size_t i = 0; i < count; ++i) {
+            xs[i] *= decay;
+            ys[i] *= decay;
+        }
+        size_t kept = 0;
+        for (size_t i = 0; i < count; ++i) {
+            Data::NodeId node = m_MoveNodes[i];
+            if (std::abs(xs[i]) < MoveEpsilon && std::abs(ys[i]) < MoveEpsilon) {
+                m_MoveSlot[node] = NoSlot;
+                continue;
+            }
+            if (kept != i) {
+                m_MoveNodes[kept] = node;
+                m_MoveX[kept] = xs[i];
+                m_MoveY[kept] = ys[i];
+                m_MoveSlot[node] = static_cast<uint32_t>(kept);
+            }
+            ++kept;
+        }
+        m_MoveNodes.resize(kept);
+        m_MoveX.resize(kept);
+        m_MoveY.resize(kept);
+    }
+
+    void Animator::SetFocus(Data::NodeId hovered, Data::NodeId selected) {
+        if (hovered == m_Hovered && selected == m_Selected) return;
+        Data::NodeId changed[] = { m_Hovered, m_Selected, hovered, selected };
+        m_Hovered = hovered;
+        m_Selected = selected;
+        for (Data::NodeId id : changed) {
+            if (m_Nodes.IsAlive(id)) Retarget(id);
+        }
+    }
+
+    void Animator::AddExit(Data::NodeId root) {
+        if (!m_Nodes.IsLive(root)) return;
+
+        // Breadth-first, so that a capped deletion still shows the nodes nearest its root
+        std::vector<Data::NodeId> queue = { root };
+        for (size_t i = 0; i < queue.size() && i < MaxExitNodes; ++i) {
+            Data::NodeId node = queue[i];
+            for (uint32_t c = 0; c < m_Nodes.GetChildCount(node); ++c) queue.push_back(m_Nodes.GetChild(node, c));
+        }
+        if (queue.size() > MaxExitNodes) queue.resize(MaxExitNodes);
+
+        for (Data::NodeId node : queue) {
+            float x = m_Nodes.GetX(node), y = m_Nodes.GetY(node);
+            GetDrawnPosition(node, x, y);
+            m_Ghosts.push_back({ x, y, m_Nodes.GetScale(node), m_Nodes.GetShape(node), m_Nodes.GetColor(node), std::string(m_Nodes.GetLabel(node)) });
+        }
+    }
+
+    void Animator::OnNodeChanged(Data::NodeId id) {
+        Grow();
+        if (m_Age[id] != Unknown) return;
+
+        // First report of a node is its creation: it pops in where it is placed
+        m_Age[id] = Born;
+        m_Born.push_back(id);
+        Retarget(id);
+    }
+
+    void Animator::OnNodeMoved(Data::NodeId id, float oldX, float oldY) {
+        Grow();
+        if (!m_InTransition || m_Age[id] != Known) return;
+
+        // Slide from where the node is drawn now, which may be mid-way through an earlier move
+        float dx = oldX - m_Nodes.GetX(id), dy = oldY - m_Nodes.GetY(id);
+        GetDrawnPosition(id, dx, dy);
+        if (std::abs(dx) < MoveEpsilon && std::abs(dy) < MoveEpsilon) {
+            RemoveMove(id);
+        } else if (m_MoveDense) {
+            m_OffsetX[id] = dx;
+            m_OffsetY[id] = dy;
+        } else if (m_MoveSlot[id] != NoSlot) {
+            m_MoveX[m_MoveSlot[id]] = dx;
+            m_MoveY[m_MoveSlot[id]] = dy;
+        } else {
+            AddMove(id, dx, dy);
+        }
+    }
+
+    void Animator::OnSubtreeMoved(const Data::NodeStore& nodes, Data::NodeId root, float dx, float dy) {
+        // Outside a transition no node of the subtree would slide
+        if (m_InTransition) NodeObserver::OnSubtreeMoved(nodes, root, dx, dy);
+    }
+
+    void Animator::OnNodeDestroyed(Data::NodeId id) {
+        if (id >= m_Age.size()) return;
+        RemoveScale(id);
+        RemoveMove(id);
+        m_Age[id] = Unknown;
+    }
+
+    void Animator::OnStoreCleared() {
+        m_ScaleNodes.clear(); m_ScaleValues.clear(); m_ScaleTargets.clear();
+        m_MoveNodes.clear(); m_MoveX.clear(); m_MoveY.clear();
+        m_ScaleSlot.clear(); m_MoveSlot.clear(); m_Age.clear();
+        m_ScaleDense = m_MoveDense = false;
+        m_ScaleActive = m_MoveActive = 0;
+        m_OffsetX.clear(); m_OffsetY.clear();
+        m_Born.clear();
+        m_Ghosts.clear();
+        m_Hovered = m_Selected = Data::InvalidNode;
+    }
+
+    float Animator::GetRestScale(Data::NodeId id) const {
+        if (id == m_Hovered) return HoverScale;
+        if (id == m_Selected) return SelectedScale;
+        return 1.0f;
+    }
+
+    void Animator::Grow() {
+        size_t capacity = m_Nodes.GetCapacity();
+        if (m_Age.size() >= capacity) return;
+        m_ScaleSlot.resize(capacity, NoSlot);
+        m_MoveSlot.resize(capacity, NoSlot);
+        m_Age.resize(capacity, Unknown);
+        if (m_MoveDense) {
+            m_OffsetX.resize(capacity, 0.0f);
+            m_OffsetY.resize(capacity, 0.0f);
+        }
+    }
+
+    void Animator::Retarget(Data::NodeId id) {
+        Grow();
+        float target = GetRestScale(id);
+        m_Nodes.GetTargetScaleData()[id] = target;
+        if (m_ScaleDense) return;   // The next sweep picks the new target up
+        uint32_t slot = m_ScaleSlot[id];
+        if (slot != NoSlot) {
+            m_ScaleTargets[slot] = target;
+        } else if (m_Nodes.GetScale(id) != target) {
+            m_ScaleSlot[id] = static_cast<uint32_t>(m_ScaleNodes.size());
+            m_ScaleNodes.push_back(id);
+            m_ScaleValues.push_back(m_Nodes.GetScale(id));
+            m_ScaleTargets.push_back(target);
+            if (m_ScaleNodes.size() * DenseShare > m_Nodes.GetLiveCount()) MakeScalesDense();
+        }
+    }
+
+    void Animator::RemoveScale(Data::NodeId id) {
+        if (m_ScaleDense) {
+            // Left at rest, a freed node drops out of the sweep's count
+            m_Nodes.SetScale(id, m_Nodes.GetTargetScaleData()[id]);
+            return;
+        }
+        uint32_t slot = m_ScaleSlot[id];
+        if (slot == NoSlot) return;
+        // The last animation takes the freed place, keeping the channel packed
+        Data::NodeId last = m_ScaleNodes.back();
+        m_ScaleNodes[slot] = last;
+        m_ScaleValues[slot] = m_ScaleValues.back();
+        m_ScaleTargets[slot] = m_ScaleTargets.back();
+        m_ScaleSlot[last] = slot;
+        m_ScaleNodes.pop_back(); m_ScaleValues.pop_back(); m_ScaleTargets.pop_back();
+        m_ScaleSlot[id] = NoSlot;
+    }
+
+    void Animator::RemoveMove(Data::NodeId id) {
+        if (m_MoveDense) {
+            m_OffsetX[id] = m_OffsetY[id] = 0.0f;
+            return;
+        }
+        uint32_t slot = m_MoveSlot[id];
+        if (slot == NoSlot) return;
+        Data::NodeId last = m_MoveNodes.back();
+        m_MoveNodes[slot] = last;
+        m_MoveX[slot] = m_MoveX.back();
+        m_MoveY[slot] = m_MoveY.back();
+        m_MoveSlot[last] = slot;
+        m_MoveNodes.pop_back(); m_MoveX.pop_back(); m_MoveY.pop_back();
+        m_MoveSlot[id] = NoSlot;
+    }
+
+    void Animator::AddMove(Data::NodeId id, float dx, float dy) {
+        m_MoveSlot[id] = static_cast<uint32_t>(m_MoveNodes.size());
+        m_MoveNodes.push_back(id);
+        m_MoveX.push_back(dx);
+        m_MoveY.push_back(dy);
+        if (m_MoveNodes.size() * DenseShare > m_Nodes.GetLiveCount()) MakeMovesDense();
+    }
+
+    void Animator::MakeScalesDense() {
+        // Most of the tree is animating: from here on the store's columns are
+        // stepped whole, and they already hold every value and target
+        m_ScaleDense = true;
+        m_ScaleActive = m_ScaleNodes.size();
+        for (Data::NodeId node : m_ScaleNodes) m_ScaleSlot[node] = NoSlot;
+        m_ScaleNodes.clear();
+        m_ScaleValues.clear();
+        m_ScaleTargets.clear();
+    }
+
+    void Animator::MakeMovesDense() {
+        m_MoveDense = true;
+        m_MoveActive = m_MoveNodes.size();
+        m_OffsetX.assign(m_Nodes.GetCapacity(), 0.0f);
+        m_OffsetY.assign(m_Nodes.GetCapacity(), 0.0f);
+        for (size_t i = 0; i < m_MoveNodes.size(); ++i) {
+            m_OffsetX[m_MoveNodes[i]] = m_MoveX[i];
+            m_OffsetY[m_MoveNodes[i]] = m_MoveY[i];
+            m_MoveSlot[m_MoveNodes[i]] = NoSlot;
+        }
+        m_MoveNodes.clear();
+        m_MoveX.clear();
+        m_MoveY.clear();
+    }
+
+}
@@ -0,0 +1,156 @@
+/**
+ * Animator.h
+ * Time-based animation of the editor's nodes
+ *
+ * Only nodes that are animating are tracked. Scale animations (pop-in of
+ * new nodes, hover, selection) and move transitions (nodes sliding to where
+ * a layout placed them) are kept in packed arrays, one per channel, and
+ * advanced together once per frame with the real frame time. A node at rest
+ * costs nothing per frame, so the cost of a frame follows what is moving,
+ * not the size of the tree. A channel animating more than a fixed share of
+ * the tree switches to whole columns by NodeId instead: one sequential
+ * sweep then costs less than the packed arrays' scattered writes.
+ *
+ * Positions in the store are always final: a move transition only keeps
+ * the offset from there to where the node is drawn, decaying to zero.
+ * Deleted subtrees leave exit ghosts, copies of their nodes that shrink
+ * away after the nodes themselves have left the document.
+ */
+
+#pragma once
+
+#include "../Data/NodeStore.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Editor {
+
+    /**
+     * @class Animator
+     * @brief Active scale and move animations of a NodeStore's nodes
+     *
+     * Observes the store: created nodes pop in and, between BeginTransition()
+     * and EndTransition(), moved nodes slide from where they were drawn.
+     * Moves outside a transition (drags, loads) take effect at once.
+     */
+    class Animator : public Data::NodeObserver {
+    public:
+        static constexpr float ScaleRate = 6.3f;        ///< Per second; about a tenth of the gap per frame at 60 fps
+        static constexpr float MoveRate = 10.0f;        ///< Per second
+        static constexpr float HoverScale = 1.2f;
+        static constexpr float SelectedScale = 1.1f;
+        static constexpr uint32_t MaxExitNodes = 4096;  ///< Ghosts left by one deletion, the subtree's top nodes first
+        static constexpr uint32_t DenseShare = 2;       ///< A channel animating over 1/DenseShare of the live nodes uses columns
+
+        /// Copy of a deleted node, drawn while it shrinks away
+        struct Ghost {
+            float X, Y, Scale;
+            Data::ShapeType Shape;
+            Data::Color Color;
+            std::string Label;
+        };
+
+        /**
+         * @param nodes Store to observe; its nodes away from their resting scale are animated toward it
+         */
+        explicit Animator(Data::NodeStore& nodes);
+        ~Animator() override;
+
+        Animator(const Animator&) = delete;
+        Animator& operator=(const Animator&) = delete;
+
+        /**
+         * @brief Advance every active animation
+         * @param deltaTime Seconds since the last call
+         *
+         * Writes the new scales to the store and drops the animations that
+         * have come to rest.
+         */
+        void Update(float deltaTime);
+
+        /**
+         * @brief Set the hovered and selected nodes, which rest larger
+         *
+         * Only the nodes whose focus changed are retargeted.
+         */
+        void SetFocus(Data::NodeId hovered, Data::NodeId selected);
+
+        void BeginTransition() { m_InTransition = true; }   ///< Animate moves from here on
+        void EndTransition() { m_InTransition = false; }    ///< Moves take effect at once again
+
+        /**
+         * @brief Leave ghosts of a subtree about to be deleted, drawn where its nodes are now
+         */
+        void AddExit(Data::NodeId root);
+
+        /**
+         * @brief Shift a node's stored position to where it is drawn
+         */
+        void GetDrawnPosition(Data::NodeId id, float& x, float& y) const {
+            if (m_MoveDense) {
+                x += m_OffsetX[id];
+                y += m_OffsetY[id];
+            } else if (id < m_MoveSlot.size() && m_MoveSlot[id] != NoSlot) {
+                x += m_MoveX[m_MoveSlot[id]];
+                y += m_MoveY[m_MoveSlot[id]];
+            }
+        }
+
+        const std::vector<Ghost>& GetGhosts() const { return m_Ghosts; }
+        size_t GetActiveCount() const {
+            return (m_ScaleDense ? m_ScaleActive : m_ScaleNodes.size()) + (m_MoveDense ? m_MoveActive : m_MoveNodes.size()) + m_Ghosts.size();
+        }
+
+        void OnNodeChanged(Data::NodeId id) override;
+        void OnNodeMoved(Data::NodeId id, float oldX, float oldY) override;
+        void OnSubtreeMoved(const Data::NodeStore& nodes, Data::NodeId root, float dx, float dy) override;
+        void OnNodeDestroyed(Data::NodeId id) override;
+        void OnStoreCleared() override;
+
+    private:
+        static constexpr uint32_t NoSlot = UINT32_MAX;
+
+        float GetRestScale(Data::NodeId id) const;
+        void Grow();
+        void Retarget(Data::NodeId id);
+        void RemoveScale(Data::NodeId id);
+        void RemoveMove(Data::NodeId id);
+        void UpdateScales(float approach);
+        void UpdateMoves(float decay);
+        void AddMove(Data::NodeId id, float dx, float dy);
+        void MakeScalesDense();
+        void MakeMovesDense();
+
+        Data::NodeStore& m_Nodes;
+        Data::NodeId m_Hovered;
+        Data::NodeId m_Selected;
+        bool m_InTransition;
+
+        // Scale channel: animating nodes, their current and target scales
+        std::vector<Data::NodeId> m_ScaleNodes;
+        std::vector<float> m_ScaleValues;
+        std::vector<float> m_ScaleTargets;
+
+        // Move channel: animating nodes and their drawn offset from the stored position
+        std::vector<Data::NodeId> m_MoveNodes;
+        std::vector<float> m_MoveX;
+        std::vector<float> m_MoveY;
+
+        // Dense channels: the scale channel steps the store's scale columns,
+        // the move channel keeps every node's offset; the packed arrays are empty
+        bool m_ScaleDense;
+        bool m_MoveDense;
+        size_t m_ScaleActive;                ///< Nodes away from their target at the last Update(), when dense
+        size_t m_MoveActive;                 ///< Nodes with an offset at the last Update(), when dense
+        std::vector<float> m_OffsetX;        ///< Drawn offset by NodeId, when the move channel is dense
+        std::vector<float> m_OffsetY;
+
+        std::vector<uint32_t> m_ScaleSlot;   ///< Index in the scale channel, by NodeId
+        std::vector<uint32_t> m_MoveSlot;    ///< Index in the move channel, by NodeId
+        std::vector<uint8_t> m_Age;          ///< Unknown, created since the last Update() or older, by NodeId
+        std::vector<Data::NodeId> m_Born;    ///< Nodes created since the last Update()
+        std::vector<Ghost> m_Ghosts;
+    };
+
+}
@@ -5,90 +5,197 @@
 
 #include "Editor.h"
 #include "../Core/Input.h"
+#include "../IO/DocumentBinary.h"
+#include "../IO/DocumentCsv.h"
+#include "../IO/DocumentJson.h"
+#include "../Eval/CodeGen.h"
+#include "../Eval/Compiler.h"
+#include "../Eval/HitCounter.h"
+#include "../Eval/Scoring.h"
+#include "../Core/ThreadPool.h"
+#include <atomic>
 #include <iostream>
 #include <algorithm>
+#include <filesystem>
+#include <cmath>
+#include <cstdio>
 
 namespace Editor {
 
-    Editor::Editor() : m_Root(nullptr), m_SelectedNode(nullptr), m_HoveredNode(nullptr), m_IsDragging(false), m_DragOffsetX(0), m_DragOffsetY(0) {
+    namespace {
+
+        /**
+         * @brief File a document read from path is saved to: imported rule tables become JSON
+         */
+        std::string GetSavePathFor(const std::string& path) {
+            if (!IO::IsCsvPath(path)) return path;
+            return std::filesystem::path(path).replace_extension(".json").string();
+        }
+
+        /**
+         * @brief Heatmap color ramp from cold (0) through yellow to hot (1)
+         */
+        Data::Color HeatColor(float heat) {
+            auto mix = [](uint8_t a, uint8_t b, float t) { return static_cast<uint8_t>(a + (b - a) * t); };
+            if (heat < 0.5f) {
+                float t = heat * 2.0f;
+                return { mix(40, 240, t), mix(70, 220, t), mix(170, 60, t) };
+            }
+            float t = (heat - 0.5f) * 2.0f;
+            return { mix(240, 230, t), mix(220, 40, t), mix(60, 30, t) };
+        }
+
+    }
+
+    /**
+     * @struct Editor::HeatmapRun
+     * @brief State shared between the editor and the worker scoring records for the heatmap
+     */
+    struct Editor::HeatmapRun {
+        Eval::Program Program;
+        Eval::HitCounter Hits;
+        Data::NodeId Root = Data::InvalidNode;
+        std::atomic<bool> Started{ false };   ///< Program and Hits are ready to be read
+    };
+
+    Editor::Editor() : m_Document(std::make_unique<Data::Document>()), m_History(std::make_unique<History>(*m_Document)), m_Validator(std::make_unique<Eval::Validator>(*m_Document)), m_LayoutPool(Core::ThreadPool::GetHardwareThreads() > 1 ? std::make_unique<Core::ThreadPool>() : nullptr), m_Layout(std::make_unique<Data::TreeLayout>(m_Document->GetNodes(), m_LayoutPool.get())), m_Animator(std::make_unique<Animator>(m_Document->GetNodes())), m_FilePath("DecisionTree.json"), m_Journal(std::make_unique<IO::Journal>()), m_SavedRecordCount(0), m_FileOperation(FileOperation::None), m_TaskRecordCount(0), m_MaxNodeHits(0), m_ShowHeatmap(false), m_HeatmapRefresh(0), m_ShowShared(false), m_SharedRefresh(0), m_SelectedNode(Data::InvalidNode), m_HoveredNode(Data::InvalidNode), m_IsDragging(false), m_DragOffsetX(0), m_DragOffsetY(0), m_DragStartX(0), m_DragStartY(0) {
+        Data::NodeStore& nodes = m_Document->GetNodes();
+
         // Create initial demo decision tree
-        m_Root = new Data::TreeNode("Start", Data::NodeType::Start);
-        Data::TreeNode* child1 = new Data::TreeNode("Is Ready?", Data::NodeType::Condition);
-        Data::TreeNode* child2 = new Data::TreeNode("Do It", Data::NodeType::Action);
-        
-        m_Root->AddChild(child1); // Default label ""
-        child1->AddChild(child2, "Yes"); // Labeled connection
+        Data::NodeId root = m_Document->CreateNode("Start", Data::NodeType::Start);
+        Data::NodeId child1 = m_Document->CreateNode("Is Ready?", Data::NodeType::Condition);
+        Data::NodeId child2 = m_Document->CreateNode("Do It", Data::NodeType::Action);
+
+        nodes.AddChild(root, child1); // Default label ""
+        nodes.AddChild(child1, child2, "Yes"); // Labeled connection
         // Add a "No" branch
-        Data::TreeNode* child3 = new Data::TreeNode("Wait", Data::NodeType::Action);
-        child1->AddChild(child3, "No");
+        Data::NodeId child3 = m_Document->CreateNode("Wait", Data::NodeType::Action);
+        nodes.AddChild(child1, child3, "No");
+        m_Document->SetRoot(root);
 
         // Calculate initial tree layout positions
-        LayoutTree(m_Root, 600, 100, 300, 150);
+        m_Layout->Apply(root, 600, 100);
     }
 
     Editor::~Editor() {
-        if (m_Root) delete m_Root;
+        // Document releases every node when it goes out of scope. An unfinished
+        // save is abandoned; the journal keeps the edits it would have saved
+        m_FileTask.reset();
+        StopJournal();
     }
 
     void Editor::Update(float deltaTime, bool inputCaptured) {
+        // Subtrees shifted by the edits since the last frame go into place before anything reads them
+        ResolveLayout();
+        if (m_FileTask && m_FileTask->IsFinished()) FinishFileOperation();
+
+        // Counts of a running heatmap are merged a few times per second
+        if (m_FileOperation == FileOperation::Score) {
+            m_HeatmapRefresh -= deltaTime;
+            if (m_HeatmapRefresh <= 0.0f) {
+                RefreshHeatmap();
+                m_HeatmapRefresh = 0.5f;
+            }
+        }
+
+        // The shared view follows edits, but not every frame of a drag
+        if (m_ShowShared && !m_IsDragging) {
+            m_SharedRefresh -= deltaTime;
+            if (m_SharedRefresh <= 0.0f) {
+                RefreshSharedView();
+                m_SharedRefresh = 0.5f;
+            }
+        }
+
+        // Not mid-drag: the drag is logged as one move when it ends
+        if (!m_IsDragging && m_Journal->WantsCompaction()) {
+            m_Journal->Compact(TakeSnapshot());
+        }
+
+        Data::NodeStore& nodes = m_Document->GetNodes();
+        if (m_Pager) {
+            // Subtrees the user is looking at are never evicted
+            m_Pager->Touch(m_SelectedNode);
+            m_Pager->Touch(m_HoveredNode);
+            m_Pager->Update();
+            if (!nodes.IsLive(m_SelectedNode)) {
+                m_SelectedNode = Data::InvalidNode;
+                m_IsDragging = false;
+            }
+        }
+
+        // Edits made outside the editor's own operations (loads, renames) are laid out here
+        UpdateLayout();
+        ResolveLayout();
+        m_Animator->Update(deltaTime);
+
+        // Edited and newly loaded nodes are checked a bounded number at a time
+        m_Validator->Update();
+
         float mouseX = Core::Input::GetMouseX();
         float mouseY = Core::Input::GetMouseY();
 
         // Determine which node (if any) is under the mouse cursor
-        m_HoveredNode = HitTest(m_Root, mouseX, mouseY);
-        
-        // Update animation target scales based on hover state
-        UpdateNodeScales(m_Root, m_HoveredNode);
+        m_HoveredNode = HitTest(mouseX, mouseY);
+
+        // Only the nodes whose hover or selection changed start animating
+        m_Animator->SetFocus(m_HoveredNode, m_SelectedNode);
 
         if (inputCaptured) return; // UI has captured input, skip editor interactions
 
+        // A mapped file is only browsed; interacting with a node builds the document
+        bool pressed = Core::Input::IsMouseButtonPressed(1) || Core::Input::IsMouseButtonPressed(3);
+        if (m_MappedView && pressed && m_HoveredNode != Data::InvalidNode && !EnsureMaterialized()) {
+            m_HoveredNode = Data::InvalidNode;
+        }
+
         // Handle node selection and drag initiation
         if (Core::Input::IsMouseButtonPressed(1)) { // Left mouse button
             // Select the hovered node (or deselect if clicking empty space)
-            m_SelectedNode = m_HoveredNode;
-            
-            if (m_SelectedNode) {
+            Select(m_HoveredNode);
+
+            if (m_SelectedNode != Data::InvalidNode) {
                 m_IsDragging = true;
-                m_DragOffsetX = m_SelectedNode->X - mouseX;
-                m_DragOffsetY = m_SelectedNode->Y - mouseY;
+                m_DragOffsetX = nodes.GetX(m_SelectedNode) - mouseX;
+                m_DragOffsetY = nodes.GetY(m_SelectedNode) - mouseY;
+                m_DragStartX = nodes.GetX(m_SelectedNode);
+                m_DragStartY = nodes.GetY(m_SelectedNode);
             }
         }
 
         // Dragging
         if (m_IsDragging) {
             if (Core::Input::IsMouseButtonDown(1)) {
-                if (m_SelectedNode) {
+                if (m_SelectedNode != Data::InvalidNode) {
                     float newX = mouseX + m_DragOffsetX;
                     float newY = mouseY + m_DragOffsetY;
-                    float deltaX = newX - m_SelectedNode->X;
-                    float deltaY = newY - m_SelectedNode->Y;
-                    
-                    // Move Node
-                    m_SelectedNode->X = newX;
-                    m_SelectedNode->Y = newY;
-                    
-                    // Move Children Recursively (Select Tree Feature)
-                    MoveTreeRecursive(m_SelectedNode, deltaX, deltaY);
+                    float deltaX = newX - nodes.GetX(m_SelectedNode);
+                    float deltaY = newY - nodes.GetY(m_SelectedNode);
+
+                    // Move the node together with its children (Select Tree Feature)
+                    m_Document->MoveSubtree(m_SelectedNode, deltaX, deltaY);
                 }
             } else {
-                m_IsDragging = false;
+                EndDrag();
             }
         }
 
         // Create child node on right-click (simplified context menu)
         if (Core::Input::IsMouseButtonPressed(3)) { // Right Click
-            if (m_HoveredNode) {
+            if (m_HoveredNode != Data::InvalidNode) {
+                EnsureLoaded(m_HoveredNode);
+
                 // Determine connection label based on parent type
                 std::string connLabel = "";
-                if (m_HoveredNode->Type == Data::NodeType::Condition) {
-                    if (m_HoveredNode->Connections.empty()) connLabel = "Yes";
-                    else if (m_HoveredNode->Connections.size() == 1) connLabel = "No";
+                if (nodes.GetType(m_HoveredNode) == Data::NodeType::Condition) {
+                    if (nodes.GetChildCount(m_HoveredNode) == 0) connLabel = "Yes";
+                    else if (nodes.GetChildCount(m_HoveredNode) == 1) connLabel = "No";
                 }
 
-                Data::TreeNode* newChild = new Data::TreeNode("Action");
-                newChild->X = m_HoveredNode->X + 50;
-                newChild->Y = m_HoveredNode->Y + 100;
-                m_HoveredNode->AddChild(newChild, connLabel);
+                Data::NodeId newChild = m_Document->CreateNode("Action");
+                nodes.AddChild(m_HoveredNode, newChild, connLabel);
+                UpdateLayout();
+                m_History->RecordCreate(newChild);
             }
         }
 
@@ -96,20 +203,463 @@ namespace Editor {
         if (Core::Input::IsKeyPressed(SDL_SCANCODE_DELETE) || Core::Input::IsKeyPressed(SDL_SCANCODE_BACKSPACE)) {
             DeleteSelected();
         }
+
+        // Expand or collapse a subtree of a lazily opened file (E)
+        bool ctrl = Core::Input::IsKeyDown(SDL_SCANCODE_LCTRL) || Core::Input::IsKeyDown(SDL_SCANCODE_RCTRL);
+        bool shift = Core::Input::IsKeyDown(SDL_SCANCODE_LSHIFT) || Core::Input::IsKeyDown(SDL_SCANCODE_RSHIFT);
+        if (!ctrl && m_Pager && m_SelectedNode != Data::InvalidNode && Core::Input::IsKeyPressed(SDL_SCANCODE_E)) {
+            if (!m_Pager->Expand(m_SelectedNode)) m_Pager->Collapse(m_SelectedNode);
+        }
+
+        // Undo (Ctrl+Z) / Redo (Ctrl+Y or Ctrl+Shift+Z)
+        if (ctrl && Core::Input::IsKeyPressed(SDL_SCANCODE_Z)) {
+            if (shift) Redo();
+            else Undo();
+        } else if (ctrl && Core::Input::IsKeyPressed(SDL_SCANCODE_Y)) {
+            Redo();
+        }
+
+        // Save (Ctrl+S) in the background; Escape cancels a running load or save
+        if (ctrl && Core::Input::IsKeyPressed(SDL_SCANCODE_S)) {
+            SaveAsync();
+        }
+        // Export the tree as C++ source next to the document (Ctrl+E)
+        if (ctrl && Core::Input::IsKeyPressed(SDL_SCANCODE_E)) {
+            ExportAsync(std::filesystem::path(m_FilePath).replace_extension(".h").string());
+        }
+        // Score the record file next to the document into a heatmap (Ctrl+H); H shows or hides it
+        if (Core::Input::IsKeyPressed(SDL_SCANCODE_H)) {
+            if (ctrl) ScoreHeatmapAsync(std::filesystem::path(m_FilePath).replace_extension(".dtr").string());
+            else ToggleHeatmap();
+        }
+        // Tidy up the whole tree (L)
+        if (!ctrl && Core::Input::IsKeyPressed(SDL_SCANCODE_L)) {
+            AutoLayout();
+        }
+        // Draw identical subtrees once (D)
+        if (!ctrl && Core::Input::IsKeyPressed(SDL_SCANCODE_D)) {
+            ToggleSharedView();
+        }
+        if (m_FileTask && Core::Input::IsKeyPressed(SDL_SCANCODE_ESCAPE)) {
+            CancelFileOperation();
+        }
+    }
+
+    void Editor::SetDocument(std::unique_ptr<Data::Document> document) {
+        // A running load or scoring is superseded; a running save still completes
+        if (m_FileTask) {
+            if (m_FileOperation == FileOperation::Open || m_FileOperation == FileOperation::Recover
+                || m_FileOperation == FileOperation::Score) m_FileTask->Cancel();
+            m_FileTask->Wait();
+            FinishFileOperation();
+        }
+
+        // The history and journal refer to the old document's node ids; drop them first
+        StopJournal();
+        m_Pager.reset();
+        m_History.reset();
+        m_Validator.reset();
+        m_Animator.reset();
+        m_Layout.reset();
+        m_MappedView.reset();
+        m_Document = std::move(document);
+        m_History = std::make_unique<History>(*m_Document);
+        m_Validator = std::make_unique<Eval::Validator>(*m_Document);
+        m_Layout = std::make_unique<Data::TreeLayout>(m_Document->GetNodes(), m_LayoutPool.get());
+        m_Animator = std::make_unique<Animator>(m_Document->GetNodes());
+        m_HeatmapRun.reset();
+        m_NodeHits.clear();
+        m_MaxNodeHits = 0;
+        m_ShowHeatmap = false;
+        m_ShowShared = false;
+        m_SharedSource = Data::Snapshot();
+        m_Shared = Data::Snapshot();
+        m_SharedNodes.clear();
+        m_SelectedNode = Data::InvalidNode;
+        m_HoveredNode = Data::InvalidNode;
+        m_IsDragging = false;
+    }
+
+    bool Editor::Open(const std::string& path) {
+        std::string error;
+
+        // A journal left behind holds edits that were never saved
+        std::string journalPath = IO::Journal::GetPathFor(path);
+        if (m_Journal->IsActive() && m_Journal->GetPath() == journalPath) StopJournal();
+        if (std::filesystem::exists(journalPath)) {
+            auto document = std::make_unique<Data::Document>();
+            uint32_t replayed = 0;
+            if (IO::Journal::Recover(journalPath, *document, error, &replayed)) {
+                SetDocument(std::move(document));
+                m_FilePath = path;
+                StartJournal();
+                m_SavedRecordCount = UINT64_MAX;   // Unsaved until the next save
+                std::cout << "Recovered unsaved changes to " << path << " (" << replayed << " edits replayed)" << std::endl;
+                return true;
+            }
+            std::cerr << "Cannot recover " << journalPath << ": " << error << std::endl;
+            std::error_code ignored;
+            std::filesystem::rename(journalPath, journalPath + ".bad", ignored);
+        }
+
+        if (IO::IsBinaryPath(path)) {
+            auto view = std::make_unique<IO::BinaryTreeView>();
+            if (!view->Open(path, error)) {
+                std::cerr << "Failed to open " << path << ": " << error << std::endl;
+                return false;
+            }
+            if (view->GetNodeCount() >= LazyLoadNodeCount) {
+                view.reset();
+                return OpenLazy(path);
+            }
+            SetDocument(std::make_unique<Data::Document>());
+            m_MappedView = std::move(view);
+            m_FilePath = path;
+            return true;
+        }
+
+        auto document = std::make_unique<Data::Document>();
+        if (!IO::LoadDocument(path, *document, error)) {
+            std::cerr << "Failed to open " << path << ": " << error << std::endl;
+            return false;
+        }
+        SetDocument(std::move(document));
+        m_FilePath = GetSavePathFor(path);
+        StartJournal();
+        if (m_FilePath != path) m_SavedRecordCount = UINT64_MAX;   // Imported, not yet saved
+        return true;
+    }
+
+    bool Editor::OpenLazy(const std::string& path) {
+        std::string error;
+        auto document = std::make_unique<Data::Document>();
+        auto pager = std::make_unique<IO::SubtreePager>(*document);
+        if (!pager->Open(path, error)) {
+            std::cerr << "Failed to open " << path << ": " << error << std::endl;
+            return false;
+        }
+        SetDocument(std::move(document));
+        m_Pager = std::move(pager);
+        m_FilePath = path;
+        return true;
+    }
+
+    bool Editor::Save(const std::string& path) {
+        EndDrag();
+        // The mapping may be the file being overwritten; copy it out first
+        if (!EnsureMaterialized()) return false;
+        if (m_Pager) {
+            // From here on the document is edited like any other
+            m_Pager->LoadAll();
+            m_Pager.reset();
+            StartJournal();
+        }
+        const std::string target = path.empty() ? m_FilePath : path;
+        std::string error;
+        if (!IO::SaveDocument(target, *m_Document, error)) {
+            std::cerr << "Failed to save " << target << ": " << error << std::endl;
+            return false;
+        }
+        m_SavedRecordCount = m_Journal->GetRecordCount();
+        if (target != m_FilePath) {
+            // The journal follows the document to its new file
+            StopJournal();
+            m_FilePath = target;
+            StartJournal();
+        }
+        return true;
+    }
+
+    bool Editor::OpenAsync(const std::string& path) {
+        if (m_FileTask) return false;
+
+        // A journal left behind holds edits that were never saved
+        std::string journalPath = IO::Journal::GetPathFor(path);
+        if (m_Journal->IsActive() && m_Journal->GetPath() == journalPath) StopJournal();
+        if (std::filesystem::exists(journalPath)) {
+            m_FileTask = IO::FileTask::Recover(journalPath);
+            m_FileOperation = FileOperation::Recover;
+            m_TaskPath = path;
+            return true;
+        }
+
+        // Mapping is handled by Open(); only parsing is slow
+        if (IO::IsBinaryPath(path)) return Open(path);
+        m_FileTask = IO::FileTask::Load(path);
+        m_FileOperation = FileOperation::Open;
+        m_TaskPath = path;
+        return true;
+    }
+
+    bool Editor::SaveAsync(const std::string& path) {
+        return StartSave(path.empty() ? m_FilePath : path, FileOperation::Save);
+    }
+
+    bool Editor::ExportAsync(const std::string& path) {
+        return StartSave(path, FileOperation::Export);
+    }
+
+    bool Editor::ScoreHeatmapAsync(const std::string& recordsPath) {
+        if (m_FileTask) return false;
+        EndDrag();
+        if (!EnsureMaterialized()) return false;
+        if (m_Pager) {
+            // Records can reach any subtree
+            m_Pager->LoadAll();
+            m_Pager.reset();
+            StartJournal();
+        }
+
+        auto run = std::make_shared<HeatmapRun>();
+        run->Root = m_Document->GetRoot();
+        Data::Snapshot snapshot = TakeSnapshot();
+        m_FileTask = std::make_unique<IO::FileTask>([run, snapshot, recordsPath](IO::Progress& progress, std::string& error) {
+            Eval::Compiler compiler;
+            if (!compiler.Compile(snapshot, run->Program)) {
+                const Eval::Diagnostic& first = compiler.GetDiagnostics().front();
+                error = "\"" + first.Label + "\": " + first.Message;
+                return false;
+            }
+            run->Hits.Reset(run->Program);
+            run->Started.store(true, std::memory_order_release);
+
+            // One hardware thread is left to the frame loop
+            Eval::ScoreOptions options;
+            options.Threads = std::max(Core::ThreadPool::GetHardwareThreads(), 2u) - 1;
+            options.Hits = &run->Hits;
+            return Eval::ScoreFile(run->Program, recordsPath, "", error, options, nullptr, &progress);
+        });
+        m_FileOperation = FileOperation::Score;
+        m_TaskPath = recordsPath;
+        m_HeatmapRun = run;
+        m_HeatmapRefresh = 0.0f;
+        m_NodeHits.clear();
+        m_MaxNodeHits = 0;
+        m_ShowHeatmap = true;
+        return true;
+    }
+
+    void Editor::RefreshHeatmap() {
+        if (!m_HeatmapRun || !m_HeatmapRun->Started.load(std::memory_order_acquire)) return;
+        m_NodeHits = m_HeatmapRun->Hits.GetNodeHits(m_HeatmapRun->Program, m_Document->GetNodes(), m_HeatmapRun->Root);
+        m_MaxNodeHits = m_NodeHits.empty() ? 0 : *std::max_element(m_NodeHits.begin(), m_NodeHits.end());
+    }
+
+    float Editor::GetHeat(Data::NodeId node) const {
+        // Log scale: traffic spans orders of magnitude between the root and deep leaves
+        if (node >= m_NodeHits.size() || m_NodeHits[node] == 0 || m_MaxNodeHits == 0) return -1.0f;
+        return float(std::log1p(double(m_NodeHits[node])) / std::log1p(double(m_MaxNodeHits)));
+    }
+
+    void Editor::CancelFileOperation() {
+        if (m_FileTask) m_FileTask->Cancel();
+    }
+
+    bool Editor::StartSave(const std::string& path, FileOperation operation) {
+        if (m_FileTask) return false;
+        bool generateCode = Eval::IsCppPath(path);
+        if (generateCode && operation != FileOperation::Export) {
+            std::cerr << "Cannot save to " << path << ": C++ headers can only be exported" << std::endl;
+            return false;
+        }
+        EndDrag();
+        if (!EnsureMaterialized()) return false;
+        if (m_Pager) {
+            // Unloaded subtrees are read from the mapped file, which may be the target
+            m_Pager->LoadAll();
+            m_Pager.reset();
+            StartJournal();
+        }
+
+        // With the journal running this snapshot is already up to date
+        Data::Snapshot snapshot = TakeSnapshot();
+        if (generateCode) {
+            Eval::CodeGenOptions options;
+            options.SourceName = std::filesystem::path(m_FilePath).filename().string();
+            m_FileTask = std::make_unique<IO::FileTask>([path, snapshot, options](IO::Progress&, std::string& error) {
+                return Eval::ExportCpp(path, snapshot, error, options);
+            });
+        } else {
+            m_FileTask = IO::FileTask::Save(path, snapshot);
+        }
+        m_FileOperation = operation;
+        m_TaskPath = path;
+        m_TaskRecordCount = m_Journal->GetRecordCount();
+        return true;
+    }
+
+    void Editor::FinishFileOperation() {
+        std::unique_ptr<IO::FileTask> task = std::move(m_FileTask);
+        FileOperation operation = m_FileOperation;
+        m_FileOperation = FileOperation::None;
+        task->Wait();
+
+        if (!task->Succeeded()) {
+            if (!task->WasCancelled()) {
+                const char* verb = operation == FileOperation::Open ? "open" : operation == FileOperation::Recover ? "recover" :
+                                   operation == FileOperation::Save ? "save" : operation == FileOperation::Score ? "score" : "export";
+                std::cerr << "Failed to " << verb << " " << m_TaskPath << ": " << task->GetError() << std::endl;
+            }
+            if (operation == FileOperation::Recover && !task->WasCancelled()) {
+                // Set aside, then the file is opened as it was last saved
+                std::string journalPath = IO::Journal::GetPathFor(m_TaskPath);
+                std::error_code ignored;
+                std::filesystem::rename(journalPath, journalPath + ".bad", ignored);
+                if (OpenAsync(m_TaskPath)) return;
+            }
+            if ((operation == FileOperation::Open || operation == FileOperation::Recover) && !m_Journal->IsActive()) StartJournal();
+            if (operation == FileOperation::Score) {
+                // A cancelled run still shows what it counted
+                RefreshHeatmap();
+                m_ShowHeatmap = !m_NodeHits.empty() && task->WasCancelled();
+            }
+            return;
+        }
+
+        switch (operation) {
+            case FileOperation::Open:
+                SetDocument(task->TakeDocument());
+                m_FilePath = GetSavePathFor(m_TaskPath);
+                StartJournal();
+                if (m_FilePath != m_TaskPath) m_SavedRecordCount = UINT64_MAX;   // Imported, not yet saved
+                break;
+            case FileOperation::Recover:
+                SetDocument(task->TakeDocument());
+                m_FilePath = m_TaskPath;
+                StartJournal();
+                m_SavedRecordCount = UINT64_MAX;   // Unsaved until the next save
+                std::cout << "Recovered unsaved changes to " << m_TaskPath << " (" << task->GetRecordsReplayed() << " edits replayed)" << std::endl;
+                break;
+            case FileOperation::Save: {
+                // Edits made while the snapshot was written are not in the file
+                bool unsavedEdits = m_Journal->GetRecordCount() != m_TaskRecordCount;
+                m_SavedRecordCount = m_TaskRecordCount;
+                if (m_TaskPath != m_FilePath) {
+                    StopJournal();
+                    m_FilePath = m_TaskPath;
+                    StartJournal();
+                    if (unsavedEdits) m_SavedRecordCount = UINT64_MAX;
+                }
+                break;
+            }
+            case FileOperation::Score:
+                RefreshHeatmap();
+                std::cout << "Scored " << m_MaxNodeHits << " records from " << m_TaskPath << std::endl;
+                break;
+            case FileOperation::Export:
+            case FileOperation::None:
+                break;
+        }
+    }
+
+    void Editor::StartJournal() {
+        if (m_MappedView || m_Pager) return;   // Started once the file is fully loaded
+        m_Journal->Start(IO::Journal::GetPathFor(m_FilePath), TakeSnapshot());
+        m_History->SetJournal(m_Journal.get());
+        m_SavedRecordCount = 0;
+    }
+
+    void Editor::StopJournal() {
+        if (!m_Journal->IsActive()) return;
+        m_History->SetJournal(nullptr);
+        // Keep the journal only if it holds edits that were never saved
+        m_Journal->Stop(m_Journal->GetRecordCount() == m_SavedRecordCount);
     }
 
     void Editor::DeleteSelected() {
-        if (m_SelectedNode && m_SelectedNode != m_Root) {
-            DeleteNode(m_Root, m_SelectedNode);
-            m_SelectedNode = nullptr;
-            m_HoveredNode = nullptr;
+        Data::NodeId root = m_Document->GetRoot();
+        if (m_SelectedNode != Data::InvalidNode && m_SelectedNode != root) {
+            // Stashed rather than freed so that the deletion can be undone
+            m_Animator->AddExit(m_SelectedNode);
+            m_History->DeleteSubtree(m_SelectedNode);
+            UpdateLayout();
+            m_SelectedNode = Data::InvalidNode;
+            m_HoveredNode = Data::InvalidNode;
             m_IsDragging = false;
         }
     }
 
+    void Editor::RenameNode(Data::NodeId node, std::string_view label) {
+        if (!EnsureMaterialized()) return;
+        if (!m_Document->GetNodes().IsLive(node)) return;
+        if (m_Document->GetNodes().GetLabel(node) == label) return;
+        m_History->Relabel(node, label);
+    }
+
+    void Editor::AutoLayout() {
+        if (!EnsureMaterialized()) return;
+        EndDrag();
+        Data::NodeStore& nodes = m_Document->GetNodes();
+        Data::NodeId root = m_Document->GetRoot();
+        if (!nodes.IsLive(root)) return;
+        // Undo restores positions as they are drawn, shifts included
+        ResolveLayout();
+        m_Animator->BeginTransition();
+        m_History->ApplyLayout(*m_Layout, root, nodes.GetX(root), nodes.GetY(root));
+        m_Animator->EndTransition();
+    }
+
+    void Editor::Undo() {
+        EndDrag();
+        ResolveLayout();
+        m_History->Undo();
+        UpdateLayout();
+        if (!m_Document->GetNodes().IsLive(m_SelectedNode)) m_SelectedNode = Data::InvalidNode;
+        m_HoveredNode = Data::InvalidNode;
+    }
+
+    void Editor::Redo() {
+        EndDrag();
+        ResolveLayout();
+        m_History->Redo();
+        UpdateLayout();
+        if (!m_Document->GetNodes().IsLive(m_SelectedNode)) m_SelectedNode = Data::InvalidNode;
+        m_HoveredNode = Data::InvalidNode;
+    }
+
+    void Editor::Select(Data::NodeId node) {
+        // Label edits on the previous selection form one undo step
+        if (node != m_SelectedNode) m_History->Seal();
+        m_SelectedNode = node;
+    }
+
+    bool Editor::EnsureMaterialized() {
+        if (!m_MappedView) return true;
+        std::string error;
+        if (!m_MappedView->Materialize(*m_Document, error)) {
+            std::cerr << "Failed to load " << m_FilePath << ": " << error << std::endl;
+            return false;
+        }
+        // Saved ids are kept, so the hovered node is still the same node
+        m_MappedView.reset();
+        StartJournal();
+        if (!m_Document->GetNodes().IsLive(m_HoveredNode)) m_HoveredNode = Data::InvalidNode;
+        return true;
+    }
+
+    void Editor::EnsureLoaded(Data::NodeId node) {
+        // New children go after the ones on disk, so those are loaded first
+        if (m_Pager) m_Pager->Load(node);
+    }
+
+    void Editor::EndDrag() {
+        if (!m_IsDragging) return;
+        m_IsDragging = false;
+
+        // The whole drag becomes a single move command
+        const Data::NodeStore& nodes = m_Document->GetNodes();
+        if (!nodes.IsLive(m_SelectedNode)) return;
+        float dx = nodes.GetX(m_SelectedNode) - m_DragStartX;
+        float dy = nodes.GetY(m_SelectedNode) - m_DragStartY;
+        if (dx != 0.0f || dy != 0.0f) m_History->RecordMove(m_SelectedNode, dx, dy);
+    }
+
     void Editor::CreateNode(Data::NodeType type) {
-        Data::TreeNode* parent = m_SelectedNode ? m_SelectedNode : m_Root;
-        if (!parent) return;
+        if (!EnsureMaterialized()) return;
+        Data::NodeStore& nodes = m_Document->GetNodes();
+        Data::NodeId parent = m_SelectedNode != Data::InvalidNode ? m_SelectedNode : m_Document->GetRoot();
+        if (parent == Data::InvalidNode) return;
+        EnsureLoaded(parent);
 
         std::string label = "Node";
         switch (type) {
@@ -118,151 +668,346 @@ namespace Editor {
             case Data::NodeType::Condition: label = "Cond"; break;
             case Data::NodeType::End: label = "End"; break;
         }
-        
+
         // Auto-Label connection if parent is Condition
         std::string connLabel = "";
-        if (parent->Type == Data::NodeType::Condition) {
-             if (parent->Connections.empty()) connLabel = "Yes";
-             else if (parent->Connections.size() == 1) connLabel = "No";
+        if (nodes.GetType(parent) == Data::NodeType::Condition) {
+             if (nodes.GetChildCount(parent) == 0) connLabel = "Yes";
+             else if (nodes.GetChildCount(parent) == 1) connLabel = "No";
         }
 
-        Data::TreeNode* newNode = new Data::TreeNode(label, type);
-        newNode->X = parent->X + 50; // Simple offset
-        newNode->Y = parent->Y + 120;
-        parent->AddChild(newNode, connLabel);
-        
-        m_SelectedNode = newNode;
+        // Placed by the layout before the creation is recorded, so that the journal has its position
+        Data::NodeId newNode = m_Document->CreateNode(label, type);
+        nodes.AddChild(parent, newNode, connLabel);
+        UpdateLayout();
+        m_History->RecordCreate(newNode);
+
+        Select(newNode);
     }
 
     void Editor::Draw(Graphics::Renderer& renderer) {
-        DrawNodeRecursive(renderer, m_Root);
+        ResolveLayout();
+        if (m_MappedView) {
+            DrawMappedView(renderer);
+            return;
+        }
+
+        if (m_ShowShared && !m_SharedNodes.empty()) {
+            DrawSharedView(renderer);
+            return;
+        }
+
+        // Connections first so that nodes are drawn on top of them
+        DrawConnections(renderer);
+        DrawNodes(renderer);
+        if (m_Pager) DrawPlaceholders(renderer);
     }
 
-    void Editor::LayoutTree(Data::TreeNode* node, float x, float y, float hSpacing, float vSpacing) {
-        if (!node) return;
-        node->X = x;
-        node->Y = y;
-        if (!node->Connections.empty()) {
-            float startX = x - ((node->Connections.size() - 1) * hSpacing) / 2.0f;
-            for (size_t i = 0; i < node->Connections.size(); ++i) {
-                LayoutTree(node->Connections[i].Target, startX + i * hSpacing, y + vSpacing, hSpacing / 2.0f, vSpacing);
+    void Editor::UpdateLayout() {
+        // Nodes the layout moves slide into place rather than jump
+        m_Animator->BeginTransition();
+        m_Layout->Update();
+        m_Animator->EndTransition();
+    }
+
+    void Editor::ResolveLayout() {
+        m_Animator->BeginTransition();
+        m_Layout->Resolve();
+        m_Animator->EndTransition();
+    }
+
+    Data::Snapshot Editor::TakeSnapshot() {
+        // Snapshots keep positions: shifted subtrees must be in place first
+        ResolveLayout();
+        return m_Document->TakeSnapshot();
+    }
+
+    void Editor::DrawConnections(Graphics::Renderer& renderer) {
+        const Data::NodeStore& nodes = m_Document->GetNodes();
+        const uint8_t* state = nodes.GetStateData();
+
+        renderer.SetColor(200, 200, 200, 255);
+        for (Data::NodeId node = 0, n = nodes.GetCapacity(); node < n; ++node) {
+            if (state[node] != Data::NodeLive) continue;
+            float x1 = nodes.GetX(node), y1 = nodes.GetY(node);
+            m_Animator->GetDrawnPosition(node, x1, y1);
+
+            const Data::NodeId* children = nodes.GetChildren(node);
+            for (uint32_t i = 0; i < nodes.GetChildCount(node); ++i) {
+                Data::NodeId child = children[i];
+                float x2 = nodes.GetX(child), y2 = nodes.GetY(child);
+                m_Animator->GetDrawnPosition(child, x2, y2);
+
+                // With the heatmap on, an edge is as busy as the child it leads to
+                float thickness = 1.0f;
+                if (m_ShowHeatmap) {
+                    float heat = GetHeat(child);
+                    Data::Color color = heat >= 0.0f ? HeatColor(heat) : Data::Color{ 90, 90, 90 };
+                    renderer.SetColor(color.R, color.G, color.B, 255);
+                    thickness = heat >= 0.0f ? 1.0f + 6.0f * heat : 1.0f;
+                }
+
+                // Bezier control points
+                float cx1 = x1;
+                float cy1 = y1 + 50;
+                float cx2 = x2;
+                float cy2 = y2 - 50;
+                renderer.DrawBezier(x1, y1, x2, y2, cx1, cy1, cx2, cy2, thickness);
+
+                // Draw Connection Label (Midpoint 0.5)
+                std::string_view label = nodes.GetEdgeLabel(node, i);
+                if (!label.empty()) {
+                   // Calculate midpoint of bezier for text
+                   // Simple interp: 0.5
+                   float t = 0.5f;
+                   float u = 1 - t;
+                   float tt = t*t;
+                   float uu = u*u;
+                   float uuu = uu*u;
+                   float ttt = tt*t;
+
+                   // Bezier func
+                   float mx = uuu * x1 + 3 * uu * t * cx1 + 3 * u * tt * cx2 + ttt * x2;
+                   float my = uuu * y1 + 3 * uu * t * cy1 + 3 * u * tt * cy2 + ttt * y2;
+
+                   renderer.SetColor(255, 255, 100, 255); // Yellowish text
+                   renderer.DrawText(mx, my, label);
+                   renderer.SetColor(200, 200, 200, 255); // Reset line color
+                }
             }
         }
     }
 
-    void Editor::MoveTreeRecursive(Data::TreeNode* node, float dx, float dy) {
-        if (!node) return;
-        // Node itself is already moved by caller if it is the selected one.
-        // But what if this is called recursively?
-        // Let's assume caller moved 'node', we move children. 
-        
-        for (const auto& conn : node->Connections) {
-            Data::TreeNode* child = conn.Target;
-            if (child) {
-                child->X += dx;
-                child->Y += dy;
-                MoveTreeRecursive(child, dx, dy);
+    void Editor::DrawNodes(Graphics::Renderer& renderer) {
+        const Data::NodeStore& nodes = m_Document->GetNodes();
+        const float* scale = nodes.GetScaleData();
+        const uint8_t* state = nodes.GetStateData();
+
+        // Ghosts of deleted nodes shrink away behind the live ones
+        for (const Animator::Ghost& ghost : m_Animator->GetGhosts()) {
+            renderer.DrawStyledNode(ghost.X, ghost.Y, ghost.Label, false, (int)ghost.Shape, ghost.Color.R, ghost.Color.G, ghost.Color.B, ghost.Scale);
+        }
+
+        for (Data::NodeId node = 0, n = nodes.GetCapacity(); node < n; ++node) {
+            if (state[node] != Data::NodeLive) continue;
+            float x = nodes.GetX(node), y = nodes.GetY(node);
+            m_Animator->GetDrawnPosition(node, x, y);
+            Data::Color color = nodes.GetColor(node);
+            if (m_ShowHeatmap) {
+                float heat = GetHeat(node);
+                color = heat >= 0.0f ? HeatColor(heat) : Data::Color{ 90, 90, 90 };
             }
+            renderer.DrawStyledNode(x, y, nodes.GetLabel(node), (node == m_SelectedNode), (int)nodes.GetShape(node), color.R, color.G, color.B, scale[node]);
         }
-    }
 
-    void Editor::UpdateNodeScales(Data::TreeNode* node, Data::TreeNode* hovered) {
-        if (!node) return;
-        
-        if (node == hovered) {
-            node->TargetScale = 1.2f; // Scale up on hover
-        } else {
-            node->TargetScale = 1.0f; // Normal size
+        // Errors are spelled out below their node, warnings marked beside it; the selection shows everything
+        const Eval::Validator& validator = *m_Validator;
+        for (Data::NodeId node = 0, n = nodes.GetCapacity(); node < n; ++node) {
+            uint32_t issues = state[node] == Data::NodeLive ? validator.GetIssues(node) : 0;
+            // A collapsed subtree's placeholder is a leaf only until it is loaded
+            if (issues != 0 && m_Pager && m_Pager->GetPlaceholders().count(node)) issues &= ~Eval::MissingEnd;
+            if (issues == 0) continue;
+
+            float x = nodes.GetX(node), top = nodes.GetY(node);
+            m_Animator->GetDrawnPosition(node, x, top);
+            float y = top + 40.0f;
+            for (uint32_t bits = issues; bits != 0; bits &= bits - 1) {
+                auto kind = static_cast<Eval::IssueBits>(bits & ~(bits - 1));
+                bool isError = !(kind & Eval::WarningIssues);
+                if (!isError && node != m_SelectedNode) continue;
+                if (isError) renderer.SetColor(255, 110, 110, 255);
+                else renderer.SetColor(255, 170, 60, 255);
+                renderer.DrawText(x, y, validator.Describe(node, kind), 0.7f);
+                y += 14.0f;
+            }
+            if ((issues & Eval::WarningIssues) && node != m_SelectedNode) {
+                renderer.SetColor(255, 170, 60, 255);
+                renderer.DrawText(x + 55.0f * scale[node], top - 20.0f, "!", 1.0f);
+            }
         }
 
-        for (const auto& conn : node->Connections) {
-            UpdateNodeScales(conn.Target, hovered);
+        // Exact traffic of the selected node
+        if (m_ShowHeatmap && nodes.IsLive(m_SelectedNode) && m_MaxNodeHits > 0) {
+            uint64_t hits = m_SelectedNode < m_NodeHits.size() ? m_NodeHits[m_SelectedNode] : 0;
+            char text[64];
+            std::snprintf(text, sizeof(text), "%llu records (%.1f%%)", static_cast<unsigned long long>(hits),
+                          100.0 * double(hits) / double(m_MaxNodeHits));
+            renderer.SetColor(255, 255, 255, 255);
+            float x = nodes.GetX(m_SelectedNode), y = nodes.GetY(m_SelectedNode);
+            m_Animator->GetDrawnPosition(m_SelectedNode, x, y);
+            renderer.DrawText(x, y - 45.0f, text, 0.8f);
         }
     }
 
-    void Editor::DrawNodeRecursive(Graphics::Renderer& renderer, Data::TreeNode* node) {
-        if (!node) return;
+    void Editor::ToggleSharedView() {
+        m_ShowShared = !m_ShowShared;
+        if (!m_ShowShared) {
+            m_SharedSource = Data::Snapshot();
+            m_Shared = Data::Snapshot();
+            m_SharedNodes.clear();
+            return;
+        }
+        m_SharedRefresh = 0.0f;
+        if (EnsureMaterialized()) RefreshSharedView();
+    }
+
+    void Editor::RefreshSharedView() {
+        // Taking a snapshot of an unchanged tree returns the same version
+        Data::Snapshot snapshot = TakeSnapshot();
+        if (snapshot.GetRoot() == m_SharedSource.GetRoot()) return;
+        m_Shared = Data::ShareSubtrees(snapshot, &m_SharingStats);
+        m_SharedNodes = Data::ListDistinctNodes(m_Shared);
+        m_SharedSource = std::move(snapshot);
+    }
 
-        // Animation Logic (Hack: Updating in Draw for simplicity, ideally in Update)
-        // Simple Lerp: current += (target - current) * factor
-        float lerpSpeed = 0.1f;
-        node->Scale += (node->TargetScale - node->Scale) * lerpSpeed;
+    void Editor::DrawSharedView(Graphics::Renderer& renderer) {
+        // Shared nodes are drawn where the document has their first occurrence
+        const Data::NodeStore& nodes = m_Document->GetNodes();
+        // Nodes deleted since keep the position they had in the snapshot
+        auto position = [&](const Data::SnapshotNode* node, double snapshotX, double snapshotY, float& x, float& y) {
+            bool live = nodes.IsLive(node->Id);
+            x = live ? nodes.GetX(node->Id) : float(snapshotX);
+            y = live ? nodes.GetY(node->Id) : float(snapshotY);
+        };
 
-        // Draw connections first
         renderer.SetColor(200, 200, 200, 255);
-        for (const auto& conn : node->Connections) {
-            Data::TreeNode* child = conn.Target;
-            if (!child) continue;
-
-            // Bezier control points
-            float cx1 = node->X;
-            float cy1 = node->Y + 50;
-            float cx2 = child->X;
-            float cy2 = child->Y - 50;
-            renderer.DrawBezier(node->X, node->Y, child->X, child->Y, cx1, cy1, cx2, cy2);
-
-            // Draw Connection Label (Midpoint 0.5)
-            if (!conn.Label.empty()) {
-               // Calculate midpoint of bezier for text
-               // Simple interp: 0.5
-               float t = 0.5f;
-               float u = 1 - t;
-               float tt = t*t; 
-               float uu = u*u;
-               float uuu = uu*u;
-               float ttt = tt*t;
-               
-               // Bezier func
-               float mx = uuu * node->X + 3 * uu * t * cx1 + 3 * u * tt * cx2 + ttt * child->X;
-               float my = uuu * node->Y + 3 * uu * t * cy1 + 3 * u * tt * cy2 + ttt * child->Y;
-
-               renderer.SetColor(255, 255, 100, 255); // Yellowish text
-               renderer.DrawText(mx, my, conn.Label);
-               renderer.SetColor(200, 200, 200, 255); // Reset line color
+        for (const Data::SharedNodeUse& use : m_SharedNodes) {
+            float x, y;
+            position(use.Node, use.X, use.Y, x, y);
+            for (const Data::SnapshotEdge& edge : use.Node->Children) {
+                float childX, childY;
+                position(edge.Target, use.X + edge.Target->X, use.Y + edge.Target->Y, childX, childY);
+                // Edges into shared subtrees stand out
+                if (edge.Target->IsShared) renderer.SetColor(120, 200, 255, 255);
+                renderer.DrawBezier(x, y, childX, childY, x, y + 50, childX, childY - 50, edge.Target->IsShared ? 2.0f : 1.0f);
+                if (!edge.Label.empty()) {
+                    renderer.SetColor(255, 255, 100, 255);
+                    renderer.DrawText((x + childX) / 2.0f, (y + childY) / 2.0f, edge.Label);
+                }
+                renderer.SetColor(200, 200, 200, 255);
             }
+        }
 
-            DrawNodeRecursive(renderer, child);
+        char text[96];
+        const float* scale = nodes.GetScaleData();
+        for (const Data::SharedNodeUse& use : m_SharedNodes) {
+            const Data::SnapshotNode* node = use.Node;
+            float x, y;
+            position(node, use.X, use.Y, x, y);
+            float nodeScale = nodes.IsLive(node->Id) ? scale[node->Id] : 1.0f;
+            renderer.DrawStyledNode(x, y, node->Label, node->Id == m_SelectedNode, (int)node->Shape, node->Color.R, node->Color.G, node->Color.B, nodeScale);
+            if (use.Parents > 1) {
+                std::snprintf(text, sizeof(text), "x%u", use.Parents);
+                renderer.SetColor(120, 200, 255, 255);
+                renderer.DrawText(x + 40.0f, y - 30.0f, text, 0.8f);
+            }
         }
 
-        // Draw Node
-        renderer.DrawStyledNode(node->X, node->Y, node->Label, (node == m_SelectedNode), (int)node->Shape, node->R, node->G, node->B, node->Scale);
+        // Summary above the root
+        const Data::SharingStats& stats = m_SharingStats;
+        std::snprintf(text, sizeof(text), "%u of %u nodes (%.0f%% shared)", stats.SharedNodes, stats.TreeNodes,
+                      100.0 * (1.0 - double(stats.SharedNodes) / std::max(stats.TreeNodes, 1u)));
+        float x, y;
+        position(m_SharedNodes.front().Node, m_SharedNodes.front().X, m_SharedNodes.front().Y, x, y);
+        renderer.SetColor(120, 200, 255, 255);
+        renderer.DrawText(x, y - 60.0f, text, 0.8f);
     }
 
-    Data::TreeNode* Editor::HitTest(Data::TreeNode* node, float x, float y) {
-        if (!node) return nullptr;
-
-        float hitSize = 30.0f; // Approx visual size
-        float dx = node->X - x;
-        float dy = node->Y - y;
-        
-        // Simple box check for better hit testing on shapes
-        if (std::abs(dx) < hitSize && std::abs(dy) < hitSize) {
-            return node;
+    void Editor::DrawPlaceholders(Graphics::Renderer& renderer) {
+        // An unloaded subtree is summarized under the node standing for it
+        const Data::NodeStore& nodes = m_Document->GetNodes();
+        char text[96];
+        renderer.SetColor(160, 200, 255, 255);
+        for (const auto& [node, placeholder] : m_Pager->GetPlaceholders()) {
+            if (!nodes.IsLive(node)) continue;
+            const IO::SubtreeStats& stats = placeholder.Stats;
+            if (placeholder.Loading) {
+                std::snprintf(text, sizeof(text), "Loading %u nodes...", stats.Nodes);
+            } else if (stats.Ready) {
+                std::snprintf(text, sizeof(text), "+%u nodes, %u leaves, depth %u", stats.Nodes, stats.Leaves, stats.Depth);
+            } else {
+                std::snprintf(text, sizeof(text), "+%u nodes", stats.Nodes);
+            }
+            renderer.DrawText(nodes.GetX(node), nodes.GetY(node) + 40.0f, text, 0.8f);
         }
+    }
 
-        for (const auto& conn : node->Connections) {
-            Data::TreeNode* hit = HitTest(conn.Target, x, y);
-            if (hit) return hit;
+    void Editor::DrawMappedView(Graphics::Renderer& renderer) {
+        // Same drawing as for the document, read straight from the mapped records
+        const IO::BinaryTreeView& view = *m_MappedView;
+        const float* xs = view.GetXData();
+        const float* ys = view.GetYData();
+        uint32_t count = view.GetNodeCount();
+
+        renderer.SetColor(200, 200, 200, 255);
+        for (uint32_t node = 0; node < count; ++node) {
+            for (uint32_t i = 0, n = view.GetChildCount(node); i < n; ++i) {
+                uint32_t child = view.GetChild(node, i);
+                float cx1 = xs[node];
+                float cy1 = ys[node] + 50;
+                float cx2 = xs[child];
+                float cy2 = ys[child] - 50;
+                renderer.DrawBezier(xs[node], ys[node], xs[child], ys[child], cx1, cy1, cx2, cy2);
+
+                std::string_view label = view.GetEdgeLabel(node, i);
+                if (!label.empty()) {
+                    // Midpoint of the bezier (t = 0.5)
+                    float mx = 0.125f * xs[node] + 0.375f * cx1 + 0.375f * cx2 + 0.125f * xs[child];
+                    float my = 0.125f * ys[node] + 0.375f * cy1 + 0.375f * cy2 + 0.125f * ys[child];
+                    renderer.SetColor(255, 255, 100, 255);
+                    renderer.DrawText(mx, my, label);
+                    renderer.SetColor(200, 200, 200, 255);
+                }
+            }
         }
 
-        return nullptr;
+        for (uint32_t node = 0; node < count; ++node) {
+            const IO::BinaryNode& record = view.GetNode(node);
+            float scale = record.Id == m_HoveredNode ? 1.2f : 1.0f;
+            renderer.DrawStyledNode(xs[node], ys[node], view.GetLabel(node), false, record.Shape & 3, record.R, record.G, record.B, scale);
+        }
     }
 
-    void Editor::DeleteNode(Data::TreeNode* parent, Data::TreeNode* nodeToDelete) {
-        if (!parent) return;
+    Data::NodeId Editor::HitTest(float x, float y) const {
+        if (m_MappedView) {
+            const IO::BinaryTreeView& view = *m_MappedView;
+            for (uint32_t node = view.GetNodeCount(); node-- > 0;) {
+                if (std::abs(view.GetX(node) - x) < 30.0f && std::abs(view.GetY(node) - y) < 30.0f) {
+                    return view.GetNode(node).Id;
+                }
+            }
+            return Data::InvalidNode;
+        }
 
-        auto it = std::find_if(parent->Connections.begin(), parent->Connections.end(), 
-            [&](const Data::Connection& c) { return c.Target == nodeToDelete; });
-            
-        if (it != parent->Connections.end()) {
-            delete it->Target; // Destructor deletes children recursively
-            parent->Connections.erase(it);
-            return;
+        const Data::NodeStore& nodes = m_Document->GetNodes();
+        const float* xs = nodes.GetXData();
+        const float* ys = nodes.GetYData();
+        const uint8_t* state = nodes.GetStateData();
+
+        float hitSize = 30.0f; // Approx visual size
+
+        // Only the first occurrence of a shared subtree can be clicked
+        if (m_ShowShared && !m_SharedNodes.empty()) {
+            for (size_t i = m_SharedNodes.size(); i-- > 0;) {
+                Data::NodeId node = m_SharedNodes[i].Node->Id;
+                if (nodes.IsLive(node) && std::abs(xs[node] - x) < hitSize && std::abs(ys[node] - y) < hitSize) return node;
+            }
+            return Data::InvalidNode;
         }
 
-        for (auto& conn : parent->Connections) {
-            DeleteNode(conn.Target, nodeToDelete);
+        // Scan back to front so the node drawn last (on top) wins
+        for (Data::NodeId node = nodes.GetCapacity(); node-- > 0;) {
+            if (state[node] != Data::NodeLive) continue;
+            float dx = xs[node] - x;
+            float dy = ys[node] - y;
+
+            // Simple box check for better hit testing on shapes
+            if (std::abs(dx) < hitSize && std::abs(dy) < hitSize) {
+                return node;
+            }
         }
+
+        return Data::InvalidNode;
     }
 
 }
@@ -8,8 +8,20 @@
 
 #pragma once
 
-#include "../Data/TreeNode.h"
+#include "Animator.h"
+#include "History.h"
+#include "../Core/ThreadPool.h"
+#include "../Data/Document.h"
+#include "../Data/SubtreeSharing.h"
+#include "../Data/TreeLayout.h"
+#include "../Eval/Validator.h"
 #include "../Graphics/Renderer.h"
+#include "../IO/BinaryTreeView.h"
+#include "../IO/FileTask.h"
+#include "../IO/SubtreePager.h"
+#include <memory>
+#include <string>
+#include <string_view>
 #include <vector>
 
 namespace Editor {
@@ -24,12 +36,17 @@ namespace Editor {
      */
     class Editor {
     public:
+        /// File operation running in the background
+        enum class FileOperation { None, Open, Recover, Save, Export, Score };
+
+        static constexpr uint32_t LazyLoadNodeCount = 250000;   ///< Binary files this large are opened lazily
+
         Editor();
         ~Editor();
 
         /**
          * @brief Update editor state and handle input
-         * @param deltaTime Time since last frame (currently unused)
+         * @param deltaTime Seconds since the last frame, by which animations advance
          * @param inputCaptured Whether UI has captured input (prevents editor input)
          * 
          * Handles mouse hover, selection, dragging, and keyboard shortcuts.
@@ -42,12 +59,143 @@ namespace Editor {
          */
         void Draw(Graphics::Renderer& renderer);
 
-        Data::TreeNode* GetRoot() { return m_Root; }
-        Data::TreeNode* GetSelectedNode() { return m_SelectedNode; }
+        Data::NodeId GetRoot() const { return m_Document->GetRoot(); }
+        Data::NodeId GetSelectedNode() const { return m_SelectedNode; }
+
+        /**
+         * @brief Make a node the selection (InvalidNode clears it)
+         */
+        void Select(Data::NodeId node);
+
+        /**
+         * @brief Issues of the document's nodes (see Eval/Validator.h)
+         */
+        const Eval::Validator& GetValidator() const { return *m_Validator; }
+        Data::Document& GetDocument() { return *m_Document; }
+        History& GetHistory() { return *m_History; }
+
+        /**
+         * @brief Replace the edited document (clears selection and undo history)
+         * @param document New document; ownership is transferred to the editor
+         */
+        void SetDocument(std::unique_ptr<Data::Document> document);
+
+        /**
+         * @brief Open a DecisionTree.json, .dtb or .csv rule table file, replacing the current document
+         * @return false if the file could not be read; the current document is kept
+         *
+         * Binary files are mapped and drawn straight from the mapping; the
+         * document is only built from them on the first edit. Binary files of
+         * LazyLoadNodeCount nodes or more are opened with OpenLazy(). If the file has
+         * a journal left by a session that did not save, the document is
+         * recovered from the journal instead. A rule table is imported (see
+         * DocumentCsv.h) and saved next to it as JSON.
+         */
+        bool Open(const std::string& path);
+
+        /**
+         * @brief Open a .dtb file with only the top of the tree loaded
+         * @return false if the file could not be read; the current document is kept
+         *
+         * Collapsed subtrees are drawn as placeholder nodes and loaded on
+         * demand (E expands or collapses the selected node). Edits are not
+         * journaled until the next save, which loads the whole tree.
+         */
+        bool OpenLazy(const std::string& path);
+
+        /**
+         * @brief Write the current document (JSON or binary, by extension)
+         * @param path Target file (empty: the file the document was opened from)
+         */
+        bool Save(const std::string& path = "");
+
+        /**
+         * @brief Open a file without blocking the frame loop
+         * @return false if another file operation is running
+         *
+         * JSON files and rule tables are parsed, and journals replayed, on a
+         * worker thread and the document is swapped in by Update() once
+         * complete; the current document stays editable meanwhile. Binary
+         * files go through Open() directly (mapping a file is immediate).
+         */
+        bool OpenAsync(const std::string& path);
+
+        /**
+         * @brief Save without blocking the frame loop
+         * @param path Target file (empty: the file the document was opened from)
+         * @return false if another file operation is running
+         *
+         * A snapshot of the current tree is written on a worker thread, so
+         * editing continues during the save; later edits stay unsaved.
+         */
+        bool SaveAsync(const std::string& path = "");
+
+        /**
+         * @brief Write a copy of the document to another file in the background
+         *
+         * Unlike SaveAsync(), the document keeps its file and unsaved state.
+         * A .h or .hpp path exports the tree as generated C++ (see CodeGen.h).
+         */
+        bool ExportAsync(const std::string& path);
+
+        /**
+         * @brief Score a record file against the tree in the background to show where records go
+         * @param recordsPath Record file (see Eval/Scoring.h)
+         * @return false if another file operation is running
+         *
+         * Nodes are colored and edges thickened by the number of records
+         * reaching them. The overlay fills in while the file is scored and
+         * stays until another document is opened.
+         */
+        bool ScoreHeatmapAsync(const std::string& recordsPath);
+
+        void ToggleHeatmap() { m_ShowHeatmap = !m_ShowHeatmap && !m_NodeHits.empty(); }
+        bool IsShowingHeatmap() const { return m_ShowHeatmap; }
+
+        /**
+         * @brief Show identical subtrees once, with an edge from every parent (see Data/SubtreeSharing.h)
+         *
+         * The shared view is rebuilt a few times per second while the tree
+         * changes; nodes keep their positions, so only the first occurrence
+         * of each repeated subtree stays visible.
+         */
+        void ToggleSharedView();
+        bool IsShowingSharedView() const { return m_ShowShared; }
+        const Data::SharingStats& GetSharingStats() const { return m_SharingStats; }
+
+        void CancelFileOperation();   ///< Stop the running file operation; the target file is left as it was
+        FileOperation GetFileOperation() const { return m_FileOperation; }
+
+        /**
+         * @brief Fraction of the running file operation done (negative if unknown)
+         */
+        float GetFileProgress() const { return m_FileTask ? m_FileTask->GetProgress() : -1.0f; }
+
+        /**
+         * @brief Start logging edits to the journal next to GetFilePath()
+         *
+         * Edits are written in the background; if the editor exits without
+         * saving, the next Open() of the same file replays them.
+         */
+        void StartJournal();
+
+        /**
+         * @brief Whether the tree is still shown from a mapped binary file
+         */
+        bool IsViewingMappedFile() const { return m_MappedView != nullptr; }
+
+        /**
+         * @brief Pager of the lazily opened file (nullptr once fully loaded)
+         */
+        IO::SubtreePager* GetPager() { return m_Pager.get(); }
+
+        const std::string& GetFilePath() const { return m_FilePath; }
         
         /**
          * @brief Create a new child node attached to the selected node
          * @param type The type of node to create
+         *
+         * The parent's children are laid out again around it (see Data/TreeLayout.h).
          */
         void CreateNode(Data::NodeType type);
         
@@ -56,22 +204,81 @@ namespace Editor {
          */
         void DeleteSelected();
 
+        /**
+         * @brief Change a node label through the undo history
+         * @param node Node to relabel
+         * @param label New label text
+         *
+         * Successive calls for the same node merge into one undo step until
+         * the selection changes.
+         */
+        void RenameNode(Data::NodeId node, std::string_view label);
+
+        /**
+         * @brief Rearrange the whole tree into a tidy layout (see Data/TreeLayout.h)
+         *
+         * The root stays where it is. The new positions are not an undo step.
+         */
+        void AutoLayout();
+
+        void Undo();   ///< Revert the most recent edit
+        void Redo();   ///< Re-apply the most recently undone edit
+
     private:
-        Data::TreeNode* m_Root;           ///< Root node of the decision tree
-        Data::TreeNode* m_SelectedNode;   ///< Currently selected node (can be null)
-        Data::TreeNode* m_HoveredNode;    ///< Node under mouse cursor (can be null)
+        std::unique_ptr<Data::Document> m_Document;  ///< Document owning the tree and its nodes
+        std::unique_ptr<History> m_History;          ///< Undo/redo log for m_Document
+        std::unique_ptr<Eval::Validator> m_Validator;  ///< Issues of m_Document's nodes
+        std::unique_ptr<Core::ThreadPool> m_LayoutPool;  ///< Workers for whole layouts (null on one hardware thread)
+        std::unique_ptr<Data::TreeLayout> m_Layout;  ///< Tidy placement of m_Document's nodes
+        std::unique_ptr<Animator> m_Animator;        ///< Active animations of m_Document's nodes
+        std::unique_ptr<IO::BinaryTreeView> m_MappedView;  ///< Read-only tree shown until the first edit
+        std::unique_ptr<IO::SubtreePager> m_Pager;   ///< Loads m_Document's collapsed subtrees on demand
+        std::string m_FilePath;                      ///< File the document is saved to
+        std::unique_ptr<IO::Journal> m_Journal;      ///< Crash-recovery log of m_Document's edits
+        uint64_t m_SavedRecordCount;                 ///< Journal records at the last save
+        std::unique_ptr<IO::FileTask> m_FileTask;    ///< Background load or save (null when idle)
+        FileOperation m_FileOperation;               ///< What m_FileTask is doing
+        std::string m_TaskPath;                      ///< File m_FileTask reads or writes
+        uint64_t m_TaskRecordCount;                  ///< Journal records covered by the snapshot being saved
+        struct HeatmapRun;
+        std::shared_ptr<HeatmapRun> m_HeatmapRun;    ///< Program and counters of the last heatmap scoring
+        std::vector<uint64_t> m_NodeHits;            ///< Records that reached each node, by NodeId
+        uint64_t m_MaxNodeHits;                      ///< Largest of m_NodeHits (the root's count)
+        bool m_ShowHeatmap;
+        float m_HeatmapRefresh;                      ///< Seconds until running counts are merged again
+        bool m_ShowShared;
+        float m_SharedRefresh;                       ///< Seconds until the shared view is checked for changes
+        Data::Snapshot m_SharedSource;               ///< Version the shared view was built from
+        Data::Snapshot m_Shared;                     ///< m_SharedSource with identical subtrees merged
+        std::vector<Data::SharedNodeUse> m_SharedNodes;   ///< Distinct nodes of m_Shared, drawn instead of the document
+        Data::SharingStats m_SharingStats;
+        Data::NodeId m_SelectedNode;      ///< Currently selected node (can be InvalidNode)
+        Data::NodeId m_HoveredNode;       ///< Node under mouse cursor (can be InvalidNode)
 
         // Drag state
         bool m_IsDragging;                ///< Whether user is dragging a node
         float m_DragOffsetX, m_DragOffsetY; ///< Offset from mouse to node center
+        float m_DragStartX, m_DragStartY; ///< Node position when the drag began
 
         // Helper methods
-        void LayoutTree(Data::TreeNode* node, float x, float y, float hSpacing, float vSpacing);
-        void MoveTreeRecursive(Data::TreeNode* node, float dx, float dy);
-        void UpdateNodeScales(Data::TreeNode* node, Data::TreeNode* hovered);
-        void DrawNodeRecursive(Graphics::Renderer& renderer, Data::TreeNode* node);
-        Data::TreeNode* HitTest(Data::TreeNode* node, float x, float y);
-        void DeleteNode(Data::TreeNode* parent, Data::TreeNode* nodeToDelete);
+        bool EnsureMaterialized();
+        bool StartSave(const std::string& path, FileOperation operation);
+        void FinishFileOperation();
+        void RefreshHeatmap();
+        void RefreshSharedView();
+        float GetHeat(Data::NodeId node) const;
+        void EnsureLoaded(Data::NodeId node);
+        void StopJournal();
+        void EndDrag();
+        void UpdateLayout();       ///< Lays out the edited paths; the subtrees beside them wait for ResolveLayout()
+        void ResolveLayout();
+        Data::Snapshot TakeSnapshot();
+        void DrawConnections(Graphics::Renderer& renderer);
+        void DrawNodes(Graphics::Renderer& renderer);
+        void DrawPlaceholders(Graphics::Renderer& renderer);
+        void DrawMappedView(Graphics::Renderer& renderer);
+        void DrawSharedView(Graphics::Renderer& renderer);
+        Data::NodeId HitTest(float x, float y) const;
     };
 
 }
@@ -0,0 +1,292 @@
+/**
+ * History.cpp
+ * Implementation of the History class
+ */
+
+#include "History.h"
+#include "../Data/Traversal.h"
+
+namespace Editor {
+
+    History::History(Data::Document& document, size_t memoryBudget)
+        : m_Document(document), m_Journal(nullptr), m_Budget(memoryBudget), m_Usage(0) {
+    }
+
+    History::~History() {
+        Clear();
+    }
+
+    void History::RecordCreate(Data::NodeId node) {
+        Data::NodeStore& nodes = m_Document.GetNodes();
+        Command command = MakeCommand(CommandType::Create, node);
+        command.Parent = nodes.GetParent(node);
+        command.Slot = nodes.GetSlot(node);
+        if (command.Parent != Data::InvalidNode) {
+            command.EdgeLabel = nodes.GetEdgeLabelId(command.Parent, command.Slot);
+            nodes.GetStrings().Retain(command.EdgeLabel);
+        }
+        LogChange(command, false);
+        Push(command);
+    }
+
+    void History::RecordMove(Data::NodeId node, float dx, float dy) {
+        Command command = MakeCommand(CommandType::Move, node);
+        command.DX = dx;
+        command.DY = dy;
+        LogChange(command, false);
+        Push(command);
+    }
+
+    void History::Relabel(Data::NodeId node, std::string_view label) {
+        Data::NodeStore& nodes = m_Document.GetNodes();
+        Data::StringTable& strings = nodes.GetStrings();
+
+        // Keep the old label referenced across the edit
+        Data::StringId oldLabel = nodes.GetLabelId(node);
+        strings.Retain(oldLabel);
+        nodes.SetLabel(node, label);
+        Data::StringId newLabel = nodes.GetLabelId(node);
+        strings.Retain(newLabel);
+        if (m_Journal) m_Journal->AppendRelabel(node, label);
+
+        if (!m_Undo.empty()) {
+            Command& top = m_Undo.back();
+            if (top.Type == CommandType::Relabel && top.Node == node && !top.Sealed) {
+                // Continuous typing: extend the previous edit
+                strings.Release(top.NewLabel);
+                top.NewLabel = newLabel;
+                strings.Release(oldLabel);
+                ClearRedo();
+                return;
+            }
+        }
+
+        Command command = MakeCommand(CommandType::Relabel, node);
+        command.OldLabel = oldLabel;
+        command.NewLabel = newLabel;
+        Push(command);
+    }
+
+    void History::DeleteSubtree(Data::NodeId node) {
+        Data::NodeStore& nodes = m_Document.GetNodes();
+        if (!nodes.IsLive(node)) return;
+
+        Command command = MakeCommand(CommandType::Delete, node);
+        command.Parent = nodes.GetParent(node);
+        command.Slot = nodes.GetSlot(node);
+        if (command.Parent != Data::InvalidNode) {
+            command.EdgeLabel = nodes.GetEdgeLabelId(command.Parent, command.Slot);
+            nodes.GetStrings().Retain(command.EdgeLabel);
+        }
+        command.StashedNodes = m_Document.StashSubtree(node);
+        LogChange(command, false);
+        Push(command);
+    }
+
+    void History::ApplyLayout(Data::TreeLayout& layout, Data::NodeId root, float x, float y) {
+        Data::NodeStore& nodes = m_Document.GetNodes();
+        if (!nodes.IsLive(root)) return;
+
+        Command command = MakeCommand(CommandType::Layout, root);
+        Data::PreOrder(nodes, root, [&](Data::NodeId id, uint32_t) {
+            command.Positions.push_back(nodes.GetX(id));
+            command.Positions.push_back(nodes.GetY(id));
+        });
+        layout.Apply(root, x, y);
+        if (m_Journal) m_Journal->AppendLayout(root, x, y);
+        Push(std::move(command));
+    }
+
+    void History::Seal() {
+        if (!m_Undo.empty()) m_Undo.back().Sealed = true;
+    }
+
+    bool History::Undo() {
+        if (m_Undo.empty()) return false;
+        Command command = std::move(m_Undo.back());
+        m_Undo.pop_back();
+        m_Usage -= CostOf(command);
+
+        Data::NodeStore& nodes = m_Document.GetNodes();
+        switch (command.Type) {
+            case CommandType::Create:
+                command.StashedNodes = m_Document.StashSubtree(command.Node);
+                break;
+            case CommandType::Delete:
+                m_Document.RestoreSubtree(command.Node, command.Parent, command.Slot, command.EdgeLabel);
+                command.StashedNodes = 0;
+                break;
+            case CommandType::Move:
+                m_Document.MoveSubtree(command.Node, -command.DX, -command.DY);
+                break;
+            case CommandType::Relabel:
+                nodes.SetLabelId(command.Node, command.OldLabel);
+                break;
+            case CommandType::Layout:
+                SwapPositions(command);
+                break;
+        }
+        LogChange(command, true);
+
+        // Undone commands never merge with later edits
+        command.Sealed = true;
+        m_Usage += CostOf(command);
+        m_Redo.push_back(std::move(command));
+        EnforceBudget();
+        return true;
+    }
+
+    bool History::Redo() {
+        if (m_Redo.empty()) return false;
+        Command command = std::move(m_Redo.back());
+        m_Redo.pop_back();
+        m_Usage -= CostOf(command);
+
+        Data::NodeStore& nodes = m_Document.GetNodes();
+        switch (command.Type) {
+            case CommandType::Create:
+                m_Document.RestoreSubtree(command.Node, command.Parent, command.Slot, command.EdgeLabel);
+                command.StashedNodes = 0;
+                break;
+            case CommandType::Delete:
+                command.StashedNodes = m_Document.StashSubtree(command.Node);
+                break;
+            case CommandType::Move:
+                m_Document.MoveSubtree(command.Node, command.DX, command.DY);
+                break;
+            case CommandType::Relabel:
+                nodes.SetLabelId(command.Node, command.NewLabel);
+                break;
+            case CommandType::Layout:
+                SwapPositions(command);
+                break;
+        }
+        LogChange(command, false);
+
+        m_Usage += CostOf(command);
+        m_Undo.push_back(std::move(command));
+        EnforceBudget();
+        return true;
+    }
+
+    void History::Clear() {
+        ClearRedo();
+        while (!m_Undo.empty()) {
+            Release(m_Undo.front(), false);
+            m_Undo.pop_front();
+        }
+        m_Usage = 0;
+    }
+
+    void History::SetMemoryBudget(size_t bytes) {
+        m_Budget = bytes;
+        EnforceBudget();
+    }
+
+    void History::Push(Command command) {
+        ClearRedo();
+        Seal();
+        m_Usage += CostOf(command);
+        m_Undo.push_back(std::move(command));
+        EnforceBudget();
+    }
+
+    void History::ClearRedo() {
+        for (Command& command : m_Redo) {
+            m_Usage -= CostOf(command);
+            Release(command, true);
+        }
+        m_Redo.clear();
+    }
+
+    void History::Release(Command& command, bool undone) {
+        Data::StringTable& strings = m_Document.GetNodes().GetStrings();
+
+        // A stashed subtree is owned by an undone Create or a done Delete
+        bool ownsStash = (command.Type == CommandType::Create && undone)
+                      || (command.Type == CommandType::Delete && !undone);
+        if (ownsStash) m_Document.DeleteSubtree(command.Node);
+
+        strings.Release(command.EdgeLabel);
+        strings.Release(command.OldLabel);
+        strings.Release(command.NewLabel);
+        command.StashedNodes = 0;
+    }
+
+    void History::EnforceBudget() {
+        // Trim the oldest undo entries first, then the farthest redo entries
+        while (m_Usage > m_Budget && !m_Undo.empty()) {
+            m_Usage -= CostOf(m_Undo.front());
+            Release(m_Undo.front(), false);
+            m_Undo.pop_front();
+        }
+        while (m_Usage > m_Budget && !m_Redo.empty()) {
+            m_Usage -= CostOf(m_Redo.front());
+            Release(m_Redo.front(), true);
+            m_Redo.erase(m_Redo.begin());
+        }
+    }
+
+    size_t History::CostOf(const Command& command) const {
+        return sizeof(Command) + size_t(command.StashedNodes) * Data::NodeStore::BytesPerNode
+             + command.Positions.size() * sizeof(float);
+    }
+
+    void History::SwapPositions(Command& command) {
+        // Commands are undone in order, so the subtree has the nodes it had
+        // when the positions were taken, in the same order
+        Data::NodeStore& nodes = m_Document.GetNodes();
+        std::vector<float>& positions = command.Positions;
+        size_t index = 0;
+        Data::PreOrder(nodes, command.Node, [&](Data::NodeId id, uint32_t) {
+            if (index + 1 >= positions.size()) return;
+            float x = nodes.GetX(id), y = nodes.GetY(id);
+            nodes.SetPosition(id, positions[index], positions[index + 1]);
+            positions[index] = x;
+            positions[index + 1] = y;
+            index += 2;
+        });
+    }
+
+    void History::LogChange(const Command& command, bool undo) {
+        if (!m_Journal) return;
+
+        // Log the effect on the tree, which for an undo is the inverse command
+        const Data::NodeStore& nodes = m_Document.GetNodes();
+        bool removes = (command.Type == CommandType::Create) == undo;
+        switch (command.Type) {
+            case CommandType::Create:
+            case CommandType::Delete:
+                if (removes) m_Journal->AppendDelete(command.Node);
+                else m_Journal->AppendSubtree(nodes, command.Node);
+                break;
+            case CommandType::Move:
+                if (undo) m_Journal->AppendMove(command.Node, -command.DX, -command.DY);
+                else m_Journal->AppendMove(command.Node, command.DX, command.DY);
+                break;
+            case CommandType::Relabel:
+                m_Journal->AppendRelabel(command.Node, nodes.GetLabel(command.Node));
+                break;
+            case CommandType::Layout:
+                m_Journal->AppendPlacement(nodes, command.Node);
+                break;
+        }
+    }
+
+    History::Command History::MakeCommand(CommandType type, Data::NodeId node) const {
+        Command command;
+        command.Type = type;
+        command.Sealed = false;
+        command.Node = node;
+        command.Parent = Data::InvalidNode;
+        command.Slot = 0;
+        command.EdgeLabel = Data::EmptyString;
+        command.OldLabel = Data::EmptyString;
+        command.NewLabel = Data::EmptyString;
+        command.DX = 0;
+        command.DY = 0;
+        command.StashedNodes = 0;
+        return command;
+    }
+
+}
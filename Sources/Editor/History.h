@@ -0,0 +1,140 @@
+/**
+ * History.h
+ * Undo/redo command log for document edits
+ *
+ * Records every edit as a compact delta (node ids, offsets and interned
+ * label ids) instead of snapshotting the tree. Deleted subtrees are stashed
+ * in the node store rather than copied, and the log is trimmed from the
+ * oldest end whenever it exceeds its memory budget.
+ */
+
+#pragma once
+
+#include "../Data/Document.h"
+#include "../Data/TreeLayout.h"
+#include "../IO/Journal.h"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string_view>
+#include <vector>
+
+namespace Editor {
+
+    /**
+     * @class History
+     * @brief Bounded undo/redo stack operating on a Document
+     *
+     * Edits are either recorded after the fact (RecordCreate, RecordMove)
+     * or performed through the history (Relabel, DeleteSubtree, ApplyLayout)
+     * when the old state must be captured first. Consecutive label edits of the same
+     * node are merged into one command until Seal() is called.
+     */
+    class History {
+    public:
+        static constexpr size_t DefaultMemoryBudget = 64 * 1024 * 1024; ///< 64 MB
+
+        History(Data::Document& document, size_t memoryBudget = DefaultMemoryBudget);
+        ~History();
+
+        History(const History&) = delete;
+        History& operator=(const History&) = delete;
+
+        /**
+         * @brief Record that a node has just been created and attached
+         * @param node The new node (its parent, slot and edge label are captured)
+         */
+        void RecordCreate(Data::NodeId node);
+
+        /**
+         * @brief Record that a subtree has been translated
+         * @param node Root of the moved subtree
+         * @param dx Total horizontal offset of the move
+         * @param dy Total vertical offset of the move
+         */
+        void RecordMove(Data::NodeId node, float dx, float dy);
+
+        /**
+         * @brief Change a node label and record the edit
+         * @param node Node to relabel
+         * @param label New label text
+         *
+         * Merges into the previous command if it relabeled the same node
+         * and has not been sealed.
+         */
+        void Relabel(Data::NodeId node, std::string_view label);
+
+        /**
+         * @brief Remove a subtree from the document and record the deletion
+         * @param node Root of the subtree (stashed, not freed, until evicted)
+         */
+        void DeleteSubtree(Data::NodeId node);
+
+        /**
+         * @brief Lay out a whole subtree with its root at (x, y) and record the previous positions
+         *
+         * Undo puts every node of the subtree back where it was. Costs two
+         * floats per node of the subtree in the memory budget.
+         */
+        void ApplyLayout(Data::TreeLayout& layout, Data::NodeId root, float x, float y);
+
+        /**
+         * @brief Stop merging further edits into the most recent command
+         */
+        void Seal();
+
+        bool Undo();   ///< Revert the most recent command; false if none
+        bool Redo();   ///< Re-apply the most recently undone command; false if none
+        bool CanUndo() const { return !m_Undo.empty(); }
+        bool CanRedo() const { return !m_Redo.empty(); }
+
+        /**
+         * @brief Drop every command and release the subtrees they keep alive
+         */
+        void Clear();
+
+        /**
+         * @brief Log every edit, undo and redo to a journal (null to stop)
+         * @param journal Not owned; must outlive its registration
+         */
+        void SetJournal(IO::Journal* journal) { m_Journal = journal; }
+
+        void SetMemoryBudget(size_t bytes);
+        size_t GetMemoryBudget() const { return m_Budget; }
+        size_t GetMemoryUsage() const { return m_Usage; }   ///< Commands plus stashed node storage
+
+    private:
+        enum class CommandType : uint8_t { Create, Delete, Move, Relabel, Layout };
+
+        struct Command {
+            CommandType Type;
+            bool Sealed;
+            Data::NodeId Node;
+            Data::NodeId Parent;        ///< Create/Delete: parent to re-attach under
+            uint32_t Slot;              ///< Create/Delete: child slot in the parent
+            Data::StringId EdgeLabel;   ///< Create/Delete: edge label (referenced)
+            Data::StringId OldLabel;    ///< Relabel: previous label (referenced)
+            Data::StringId NewLabel;    ///< Relabel: new label (referenced)
+            float DX, DY;               ///< Move: offset applied by the command
+            uint32_t StashedNodes;      ///< Nodes this command keeps alive in the stash
+            std::vector<float> Positions;   ///< Layout: x, y of the subtree's nodes in pre-order, as undo or redo leaves them
+        };
+
+        Data::Document& m_Document;
+        IO::Journal* m_Journal;         ///< Receives every applied change (can be null)
+        std::deque<Command> m_Undo;     ///< Oldest command at the front
+        std::vector<Command> m_Redo;    ///< Next command to redo at the back
+        size_t m_Budget;
+        size_t m_Usage;
+
+        void Push(Command command);
+        void ClearRedo();
+        void Release(Command& command, bool undone);
+        void EnforceBudget();
+        size_t CostOf(const Command& command) const;
+        Command MakeCommand(CommandType type, Data::NodeId node) const;
+        void SwapPositions(Command& command);
+        void LogChange(const Command& command, bool undo);
+    };
+
+}
@@ -3,12 +3,15 @@
 #include "../UI/TextInput.h"
 #include "../UI/Label.h"
 #include "../UI/MenuBar.h"
+#include "../UI/ListView.h"
+#include <cstdio>
+#include <filesystem>
 #include <iostream>
 
 namespace Editor {
 
     Layout::Layout(Editor* editor, float screenW, float screenH, SDL_Window* window) 
-        : m_Editor(editor), m_ScreenW(screenW), m_ScreenH(screenH), m_Window(window) {
+        : m_Editor(editor), m_ScreenW(screenW), m_ScreenH(screenH), m_Window(window), m_LabelNode(Data::InvalidNode), m_LabelId(Data::EmptyString), m_IssueRevision(~uint64_t(0)) {
         
         float sidebarW = 200.0f;
         float inspectorW = 250.0f;
@@ -46,6 +49,11 @@ namespace Editor {
         m_LeftPanel->AddChild(new UI::Button(20, btnY, 160, btnH, "Add End", [=, this]() {
             m_Editor->CreateNode(Data::NodeType::End);
         }));
+        btnY += btnH + gap * 3;
+
+        m_LeftPanel->AddChild(new UI::Button(20, btnY, 160, btnH, "Auto Layout", [=, this]() {
+            m_Editor->AutoLayout();
+        }));
 
         // Right Sidebar (Inspector)
         m_RightPanel = new UI::Panel(screenW - inspectorW, totalTopOffset, inspectorW, screenH - totalTopOffset, 37, 37, 38);
@@ -61,8 +69,15 @@ namespace Editor {
         m_LabelInput = new UI::TextInput(screenW - inspectorW + 20, 120, 210, 30, nullptr, m_Window);
         m_RightPanel->AddChild(m_LabelInput);
 
+        // Problems found by the validator; clicking one selects its node
+        m_IssueList = new UI::ListView(screenW - inspectorW + 20, 170, 210, screenH - 190, "Issues", [this](size_t row) {
+            if (row < m_IssueNodes.size()) m_Editor->Select(m_IssueNodes[row]);
+        });
+        m_RightPanel->AddChild(m_IssueList);
+
         // Top Tab Bar (Below Menu Bar)
         m_TabBar = new UI::TabBar(0, menuH, screenW, topOffset); 
+        m_TabBar->SetOnCancel([this]() { m_Editor->CancelFileOperation(); });
 
         m_UIElements.push_back(m_MenuBar); 
         m_UIElements.push_back(m_TabBar); 
@@ -78,18 +93,31 @@ namespace Editor {
 
     bool Layout::Update(float deltaTime) {
         // Update selection binding
-        Data::TreeNode* selected = m_Editor->GetSelectedNode();
+        // The text input edits a local copy of the interned label; changes are
+        // re-interned into the node store (copy-on-edit) by CommitLabelEdit().
+        // The buffer is reloaded when the selection changes or the label is
+        // changed from elsewhere (e.g. by undo).
+        Data::NodeId selected = m_Editor->GetSelectedNode();
+        const Data::NodeStore& nodes = m_Editor->GetDocument().GetNodes();
+        bool live = nodes.IsLive(selected);
+        Data::StringId labelId = live ? nodes.GetLabelId(selected) : Data::EmptyString;
+        if (selected != m_LabelNode || labelId != m_LabelId) {
+            m_LabelNode = selected;
+            m_LabelId = labelId;
+            m_LabelBuffer = live ? std::string(nodes.GetLabel(selected)) : "";
+        }
         if (m_LabelInput) {
-            // Only update target if NOT focused to allow external rename? 
-            // Better: update always, but maybe careful if typing.
-            // Actually binding pointer is safe.
-            m_LabelInput->SetTarget(selected ? &selected->Label : nullptr);
+            m_LabelInput->SetTarget(live ? &m_LabelBuffer : nullptr);
         }
 
+        UpdateFileStatus();
+        UpdateIssueList();
+
         bool handled = false;
         for (auto ui : m_UIElements) {
             if (ui->Update(deltaTime)) handled = true;
         }
+        CommitLabelEdit();
         return handled;
     }
 
@@ -108,6 +136,72 @@ namespace Editor {
     void Layout::ProcessTextInput(const char* text) {
         if (m_LabelInput) {
             m_LabelInput->AppendText(text);
+            CommitLabelEdit();
+        }
+    }
+
+    void Layout::UpdateFileStatus() {
+        // The active tab names the open file and shows background loads and saves
+        m_TabBar->SetActiveTitle(std::filesystem::path(m_Editor->GetFilePath()).filename().string());
+
+        const char* verb = nullptr;
+        switch (m_Editor->GetFileOperation()) {
+            case Editor::FileOperation::Open: verb = "Opening"; break;
+            case Editor::FileOperation::Recover: verb = "Recovering"; break;
+            case Editor::FileOperation::Save: verb = "Saving"; break;
+            case Editor::FileOperation::Export: verb = "Exporting"; break;
+            case Editor::FileOperation::Score: verb = "Scoring"; break;
+            case Editor::FileOperation::None: break;
+        }
+        if (!verb) {
+            m_TabBar->ClearProgress();
+            return;
+        }
+        char status[32];
+        float progress = m_Editor->GetFileProgress();
+        if (progress >= 0.0f) std::snprintf(status, sizeof(status), "%s %d%%", verb, int(progress * 100.0f));
+        else std::snprintf(status, sizeof(status), "%s...", verb);
+        m_TabBar->SetProgress(status, progress);
+    }
+
+    void Layout::UpdateIssueList() {
+        static constexpr size_t MaxListed = 100;
+        const Eval::Validator& validator = m_Editor->GetValidator();
+        if (validator.GetRevision() == m_IssueRevision) return;
+        m_IssueRevision = validator.GetRevision();
+
+        const Data::NodeStore& nodes = m_Editor->GetDocument().GetNodes();
+        const IO::SubtreePager* pager = m_Editor->GetPager();
+        std::vector<UI::ListView::Item> items;
+        m_IssueNodes.clear();
+        for (Eval::Issue& issue : validator.CollectIssues(m_Editor->GetRoot(), MaxListed)) {
+            // Collapsed subtrees are leaves only until they are loaded
+            if (issue.Kind == Eval::MissingEnd && pager && pager->GetPlaceholders().count(issue.Node)) continue;
+            std::string_view label = nodes.GetLabel(issue.Node);
+            UI::ListView::Item item;
+            item.Text = (label.empty() ? std::string("(unnamed)") : std::string(label)) + ": " + issue.Message;
+            if (issue.IsError) {
+                item.G = 110;
+                item.B = 110;
+            } else {
+                item.G = 170;
+                item.B = 60;
+            }
+            items.push_back(std::move(item));
+            m_IssueNodes.push_back(issue.Node);
+        }
+        m_IssueList->SetItems(std::move(items));
+
+        char title[48];
+        std::snprintf(title, sizeof(title), "Issues (%u)", validator.GetIssueCount());
+        m_IssueList->SetTitle(title);
+    }
+
+    void Layout::CommitLabelEdit() {
+        const Data::NodeStore& nodes = m_Editor->GetDocument().GetNodes();
+        if (nodes.IsLive(m_LabelNode) && nodes.GetLabel(m_LabelNode) != m_LabelBuffer) {
+            m_Editor->RenameNode(m_LabelNode, m_LabelBuffer);
+            m_LabelId = nodes.GetLabelId(m_LabelNode);
         }
     }
 
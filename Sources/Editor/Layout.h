@@ -9,7 +9,7 @@
 #include "../UI/Button.h"
 #include "Editor.h"
 
-namespace UI { class TextInput; }
+namespace UI { class TextInput; class TabBar; class ListView; }
 
 namespace Editor {
 
@@ -36,10 +36,21 @@ namespace Editor {
 
         UI::Panel* m_LeftPanel;
         UI::Panel* m_RightPanel;
-        UI::Widget* m_TabBar;
+        UI::TabBar* m_TabBar;
         UI::Widget* m_MenuBar;
         
         UI::TextInput* m_LabelInput;
+        Data::NodeId m_LabelNode;        ///< Node whose label is being edited
+        std::string m_LabelBuffer;       ///< Edit buffer bound to the text input
+        Data::StringId m_LabelId;        ///< Label id the buffer was last synced with
+
+        UI::ListView* m_IssueList;
+        std::vector<Data::NodeId> m_IssueNodes;   ///< Node of each row of m_IssueList
+        uint64_t m_IssueRevision;        ///< Validator revision the list was built from
+
+        void CommitLabelEdit();
+        void UpdateFileStatus();
+        void UpdateIssueList();
 
         std::vector<UI::Widget*> m_UIElements;
     };
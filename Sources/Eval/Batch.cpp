@@ -0,0 +1,202 @@
+/**
+ * Batch.cpp
+ * Implementation of the batch evaluators
+ */
+
+#include "Batch.h"
+#include <algorithm>
+#include <climits>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define EVAL_HAS_SSE2 1
+#include <emmintrin.h>
+#if defined(__GNUC__)
+// AVX2 code is compiled per function and only run after a CPU check
+#define EVAL_HAS_AVX2 1
+#include <immintrin.h>
+#endif
+#endif
+
+namespace Eval {
+
+    namespace {
+
+        /// Programs above this (1 MiB of code) are run by EvaluateScalar() at SimdLevel::Sse2
+        constexpr size_t Sse2MaxInstructions = size_t(1) << 16;
+
+        /**
+         * @brief Test result bits of a feature against a constant (see CompareBits)
+         */
+        inline uint32_t Compare(float x, float value) {
+            return uint32_t(x < value) | uint32_t(x == value) << 1 | uint32_t(x > value) << 2 | uint32_t(x != x) << 3;
+        }
+
+        /**
+         * @brief One record at a time, reading its features straight from the columns
+         */
+        void EvaluateScalar(const Program& program, const ColumnBlock& block, size_t begin, uint32_t* outcomes, uint32_t* exits) {
+            const Instruction* code = program.GetCode().data();
+            for (size_t record = begin; record < block.Count; ++record) {
+                const float* features = block.Columns + record;
+                uint32_t pc = 0;
+                while (code[pc].Op == Opcode::Test) {
+                    const Instruction& test = code[pc];
+                    pc = (Compare(features[test.Operand * block.Stride], test.Value) & test.Mask) ? pc + 1 : test.Target;
+                }
+                outcomes[record] = code[pc].Operand;
+                if (exits) exits[record] = pc;
+            }
+        }
+
+#if EVAL_HAS_SSE2
+        /**
+         * @brief 4 lanes; SSE2 has no gather, so operands are loaded per lane and compared together
+         * @return Records done (a multiple of 4); the caller finishes the rest
+         */
+        size_t EvaluateSse2(const Program& program, const ColumnBlock& block, uint32_t* outcomes, uint32_t* exits) {
+            const Instruction* code = program.GetCode().data();
+            const __m128i one = _mm_set1_epi32(1);
+            const __m128i bitLess = _mm_set1_epi32(Less), bitEqual = _mm_set1_epi32(Equal);
+            const __m128i bitGreater = _mm_set1_epi32(Greater), bitUnordered = _mm_set1_epi32(Unordered);
+            size_t end = block.Count & ~size_t(3);
+
+            for (size_t base = 0; base < end; base += 4) {
+                alignas(16) uint32_t pc[4] = {};
+                while (true) {
+                    const Instruction* lane[4] = { &code[pc[0]], &code[pc[1]], &code[pc[2]], &code[pc[3]] };
+                    int active = 0;
+                    alignas(16) float x[4] = {}, value[4] = {};
+                    alignas(16) uint32_t mask[4] = {}, target[4] = {};
+                    for (int i = 0; i < 4; ++i) {
+                        if (lane[i]->Op != Opcode::Test) continue;
+                        active |= 1 << i;
+                        x[i] = block.Columns[lane[i]->Operand * block.Stride + base + i];
+                        value[i] = lane[i]->Value;
+                        mask[i] = lane[i]->Mask;
+                        target[i] = lane[i]->Target;
+                    }
+                    if (!active) break;
+
+                    __m128 vx = _mm_load_ps(x), vvalue = _mm_load_ps(value);
+                    __m128i bits = _mm_or_si128(
+                        _mm_or_si128(_mm_and_si128(_mm_castps_si128(_mm_cmplt_ps(vx, vvalue)), bitLess),
+                                     _mm_and_si128(_mm_castps_si128(_mm_cmpeq_ps(vx, vvalue)), bitEqual)),
+                        _mm_or_si128(_mm_and_si128(_mm_castps_si128(_mm_cmpgt_ps(vx, vvalue)), bitGreater),
+                                     _mm_and_si128(_mm_castps_si128(_mm_cmpunord_ps(vx, vx)), bitUnordered)));
+                    __m128i fail = _mm_cmpeq_epi32(_mm_and_si128(bits, _mm_load_si128(reinterpret_cast<const __m128i*>(mask))), _mm_setzero_si128());
+                    __m128i current = _mm_load_si128(reinterpret_cast<const __m128i*>(pc));
+                    __m128i next = _mm_or_si128(_mm_and_si128(fail, _mm_load_si128(reinterpret_cast<const __m128i*>(target))),
+                                                _mm_andnot_si128(fail, _mm_add_epi32(current, one)));
+                    alignas(16) uint32_t nextPc[4];
+                    _mm_store_si128(reinterpret_cast<__m128i*>(nextPc), next);
+                    for (int i = 0; i < 4; ++i) {
+                        if (active & (1 << i)) pc[i] = nextPc[i];
+                    }
+                }
+                for (int i = 0; i < 4; ++i) outcomes[base + i] = code[pc[i]].Operand;
+                if (exits) std::copy_n(pc, 4, exits + base);
+            }
+            return end;
+        }
+#endif
+
+#if EVAL_HAS_AVX2
+        /**
+         * @brief 8 lanes; instruction fields and features are fetched with gathers
+         * @return Records done (a multiple of 8); the caller finishes the rest
+         */
+        __attribute__((target("avx2")))
+        size_t EvaluateAvx2(const Program& program, const ColumnBlock& block, uint32_t* outcomes, uint32_t* exits) {
+            // An Instruction is four 32-bit words: Op | Mask << 8, Operand, Value, Target
+            const int* words = reinterpret_cast<const int*>(program.GetCode().data());
+            const float* values = reinterpret_cast<const float*>(words);
+            const __m256i one = _mm256_set1_epi32(1), byteMask = _mm256_set1_epi32(0xFF);
+            const __m256i bitLess = _mm256_set1_epi32(Less), bitEqual = _mm256_set1_epi32(Equal);
+            const __m256i bitGreater = _mm256_set1_epi32(Greater), bitUnordered = _mm256_set1_epi32(Unordered);
+            const __m256i testOp = _mm256_set1_epi32(static_cast<int>(Opcode::Test));
+            const __m256i stride = _mm256_set1_epi32(static_cast<int>(block.Stride));
+            const __m256i laneOffsets = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+            size_t end = block.Count & ~size_t(7);
+
+            for (size_t base = 0; base < end; base += 8) {
+                __m256i record = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(base)), laneOffsets);
+                __m256i pc = _mm256_setzero_si256();
+                while (true) {
+                    __m256i word = _mm256_slli_epi32(pc, 2);
+                    __m256i head = _mm256_i32gather_epi32(words, word, 4);
+                    __m256i active = _mm256_cmpeq_epi32(_mm256_and_si256(head, byteMask), testOp);
+                    if (_mm256_testz_si256(active, active)) break;
+
+                    __m256i feature = _mm256_i32gather_epi32(words, _mm256_add_epi32(word, one), 4);
+                    __m256 value = _mm256_i32gather_ps(values, _mm256_add_epi32(word, _mm256_set1_epi32(2)), 4);
+                    __m256i target = _mm256_i32gather_epi32(words, _mm256_add_epi32(word, _mm256_set1_epi32(3)), 4);
+
+                    // Lanes that already stopped hold an outcome, not a feature: do not load for them
+                    __m256i column = _mm256_add_epi32(_mm256_mullo_epi32(feature, stride), record);
+                    __m256 x = _mm256_mask_i32gather_ps(_mm256_setzero_ps(), block.Columns, column, _mm256_castsi256_ps(active), 4);
+
+                    __m256i bits = _mm256_or_si256(
+                        _mm256_or_si256(_mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(x, value, _CMP_LT_OQ)), bitLess),
+                                        _mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(x, value, _CMP_EQ_OQ)), bitEqual)),
+                        _mm256_or_si256(_mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(x, value, _CMP_GT_OQ)), bitGreater),
+                                        _mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(x, x, _CMP_UNORD_Q)), bitUnordered)));
+                    __m256i mask = _mm256_and_si256(_mm256_srli_epi32(head, 8), byteMask);
+                    __m256i fail = _mm256_cmpeq_epi32(_mm256_and_si256(bits, mask), _mm256_setzero_si256());
+                    __m256i next = _mm256_blendv_epi8(_mm256_add_epi32(pc, one), target, fail);
+                    pc = _mm256_blendv_epi8(pc, next, active);
+                }
+                __m256i outcome = _mm256_i32gather_epi32(words, _mm256_add_epi32(_mm256_slli_epi32(pc, 2), one), 4);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(outcomes + base), outcome);
+                if (exits) _mm256_storeu_si256(reinterpret_cast<__m256i*>(exits + base), pc);
+            }
+            return end;
+        }
+#endif
+
+    }
+
+    SimdLevel GetSimdLevel() {
+#if EVAL_HAS_AVX2
+        static const bool hasAvx2 = __builtin_cpu_supports("avx2");
+        if (hasAvx2) return SimdLevel::Avx2;
+#endif
+#if EVAL_HAS_SSE2
+        return SimdLevel::Sse2;
+#else
+        return SimdLevel::Scalar;
+#endif
+    }
+
+    const char* GetSimdLevelName(SimdLevel level) {
+        switch (level) {
+            case SimdLevel::Avx2: return "AVX2";
+            case SimdLevel::Sse2: return "SSE2";
+            default: return "Scalar";
+        }
+    }
+
+    void EvaluateBatch(const Program& program, const ColumnBlock& block, uint32_t* outcomes, SimdLevel level) {
+        EvaluateBatch(program, block, outcomes, nullptr, level);
+    }
+
+    void EvaluateBatch(const Program& program, const ColumnBlock& block, uint32_t* outcomes, uint32_t* exits, SimdLevel level) {
+        level = std::min(level, GetSimdLevel());
+        size_t done = 0;
+#if EVAL_HAS_AVX2
+        // Gather offsets are 32-bit: the last column must start below INT_MAX
+        size_t lastColumn = program.GetFeatureCount() > 0 ? size_t(program.GetFeatureCount() - 1) * block.Stride + block.Count : 0;
+        if (level == SimdLevel::Avx2 && lastColumn <= size_t(INT_MAX) && program.GetCode().size() < (size_t(1) << 29)) {
+            done = EvaluateAvx2(program, block, outcomes, exits);
+        }
+#endif
+#if EVAL_HAS_SSE2
+        // Per-lane loads leave SSE2 no faster than Scalar once the code outgrows
+        // the cache, and lanes waiting for each other then make it slower
+        if (level == SimdLevel::Sse2 && program.GetCode().size() <= Sse2MaxInstructions) {
+            done = EvaluateSse2(program, block, outcomes, exits);
+        }
+#endif
+        EvaluateScalar(program, block, done, outcomes, exits);
+    }
+
+}
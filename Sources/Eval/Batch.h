@@ -0,0 +1,69 @@
+/**
+ * Batch.h
+ * Vectorized evaluation of many records at once
+ *
+ * Records are given column by column, and a block of them moves through
+ * the program together: every lane keeps its own instruction index and
+ * one step advances all lanes by one tree level. Lanes that reach an Emit
+ * wait for the rest of their block. AVX2 processes 8 records per step with
+ * gathers, SSE2 processes 4 and the portable fallback walks one record at a
+ * time. The widest level the CPU supports is chosen at run time; SSE2 falls
+ * back to the portable walk for programs too large to stay in cache.
+ */
+
+#pragma once
+
+#include "Program.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace Eval {
+
+    /**
+     * @struct ColumnBlock
+     * @brief Records stored by feature: feature f of record i is Columns[f * Stride + i]
+     */
+    struct ColumnBlock {
+        const float* Columns;
+        size_t Stride;   ///< Distance between two features of a record, at least Count
+        size_t Count;    ///< Records in the block
+    };
+
+    /**
+     * @enum SimdLevel
+     * @brief Instruction set used by EvaluateBatch()
+     */
+    enum class SimdLevel {
+        Scalar,
+        Sse2,
+        Avx2
+    };
+
+    /**
+     * @brief Widest SimdLevel this CPU and build support
+     */
+    SimdLevel GetSimdLevel();
+
+    const char* GetSimdLevelName(SimdLevel level);
+
+    /**
+     * @brief Evaluate every record of a block
+     * @param program Non-empty compiled tree; the block holds GetFeatureCount() columns
+     * @param block Records to evaluate
+     * @param outcomes Receives block.Count outcome indices (see Program::Evaluate())
+     * @param level Instruction set to use; lowered to GetSimdLevel() if wider
+     *
+     * Gives the same results as calling Program::Evaluate() on each record.
+     */
+    void EvaluateBatch(const Program& program, const ColumnBlock& block, uint32_t* outcomes, SimdLevel level = GetSimdLevel());
+
+    /**
+     * @brief Evaluate every record of a block and report where each one stopped
+     * @param exits Receives block.Count instruction indices, each the Emit a record reached
+     *
+     * Traffic through the tree is measured from the exits (see HitCounter.h).
+     */
+    void EvaluateBatch(const Program& program, const ColumnBlock& block, uint32_t* outcomes, uint32_t* exits,
+                       SimdLevel level = GetSimdLevel());
+
+}
@@ -0,0 +1,291 @@
+/**
+ * CodeGen.cpp
+ * Implementation of the C++ code generator
+ */
+
+#include "CodeGen.h"
+#include "Compiler.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+namespace Eval {
+
+    namespace {
+
+        /// C++ string literal contents for arbitrary text
+        std::string Escape(std::string_view text) {
+            std::string escaped;
+            escaped.reserve(text.size());
+            for (char c : text) {
+                unsigned char byte = static_cast<unsigned char>(c);
+                if (c == '"' || c == '\\') {
+                    escaped += '\\';
+                    escaped += c;
+                } else if (byte < 0x20 || byte == 0x7F) {
+                    // Octal escapes stop after three digits, unlike \x
+                    char octal[8];
+                    std::snprintf(octal, sizeof(octal), "\\%03o", byte);
+                    escaped += octal;
+                } else {
+                    escaped += c;
+                }
+            }
+            return escaped;
+        }
+
+        /// Text safe inside a // comment
+        std::string CommentText(std::string_view text) {
+            std::string result;
+            for (char c : text) result += (c == '\n' || c == '\r' || c == '\\') ? ' ' : c;
+            return result;
+        }
+
+        std::string FloatLiteral(float value) {
+            if (std::isnan(value)) return "std::numeric_limits<float>::quiet_NaN()";
+            if (std::isinf(value)) return value > 0 ? "std::numeric_limits<float>::infinity()" : "-std::numeric_limits<float>::infinity()";
+            // Nine significant digits round-trip any float
+            char text[32];
+            std::snprintf(text, sizeof(text), "%.9g", value);
+            std::string literal = text;
+            if (literal.find_first_of(".e") == std::string::npos) literal += ".0";
+            return literal + "f";
+        }
+
+        /// A mask written as one C++ operator, or nullptr
+        const char* Operator(uint8_t mask) {
+            switch (mask) {
+                case Less: return " < ";
+                case Less | Equal: return " <= ";
+                case Greater: return " > ";
+                case Greater | Equal: return " >= ";
+                case Equal: return " == ";
+                case Less | Greater | Unordered: return " != ";
+                default: return nullptr;
+            }
+        }
+
+        /// The comparison a test's mask stands for, in C++
+        std::string Condition(const Instruction& test) {
+            std::string x = "record[" + std::to_string(test.Operand) + "]";
+            std::string value = FloatLiteral(test.Value);
+            if (const char* op = Operator(test.Mask)) return x + op + value;
+            // Negated comparisons come from expressions lowered to fall through on false
+            if (const char* op = Operator(static_cast<uint8_t>(~test.Mask & (Less | Equal | Greater | Unordered)))) {
+                return "!(" + x + op + value + ")";
+            }
+            std::string condition;
+            auto add = [&](uint8_t bit, const std::string& term) {
+                if (!(test.Mask & bit)) return;
+                if (!condition.empty()) condition += " || ";
+                condition += term;
+            };
+            add(Less, x + " < " + value);
+            add(Equal, x + " == " + value);
+            add(Greater, x + " > " + value);
+            add(Unordered, x + " != " + x);
+            return condition.empty() ? "false" : "(" + condition + ")";
+        }
+
+        /**
+         * @brief Tests that more than one instruction leads to
+         *
+         * A compound condition compiles to several tests whose jumps meet at
+         * the same branches. Such code gets a function of its own rather than
+         * a copy in every block that reaches it.
+         */
+        std::vector<bool> SharedTests(const std::vector<Instruction>& code) {
+            std::vector<uint8_t> predecessors(code.size(), 0);
+            auto reach = [&](uint32_t pc) { if (predecessors[pc] < 2) ++predecessors[pc]; };
+            for (size_t pc = 0; pc < code.size(); ++pc) {
+                if (code[pc].Op != Opcode::Test) continue;
+                reach(static_cast<uint32_t>(pc + 1));
+                reach(code[pc].Target);
+            }
+            std::vector<bool> shared(code.size(), false);
+            for (size_t pc = 1; pc < code.size(); ++pc) shared[pc] = predecessors[pc] > 1 && code[pc].Op == Opcode::Test;
+            return shared;
+        }
+
+        /**
+         * @brief Instructions emitted for each pc, a call to shared code counting as one
+         */
+        std::vector<uint32_t> SubtreeSizes(const std::vector<Instruction>& code, const std::vector<bool>& shared) {
+            // Branches point forward in pre-order code (backward jumps only reach shared code, counted as one),
+            // so one backward pass sees children first
+            std::vector<uint32_t> sizes(code.size(), 1);
+            auto sizeOf = [&](uint32_t pc) { return shared[pc] ? 1u : sizes[pc]; };
+            for (size_t pc = code.size(); pc-- > 0;) {
+                if (code[pc].Op != Opcode::Test) continue;
+                uint64_t size = 1ull + sizeOf(static_cast<uint32_t>(pc + 1)) + sizeOf(code[pc].Target);
+                sizes[pc] = static_cast<uint32_t>(std::min<uint64_t>(size, UINT32_MAX));
+            }
+            return sizes;
+        }
+
+        /**
+         * @brief Evaluate() and the subtree functions it calls
+         *
+         * Pre-order code maps onto nested blocks: the true branch of a test
+         * follows it, the false branch comes after the closing brace. A
+         * function larger than MaxFunctionSize hands its largest subtrees that
+         * fit the limit to functions of their own, shared code always gets
+         * one, and blocks nested deeper than MaxNesting continue at a label
+         * after the function's main body.
+         */
+        std::string FunctionBodies(const Program& program, const CodeGenOptions& options) {
+            const std::vector<Instruction>& code = program.GetCode();
+            std::vector<bool> shared = SharedTests(code);
+            std::vector<uint32_t> sizes = SubtreeSizes(code, shared);
+            uint32_t maxSize = std::max(options.MaxFunctionSize, 1u);
+            uint32_t minSplit = std::max(maxSize / 16, 2u);
+
+            struct Item {
+                uint32_t Pc;
+                uint32_t Depth;
+                bool Close;   ///< Emit the closing brace of a block at Depth
+            };
+            std::vector<Item> stack;
+            std::vector<uint32_t> functions = { 0 };   // Entry pcs; the first is Evaluate()
+            std::vector<bool> isEntry(code.size(), false);
+            std::vector<uint32_t> labels;              // Deferred blocks of the current function
+            std::string bodies;
+
+            for (size_t f = 0; f < functions.size(); ++f) {
+                uint32_t entry = functions[f];
+                bool split = sizes[entry] > maxSize;
+                std::string body;
+                labels.clear();
+                auto emitBlock = [&](uint32_t start) {
+                    stack.push_back({ start, 0, false });
+                    while (!stack.empty()) {
+                        Item item = stack.back();
+                        stack.pop_back();
+                        std::string indent(8 + 4 * item.Depth, ' ');
+                        if (item.Close) {
+                            body += indent + "}\n";
+                            continue;
+                        }
+
+                        const Instruction& instruction = code[item.Pc];
+                        if (instruction.Op == Opcode::Emit) {
+                            if (instruction.Operand == NoOutcome) {
+                                body += indent + "return NoOutcome;\n";
+                            } else {
+                                body += indent + "return " + std::to_string(instruction.Operand) + "u; // " +
+                                        CommentText(program.GetOutcomeLabel(instruction.Operand)) + "\n";
+                            }
+                            continue;
+                        }
+                        bool ownFunction = split && sizes[item.Pc] <= maxSize && sizes[item.Pc] >= minSplit;
+                        if (item.Pc != entry && (shared[item.Pc] || ownFunction)) {
+                            body += indent + "return Subtree" + std::to_string(item.Pc) + "(record);\n";
+                            if (!isEntry[item.Pc]) functions.push_back(item.Pc);
+                            isEntry[item.Pc] = true;
+                            continue;
+                        }
+                        if (item.Depth < options.MaxNesting) {
+                            body += indent + "if (" + Condition(instruction) + ") {\n";
+                            stack.push_back({ instruction.Target, item.Depth, false });
+                            stack.push_back({ 0, item.Depth, true });
+                            stack.push_back({ item.Pc + 1, item.Depth + 1, false });
+                        } else {
+                            body += indent + "if (" + Condition(instruction) + ") goto n" + std::to_string(item.Pc + 1) + ";\n";
+                            labels.push_back(item.Pc + 1);
+                            stack.push_back({ instruction.Target, item.Depth, false });
+                        }
+                    }
+                };
+                emitBlock(entry);
+                for (size_t i = 0; i < labels.size(); ++i) {
+                    body += "    n" + std::to_string(labels[i]) + ":\n";
+                    emitBlock(labels[i]);
+                }
+
+                if (f == 0) {
+                    bodies += "    /// Index into OutcomeLabels of the leaf a record reaches, or NoOutcome\n";
+                    bodies += "    inline uint32_t Evaluate(const float* record) noexcept {\n" + body + "    }\n\n";
+                } else {
+                    bodies += "    inline uint32_t Subtree" + std::to_string(entry) + "(const float* record) noexcept {\n" + body + "    }\n\n";
+                }
+            }
+
+            // Declarations first: Evaluate() calls subtrees defined after it
+            std::string declarations;
+            for (size_t f = 1; f < functions.size(); ++f) {
+                declarations += "    inline uint32_t Subtree" + std::to_string(functions[f]) + "(const float* record) noexcept;\n";
+            }
+            return declarations.empty() ? bodies : declarations + "\n" + bodies;
+        }
+
+    }
+
+    std::string GenerateCpp(const Program& program, const CodeGenOptions& options) {
+        const std::vector<Instruction>& code = program.GetCode();
+        std::string out;
+        out += "// Generated decision tree";
+        if (!options.SourceName.empty()) out += " from " + CommentText(options.SourceName);
+        out += ". Do not edit.\n";
+        out += "// " + std::to_string(code.size()) + " instructions, " + std::to_string(program.GetFeatureCount()) + " features, " +
+               std::to_string(program.GetOutcomeCount()) + " outcomes\n\n";
+        out += "#pragma once\n\n#include <cstdint>\n#include <limits>\n\n";
+        out += "namespace " + options.Namespace + " {\n\n";
+
+        out += "    constexpr uint32_t FeatureCount = " + std::to_string(program.GetFeatureCount()) + ";\n";
+        out += "    constexpr uint32_t OutcomeCount = " + std::to_string(program.GetOutcomeCount()) + ";\n";
+        out += "    constexpr uint32_t NoOutcome = 0xFFFFFFFFu;\n\n";
+
+        // Null-terminated, so the tables are valid even when empty
+        out += "    /// Record layout: record[i] holds the feature named FeatureNames[i]\n";
+        out += "    inline constexpr const char* FeatureNames[] = {\n";
+        for (uint32_t i = 0; i < program.GetFeatureCount(); ++i) out += "        \"" + Escape(program.GetFeatureName(i)) + "\",\n";
+        out += "        nullptr\n    };\n\n";
+        out += "    inline constexpr const char* OutcomeLabels[] = {\n";
+        for (uint32_t i = 0; i < program.GetOutcomeCount(); ++i) out += "        \"" + Escape(program.GetOutcomeLabel(i)) + "\",\n";
+        out += "        nullptr\n    };\n\n";
+
+        if (code.empty()) {
+            out += "    /// Index into OutcomeLabels of the leaf a record reaches, or NoOutcome\n";
+            out += "    inline uint32_t Evaluate(const float* record) noexcept {\n        (void)record;\n        return NoOutcome;\n    }\n\n";
+        } else {
+            out += FunctionBodies(program, options);
+        }
+
+        out += "    inline const char* GetOutcomeLabel(uint32_t outcome) noexcept {\n";
+        out += "        return outcome < OutcomeCount ? OutcomeLabels[outcome] : \"\";\n";
+        out += "    }\n\n}\n";
+        return out;
+    }
+
+    bool ExportCpp(const std::string& path, const Data::Snapshot& snapshot, std::string& error, const CodeGenOptions& options) {
+        Compiler compiler;
+        Program program;
+        if (!compiler.Compile(snapshot, program)) {
+            const Diagnostic& first = compiler.GetDiagnostics().front();
+            error = first.Label.empty() ? first.Message : "\"" + first.Label + "\": " + first.Message;
+            return false;
+        }
+        std::string source = GenerateCpp(program, options);
+
+        std::FILE* file = std::fopen(path.c_str(), "wb");
+        if (!file) {
+            error = "Cannot create " + path;
+            return false;
+        }
+        bool ok = std::fwrite(source.data(), 1, source.size(), file) == source.size();
+        if (std::fclose(file) != 0) ok = false;
+        if (!ok) error = "Write failed";
+        return ok;
+    }
+
+    bool IsCppPath(const std::string& path) {
+        auto endsWith = [&](const char* suffix) {
+            size_t length = std::char_traits<char>::length(suffix);
+            return path.size() >= length && path.compare(path.size() - length, length, suffix) == 0;
+        };
+        return endsWith(".h") || endsWith(".hpp");
+    }
+
+}
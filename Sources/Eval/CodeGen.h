@@ -0,0 +1,59 @@
+/**
+ * CodeGen.h
+ * Generation of standalone C++ source from compiled trees
+ *
+ * The generated header needs only the C++17 standard library. It defines,
+ * in its own namespace, an inline Evaluate(const float* record) returning
+ * the same outcome index as Program::Evaluate(), with every test turned
+ * into a comparison against a literal and every outcome into a return, plus
+ * tables of the feature names (the record layout) and outcome labels.
+ */
+
+#pragma once
+
+#include "Program.h"
+#include "../Data/Snapshot.h"
+#include <string>
+
+namespace Eval {
+
+    /**
+     * @struct CodeGenOptions
+     * @brief How generated code is named and shaped
+     */
+    struct CodeGenOptions {
+        std::string Namespace = "DecisionTree";   ///< Must be a valid C++ identifier
+        std::string SourceName;                   ///< Mentioned in the header comment if set
+
+        /**
+         * Tests nest as if-blocks up to this depth; deeper subtrees continue
+         * at labels, which keeps the output within compiler nesting limits.
+         */
+        uint32_t MaxNesting = 48;
+
+        /**
+         * Larger trees are split into functions of about this many
+         * instructions. Optimizers slow down sharply on huge functions.
+         */
+        uint32_t MaxFunctionSize = 4096;
+    };
+
+    /**
+     * @brief Generate the header source for a program
+     */
+    std::string GenerateCpp(const Program& program, const CodeGenOptions& options = CodeGenOptions());
+
+    /**
+     * @brief Compile a snapshot and write it as a C++ header (safe on any thread)
+     * @param path Header to create or overwrite
+     * @param error Receives the first compile diagnostic or I/O problem on failure
+     */
+    bool ExportCpp(const std::string& path, const Data::Snapshot& snapshot, std::string& error,
+                   const CodeGenOptions& options = CodeGenOptions());
+
+    /**
+     * @brief True if a path names a C++ header (.h or .hpp)
+     */
+    bool IsCppPath(const std::string& path);
+
+}
@@ -0,0 +1,378 @@
+/**
+ * Compiler.cpp
+ * Implementation of the Compiler class
+ */
+
+#include "Compiler.h"
+#include <charconv>
+#include <unordered_map>
+
+namespace Eval {
+
+    namespace {
+
+        constexpr uint32_t NoPatch = ~uint32_t(0);
+
+        /// Node fields for Build(), read from a document's store
+        struct StoreSource {
+            using Node = Data::NodeId;
+            static constexpr bool MayShare = false;   ///< Whether IsShared() may be true
+            const Data::NodeStore& Nodes;
+
+            uint32_t ChildCount(Node node) const { return Nodes.GetChildCount(node); }
+            Node Child(Node node, uint32_t slot) const { return Nodes.GetChild(node, slot); }
+            std::string_view EdgeLabel(Node node, uint32_t slot) const { return Nodes.GetEdgeLabel(node, slot); }
+            std::string_view Label(Node node) const { return Nodes.GetLabel(node); }
+            Data::NodeType Type(Node node) const { return Nodes.GetType(node); }
+            Data::NodeId Id(Node node) const { return node; }
+        };
+
+        /// Node fields for Build(), read from a snapshot (safe on any thread)
+        struct SnapshotSource {
+            using Node = const Data::SnapshotNode*;
+            static constexpr bool MayShare = true;    ///< See Data/SubtreeSharing.h
+
+            uint32_t ChildCount(Node node) const { return static_cast<uint32_t>(node->Children.size()); }
+            Node Child(Node node, uint32_t slot) const { return node->Children[slot].Target; }
+            std::string_view EdgeLabel(Node node, uint32_t slot) const { return node->Children[slot].Label; }
+            std::string_view Label(Node node) const { return node->Label; }
+            Data::NodeType Type(Node node) const { return node->Type; }
+            Data::NodeId Id(Node node) const { return node->Id; }
+            bool IsShared(Node node) const { return node->IsShared; }
+        };
+
+        /// Node fields for Build(), read from a pointer-linked hierarchy
+        struct TreeNodeSource {
+            using Node = const Data::TreeNode*;
+            static constexpr bool MayShare = false;
+
+            uint32_t ChildCount(Node node) const { return static_cast<uint32_t>(node->Connections.size()); }
+            Node Child(Node node, uint32_t slot) const { return node->Connections[slot].Target; }
+            std::string_view EdgeLabel(Node node, uint32_t slot) const { return node->Connections[slot].Label; }
+            std::string_view Label(Node node) const { return node->Label; }
+            Data::NodeType Type(Node node) const { return node->Type; }
+            Data::NodeId Id(Node) const { return Data::InvalidNode; }
+        };
+
+        std::string_view Trim(std::string_view text) {
+            size_t begin = 0, end = text.size();
+            while (begin < end && (text[begin] == ' ' || text[begin] == '\t')) ++begin;
+            while (end > begin && (text[end - 1] == ' ' || text[end - 1] == '\t')) --end;
+            return text.substr(begin, end - begin);
+        }
+
+        bool EqualsIgnoringCase(std::string_view text, std::string_view lower) {
+            if (text.size() != lower.size()) return false;
+            for (size_t i = 0; i < text.size(); ++i) {
+                char c = text[i];
+                if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+                if (c != lower[i]) return false;
+            }
+            return true;
+        }
+
+        bool ParseNumber(std::string_view text, float& value) {
+            text = Trim(text);
+            if (!text.empty() && text[0] == '+') text.remove_prefix(1);
+            auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+            return !text.empty() && error == std::errc() && end == text.data() + text.size();
+        }
+
+        /**
+         * @brief Which branch of a test an edge label names
+         */
+        enum class Branch { Unlabeled, True, False, Other };
+
+        Branch ClassifyEdge(std::string_view label) {
+            label = Trim(label);
+            if (label.empty()) return Branch::Unlabeled;
+            if (EqualsIgnoringCase(label, "yes") || EqualsIgnoringCase(label, "true")) return Branch::True;
+            if (EqualsIgnoringCase(label, "no") || EqualsIgnoringCase(label, "false")) return Branch::False;
+            return Branch::Other;
+        }
+
+        /// Points every test on a chain (linked through Target) at 'pc'
+        void Resolve(std::vector<Instruction>& code, uint32_t chain, uint32_t pc) {
+            while (chain != NoPatch) {
+                uint32_t next = code[chain].Target;
+                code[chain].Target = pc;
+                chain = next;
+            }
+        }
+
+        /// Joins two jump chains
+        uint32_t Merge(std::vector<Instruction>& code, uint32_t first, uint32_t second) {
+            if (first == NoPatch) return second;
+            uint32_t last = first;
+            while (code[last].Target != NoPatch) last = code[last].Target;
+            code[last].Target = second;
+            return first;
+        }
+
+        /**
+         * @brief Short-circuit tests for an expression
+         *
+         * Appends tests that fall through to the next instruction when the
+         * term is 'fallsThrough' and jump otherwise. The jumps still to be
+         * resolved are returned as chains: tests taken when the term is true
+         * (trueJumps) and when it is false (falseJumps). A comparison that
+         * should fall through on false tests the complementary mask, which is
+         * exact because the four CompareBits cover every outcome.
+         */
+        template<typename EmitTest>
+        void Lower(const Expression& expression, uint32_t index, bool fallsThrough, std::vector<Instruction>& code, const EmitTest& emitTest,
+                   uint32_t& trueJumps, uint32_t& falseJumps) {
+            const ExpressionTerm& term = expression.GetTerms()[index];
+            switch (term.Kind) {
+                case TermKind::Compare: {
+                    uint8_t mask = fallsThrough ? term.Mask : static_cast<uint8_t>(~term.Mask & (Less | Equal | Greater | Unordered));
+                    uint32_t pc = emitTest(term.Feature, mask, term.Value);
+                    uint32_t& jumps = fallsThrough ? falseJumps : trueJumps;
+                    jumps = Merge(code, pc, jumps);
+                    break;
+                }
+                case TermKind::Not:
+                    Lower(expression, term.Left, !fallsThrough, code, emitTest, falseJumps, trueJumps);
+                    break;
+                case TermKind::And:
+                case TermKind::Or: {
+                    // The left operand falls through to the right one when it does not decide the result
+                    bool isAnd = term.Kind == TermKind::And;
+                    uint32_t leftTrue = NoPatch, leftFalse = NoPatch;
+                    Lower(expression, term.Left, isAnd, code, emitTest, leftTrue, leftFalse);
+                    Resolve(code, isAnd ? leftTrue : leftFalse, static_cast<uint32_t>(code.size()));
+                    uint32_t& decided = isAnd ? falseJumps : trueJumps;
+                    decided = Merge(code, isAnd ? leftFalse : leftTrue, decided);
+                    Lower(expression, term.Right, fallsThrough, code, emitTest, trueJumps, falseJumps);
+                    break;
+                }
+            }
+        }
+
+    }
+
+    bool Compiler::Compile(const Data::Document& document, Program& program) {
+        const Data::NodeStore& nodes = document.GetNodes();
+        m_Diagnostics.clear();
+        if (!nodes.IsAlive(document.GetRoot())) {
+            program.Clear();
+            Report(Data::InvalidNode, "", "Document has no root node");
+            return false;
+        }
+        return Build(StoreSource{ nodes }, document.GetRoot(), program);
+    }
+
+    bool Compiler::Compile(const Data::Snapshot& snapshot, Program& program) {
+        m_Diagnostics.clear();
+        if (snapshot.IsEmpty()) {
+            program.Clear();
+            Report(Data::InvalidNode, "", "Snapshot is empty");
+            return false;
+        }
+        return Build(SnapshotSource{}, snapshot.GetRoot(), program);
+    }
+
+    bool Compiler::Compile(const Data::TreeNode* root, Program& program) {
+        m_Diagnostics.clear();
+        if (!root) {
+            program.Clear();
+            Report(Data::InvalidNode, "", "Tree is empty");
+            return false;
+        }
+        return Build(TreeNodeSource{}, root, program);
+    }
+
+    void Compiler::Report(Data::NodeId node, std::string_view label, std::string message) {
+        if (m_Diagnostics.size() < MaxDiagnostics) m_Diagnostics.push_back({ node, std::string(label), std::move(message) });
+    }
+
+    const Expression* Compiler::ParseCondition(std::string_view label, std::string& error) {
+        auto found = m_Labels.find(label);
+        ParsedLabel* parsed = found != m_Labels.end() ? &found->second : nullptr;
+        if (!parsed) {
+            // Once the cache is full, further labels are parsed every time rather than evicting others
+            parsed = m_Labels.size() < MaxCachedLabels ? &m_Labels.emplace(std::string(label), ParsedLabel()).first->second : &m_Scratch;
+            parsed->Error.clear();
+            if (!parsed->Condition.Parse(label, parsed->Error) && parsed->Error.empty()) parsed->Error = "Invalid condition";
+        }
+        if (!parsed->Error.empty()) {
+            error = parsed->Error;
+            return nullptr;
+        }
+        return &parsed->Condition;
+    }
+
+    template<typename Source>
+    bool Compiler::Build(const Source& source, typename Source::Node root, Program& program) {
+        using Node = typename Source::Node;
+        program.Clear();
+        std::vector<Instruction>& code = program.m_Code;
+        std::vector<Data::NodeId>& sourceNodes = program.m_SourceNodes;
+        std::unordered_map<std::string, uint32_t> features;
+        std::unordered_map<std::string, uint32_t> outcomes;
+
+        auto emit = [&](uint32_t outcome, Data::NodeId from) {
+            code.push_back({ Opcode::Emit, 0, 0, outcome, 0.0f, 0 });
+            sourceNodes.push_back(from);
+        };
+        auto test = [&](std::string_view feature, uint8_t mask, float value, Data::NodeId from) {
+            auto [entry, added] = features.try_emplace(std::string(feature), static_cast<uint32_t>(program.m_Features.size()));
+            if (added) program.m_Features.push_back(entry->first);
+            code.push_back({ Opcode::Test, mask, 0, entry->second, value, NoPatch });
+            sourceNodes.push_back(from);
+            return static_cast<uint32_t>(code.size() - 1);
+        };
+
+        // Code is laid out in pre-order: an item popped from the stack is
+        // compiled at the end of the code, so the item pushed last follows
+        // the current instruction and the others are reached by jumps
+        struct Pending {
+            Node Target;
+            bool Missing;          ///< A branch the tree does not have: emit NoOutcome
+            Data::NodeId From;     ///< Node a missing branch belongs to
+            uint32_t Patch;        ///< Chain of tests jumping to this code (see Resolve()), or NoPatch
+        };
+        std::vector<Pending> stack;
+        stack.push_back({ root, false, Data::InvalidNode, NoPatch });
+
+        // Pushes the two branches of a test whose false jumps are chained from 'pc'; false if the edges are ambiguous
+        auto pushBranches = [&](Node node, uint32_t pc, std::string& error) {
+            uint32_t count = source.ChildCount(node);
+            if (count > 2) {
+                error = "A test has two branches, found " + std::to_string(count);
+                return false;
+            }
+            int branches[2] = { -1, -1 };   // Child slot of the true and false branches
+            for (uint32_t slot = 0; slot < count; ++slot) {
+                Branch branch = ClassifyEdge(source.EdgeLabel(node, slot));
+                if (branch == Branch::Other) {
+                    error = "Branch \"" + std::string(source.EdgeLabel(node, slot)) + "\" of a test must be labeled Yes or No";
+                    return false;
+                }
+                if (branch == Branch::Unlabeled) continue;
+                int& target = branches[branch == Branch::True ? 0 : 1];
+                if (target >= 0) {
+                    error = "Two branches are labeled " + std::string(branch == Branch::True ? "Yes" : "No");
+                    return false;
+                }
+                target = static_cast<int>(slot);
+            }
+            for (uint32_t slot = 0; slot < count; ++slot) {
+                if (ClassifyEdge(source.EdgeLabel(node, slot)) != Branch::Unlabeled) continue;
+                branches[branches[0] < 0 ? 0 : 1] = static_cast<int>(slot);
+            }
+
+            Data::NodeId id = source.Id(node);
+            for (int i = 1; i >= 0; --i) {
+                uint32_t patch = i == 1 ? pc : NoPatch;   // True falls through, false is jumped to
+                if (branches[i] < 0) stack.push_back({ node, true, id, patch });
+                else stack.push_back({ source.Child(node, static_cast<uint32_t>(branches[i])), false, id, patch });
+            }
+            return true;
+        };
+
+        // Start of the code of each subtree compiled so far, when subtrees can be shared
+        std::unordered_map<Node, uint32_t> compiled;
+
+        while (!stack.empty()) {
+            Pending item = stack.back();
+            stack.pop_back();
+            uint32_t pc = static_cast<uint32_t>(code.size());
+            if constexpr (Source::MayShare) {
+                // A shared subtree reached by jumps is compiled once; falling through needs a copy
+                if (!item.Missing && source.IsShared(item.Target) && source.ChildCount(item.Target) > 0) {
+                    auto [entry, added] = compiled.try_emplace(item.Target, pc);
+                    if (!added && item.Patch != NoPatch) {
+                        Resolve(code, item.Patch, entry->second);
+                        continue;
+                    }
+                }
+            }
+            Resolve(code, item.Patch, pc);
+            if (item.Missing) {
+                emit(NoOutcome, item.From);
+                continue;
+            }
+
+            Node node = item.Target;
+            Data::NodeId id = source.Id(node);
+            uint32_t count = source.ChildCount(node);
+            if (count == 0) {
+                std::string_view label = source.Label(node);
+                auto [entry, added] = outcomes.try_emplace(std::string(label), static_cast<uint32_t>(program.m_Outcomes.size()));
+                if (added) program.m_Outcomes.push_back(entry->first);
+                emit(entry->second, id);
+                continue;
+            }
+            if (source.Type(node) != Data::NodeType::Condition) {
+                if (count > 1) Report(id, source.Label(node), "Only Condition nodes can branch");
+                stack.push_back({ source.Child(node, 0), false, id, NoPatch });
+                continue;
+            }
+
+            std::string error;
+            const Expression* condition = ParseCondition(source.Label(node), error);
+            if (!condition) {
+                Report(id, source.Label(node), std::move(error));
+                continue;
+            }
+            if (!condition->IsBareFeature()) {
+                uint32_t trueJumps = NoPatch, falseJumps = NoPatch;
+                auto emitTest = [&](uint32_t feature, uint8_t mask, float value) {
+                    return test(condition->GetFeatures()[feature], mask, value, id);
+                };
+                Lower(*condition, condition->GetRoot(), true, code, emitTest, trueJumps, falseJumps);
+                // The true branch is compiled next, right after the tests
+                Resolve(code, trueJumps, static_cast<uint32_t>(code.size()));
+                if (!pushBranches(node, falseJumps, error)) Report(id, source.Label(node), std::move(error));
+                continue;
+            }
+            std::string_view feature = condition->GetFeatures()[0];
+
+            // A bare feature: a Yes / No flag, or a switch over numeric edge labels
+            bool isFlag = true, isLabeled = false;
+            for (uint32_t slot = 0; slot < count; ++slot) {
+                Branch branch = ClassifyEdge(source.EdgeLabel(node, slot));
+                isFlag = isFlag && branch != Branch::Other;
+                isLabeled = isLabeled || branch == Branch::True || branch == Branch::False;
+            }
+            if (isFlag && isLabeled) {
+                uint32_t at = test(feature, Less | Greater, 0.0f, id);
+                if (!pushBranches(node, at, error)) Report(id, source.Label(node), std::move(error));
+                continue;
+            }
+
+            // One "!=" test per case, falling through to the next; the default follows the last
+            int fallback = -1;
+            std::vector<std::pair<uint32_t, uint32_t>> cases;   // (test, child slot)
+            for (uint32_t slot = 0; slot < count && error.empty(); ++slot) {
+                std::string_view edge = Trim(source.EdgeLabel(node, slot));
+                float value;
+                if (edge.empty() || edge == "*") {
+                    if (fallback >= 0) error = "Two branches are the default (\"*\")";
+                    fallback = static_cast<int>(slot);
+                } else if (ParseNumber(edge, value)) {
+                    cases.push_back({ test(feature, Less | Greater | Unordered, value, id), slot });
+                } else {
+                    error = "Branch \"" + std::string(edge) + "\" is not a number";
+                }
+            }
+            if (!error.empty()) {
+                Report(id, source.Label(node), std::move(error));
+                continue;
+            }
+            for (size_t i = cases.size(); i-- > 0;) {
+                stack.push_back({ source.Child(node, cases[i].second), false, id, cases[i].first });
+            }
+            if (fallback >= 0) stack.push_back({ source.Child(node, static_cast<uint32_t>(fallback)), false, id, NoPatch });
+            else stack.push_back({ node, true, id, NoPatch });
+        }
+
+        if (!m_Diagnostics.empty()) {
+            program.Clear();
+            return false;
+        }
+        return true;
+    }
+
+}
@@ -0,0 +1,112 @@
+/**
+ * Compiler.h
+ * Lowering of decision trees to bytecode Programs
+ *
+ * Node semantics:
+ * - A node without children is an outcome: evaluation stops there and
+ *   reports its label.
+ * - A Condition labeled with an expression ("age >= 18", "x in [0, 1)
+ *   and not flag", see Expression.h) is a test. Its branches are told apart
+ *   by their edge labels (Yes / No or True / False, any case); unlabeled
+ *   branches are true first, then false. Compound expressions become a
+ *   short-circuit sequence of tests whose jumps meet at the two branches.
+ * - A Condition labeled with a bare feature name and Yes / No branches
+ *   tests the feature for a non-zero value.
+ * - A Condition labeled with a bare feature name and numeric edge labels
+ *   picks the branch equal to the feature; an edge labeled "*" or left
+ *   empty is taken when no other matches.
+ * - Any other node passes straight through to its only child.
+ *
+ * A record that reaches a branch the tree does not have (a test with only
+ * one child, a switch without a default) ends with NoOutcome.
+ *
+ * Subtrees shared by several parents of a snapshot (see SubtreeSharing.h)
+ * are compiled once where they are reached by jumps, so their tests may
+ * jump backwards to code compiled earlier.
+ */
+
+#pragma once
+
+#include "Expression.h"
+#include "Program.h"
+#include "../Data/Document.h"
+#include "../Data/Snapshot.h"
+#include "../Data/TreeNode.h"
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace Eval {
+
+    /**
+     * @struct Diagnostic
+     * @brief A node the compiler could not translate, and why
+     */
+    struct Diagnostic {
+        Data::NodeId Node;     ///< InvalidNode when compiling a TreeNode hierarchy
+        std::string Label;     ///< Label of the node
+        std::string Message;
+    };
+
+    /**
+     * @class Compiler
+     * @brief Builds a Program from a tree, reporting every node it rejects
+     *
+     * Condition labels are parsed once per distinct text and kept for later
+     * compilations, so recompiling after an edit only parses the labels the
+     * edit introduced.
+     */
+    class Compiler {
+    public:
+        static constexpr size_t MaxDiagnostics = 100;       ///< Further problems are not listed
+        static constexpr size_t MaxCachedLabels = 1 << 16;   ///< Parsed labels kept between compilations
+
+        /**
+         * @brief Compile the tree under a document's root
+         * @return false if any node was rejected; the program is then left empty
+         */
+        bool Compile(const Data::Document& document, Program& program);
+
+        /**
+         * @brief Compile a snapshot (safe on any thread)
+         */
+        bool Compile(const Data::Snapshot& snapshot, Program& program);
+
+        /**
+         * @brief Compile a pointer-linked TreeNode hierarchy
+         */
+        bool Compile(const Data::TreeNode* root, Program& program);
+
+        const std::vector<Diagnostic>& GetDiagnostics() const { return m_Diagnostics; }
+
+        /**
+         * @brief Parse a Condition label, or find it already parsed
+         * @param error Receives the parse error if the label is not valid
+         * @return nullptr if the label is not valid; otherwise valid until the next call
+         */
+        const Expression* ParseCondition(std::string_view label, std::string& error);
+
+    private:
+        struct ParsedLabel {
+            Expression Condition;
+            std::string Error;   ///< Empty if the label parsed
+        };
+
+        struct LabelHash {
+            using is_transparent = void;
+            size_t operator()(std::string_view text) const { return std::hash<std::string_view>()(text); }
+        };
+
+        std::vector<Diagnostic> m_Diagnostics;
+        std::unordered_map<std::string, ParsedLabel, LabelHash, std::equal_to<>> m_Labels;
+        ParsedLabel m_Scratch;   ///< Labels parsed while the cache is full
+
+        template<typename Source>
+        bool Build(const Source& source, typename Source::Node root, Program& program);
+
+        void Report(Data::NodeId node, std::string_view label, std::string message);
+    };
+
+}
@@ -0,0 +1,408 @@
+/**
+ * Expression.cpp
+ * Implementation of the condition language parser
+ */
+
+#include "Expression.h"
+#include "Program.h"
+#include <charconv>
+
+namespace Eval {
+
+    namespace {
+
+        constexpr uint32_t Failed = ~uint32_t(0);
+
+        enum class TokenKind : uint8_t {
+            End, Name, Number, Compare, And, Or, Not, In,
+            OpenParen, CloseParen, OpenBracket, CloseBracket, OpenBrace, CloseBrace, Comma
+        };
+
+        struct Token {
+            TokenKind Kind;
+            size_t Begin, End;   ///< Source range; a quoted name excludes the quotes
+            uint8_t Mask;        ///< CompareBits of a comparison operator
+            float Value;         ///< Value of a number
+        };
+
+        bool IsSpace(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+
+        /// Characters that end a word
+        bool IsDelimiter(char c) {
+            switch (c) {
+                case '(': case ')': case '[': case ']': case '{': case '}': case ',':
+                case '<': case '>': case '=': case '!': case '&': case '|': case '"':
+                    return true;
+                default:
+                    return IsSpace(c);
+            }
+        }
+
+        bool IsKeyword(std::string_view word, std::string_view lower) {
+            if (word.size() != lower.size()) return false;
+            for (size_t i = 0; i < word.size(); ++i) {
+                char c = word[i];
+                if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+                if (c != lower[i]) return false;
+            }
+            return true;
+        }
+
+        bool ParseNumberWord(std::string_view word, float& value) {
+            char first = word.empty() ? '\0' : word[0];
+            if (!((first >= '0' && first <= '9') || first == '.' || first == '-' || first == '+')) return false;
+            if (first == '+') word.remove_prefix(1);
+            auto [end, error] = std::from_chars(word.data(), word.data() + word.size(), value);
+            return !word.empty() && error == std::errc() && end == word.data() + word.size();
+        }
+
+        /// The same test with the feature on the other side: "5 < x" is "x > 5"
+        uint8_t Mirror(uint8_t mask) {
+            return static_cast<uint8_t>((mask & (Equal | Unordered)) | (mask & Less ? Greater : 0) | (mask & Greater ? Less : 0));
+        }
+
+        class Parser {
+        public:
+            Parser(std::string_view text, std::vector<ExpressionTerm>& terms, std::vector<std::string>& features)
+                : m_Text(text), m_Terms(terms), m_Features(features), m_Next(0), m_LastBare(false) {}
+
+            uint32_t Run(std::string& error, bool& isBareFeature) {
+                uint32_t root = Failed;
+                if (Tokenize()) {
+                    if (m_Tokens.size() == 1) {
+                        Fail(0, "Condition does not name a feature");
+                    } else {
+                        root = ParseOr(0);
+                        if (root != Failed && Peek().Kind != TokenKind::End) {
+                            const Token& token = Peek();
+                            Fail(token.Begin, "Unexpected \"" + std::string(m_Text.substr(token.Begin, token.End - token.Begin)) + "\"");
+                            root = Failed;
+                        }
+                    }
+                }
+                if (root == Failed) {
+                    error = m_Error;
+                    return Failed;
+                }
+                isBareFeature = m_LastBare && m_Terms.size() == 1;
+                return root;
+            }
+
+        private:
+            std::string_view m_Text;
+            std::vector<ExpressionTerm>& m_Terms;
+            std::vector<std::string>& m_Features;
+            std::vector<Token> m_Tokens;
+            size_t m_Next;
+            bool m_LastBare;   ///< The last predicate parsed was a lone feature
+            std::string m_Error;
+
+            const Token& Peek() const { return m_Tokens[m_Next]; }
+            const Token& Take() { return m_Tokens[m_Next < m_Tokens.size() - 1 ? m_Next++ : m_Next]; }
+            std::string_view TextOf(const Token& token) const { return m_Text.substr(token.Begin, token.End - token.Begin); }
+
+            void Fail(size_t at, std::string message) {
+                if (m_Error.empty()) m_Error = m_Text.empty() ? message : message + " at column " + std::to_string(at + 1);
+            }
+
+            bool Tokenize() {
+                size_t i = 0, n = m_Text.size();
+                while (true) {
+                    while (i < n && IsSpace(m_Text[i])) ++i;
+                    if (i == n) break;
+                    size_t begin = i;
+                    char c = m_Text[i];
+                    char next = i + 1 < n ? m_Text[i + 1] : '\0';
+                    auto single = [&](TokenKind kind) { m_Tokens.push_back({ kind, begin, ++i, 0, 0.0f }); };
+                    auto compare = [&](uint8_t mask, size_t length) { i += length; m_Tokens.push_back({ TokenKind::Compare, begin, i, mask, 0.0f }); };
+                    switch (c) {
+                        case '(': single(TokenKind::OpenParen); continue;
+                        case ')': single(TokenKind::CloseParen); continue;
+                        case '[': single(TokenKind::OpenBracket); continue;
+                        case ']': single(TokenKind::CloseBracket); continue;
+                        case '{': single(TokenKind::OpenBrace); continue;
+                        case '}': single(TokenKind::CloseBrace); continue;
+                        case ',': single(TokenKind::Comma); continue;
+                        case '<': next == '=' ? compare(Less | Equal, 2) : compare(Less, 1); continue;
+                        case '>': next == '=' ? compare(Greater | Equal, 2) : compare(Greater, 1); continue;
+                        case '=': compare(Equal, next == '=' ? 2 : 1); continue;
+                        case '!':
+                            if (next == '=') compare(Less | Greater | Unordered, 2);
+                            else single(TokenKind::Not);
+                            continue;
+                        case '&': case '|':
+                            if (next != c) {
+                                Fail(begin, std::string("Unexpected \"") + c + "\"");
+                                return false;
+                            }
+                            i += 2;
+                            m_Tokens.push_back({ c == '&' ? TokenKind::And : TokenKind::Or, begin, i, 0, 0.0f });
+                            continue;
+                        case '"': {
+                            size_t close = m_Text.find('"', i + 1);
+                            if (close == std::string_view::npos) {
+                                Fail(begin, "Missing closing quote");
+                                return false;
+                            }
+                            m_Tokens.push_back({ TokenKind::Name, i + 1, close, 0, 0.0f });
+                            i = close + 1;
+                            continue;
+                        }
+                        default:
+                            break;
+                    }
+
+                    // A word: a keyword, a number, or the start of a feature name
+                    while (i < n && !IsDelimiter(m_Text[i])) ++i;
+                    std::string_view word = m_Text.substr(begin, i - begin);
+                    Token token = { TokenKind::Name, begin, i, 0, 0.0f };
+                    if (IsKeyword(word, "and")) token.Kind = TokenKind::And;
+                    else if (IsKeyword(word, "or")) token.Kind = TokenKind::Or;
+                    else if (IsKeyword(word, "not")) token.Kind = TokenKind::Not;
+                    else if (IsKeyword(word, "in")) token.Kind = TokenKind::In;
+                    else if (ParseNumberWord(word, token.Value)) token.Kind = TokenKind::Number;
+
+                    // Further words, numbers included, continue an unquoted name ("Level 2")
+                    bool continuesName = (token.Kind == TokenKind::Name || token.Kind == TokenKind::Number) && !m_Tokens.empty() &&
+                                         m_Tokens.back().Kind == TokenKind::Name && m_Text[m_Tokens.back().End] != '"';
+                    if (continuesName) {
+                        m_Tokens.back().End = i;
+                        continue;
+                    }
+                    m_Tokens.push_back(token);
+                }
+                m_Tokens.push_back({ TokenKind::End, n, n, 0, 0.0f });
+                return true;
+            }
+
+            uint32_t Add(const ExpressionTerm& term) {
+                m_Terms.push_back(term);
+                return static_cast<uint32_t>(m_Terms.size() - 1);
+            }
+
+            uint32_t AddCompare(uint32_t feature, uint8_t mask, float value) {
+                return Add({ TermKind::Compare, mask, feature, value, 0, 0 });
+            }
+
+            uint32_t AddLogic(TermKind kind, uint32_t left, uint32_t right) {
+                return Add({ kind, 0, 0, 0.0f, left, right });
+            }
+
+            uint32_t Feature(std::string_view name) {
+                for (uint32_t i = 0; i < m_Features.size(); ++i) {
+                    if (m_Features[i] == name) return i;
+                }
+                m_Features.emplace_back(name);
+                return static_cast<uint32_t>(m_Features.size() - 1);
+            }
+
+            uint32_t ParseOr(uint32_t depth) {
+                uint32_t left = ParseAnd(depth);
+                while (left != Failed && Peek().Kind == TokenKind::Or) {
+                    Take();
+                    uint32_t right = ParseAnd(depth);
+                    left = right == Failed ? Failed : AddLogic(TermKind::Or, left, right);
+                }
+                return left;
+            }
+
+            uint32_t ParseAnd(uint32_t depth) {
+                uint32_t left = ParseFactor(depth);
+                while (left != Failed && Peek().Kind == TokenKind::And) {
+                    Take();
+                    uint32_t right = ParseFactor(depth);
+                    left = right == Failed ? Failed : AddLogic(TermKind::And, left, right);
+                }
+                return left;
+            }
+
+            uint32_t ParseFactor(uint32_t depth) {
+                if (depth >= Expression::MaxNesting) {
+                    Fail(Peek().Begin, "Expression is nested too deeply");
+                    return Failed;
+                }
+                if (Peek().Kind == TokenKind::Not) {
+                    Take();
+                    uint32_t operand = ParseFactor(depth + 1);
+                    m_LastBare = false;
+                    return operand == Failed ? Failed : AddLogic(TermKind::Not, operand, 0);
+                }
+                if (Peek().Kind == TokenKind::OpenParen) {
+                    Take();
+                    uint32_t inner = ParseOr(depth + 1);
+                    if (inner == Failed) return Failed;
+                    if (Peek().Kind != TokenKind::CloseParen) {
+                        Fail(Peek().Begin, "Expected \")\"");
+                        return Failed;
+                    }
+                    Take();
+                    m_LastBare = false;
+                    return inner;
+                }
+                return ParsePredicate();
+            }
+
+            bool ExpectNumber(const Token& after, float& value) {
+                if (Peek().Kind != TokenKind::Number) {
+                    Fail(Peek().Begin, "Expected a number after \"" + std::string(TextOf(after)) + "\"");
+                    return false;
+                }
+                value = Take().Value;
+                return true;
+            }
+
+            uint32_t ParsePredicate() {
+                m_LastBare = false;
+                if (Peek().Kind == TokenKind::Number) {
+                    // "18 <= age" or "18 <= age < 65"
+                    float low = Take().Value;
+                    if (Peek().Kind != TokenKind::Compare) {
+                        Fail(Peek().Begin, "Expected a comparison after a number");
+                        return Failed;
+                    }
+                    Token first = Take();
+                    if (Peek().Kind != TokenKind::Name) {
+                        Fail(Peek().Begin, "Expected a feature after \"" + std::string(TextOf(first)) + "\"");
+                        return Failed;
+                    }
+                    uint32_t feature = Feature(TextOf(Take()));
+                    uint32_t lower = AddCompare(feature, Mirror(first.Mask), low);
+                    if (Peek().Kind != TokenKind::Compare) return lower;
+
+                    Token second = Take();
+                    bool ascending = (first.Mask == Less || first.Mask == (Less | Equal)) && (second.Mask == Less || second.Mask == (Less | Equal));
+                    bool descending = (first.Mask == Greater || first.Mask == (Greater | Equal)) && (second.Mask == Greater || second.Mask == (Greater | Equal));
+                    if (!ascending && !descending) {
+                        Fail(second.Begin, "A range needs two \"<\" or two \">\" comparisons");
+                        return Failed;
+                    }
+                    float high;
+                    if (!ExpectNumber(second, high)) return Failed;
+                    return AddLogic(TermKind::And, lower, AddCompare(feature, second.Mask, high));
+                }
+
+                if (Peek().Kind != TokenKind::Name) {
+                    const Token& token = Peek();
+                    Fail(token.Begin, token.Kind == TokenKind::End ? "Expected a feature at the end" :
+                                      "Expected a feature before \"" + std::string(TextOf(token)) + "\"");
+                    return Failed;
+                }
+                Token name = Take();
+                uint32_t feature = Feature(TextOf(name));
+                if (Peek().Kind == TokenKind::Compare) {
+                    Token op = Take();
+                    float value;
+                    if (!ExpectNumber(op, value)) return Failed;
+                    return AddCompare(feature, op.Mask, value);
+                }
+
+                bool negated = Peek().Kind == TokenKind::Not && m_Tokens[m_Next + 1].Kind == TokenKind::In;
+                if (negated) Take();
+                if (Peek().Kind == TokenKind::In) {
+                    Take();
+                    uint32_t membership = ParseMembership(feature);
+                    return membership == Failed || !negated ? membership : AddLogic(TermKind::Not, membership, 0);
+                }
+
+                // A lone feature is a flag
+                m_LastBare = true;
+                return AddCompare(feature, Less | Greater, 0.0f);
+            }
+
+            /// The part after "in": {a, b, ...} or an interval such as [a, b)
+            uint32_t ParseMembership(uint32_t feature) {
+                const Token& open = Peek();
+                if (open.Kind == TokenKind::OpenBrace) {
+                    Take();
+                    uint32_t set = Failed;
+                    while (true) {
+                        float value;
+                        if (Peek().Kind != TokenKind::Number) {
+                            Fail(Peek().Begin, "Expected a number in the set");
+                            return Failed;
+                        }
+                        value = Take().Value;
+                        uint32_t member = AddCompare(feature, Equal, value);
+                        set = set == Failed ? member : AddLogic(TermKind::Or, set, member);
+                        if (Peek().Kind == TokenKind::CloseBrace) break;
+                        if (Peek().Kind != TokenKind::Comma) {
+                            Fail(Peek().Begin, "Expected \",\" or \"}\"");
+                            return Failed;
+                        }
+                        Take();
+                    }
+                    Take();
+                    return set;
+                }
+                if (open.Kind != TokenKind::OpenBracket && open.Kind != TokenKind::OpenParen) {
+                    Fail(open.Begin, "Expected a set {a, b} or a range [a, b] after \"in\"");
+                    return Failed;
+                }
+                bool closedLow = Take().Kind == TokenKind::OpenBracket;
+                float low, high;
+                if (Peek().Kind != TokenKind::Number) {
+                    Fail(Peek().Begin, "Expected the start of the range");
+                    return Failed;
+                }
+                low = Take().Value;
+                if (Peek().Kind != TokenKind::Comma) {
+                    Fail(Peek().Begin, "Expected \",\"");
+                    return Failed;
+                }
+                Take();
+                if (Peek().Kind != TokenKind::Number) {
+                    Fail(Peek().Begin, "Expected the end of the range");
+                    return Failed;
+                }
+                high = Take().Value;
+                TokenKind close = Peek().Kind;
+                if (close != TokenKind::CloseBracket && close != TokenKind::CloseParen) {
+                    Fail(Peek().Begin, "Expected \"]\" or \")\"");
+                    return Failed;
+                }
+                Take();
+                uint32_t lower = AddCompare(feature, closedLow ? Greater | Equal : Greater, low);
+                uint32_t upper = AddCompare(feature, close == TokenKind::CloseBracket ? Less | Equal : Less, high);
+                return AddLogic(TermKind::And, lower, upper);
+            }
+        };
+
+        bool EvaluateTerm(const std::vector<ExpressionTerm>& terms, uint32_t index, const float* features) {
+            const ExpressionTerm& term = terms[index];
+            switch (term.Kind) {
+                case TermKind::Compare: {
+                    float x = features[term.Feature];
+                    uint32_t bits = uint32_t(x < term.Value) | uint32_t(x == term.Value) << 1 |
+                                    uint32_t(x > term.Value) << 2 | uint32_t(x != x) << 3;
+                    return (bits & term.Mask) != 0;
+                }
+                case TermKind::And: return EvaluateTerm(terms, term.Left, features) && EvaluateTerm(terms, term.Right, features);
+                case TermKind::Or: return EvaluateTerm(terms, term.Left, features) || EvaluateTerm(terms, term.Right, features);
+                case TermKind::Not: return !EvaluateTerm(terms, term.Left, features);
+            }
+            return false;
+        }
+
+    }
+
+    bool Expression::Parse(std::string_view text, std::string& error) {
+        m_Terms.clear();
+        m_Features.clear();
+        m_IsBareFeature = false;
+        Parser parser(text, m_Terms, m_Features);
+        uint32_t root = parser.Run(error, m_IsBareFeature);
+        if (root == Failed) {
+            m_Terms.clear();
+            m_Features.clear();
+            m_Root = 0;
+            return false;
+        }
+        m_Root = root;
+        return true;
+    }
+
+    bool Expression::Evaluate(const float* features) const {
+        return !m_Terms.empty() && EvaluateTerm(m_Terms, m_Root, features);
+    }
+
+}
@@ -0,0 +1,96 @@
+/**
+ * Expression.h
+ * The condition language of Condition node labels
+ *
+ * Grammar (keywords in any case):
+ *   expression := term { ("or" | "||") term }
+ *   term       := factor { ("and" | "&&") factor }
+ *   factor     := ("not" | "!") factor | "(" expression ")" | predicate
+ *   predicate  := feature op number              age >= 18
+ *               | number op feature              18 <= age
+ *               | number op feature op number    18 <= age < 65 (both ops < / <= or both > / >=)
+ *               | feature ["not"] "in" range     score in [0.5, 1)
+ *               | feature ["not"] "in" set       region in {1, 4, 7}
+ *               | feature                        flag: true when non-zero
+ *   op         := "<" | "<=" | ">" | ">=" | "==" | "=" | "!="
+ *
+ * A feature is a run of words ("Credit score"), or any text in double
+ * quotes. A missing (NaN) feature fails every comparison except "!=", so
+ * "not (x < 5)" holds for a missing x while "x >= 5" does not.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Eval {
+
+    /**
+     * @enum TermKind
+     * @brief Node type of a parsed expression
+     */
+    enum class TermKind : uint8_t {
+        Compare,   ///< Feature against a constant, accepting the CompareBits in Mask
+        And,
+        Or,
+        Not
+    };
+
+    /**
+     * @struct ExpressionTerm
+     * @brief One node of a parsed expression; operands precede the terms using them
+     */
+    struct ExpressionTerm {
+        TermKind Kind;
+        uint8_t Mask;      ///< CompareBits (Compare)
+        uint32_t Feature;  ///< Index into Expression::GetFeatures() (Compare)
+        float Value;       ///< Constant (Compare)
+        uint32_t Left;     ///< Operand (Not), first operand (And, Or)
+        uint32_t Right;    ///< Second operand (And, Or)
+    };
+
+    /**
+     * @class Expression
+     * @brief A parsed Condition label
+     */
+    class Expression {
+    public:
+        static constexpr uint32_t MaxNesting = 64;   ///< Deepest parenthesis / "not" nesting accepted
+
+        Expression() : m_Root(0), m_IsBareFeature(false) {}
+
+        /**
+         * @brief Parse a label, replacing any previous contents
+         * @param error Receives the problem and its column (1-based) on failure
+         */
+        bool Parse(std::string_view text, std::string& error);
+
+        /**
+         * @brief Whether the whole label is a feature name alone
+         *
+         * The compiler gives bare features a meaning of their own depending on
+         * the node's edges (see Compiler.h); elsewhere they are flags.
+         */
+        bool IsBareFeature() const { return m_IsBareFeature; }
+
+        const std::vector<ExpressionTerm>& GetTerms() const { return m_Terms; }
+        const std::vector<std::string>& GetFeatures() const { return m_Features; }
+        uint32_t GetRoot() const { return m_Root; }
+        bool IsEmpty() const { return m_Terms.empty(); }
+
+        /**
+         * @brief Truth of the expression for feature values ordered like GetFeatures()
+         */
+        bool Evaluate(const float* features) const;
+
+    private:
+        std::vector<ExpressionTerm> m_Terms;
+        std::vector<std::string> m_Features;
+        uint32_t m_Root;
+        bool m_IsBareFeature;
+    };
+
+}
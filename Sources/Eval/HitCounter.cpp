@@ -0,0 +1,65 @@
+/**
+ * HitCounter.cpp
+ * Implementation of the per-thread hit counters
+ */
+
+#include "HitCounter.h"
+#include "../Data/Traversal.h"
+
+namespace Eval {
+
+    void HitCounter::Reset(const Program& program) {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Shards.clear();
+        m_CodeSize = program.GetCode().size();
+    }
+
+    void HitCounter::Add(const uint32_t* exits, size_t count) {
+        std::atomic<uint64_t>* counts = GetShard().Counts.get();
+        for (size_t i = 0; i < count; ++i) {
+            std::atomic<uint64_t>& counter = counts[exits[i]];
+            counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+    }
+
+    std::vector<uint64_t> HitCounter::GetExitCounts() const {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        std::vector<uint64_t> total(m_CodeSize, 0);
+        for (const std::unique_ptr<Shard>& shard : m_Shards) {
+            for (size_t pc = 0; pc < m_CodeSize; ++pc) total[pc] += shard->Counts[pc].load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    std::vector<uint64_t> HitCounter::GetNodeHits(const Program& program, const Data::NodeStore& nodes, Data::NodeId root) const {
+        std::vector<uint64_t> hits(nodes.GetCapacity(), 0);
+        std::vector<uint64_t> exits = GetExitCounts();
+
+        // A record stops at a leaf, or at the node whose branch for it is missing
+        for (uint32_t pc = 0; pc < exits.size() && pc < program.GetCode().size(); ++pc) {
+            Data::NodeId node = program.GetSourceNode(pc);
+            if (exits[pc] > 0 && nodes.IsLive(node)) hits[node] += exits[pc];
+        }
+        if (!nodes.IsLive(root)) return hits;
+        Data::PostOrder(nodes, root, [&](Data::NodeId node, uint32_t) {
+            Data::NodeId parent = nodes.GetParent(node);
+            if (node != root && nodes.IsLive(parent)) hits[parent] += hits[node];
+        });
+        return hits;
+    }
+
+    HitCounter::Shard& HitCounter::GetShard() {
+        std::thread::id self = std::this_thread::get_id();
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        for (const std::unique_ptr<Shard>& shard : m_Shards) {
+            if (shard->Owner == self) return *shard;
+        }
+        auto shard = std::make_unique<Shard>();
+        shard->Owner = self;
+        shard->Counts = std::make_unique<std::atomic<uint64_t>[]>(m_CodeSize);
+        for (size_t pc = 0; pc < m_CodeSize; ++pc) shard->Counts[pc].store(0, std::memory_order_relaxed);
+        m_Shards.push_back(std::move(shard));
+        return *m_Shards.back();
+    }
+
+}
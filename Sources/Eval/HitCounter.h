@@ -0,0 +1,81 @@
+/**
+ * HitCounter.h
+ * Counting how many records pass through each node of a tree
+ *
+ * Every record stops at exactly one Emit instruction, and the records that
+ * pass through a node are those stopping somewhere in its subtree. So only
+ * the exit of each record is counted, one increment per record instead of
+ * one per tree level, and node totals are summed up the tree on demand.
+ * The number of records taking an edge is the total of the child it leads to.
+ *
+ * Each thread counts into its own shard. Shards are only written by their
+ * owner with relaxed loads and stores (plain moves, no locked instructions)
+ * and summed when the counts are read, which may happen while counting goes on.
+ */
+
+#pragma once
+
+#include "Program.h"
+#include "../Data/NodeStore.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Eval {
+
+    /**
+     * @class HitCounter
+     * @brief Per-thread counts of the Emit instructions records stop at
+     */
+    class HitCounter {
+    public:
+        HitCounter() : m_CodeSize(0) {}
+
+        HitCounter(const HitCounter&) = delete;
+        HitCounter& operator=(const HitCounter&) = delete;
+
+        /**
+         * @brief Drop all counts and size the counters for a program
+         *
+         * Must not be called while other threads are counting.
+         */
+        void Reset(const Program& program);
+
+        /**
+         * @brief Count records evaluated by the calling thread
+         * @param exits Exit instruction of each record (see EvaluateBatch())
+         */
+        void Add(const uint32_t* exits, size_t count);
+
+        /**
+         * @brief Records that stopped at each instruction, summed over all threads
+         */
+        std::vector<uint64_t> GetExitCounts() const;
+
+        /**
+         * @brief Records that reached each node, indexed by NodeId
+         * @param program The program the counts were taken with
+         * @param nodes Tree the program was compiled from; edits since only lose counts of removed nodes
+         * @param root Root of the compiled tree
+         * @return nodes.GetCapacity() counts, 0 for nodes no record reached
+         */
+        std::vector<uint64_t> GetNodeHits(const Program& program, const Data::NodeStore& nodes, Data::NodeId root) const;
+
+    private:
+        struct Shard {
+            std::thread::id Owner;
+            std::unique_ptr<std::atomic<uint64_t>[]> Counts;
+        };
+
+        Shard& GetShard();
+
+        mutable std::mutex m_Mutex;   ///< Guards the list of shards, not their counts
+        std::vector<std::unique_ptr<Shard>> m_Shards;
+        size_t m_CodeSize;
+    };
+
+}
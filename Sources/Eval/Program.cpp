@@ -0,0 +1,24 @@
+/**
+ * Program.cpp
+ * Implementation of the Program class
+ */
+
+#include "Program.h"
+
+namespace Eval {
+
+    uint32_t Program::FindFeature(std::string_view name) const {
+        for (uint32_t i = 0; i < m_Features.size(); ++i) {
+            if (m_Features[i] == name) return i;
+        }
+        return NoFeature;
+    }
+
+    void Program::Clear() {
+        m_Code.clear();
+        m_SourceNodes.clear();
+        m_Features.clear();
+        m_Outcomes.clear();
+    }
+
+}
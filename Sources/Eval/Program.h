@@ -0,0 +1,131 @@
+/**
+ * Program.h
+ * Flat bytecode form of a decision tree and its evaluator
+ *
+ * A compiled tree is an array of fixed-size instructions laid out in
+ * pre-order, so the true branch of every test is the next instruction and
+ * only the false branch jumps. Evaluating a record walks the array from the
+ * first instruction until an Emit, touching one instruction per tree level.
+ *
+ * Records are arrays of float features, indexed by the feature numbers the
+ * compiler assigned (see GetFeatureName()). A NaN feature is missing: it
+ * fails every comparison except "!=".
+ */
+
+#pragma once
+
+#include "../Data/NodeStore.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Eval {
+
+    /**
+     * @enum Opcode
+     * @brief Operation of an instruction
+     */
+    enum class Opcode : uint8_t {
+        Test,   ///< Compare a feature with a constant; continue on true, jump to Target on false
+        Emit    ///< Stop with an outcome
+    };
+
+    /**
+     * @brief Comparison outcomes an instruction's Mask accepts
+     *
+     * A test passes when the relation between the feature and the constant
+     * is one of the bits in its mask: "<=" is Less | Equal, "!=" is
+     * Less | Greater | Unordered, and so on.
+     */
+    enum CompareBits : uint8_t {
+        Less = 1,
+        Equal = 2,
+        Greater = 4,
+        Unordered = 8   ///< The feature is NaN (missing)
+    };
+
+    /**
+     * @struct Instruction
+     * @brief One 16-byte step of a compiled tree
+     */
+    struct Instruction {
+        Opcode Op;
+        uint8_t Mask;        ///< CompareBits accepted by a Test
+        uint16_t Reserved;
+        uint32_t Operand;    ///< Feature index (Test) or outcome index (Emit)
+        float Value;         ///< Constant compared against (Test)
+        uint32_t Target;     ///< Instruction taken when a Test fails
+    };
+
+    static_assert(sizeof(Instruction) == 16, "Instructions are meant to pack four to a cache line");
+
+    constexpr uint32_t NoOutcome = ~uint32_t(0);   ///< Result of a record reaching a missing branch
+    constexpr uint32_t NoFeature = ~uint32_t(0);
+
+    /**
+     * @class Program
+     * @brief A compiled decision tree
+     *
+     * Immutable once built by Compile(); any number of threads may evaluate
+     * the same program concurrently.
+     */
+    class Program {
+    public:
+        Program() = default;
+
+        /**
+         * @brief Run one record through the tree
+         * @param record GetFeatureCount() feature values
+         * @return Index of the outcome reached, or NoOutcome
+         * @pre The program is not empty
+         */
+        uint32_t Evaluate(const float* record) const {
+            const Instruction* code = m_Code.data();
+            uint32_t pc = 0;
+            while (code[pc].Op == Opcode::Test) {
+                const Instruction& test = code[pc];
+                float x = record[test.Operand];
+                uint32_t bits = uint32_t(x < test.Value) | uint32_t(x == test.Value) << 1 |
+                                uint32_t(x > test.Value) << 2 | uint32_t(x != x) << 3;
+                pc = (bits & test.Mask) ? pc + 1 : test.Target;
+            }
+            return code[pc].Operand;
+        }
+
+        /**
+         * @brief Label of the node an outcome index stands for ("" for NoOutcome)
+         */
+        std::string_view GetOutcomeLabel(uint32_t outcome) const {
+            return outcome < m_Outcomes.size() ? std::string_view(m_Outcomes[outcome]) : std::string_view();
+        }
+
+        /**
+         * @brief Index of a feature by name, or NoFeature if the tree never reads it
+         */
+        uint32_t FindFeature(std::string_view name) const;
+
+        const std::string& GetFeatureName(uint32_t feature) const { return m_Features[feature]; }
+        uint32_t GetFeatureCount() const { return static_cast<uint32_t>(m_Features.size()); }
+        uint32_t GetOutcomeCount() const { return static_cast<uint32_t>(m_Outcomes.size()); }
+
+        const std::vector<Instruction>& GetCode() const { return m_Code; }
+        bool IsEmpty() const { return m_Code.empty(); }
+
+        /**
+         * @brief Node an instruction was compiled from (InvalidNode for trees without ids)
+         */
+        Data::NodeId GetSourceNode(uint32_t pc) const { return m_SourceNodes[pc]; }
+
+        void Clear();
+
+    private:
+        friend class Compiler;
+
+        std::vector<Instruction> m_Code;
+        std::vector<Data::NodeId> m_SourceNodes;   ///< Parallel to m_Code
+        std::vector<std::string> m_Features;       ///< Feature names, by index
+        std::vector<std::string> m_Outcomes;       ///< Outcome labels, by index
+    };
+
+}
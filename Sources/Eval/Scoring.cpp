@@ -0,0 +1,344 @@
+/**
+ * Scoring.cpp
+ * Implementation of the record file scoring pipeline
+ */
+
+#include "Scoring.h"
+#include "Batch.h"
+#include "../Core/ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+
+namespace Eval {
+
+    namespace {
+
+        constexpr uint64_t MaxHeaderBytes = 64ull * 1024 * 1024;
+
+        /**
+         * @brief Read a record file header and find the column of every program feature
+         */
+        bool ReadHeader(std::FILE* file, const Program& program, uint32_t& columnCount, uint64_t& dataOffset,
+                        std::vector<uint32_t>& featureColumns, std::string& error) {
+            RecordHeader header;
+            if (std::fread(&header, sizeof(header), 1, file) != 1 || std::memcmp(header.Magic, RecordMagic, sizeof(RecordMagic)) != 0) {
+                error = "Not a record file";
+                return false;
+            }
+            if (header.Version != RecordVersion) {
+                error = "Unsupported record file version " + std::to_string(header.Version);
+                return false;
+            }
+            if (header.ColumnCount == 0 || header.DataOffset < sizeof(header) || header.DataOffset > MaxHeaderBytes) {
+                error = "Corrupt record file header";
+                return false;
+            }
+
+            std::vector<char> names(header.DataOffset - sizeof(header));
+            if (!names.empty() && std::fread(names.data(), 1, names.size(), file) != names.size()) {
+                error = "Corrupt record file header";
+                return false;
+            }
+            std::unordered_map<std::string_view, uint32_t> columns;
+            size_t position = 0;
+            for (uint32_t column = 0; column < header.ColumnCount; ++column) {
+                uint32_t length = 0;
+                if (names.size() - position < sizeof(length)) {
+                    error = "Corrupt record file header";
+                    return false;
+                }
+                std::memcpy(&length, names.data() + position, sizeof(length));
+                position += sizeof(length);
+                if (names.size() - position < length) {
+                    error = "Corrupt record file header";
+                    return false;
+                }
+                columns.emplace(std::string_view(names.data() + position, length), column);   // First of duplicates wins
+                position += length;
+            }
+
+            featureColumns.resize(program.GetFeatureCount());
+            for (uint32_t feature = 0; feature < program.GetFeatureCount(); ++feature) {
+                auto found = columns.find(program.GetFeatureName(feature));
+                if (found == columns.end()) {
+                    error = "Record file has no column \"" + program.GetFeatureName(feature) + "\"";
+                    return false;
+                }
+                featureColumns[feature] = found->second;
+            }
+            columnCount = header.ColumnCount;
+            dataOffset = header.DataOffset;
+            return true;
+        }
+
+        /**
+         * @class Pipeline
+         * @brief Chunks moving from the reader through the pool to the writer
+         *
+         * Chunk n lives in slot n % slot count. The reader fills a free slot
+         * and submits it, pool tasks evaluate it, and the writer waits for
+         * the slots in sequence order, writes them out and frees them.
+         */
+        class Pipeline {
+        public:
+            Pipeline(const Program& program, const std::vector<uint32_t>& featureColumns, uint32_t columnCount,
+                     const ScoreOptions& options, uint32_t threads)
+                : m_Program(program), m_FeatureColumns(featureColumns), m_ColumnCount(columnCount),
+                  m_ChunkRecords(std::max(options.ChunkRecords, 1u)), m_PieceRecords(std::max(options.PieceRecords, 1u)),
+                  m_Hits(options.Hits), m_Failed(false) {
+                // Enough chunks in flight to keep every worker busy while one is read and one written
+                size_t piecesPerChunk = (m_ChunkRecords + m_PieceRecords - 1) / m_PieceRecords;
+                size_t slotCount = 2 + 2 * ((threads + piecesPerChunk - 1) / piecesPerChunk);
+                for (size_t i = 0; i < slotCount; ++i) {
+                    auto slot = std::make_unique<Slot>();
+                    slot->Rows.resize(size_t(m_ChunkRecords) * columnCount);
+                    slot->Columns.resize(size_t(m_ChunkRecords) * featureColumns.size());
+                    slot->Outcomes.resize(m_ChunkRecords);
+                    if (m_Hits) slot->Exits.resize(m_ChunkRecords);
+                    m_Slots.push_back(std::move(slot));
+                }
+                m_Pool = std::make_unique<Core::ThreadPool>(threads);
+            }
+
+            ~Pipeline() {
+                // Tasks still running refer to the slots
+                m_Pool.reset();
+            }
+
+            /**
+             * @brief Read, evaluate and write every chunk; runs the reader on the calling thread
+             */
+            bool Run(std::FILE* input, std::FILE* output, uint64_t recordCount, IO::Progress* progress, std::string& error) {
+                uint64_t chunkCount = (recordCount + m_ChunkRecords - 1) / m_ChunkRecords;
+                std::thread writer(&Pipeline::Write, this, output, chunkCount);
+
+                for (uint64_t sequence = 0; sequence < chunkCount; ++sequence) {
+                    Slot& slot = *m_Slots[sequence % m_Slots.size()];
+                    {
+                        std::unique_lock<std::mutex> lock(m_Mutex);
+                        m_Changed.wait(lock, [&]() { return slot.State == SlotState::Free || m_Failed; });
+                        if (m_Failed) break;
+                    }
+
+                    uint64_t first = sequence * m_ChunkRecords;
+                    size_t count = static_cast<size_t>(std::min<uint64_t>(m_ChunkRecords, recordCount - first));
+                    if (std::fread(slot.Rows.data(), sizeof(float) * m_ColumnCount, count, input) != count) {
+                        Fail("Read failed");
+                        break;
+                    }
+                    if (progress && !progress->Report(first + count)) {
+                        Fail("Cancelled");
+                        break;
+                    }
+                    slot.Count = count;
+                    {
+                        std::lock_guard<std::mutex> lock(m_Mutex);
+                        slot.State = SlotState::Evaluating;
+                    }
+                    m_Pool->Submit([this, &slot]() { EvaluateChunk(slot); });
+                }
+
+                writer.join();
+                m_Pool->Wait();
+                if (m_Failed) error = m_Error;
+                return !m_Failed;
+            }
+
+        private:
+            enum class SlotState {
+                Free,
+                Evaluating,
+                Done
+            };
+
+            struct Slot {
+                std::vector<float> Rows;         ///< As read: Count records of every column
+                std::vector<float> Columns;      ///< Program features, transposed for EvaluateBatch()
+                std::vector<uint32_t> Outcomes;
+                std::vector<uint32_t> Exits;     ///< Emit each record stopped at, when counting hits
+                size_t Count = 0;
+                std::atomic<size_t> PiecesLeft{ 0 };
+                SlotState State = SlotState::Free;   ///< Guarded by m_Mutex
+            };
+
+            void EvaluateChunk(Slot& slot) {
+                size_t pieces = (slot.Count + m_PieceRecords - 1) / m_PieceRecords;
+                slot.PiecesLeft.store(pieces, std::memory_order_relaxed);
+                // Queued on this worker's own queue, where idle workers steal them
+                for (size_t piece = 1; piece < pieces; ++piece) {
+                    m_Pool->Submit([this, &slot, piece]() { EvaluatePiece(slot, piece); });
+                }
+                EvaluatePiece(slot, 0);
+            }
+
+            void EvaluatePiece(Slot& slot, size_t piece) {
+                size_t begin = piece * m_PieceRecords;
+                size_t end = std::min(slot.Count, begin + m_PieceRecords);
+                size_t featureCount = m_FeatureColumns.size();
+                for (size_t record = begin; record < end; ++record) {
+                    const float* row = &slot.Rows[record * m_ColumnCount];
+                    for (size_t feature = 0; feature < featureCount; ++feature) {
+                        slot.Columns[feature * m_ChunkRecords + record] = row[m_FeatureColumns[feature]];
+                    }
+                }
+                ColumnBlock block = { slot.Columns.data() + begin, m_ChunkRecords, end - begin };
+                if (m_Hits) {
+                    EvaluateBatch(m_Program, block, slot.Outcomes.data() + begin, slot.Exits.data() + begin);
+                    m_Hits->Add(slot.Exits.data() + begin, end - begin);
+                } else {
+                    EvaluateBatch(m_Program, block, slot.Outcomes.data() + begin);
+                }
+
+                if (slot.PiecesLeft.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    {
+                        std::lock_guard<std::mutex> lock(m_Mutex);
+                        slot.State = SlotState::Done;
+                    }
+                    m_Changed.notify_all();
+                }
+            }
+
+            void Write(std::FILE* output, uint64_t chunkCount) {
+                for (uint64_t sequence = 0; sequence < chunkCount; ++sequence) {
+                    Slot& slot = *m_Slots[sequence % m_Slots.size()];
+                    {
+                        std::unique_lock<std::mutex> lock(m_Mutex);
+                        m_Changed.wait(lock, [&]() { return slot.State == SlotState::Done || m_Failed; });
+                        if (m_Failed) return;
+                    }
+                    if (output && std::fwrite(slot.Outcomes.data(), sizeof(uint32_t), slot.Count, output) != slot.Count) {
+                        Fail("Write failed");
+                        return;
+                    }
+                    {
+                        std::lock_guard<std::mutex> lock(m_Mutex);
+                        slot.State = SlotState::Free;
+                    }
+                    m_Changed.notify_all();
+                }
+            }
+
+            void Fail(const std::string& error) {
+                {
+                    std::lock_guard<std::mutex> lock(m_Mutex);
+                    if (!m_Failed) m_Error = error;
+                    m_Failed = true;
+                }
+                m_Changed.notify_all();
+            }
+
+            const Program& m_Program;
+            const std::vector<uint32_t>& m_FeatureColumns;   ///< Input column of each program feature
+            uint32_t m_ColumnCount;
+            uint32_t m_ChunkRecords;
+            uint32_t m_PieceRecords;
+            HitCounter* m_Hits;
+            std::vector<std::unique_ptr<Slot>> m_Slots;
+            std::unique_ptr<Core::ThreadPool> m_Pool;
+
+            std::mutex m_Mutex;
+            std::condition_variable m_Changed;   ///< A slot changed state or the run failed
+            bool m_Failed;
+            std::string m_Error;
+        };
+
+    }
+
+    std::string EncodeRecordHeader(const std::vector<std::string>& columns) {
+        std::string names;
+        for (const std::string& column : columns) {
+            uint32_t length = static_cast<uint32_t>(column.size());
+            names.append(reinterpret_cast<const char*>(&length), sizeof(length));
+            names += column;
+        }
+        // Records start 8-byte aligned so the file can also be mapped and read in place
+        while ((sizeof(RecordHeader) + names.size()) % 8 != 0) names += '\0';
+
+        RecordHeader header = {};
+        std::memcpy(header.Magic, RecordMagic, sizeof(RecordMagic));
+        header.Version = RecordVersion;
+        header.ColumnCount = static_cast<uint32_t>(columns.size());
+        header.DataOffset = sizeof(RecordHeader) + names.size();
+        return std::string(reinterpret_cast<const char*>(&header), sizeof(header)) + names;
+    }
+
+    bool ScoreFile(const Program& program, const std::string& inputPath, const std::string& outputPath, std::string& error,
+                   const ScoreOptions& options, ScoreStats* stats, IO::Progress* progress) {
+        auto start = std::chrono::steady_clock::now();
+        if (program.IsEmpty()) {
+            error = "The tree is empty";
+            return false;
+        }
+
+        std::error_code sizeError;
+        uint64_t fileSize = std::filesystem::file_size(inputPath, sizeError);
+        std::FILE* input = sizeError ? nullptr : std::fopen(inputPath.c_str(), "rb");
+        if (!input) {
+            error = "Cannot open " + inputPath;
+            return false;
+        }
+        uint32_t columnCount = 0;
+        uint64_t dataOffset = 0;
+        std::vector<uint32_t> featureColumns;
+        if (!ReadHeader(input, program, columnCount, dataOffset, featureColumns, error)) {
+            std::fclose(input);
+            return false;
+        }
+        uint64_t recordBytes = uint64_t(columnCount) * sizeof(float);
+        if (fileSize < dataOffset || (fileSize - dataOffset) % recordBytes != 0) {
+            std::fclose(input);
+            error = "Record file is truncated";
+            return false;
+        }
+        uint64_t recordCount = (fileSize - dataOffset) / recordBytes;
+        if (progress) progress->SetTotal(recordCount);
+
+        std::FILE* output = nullptr;
+        if (!outputPath.empty()) {
+            output = std::fopen(outputPath.c_str(), "wb");
+            if (!output) {
+                std::fclose(input);
+                error = "Cannot create " + outputPath;
+                return false;
+            }
+            std::setvbuf(output, nullptr, _IOFBF, 1 << 20);
+        }
+        // Large buffers let each fread()/fwrite() move a whole chunk
+        std::setvbuf(input, nullptr, _IOFBF, 1 << 20);
+
+        uint32_t threads = options.Threads > 0 ? options.Threads : Core::ThreadPool::GetHardwareThreads();
+        bool ok;
+        {
+            Pipeline pipeline(program, featureColumns, columnCount, options, threads);
+            ok = pipeline.Run(input, output, recordCount, progress, error);
+        }
+        std::fclose(input);
+        if (output && std::fclose(output) != 0 && ok) {
+            error = "Write failed";
+            ok = false;
+        }
+        if (!ok) {
+            if (output) std::remove(outputPath.c_str());
+            return false;
+        }
+
+        if (stats) {
+            stats->Records = recordCount;
+            stats->InputBytes = fileSize;
+            stats->Threads = threads;
+            stats->Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+        return true;
+    }
+
+}
@@ -0,0 +1,92 @@
+/**
+ * Scoring.h
+ * Multi-threaded scoring of record files
+ *
+ * ScoreFile() runs a compiled tree over every record of a file as a
+ * three-stage pipeline: the calling thread reads chunks of records, a
+ * Core::ThreadPool evaluates them (each chunk split into pieces that idle
+ * workers steal) and a writer thread appends the outcomes of finished
+ * chunks in input order. The stages overlap, and a bounded number of chunks
+ * in flight keeps memory use independent of the file size.
+ *
+ * Record file layout (little-endian):
+ *   RecordHeader
+ *   Column names: ColumnCount times uint32 length and UTF-8 bytes
+ *   Padding up to DataOffset
+ *   Records: float[ColumnCount] each, until the end of the file
+ *
+ * Columns are matched to the program's features by name, so the file may
+ * hold them in any order and carry columns the tree does not use. A NaN
+ * value is missing. The output file is one uint32 outcome index per
+ * record, in input order (NoOutcome where a branch is missing).
+ */
+
+#pragma once
+
+#include "HitCounter.h"
+#include "Program.h"
+#include "../IO/Progress.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Eval {
+
+    constexpr char RecordMagic[8] = { 'D', 'T', 'R', 'E', 'C', 'O', 'R', 'D' };
+    constexpr uint32_t RecordVersion = 1;
+
+    /**
+     * @struct RecordHeader
+     * @brief Start of a record file
+     */
+    struct RecordHeader {
+        char Magic[8];
+        uint32_t Version;
+        uint32_t ColumnCount;
+        uint64_t DataOffset;   ///< Start of the first record
+    };
+
+    static_assert(sizeof(RecordHeader) == 24, "RecordHeader layout must not change");
+
+    /**
+     * @brief Header and column names of a record file; the records follow directly
+     */
+    std::string EncodeRecordHeader(const std::vector<std::string>& columns);
+
+    /**
+     * @struct ScoreOptions
+     * @brief Parallelism and memory use of ScoreFile()
+     */
+    struct ScoreOptions {
+        uint32_t Threads = 0;            ///< Evaluation workers; 0 uses every hardware thread
+        uint32_t ChunkRecords = 65536;   ///< Records read and written at a time
+        uint32_t PieceRecords = 8192;    ///< Records per evaluation task within a chunk
+        HitCounter* Hits = nullptr;      ///< Also counts where records go if set (Reset() for the program first)
+    };
+
+    /**
+     * @struct ScoreStats
+     * @brief What ScoreFile() did
+     */
+    struct ScoreStats {
+        uint64_t Records = 0;
+        uint64_t InputBytes = 0;
+        uint32_t Threads = 0;
+        double Seconds = 0.0;
+
+        double GetRecordsPerSecond() const { return Seconds > 0.0 ? double(Records) / Seconds : 0.0; }
+    };
+
+    /**
+     * @brief Evaluate every record of a file and write the outcomes to another
+     * @param program Compiled tree; every feature it tests must be a column of the input
+     * @param inputPath Record file (see above)
+     * @param outputPath Outcome file to create or overwrite; removed again on failure.
+     *        Empty to only count hits (see ScoreOptions::Hits)
+     * @param error Receives the reason on failure ("Cancelled" if cancelled)
+     * @param progress Optional; counts records read and is checked for cancellation
+     */
+    bool ScoreFile(const Program& program, const std::string& inputPath, const std::string& outputPath, std::string& error,
+                   const ScoreOptions& options = ScoreOptions(), ScoreStats* stats = nullptr, IO::Progress* progress = nullptr);
+
+}
@@ -0,0 +1,286 @@
+/**
+ * Validator.cpp
+ * Implementation of the Validator class
+ */
+
+#include "Validator.h"
+#include <algorithm>
+#include <bit>
+#include <charconv>
+
+namespace Eval {
+
+    namespace {
+
+        constexpr uint8_t Queued = 1;
+        constexpr uint8_t Marked = 2;   ///< Subtree total must be recomputed
+
+        std::string_view Trim(std::string_view text) {
+            size_t begin = 0, end = text.size();
+            while (begin < end && (text[begin] == ' ' || text[begin] == '\t')) ++begin;
+            while (end > begin && (text[end - 1] == ' ' || text[end - 1] == '\t')) --end;
+            return text.substr(begin, end - begin);
+        }
+
+        /// Edge labels a switch accepts: a number, or "*" / nothing for the default
+        bool IsSwitchEdge(std::string_view label) {
+            label = Trim(label);
+            if (label.empty() || label == "*") return true;
+            if (label[0] == '+') label.remove_prefix(1);
+            float value;
+            auto [end, error] = std::from_chars(label.data(), label.data() + label.size(), value);
+            return !label.empty() && error == std::errc() && end == label.data() + label.size();
+        }
+
+        /// Slot of the second child whose edge label repeats an earlier one, or -1
+        int FindDuplicateEdge(const Data::NodeStore& nodes, Data::NodeId id) {
+            uint32_t count = nodes.GetChildCount(id);
+            for (uint32_t i = 1; i < count; ++i) {
+                Data::StringId label = nodes.GetEdgeLabelId(id, i);
+                if (label == Data::EmptyString) continue;
+                for (uint32_t j = 0; j < i; ++j) {
+                    if (nodes.GetEdgeLabelId(id, j) == label) return static_cast<int>(i);
+                }
+            }
+            return -1;
+        }
+
+    }
+
+    Validator::Validator(Data::Document& document) : m_Document(document), m_Nodes(document.GetNodes()), m_QueueHead(0), m_Revision(0) {
+        m_Nodes.AddObserver(this);
+        Grow();
+        // Stashed nodes too: undo brings them back without notifying
+        for (Data::NodeId id = 0; id < m_Nodes.GetCapacity(); ++id) {
+            if (m_Nodes.IsAlive(id)) Queue(id);
+        }
+    }
+
+    Validator::~Validator() {
+        m_Nodes.RemoveObserver(this);
+    }
+
+    bool Validator::Update(uint32_t budget) {
+        // Detaching notifies only the parent: misplaced Start nodes are watched for losing theirs
+        size_t kept = 0;
+        for (Data::NodeId id : m_Misplaced) {
+            if (!(m_Issues[id] & StartInside)) continue;
+            if (m_Nodes.GetParent(id) == Data::InvalidNode) Queue(id);
+            m_Misplaced[kept++] = id;
+        }
+        m_Misplaced.resize(kept);
+
+        for (uint32_t checked = 0; m_QueueHead < m_Queue.size() && checked < budget;) {
+            Data::NodeId id = m_Queue[m_QueueHead++];
+            m_Flags[id] &= ~Queued;
+            if (!m_Nodes.IsAlive(id)) continue;
+            ++checked;
+
+            uint32_t issues = Check(id);
+            if ((issues & StartInside) && !(m_Issues[id] & StartInside)) m_Misplaced.push_back(id);
+            if (issues != m_Issues[id]) {
+                m_Issues[id] = issues;
+                ++m_Revision;
+            }
+
+            // Its subtree and every subtree above it may have changed
+            for (Data::NodeId node = id; node != Data::InvalidNode && !(m_Flags[node] & Marked); node = m_Nodes.GetParent(node)) {
+                m_Flags[node] |= Marked;
+                m_Marked.push_back(node);
+            }
+
+            // Whether a Start node is misplaced depends on its parent, which is what changed
+            for (uint32_t slot = 0; slot < m_Nodes.GetChildCount(id); ++slot) {
+                Data::NodeId child = m_Nodes.GetChild(id, slot);
+                if (m_Nodes.GetType(child) == Data::NodeType::Start) Queue(child);
+            }
+        }
+        // Totals wait for the queue to drain: the paths of a bulk check then
+        // merge into one pass instead of reaching the root every frame
+        if (m_QueueHead < m_Queue.size()) return false;
+        m_Queue.clear();
+        m_QueueHead = 0;
+        RefreshTotals();
+        return true;
+    }
+
+    uint32_t Validator::GetIssueCount() const {
+        Data::NodeId root = m_Document.GetRoot();
+        return m_Nodes.IsLive(root) ? GetSubtreeIssueCount(root) : 0;
+    }
+
+    std::string Validator::Describe(Data::NodeId node, IssueBits kind) const {
+        uint32_t count = m_Nodes.IsAlive(node) ? m_Nodes.GetChildCount(node) : 0;
+        switch (kind) {
+            case ConditionSyntax: {
+                auto found = m_SyntaxErrors.find(node);
+                return found != m_SyntaxErrors.end() ? found->second : "Condition does not parse";
+            }
+            case ConditionBranches:
+                if (count == 0) return "Condition has no branches";
+                return "Condition has " + std::to_string(count) + " branches; only a bare feature with numeric branches can have more than two";
+            case SingleBranch: return "Condition has only one branch";
+            case MissingEnd: return "Branch ends without an End node";
+            case EndWithChildren: return "End node has " + std::to_string(count) + (count == 1 ? " child" : " children");
+            case StartInside: return "Start node in the middle of the tree";
+            case DuplicateEdge: {
+                int slot = m_Nodes.IsAlive(node) ? FindDuplicateEdge(m_Nodes, node) : -1;
+                if (slot < 0) return "Two branches have the same label";
+                return "Two branches are labeled \"" + std::string(m_Nodes.GetEdgeLabel(node, static_cast<uint32_t>(slot))) + "\"";
+            }
+            default: return "";
+        }
+    }
+
+    std::vector<Issue> Validator::CollectIssues(Data::NodeId root, size_t limit) const {
+        std::vector<Issue> issues;
+        if (!m_Nodes.IsLive(root)) return issues;
+        std::vector<Data::NodeId> stack = { root };
+        while (!stack.empty() && issues.size() < limit) {
+            Data::NodeId node = stack.back();
+            stack.pop_back();
+            if (GetSubtreeIssueCount(node) == 0) continue;
+
+            for (uint32_t bits = GetIssues(node); bits != 0 && issues.size() < limit; bits &= bits - 1) {
+                IssueBits kind = static_cast<IssueBits>(bits & ~(bits - 1));
+                issues.push_back({ node, kind, !(kind & WarningIssues), Describe(node, kind) });
+            }
+            for (uint32_t slot = m_Nodes.GetChildCount(node); slot-- > 0;) stack.push_back(m_Nodes.GetChild(node, slot));
+        }
+        return issues;
+    }
+
+    void Validator::OnNodeChanged(Data::NodeId id) {
+        Grow();
+        // A label id can be recycled once released: forget the parse as soon as the label moves on
+        if (m_Parsed[id] != Unparsed && m_Parsed[id] != m_Nodes.GetLabelId(id)) m_Parsed[id] = Unparsed;
+        Queue(id);
+    }
+
+    void Validator::OnNodeDestroyed(Data::NodeId id) {
+        if (id >= m_Issues.size()) return;
+        if (m_Issues[id] & AllIssues) ++m_Revision;
+        m_Issues[id] = 0;
+        m_Totals[id] = 0;
+        m_Parsed[id] = Unparsed;
+        m_SyntaxErrors.erase(id);
+    }
+
+    void Validator::OnStoreCleared() {
+        m_Issues.clear();
+        m_Totals.clear();
+        m_Parsed.clear();
+        m_Flags.clear();
+        m_Queue.clear();
+        m_QueueHead = 0;
+        m_Marked.clear();
+        m_Misplaced.clear();
+        m_SyntaxErrors.clear();
+        ++m_Revision;
+    }
+
+    void Validator::Queue(Data::NodeId id) {
+        Grow();
+        if (m_Flags[id] & Queued) return;
+        m_Flags[id] |= Queued;
+        m_Queue.push_back(id);
+    }
+
+    void Validator::Grow() {
+        size_t capacity = m_Nodes.GetCapacity();
+        if (m_Issues.size() >= capacity) return;
+        m_Issues.resize(capacity, 0);
+        m_Totals.resize(capacity, 0);
+        m_Parsed.resize(capacity, Unparsed);
+        m_Flags.resize(capacity, 0);
+    }
+
+    uint32_t Validator::Check(Data::NodeId id) {
+        Data::NodeType type = m_Nodes.GetType(id);
+        uint32_t count = m_Nodes.GetChildCount(id);
+        uint32_t issues = 0;
+
+        if (type == Data::NodeType::Condition) {
+            // The label is parsed again only when it changed
+            Data::StringId label = m_Nodes.GetLabelId(id);
+            uint32_t parse = m_Issues[id] & (ConditionSyntax | BareFeature);
+            if (m_Parsed[id] != label) {
+                m_Parsed[id] = label;
+                std::string error;
+                if (m_Scratch.Parse(m_Nodes.GetLabel(id), error)) {
+                    parse = m_Scratch.IsBareFeature() ? BareFeature : 0;
+                    if (m_SyntaxErrors.erase(id)) ++m_Revision;
+                } else {
+                    parse = ConditionSyntax;
+                    std::string& message = m_SyntaxErrors[id];
+                    if (message != error) {
+                        message = std::move(error);
+                        ++m_Revision;
+                    }
+                }
+            }
+            issues |= parse;
+
+            if (count == 0) {
+                issues |= ConditionBranches;
+            } else if (count == 1) {
+                issues |= SingleBranch;
+            } else if (count > 2) {
+                bool isSwitch = (parse & BareFeature) != 0;
+                for (uint32_t slot = 0; slot < count && isSwitch; ++slot) isSwitch = IsSwitchEdge(m_Nodes.GetEdgeLabel(id, slot));
+                if (!isSwitch) issues |= ConditionBranches;
+            }
+        } else {
+            if (m_Parsed[id] != Unparsed) {
+                m_Parsed[id] = Unparsed;
+                m_SyntaxErrors.erase(id);
+            }
+            if (count == 0 && type != Data::NodeType::End) issues |= MissingEnd;
+        }
+
+        if (type == Data::NodeType::End && count > 0) issues |= EndWithChildren;
+        if (type == Data::NodeType::Start && m_Nodes.GetParent(id) != Data::InvalidNode) issues |= StartInside;
+        if (count > 1 && FindDuplicateEdge(m_Nodes, id) >= 0) issues |= DuplicateEdge;
+        return issues;
+    }
+
+    void Validator::RefreshTotals() {
+        // Marked nodes form paths up to the tops of their trees; totals are
+        // recomputed bottom-up from each top, descending only into marked children
+        struct Frame {
+            Data::NodeId Node;
+            uint32_t Slot;
+        };
+        std::vector<Frame> stack;
+        for (Data::NodeId top : m_Marked) {
+            if (!(m_Flags[top] & Marked)) continue;
+            if (!m_Nodes.IsAlive(top)) {
+                m_Flags[top] &= ~Marked;
+                continue;
+            }
+            Data::NodeId parent = m_Nodes.GetParent(top);
+            if (parent != Data::InvalidNode && (m_Flags[parent] & Marked)) continue;
+
+            stack.push_back({ top, 0 });
+            while (!stack.empty()) {
+                Frame& frame = stack.back();
+                if (frame.Slot < m_Nodes.GetChildCount(frame.Node)) {
+                    Data::NodeId child = m_Nodes.GetChild(frame.Node, frame.Slot++);
+                    if (m_Flags[child] & Marked) stack.push_back({ child, 0 });
+                    continue;
+                }
+                Data::NodeId node = frame.Node;
+                stack.pop_back();
+                uint32_t total = static_cast<uint32_t>(std::popcount(m_Issues[node] & AllIssues));
+                for (uint32_t slot = 0; slot < m_Nodes.GetChildCount(node); ++slot) total += m_Totals[m_Nodes.GetChild(node, slot)];
+                if (total != m_Totals[node]) {
+                    m_Totals[node] = total;
+                    ++m_Revision;
+                }
+                m_Flags[node] &= ~Marked;
+            }
+        }
+        m_Marked.clear();
+    }
+
+}
@@ -0,0 +1,146 @@
+/**
+ * Validator.h
+ * Incremental checks that a tree is well-formed
+ *
+ * Every rule looks at one node and its child list: a Condition needs two
+ * branches (or numeric ones, for a switch), a branch should end at an End
+ * node, End nodes have no children, Start nodes only begin trees, sibling
+ * edges have distinct labels and Condition labels parse (see Expression.h).
+ *
+ * The validator observes a document's NodeStore. A change queues the node
+ * for its rules to be run again; Update() runs queued checks up to a budget
+ * and, once none are left, recomputes the cached issue count of every
+ * subtree containing a checked node, walking only those nodes' ancestors.
+ * A single edit costs one node's rules and one path to the root, whatever
+ * the tree size.
+ */
+
+#pragma once
+
+#include "Expression.h"
+#include "../Data/Document.h"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Eval {
+
+    /**
+     * @brief Problems a node can have, one bit each
+     */
+    enum IssueBits : uint32_t {
+        ConditionSyntax = 1,        ///< Condition label does not parse
+        ConditionBranches = 2,      ///< Condition without branches, or more than two that do not form a switch
+        SingleBranch = 4,           ///< Condition with one branch (records taking the other stop there)
+        MissingEnd = 8,             ///< Leaf that is not an End node
+        EndWithChildren = 16,       ///< End node that continues
+        StartInside = 32,           ///< Start node below another node
+        DuplicateEdge = 64,         ///< Two child edges with the same label
+        AllIssues = 127
+    };
+
+    constexpr uint32_t WarningIssues = SingleBranch | MissingEnd;   ///< Issues that do not stop a tree from compiling
+
+    /**
+     * @struct Issue
+     * @brief One problem of one node, as listed to the user
+     */
+    struct Issue {
+        Data::NodeId Node;
+        IssueBits Kind;
+        bool IsError;          ///< Otherwise a warning
+        std::string Message;
+    };
+
+    /**
+     * @class Validator
+     * @brief Issues of every node of a document, kept up to date as it is edited
+     *
+     * Used from the thread that edits the document. Results lag edits until
+     * an Update() that empties the queue.
+     */
+    class Validator : public Data::NodeObserver {
+    public:
+        static constexpr uint32_t DefaultBudget = 4096;   ///< Nodes checked per Update()
+
+        /**
+         * @param document Document to observe; every node in it is queued for checking
+         */
+        explicit Validator(Data::Document& document);
+        ~Validator() override;
+
+        Validator(const Validator&) = delete;
+        Validator& operator=(const Validator&) = delete;
+
+        /**
+         * @brief Check queued nodes, then bring subtree counts up to date if none are left
+         * @param budget Most nodes to check
+         * @return true if nothing is left queued
+         */
+        bool Update(uint32_t budget = DefaultBudget);
+
+        /**
+         * @brief IssueBits of a node (0 if it has none or is not checked yet)
+         */
+        uint32_t GetIssues(Data::NodeId node) const { return node < m_Issues.size() ? m_Issues[node] & AllIssues : 0; }
+
+        /**
+         * @brief Issues in a node's subtree, the node included
+         */
+        uint32_t GetSubtreeIssueCount(Data::NodeId node) const { return node < m_Totals.size() ? m_Totals[node] : 0; }
+
+        /**
+         * @brief Issues in the document's tree
+         */
+        uint32_t GetIssueCount() const;
+
+        /**
+         * @brief Changes whenever any node's issues or subtree count change
+         */
+        uint64_t GetRevision() const { return m_Revision; }
+
+        size_t GetQueuedCount() const { return m_Queue.size() - m_QueueHead; }
+
+        /**
+         * @brief Text of one issue of a node
+         */
+        std::string Describe(Data::NodeId node, IssueBits kind) const;
+
+        /**
+         * @brief Issues of a subtree in pre-order, skipping subtrees without any
+         * @param limit Most issues to return
+         */
+        std::vector<Issue> CollectIssues(Data::NodeId root, size_t limit) const;
+
+        void OnNodeChanged(Data::NodeId id) override;
+        void OnNodeMoved(Data::NodeId, float, float) override {}   ///< No rule depends on positions
+        void OnSubtreeMoved(const Data::NodeStore&, Data::NodeId, float, float) override {}
+        void OnNodeDestroyed(Data::NodeId id) override;
+        void OnStoreCleared() override;
+
+    private:
+        static constexpr uint32_t BareFeature = 1u << 31;   ///< Parsed label is a lone feature (may switch)
+        static constexpr Data::StringId Unparsed = ~Data::StringId(0);
+
+        void Queue(Data::NodeId id);
+        void Grow();
+        uint32_t Check(Data::NodeId id);
+        void RefreshTotals();
+
+        Data::Document& m_Document;
+        Data::NodeStore& m_Nodes;
+        std::vector<uint32_t> m_Issues;            ///< IssueBits (plus BareFeature), by NodeId
+        std::vector<uint32_t> m_Totals;            ///< Issues in each subtree, by NodeId
+        std::vector<Data::StringId> m_Parsed;      ///< Label the syntax bits were computed from, by NodeId
+        std::vector<uint8_t> m_Flags;              ///< Queued / marked for a total update, by NodeId
+        std::vector<Data::NodeId> m_Queue;
+        size_t m_QueueHead;                        ///< Entries before this are done
+        std::vector<Data::NodeId> m_Marked;        ///< Nodes whose subtree totals are out of date
+        std::vector<Data::NodeId> m_Misplaced;     ///< Nodes with StartInside (some may have lost it since)
+        std::unordered_map<Data::NodeId, std::string> m_SyntaxErrors;
+        Expression m_Scratch;
+        uint64_t m_Revision;
+    };
+
+}
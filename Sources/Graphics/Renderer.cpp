@@ -1,5 +1,6 @@
 #include "Renderer.h"
 #include "SimpleFont.h"
+#include <algorithm>
 #include <cmath>
 
 namespace Graphics {
@@ -14,7 +15,17 @@ namespace Graphics {
         SDL_RenderLine(m_Renderer, x1, y1, x2, y2);
     }
 
-    void Renderer::DrawBezier(float x1, float y1, float x2, float y2, float cx1, float cy1, float cx2, float cy2) {
+    void Renderer::DrawBezier(float x1, float y1, float x2, float y2, float cx1, float cy1, float cx2, float cy2, float thickness) {
+        // Thick curves are drawn as side-by-side strokes
+        int strokes = std::max(1, int(thickness + 0.5f));
+        if (strokes > 1) {
+            for (int i = 0; i < strokes; ++i) {
+                float dx = float(i) - float(strokes - 1) * 0.5f;
+                DrawBezier(x1 + dx, y1, x2 + dx, y2, cx1 + dx, cy1, cx2 + dx, cy2);
+            }
+            return;
+        }
+
         float t = 0;
         float step = 0.05f;
         float prevX = x1;
@@ -51,7 +62,7 @@ namespace Graphics {
         }
     }
 
-    void Renderer::DrawStyledNode(float x, float y, const std::string& label, bool isSelected, int shapeType, uint8_t r, uint8_t g, uint8_t b, float scale) {
+    void Renderer::DrawStyledNode(float x, float y, std::string_view label, bool isSelected, int shapeType, uint8_t r, uint8_t g, uint8_t b, float scale) {
         float baseSize = 50.0f;
         float size = baseSize * scale;
         
@@ -193,7 +204,7 @@ namespace Graphics {
         DrawLine(x + rectW/2 + radius, y, x + rectW/2, y + radius);
     }
 
-    void Renderer::DrawText(float x, float y, const std::string& text, float scale) {
+    void Renderer::DrawText(float x, float y, std::string_view text, float scale) {
         for (char c : text) {
             if (c < 32 || c > 127) c = '?';
             const uint8_t* glyph = font8x8_basic[c - 32];
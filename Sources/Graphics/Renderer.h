@@ -10,6 +10,7 @@
 
 #include <SDL3/SDL.h>
 #include <string>
+#include <string_view>
 
 namespace Graphics {
 
@@ -28,7 +29,7 @@ namespace Graphics {
 
         // Line drawing
         void DrawLine(float x1, float y1, float x2, float y2);
-        void DrawBezier(float x1, float y1, float x2, float y2, float cx1, float cy1, float cx2, float cy2);
+        void DrawBezier(float x1, float y1, float x2, float y2, float cx1, float cy1, float cx2, float cy2, float thickness = 1.0f);
         
         // Shape outlines
         void DrawCircle(float x, float y, float radius);
@@ -54,7 +55,7 @@ namespace Graphics {
          * @param b Blue color component
          * @param scale Scale factor for animation
          */
-        void DrawStyledNode(float x, float y, const std::string& label, bool isSelected, int shapeType, uint8_t r, uint8_t g, uint8_t b, float scale = 1.0f);
+        void DrawStyledNode(float x, float y, std::string_view label, bool isSelected, int shapeType, uint8_t r, uint8_t g, uint8_t b, float scale = 1.0f);
         
         /**
          * @brief Draw text using the simple bitmap font
@@ -63,7 +64,7 @@ namespace Graphics {
          * @param text Text string to draw
          * @param scale Scale factor for text size
          */
-        void DrawText(float x, float y, const std::string& text, float scale = 1.0f);
+        void DrawText(float x, float y, std::string_view text, float scale = 1.0f);
 
         /**
          * @brief Set the current drawing color
@@ -0,0 +1,68 @@
+/**
+ * BinaryFormat.h
+ * On-disk layout of the compact binary tree format (.dtb)
+ *
+ * A file is a fixed header followed by 8-byte aligned sections:
+ *   Nodes       BinaryNode[NodeCount], in pre-order (record 0 is the root)
+ *   Children    uint32[ChildCount], record indices of each node's children
+ *   EdgeLabels  uint32[ChildCount], string index of the edge to each child
+ *   StringOffs  uint32[StringCount + 1], start of each string in StringData
+ *   StringData  UTF-8 bytes, not terminated
+ *   Layout      float X[NodeCount] followed by float Y[NodeCount]
+ *
+ * Everything is little-endian and laid out so that a mapped file can be
+ * read in place. String 0 is always the empty string. Records keep the
+ * NodeId the node had when saved, so ids survive a save/load round trip.
+ */
+
+#pragma once
+
+#include <bit>
+#include <cstdint>
+
+namespace IO {
+
+    static_assert(std::endian::native == std::endian::little, "The binary tree format is read in place and assumes a little-endian host");
+
+    constexpr char BinaryMagic[8] = { 'D', 'T', 'R', 'E', 'E', 'B', 'I', 'N' };
+    constexpr uint32_t BinaryVersion = 1;
+
+    /**
+     * @struct BinaryHeader
+     * @brief File header; section offsets are from the start of the file
+     */
+    struct BinaryHeader {
+        char Magic[8];
+        uint32_t Version;
+        uint32_t NodeCount;
+        uint32_t ChildCount;
+        uint32_t StringCount;
+        uint64_t NodesOffset;
+        uint64_t ChildrenOffset;
+        uint64_t EdgeLabelsOffset;
+        uint64_t StringOffsetsOffset;
+        uint64_t StringDataOffset;
+        uint64_t StringDataSize;
+        uint64_t LayoutOffset;
+    };
+
+    /**
+     * @struct BinaryNode
+     * @brief One node record of the node table
+     */
+    struct BinaryNode {
+        uint32_t Id;            ///< NodeId of the node when it was saved
+        uint32_t Label;         ///< String index of the node label
+        uint32_t FirstChild;    ///< Start of the node's range in Children/EdgeLabels
+        uint32_t ChildCount;
+        uint32_t SubtreeSize;   ///< Records in this subtree, including this one
+        uint8_t Type;           ///< Data::NodeType
+        uint8_t Shape;          ///< Data::ShapeType
+        uint8_t R, G, B;
+        uint8_t Reserved[3];
+    };
+
+    static_assert(sizeof(BinaryHeader) == 80, "BinaryHeader layout must not change");
+    static_assert(sizeof(BinaryNode) == 28, "BinaryNode layout must not change");
+
+}
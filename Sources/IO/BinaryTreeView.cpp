@@ -0,0 +1,187 @@
+/**
+ * BinaryTreeView.cpp
+ * Implementation of the BinaryTreeView class
+ */
+
+#include "BinaryTreeView.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace IO {
+
+    namespace {
+
+        /// True if [offset, offset + count * size) lies inside a file of fileSize bytes
+        bool SectionFits(uint64_t offset, uint64_t count, uint64_t size, uint64_t fileSize) {
+            if (offset % 4 != 0 || offset > fileSize) return false;
+            return count <= (fileSize - offset) / size;
+        }
+
+        constexpr uint64_t MinSparseIdLimit = 1 << 20;   ///< Saved ids below this are always restored
+
+    }
+
+    BinaryTreeView::BinaryTreeView()
+        : m_Header{}, m_Nodes(nullptr), m_Children(nullptr), m_EdgeLabels(nullptr), m_StringOffsets(nullptr), m_StringData(nullptr), m_X(nullptr), m_Y(nullptr) {
+    }
+
+    bool BinaryTreeView::Open(const std::string& path, std::string& error) {
+        Close();
+        if (!m_File.Open(path)) {
+            error = "Cannot open " + path;
+            return false;
+        }
+        if (!Attach(m_File.GetData(), m_File.GetSize(), error)) {
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    bool BinaryTreeView::Attach(const uint8_t* data, uint64_t size, std::string& error) {
+        if (size < sizeof(BinaryHeader)) {
+            error = "File is too small to be a binary tree";
+            return false;
+        }
+        BinaryHeader header;
+        std::memcpy(&header, data, sizeof(BinaryHeader));
+        if (std::memcmp(header.Magic, BinaryMagic, sizeof(BinaryMagic)) != 0) {
+            error = "Not a binary DecisionTree file";
+            return false;
+        }
+        if (header.Version > BinaryVersion) {
+            error = "Unsupported binary format version";
+            return false;
+        }
+
+        const BinaryHeader& h = header;
+        bool valid = h.NodeCount > 0
+            && SectionFits(h.NodesOffset, h.NodeCount, sizeof(BinaryNode), size)
+            && SectionFits(h.ChildrenOffset, h.ChildCount, sizeof(uint32_t), size)
+            && SectionFits(h.EdgeLabelsOffset, h.ChildCount, sizeof(uint32_t), size)
+            && SectionFits(h.StringOffsetsOffset, uint64_t(h.StringCount) + 1, sizeof(uint32_t), size)
+            && SectionFits(h.StringDataOffset, h.StringDataSize, 1, size)
+            && SectionFits(h.LayoutOffset, uint64_t(h.NodeCount) * 2, sizeof(float), size);
+        if (!valid) {
+            error = "Binary tree file is truncated or corrupt";
+            return false;
+        }
+
+        m_Header = header;
+        m_Nodes = reinterpret_cast<const BinaryNode*>(data + h.NodesOffset);
+        m_Children = reinterpret_cast<const uint32_t*>(data + h.ChildrenOffset);
+        m_EdgeLabels = reinterpret_cast<const uint32_t*>(data + h.EdgeLabelsOffset);
+        m_StringOffsets = reinterpret_cast<const uint32_t*>(data + h.StringOffsetsOffset);
+        m_StringData = reinterpret_cast<const char*>(data + h.StringDataOffset);
+        m_X = reinterpret_cast<const float*>(data + h.LayoutOffset);
+        m_Y = m_X + h.NodeCount;
+        return true;
+    }
+
+    void BinaryTreeView::Close() {
+        m_File.Close();
+        m_Header = {};
+        m_Nodes = nullptr;
+        m_Children = m_EdgeLabels = m_StringOffsets = nullptr;
+        m_StringData = nullptr;
+        m_X = m_Y = nullptr;
+    }
+
+    uint32_t BinaryTreeView::GetChildCount(uint32_t index) const {
+        const BinaryNode& node = m_Nodes[index];
+        if (node.FirstChild > m_Header.ChildCount || node.ChildCount > m_Header.ChildCount - node.FirstChild) return 0;
+        return node.ChildCount;
+    }
+
+    uint32_t BinaryTreeView::GetChild(uint32_t index, uint32_t slot) const {
+        uint32_t child = m_Children[m_Nodes[index].FirstChild + slot];
+        return child < m_Header.NodeCount ? child : 0;
+    }
+
+    std::string_view BinaryTreeView::GetEdgeLabel(uint32_t index, uint32_t slot) const {
+        return GetString(m_EdgeLabels[m_Nodes[index].FirstChild + slot]);
+    }
+
+    std::string_view BinaryTreeView::GetString(uint32_t string) const {
+        if (string >= m_Header.StringCount) return {};
+        uint32_t begin = m_StringOffsets[string];
+        uint32_t end = m_StringOffsets[string + 1];
+        if (begin > end || end > m_Header.StringDataSize) return {};
+        return std::string_view(m_StringData + begin, end - begin);
+    }
+
+    bool BinaryTreeView::Materialize(Data::Document& document, std::string& error) const {
+        document.Clear();
+        if (!IsOpen()) {
+            error = "No binary tree is open";
+            return false;
+        }
+
+        Data::NodeStore& nodes = document.GetNodes();
+        Data::StringTable& strings = nodes.GetStrings();
+
+        // Intern every pooled string once; node labels then only take references
+        std::vector<Data::StringId> interned(m_Header.StringCount);
+        for (uint32_t i = 0; i < m_Header.StringCount; ++i) interned[i] = strings.Intern(GetString(i));
+        auto lookup = [&](uint32_t string) { return string < interned.size() ? interned[string] : Data::EmptyString; };
+
+        // Saved ids are kept unless they are so sparse that restoring them
+        // would allocate far more slots than the file has nodes
+        uint32_t maxId = 0;
+        for (uint32_t i = 0; i < m_Header.NodeCount; ++i) maxId = std::max(maxId, m_Nodes[i].Id);
+        bool keepIds = maxId != Data::InvalidNode && maxId < std::max<uint64_t>(uint64_t(m_Header.NodeCount) * 4, MinSparseIdLimit);
+        nodes.Reserve(keepIds ? maxId + 1 : m_Header.NodeCount);
+
+        // Pass 1: create every node under its saved id
+        std::vector<Data::NodeId> ids(m_Header.NodeCount);
+        bool ok = true;
+        for (uint32_t i = 0; i < m_Header.NodeCount && ok; ++i) {
+            const BinaryNode& record = m_Nodes[i];
+            Data::NodeType type = Data::NodeType(record.Type & 3);
+            Data::NodeId id = keepIds ? nodes.CreateWithId(record.Id, {}, type) : nodes.Create({}, type);
+            if (id == Data::InvalidNode) {
+                error = "Duplicate node id " + std::to_string(record.Id);
+                ok = false;
+                break;
+            }
+            ids[i] = id;
+            nodes.SetLabelId(id, lookup(record.Label));
+            nodes.SetShape(id, Data::ShapeType(record.Shape & 3));
+            nodes.SetColor(id, { record.R, record.G, record.B });
+            nodes.SetPosition(id, m_X[i], m_Y[i]);
+            nodes.ReserveChildren(id, GetChildCount(i));
+        }
+
+        // Pass 2: link children. Pre-order puts every child after its parent,
+        // so with one parent per record and NodeCount - 1 links the records
+        // form a single tree rooted at record 0
+        uint32_t linked = 0;
+        for (uint32_t i = 0; i < m_Header.NodeCount && ok; ++i) {
+            const BinaryNode& record = m_Nodes[i];
+            for (uint32_t slot = 0, count = GetChildCount(i); slot < count; ++slot) {
+                uint32_t child = m_Children[record.FirstChild + slot];
+                if (child <= i || child >= m_Header.NodeCount || nodes.GetParent(ids[child]) != Data::InvalidNode) {
+                    error = "Binary tree file has an invalid child list";
+                    ok = false;
+                    break;
+                }
+                nodes.InsertChildWithLabelId(ids[i], ids[child], slot, lookup(m_EdgeLabels[record.FirstChild + slot]));
+                ++linked;
+            }
+        }
+        if (ok && linked != m_Header.NodeCount - 1) {
+            error = "Binary tree file contains unreachable nodes";
+            ok = false;
+        }
+
+        for (Data::StringId string : interned) strings.Release(string);
+        if (!ok) {
+            document.Clear();
+            return false;
+        }
+        document.SetRoot(ids[0]);
+        return true;
+    }
+
+}
@@ -0,0 +1,84 @@
+/**
+ * BinaryTreeView.h
+ * Zero-copy read access to a memory-mapped binary tree file
+ *
+ * Opening a view maps the file and checks the header; no node is parsed
+ * or copied. Labels, child lists and positions are read straight from the
+ * mapping, so a large tree can be browsed and drawn right after opening.
+ * Materialize() turns the view into a regular editable Document.
+ */
+
+#pragma once
+
+#include "BinaryFormat.h"
+#include "MappedFile.h"
+#include "../Data/Document.h"
+#include <string>
+#include <string_view>
+
+namespace IO {
+
+    /**
+     * @class BinaryTreeView
+     * @brief Read-only tree backed by a mapped .dtb file
+     *
+     * Records are addressed by their index in the node table (0 is the
+     * root). Accessors are bounds-checked against the mapped sections, so a
+     * truncated or corrupt file yields empty labels and missing children
+     * rather than reads outside the mapping.
+     */
+    class BinaryTreeView {
+    public:
+        BinaryTreeView();
+
+        /**
+         * @brief Map a file and validate its header and section bounds
+         * @param error Receives a description of the problem on failure
+         */
+        bool Open(const std::string& path, std::string& error);
+
+        /**
+         * @brief Read an image already in memory (not owned; must outlive the view)
+         * @param data Start of the image, 8-byte aligned
+         * @param size Bytes available at data
+         */
+        bool Attach(const uint8_t* data, uint64_t size, std::string& error);
+        void Close();
+        bool IsOpen() const { return m_Nodes != nullptr; }
+
+        uint32_t GetNodeCount() const { return m_Header.NodeCount; }
+        const BinaryNode& GetNode(uint32_t index) const { return m_Nodes[index]; }
+        std::string_view GetLabel(uint32_t index) const { return GetString(m_Nodes[index].Label); }
+        float GetX(uint32_t index) const { return m_X[index]; }
+        float GetY(uint32_t index) const { return m_Y[index]; }
+        const float* GetXData() const { return m_X; }
+        const float* GetYData() const { return m_Y; }
+
+        uint32_t GetChildCount(uint32_t index) const;
+        uint32_t GetChild(uint32_t index, uint32_t slot) const;   ///< Record index of a child
+        std::string_view GetEdgeLabel(uint32_t index, uint32_t slot) const;
+        std::string_view GetString(uint32_t string) const;
+
+        /**
+         * @brief Copy the whole tree into a document, keeping the saved NodeIds
+         * @param document Document to fill (cleared first)
+         * @param error Receives a description of the problem on failure
+         *
+         * Each distinct string is interned once and every node's child range
+         * is sized exactly, so this is a single linear pass over the file.
+         */
+        bool Materialize(Data::Document& document, std::string& error) const;
+
+    private:
+        MappedFile m_File;
+        BinaryHeader m_Header;
+        const BinaryNode* m_Nodes;
+        const uint32_t* m_Children;
+        const uint32_t* m_EdgeLabels;
+        const uint32_t* m_StringOffsets;
+        const char* m_StringData;
+        const float* m_X;
+        const float* m_Y;
+    };
+
+}
@@ -0,0 +1,154 @@
+/**
+ * CsvReader.cpp
+ * Implementation of the CsvReader class
+ */
+
+#include "CsvReader.h"
+#include <cstring>
+
+namespace IO {
+
+    namespace {
+
+        constexpr size_t NoRecordEnd = static_cast<size_t>(-1);
+
+    }
+
+    CsvReader::CsvReader(size_t bufferSize)
+        : m_Buffer(bufferSize > 0 ? bufferSize : 1), m_Begin(0), m_End(0), m_File(nullptr), m_Consumed(0), m_Line(0), m_Delimiter(','), m_Progress(nullptr) {
+    }
+
+    bool CsvReader::ParseFile(const std::string& path, CsvHandler& handler) {
+        m_File = std::fopen(path.c_str(), "rb");
+        if (!m_File) {
+            m_Error = "Cannot open " + path;
+            return false;
+        }
+        if (m_Progress && std::fseek(m_File, 0, SEEK_END) == 0) {
+            long size = std::ftell(m_File);
+            if (size > 0) m_Progress->SetTotal(static_cast<uint64_t>(size));
+            std::fseek(m_File, 0, SEEK_SET);
+        }
+        m_Begin = m_End = 0;
+        m_Consumed = 0;
+        m_Line = 1;
+        m_Error.clear();
+
+        // Skip a UTF-8 byte order mark
+        bool atEnd = !Refill();
+        if (m_End - m_Begin >= 3 && std::memcmp(m_Buffer.data() + m_Begin, "\xEF\xBB\xBF", 3) == 0) m_Begin += 3;
+
+        bool ok = true;
+        size_t scanned = m_Begin;   // Bytes of the pending record already searched for its end
+        while (ok) {
+            size_t recordEnd = FindRecordEnd(scanned, atEnd);
+            if (recordEnd == NoRecordEnd) {
+                if (atEnd) break;
+                // Incomplete record: Refill() moves it to the front of the buffer
+                scanned = m_End - m_Begin;
+                atEnd = !Refill();
+                if (m_Progress && m_Progress->IsCancelled()) {
+                    m_Error = "Cancelled";
+                    ok = false;
+                    break;
+                }
+                continue;
+            }
+
+            char* begin = m_Buffer.data() + m_Begin;
+            char* end = m_Buffer.data() + recordEnd;
+            uint64_t lines = 1;
+            for (const char* p = begin; p < end; ++p) lines += (*p == '\n');
+
+            // Drop the line break (LF or CRLF) ending the record
+            size_t next = recordEnd < m_End ? recordEnd + 1 : recordEnd;
+            if (end > begin && end[-1] == '\r') --end;
+
+            if (end > begin) {
+                if (!SplitRecord(begin, end)) {
+                    ok = false;
+                } else if (!handler.OnRecord(m_Fields)) {
+                    if (m_Error.empty()) m_Error = "Aborted";
+                    ok = false;
+                }
+            }
+            if (ok) m_Line += lines;
+            m_Begin = next;
+            scanned = next;
+        }
+
+        std::fclose(m_File);
+        m_File = nullptr;
+        return ok;
+    }
+
+    bool CsvReader::Refill() {
+        // Move the pending record to the front, growing the buffer if it fills it
+        size_t pending = m_End - m_Begin;
+        if (m_Begin > 0 && pending > 0) std::memmove(m_Buffer.data(), m_Buffer.data() + m_Begin, pending);
+        m_Begin = 0;
+        m_End = pending;
+        if (m_End == m_Buffer.size()) m_Buffer.resize(m_Buffer.size() * 2);
+
+        size_t count = std::fread(m_Buffer.data() + m_End, 1, m_Buffer.size() - m_End, m_File);
+        m_End += count;
+        m_Consumed += count;
+        if (m_Progress) m_Progress->Report(m_Consumed);
+        return count > 0;
+    }
+
+    size_t CsvReader::FindRecordEnd(size_t from, bool atEnd) const {
+        // A line break ends the record unless it is inside quotes. Quotes
+        // toggle the state, so a doubled quote leaves it unchanged; the
+        // state at 'from' is recomputed from the record start
+        const char* data = m_Buffer.data();
+        bool quoted = false;
+        for (size_t i = m_Begin; i < from; ++i) quoted ^= (data[i] == '"');
+        for (size_t i = from; i < m_End; ++i) {
+            char c = data[i];
+            if (c == '"') quoted = !quoted;
+            else if (c == '\n' && !quoted) return i;
+        }
+        return atEnd && m_End > m_Begin ? m_End : NoRecordEnd;
+    }
+
+    bool CsvReader::SplitRecord(char* begin, char* end) {
+        m_Fields.clear();
+        char* p = begin;
+        while (true) {
+            char* fieldStart = p;
+            if (p < end && *p == '"') {
+                // Quoted: unescape in place; the result is never longer than the input
+                char* out = p;
+                ++p;
+                while (true) {
+                    if (p == end) {
+                        m_Error = "Unterminated quoted field on line " + std::to_string(m_Line);
+                        return false;
+                    }
+                    if (*p == '"') {
+                        if (p + 1 < end && p[1] == '"') {
+                            *out++ = '"';
+                            p += 2;
+                            continue;
+                        }
+                        ++p;
+                        break;
+                    }
+                    *out++ = *p++;
+                }
+                if (p < end && *p != m_Delimiter) {
+                    m_Error = "Unexpected character after a quoted field on line " + std::to_string(m_Line);
+                    return false;
+                }
+                m_Fields.emplace_back(fieldStart, static_cast<size_t>(out - fieldStart));
+            } else {
+                while (p < end && *p != m_Delimiter) ++p;
+                m_Fields.emplace_back(fieldStart, static_cast<size_t>(p - fieldStart));
+            }
+            if (p == end) return true;
+            ++p;   // Delimiter
+        }
+    }
+
+}
@@ -0,0 +1,83 @@
+/**
+ * CsvReader.h
+ * Streaming CSV parser
+ *
+ * Reads comma-separated values (RFC 4180: quoted fields, doubled quotes,
+ * line breaks inside quotes, CRLF or LF line ends) through a buffer and
+ * hands each record to a handler as a list of field views. Fields point
+ * into the buffer, where quoted fields are unescaped in place, so parsing
+ * copies no field text.
+ */
+
+#pragma once
+
+#include "Progress.h"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace IO {
+
+    /**
+     * @class CsvHandler
+     * @brief Receives the records of a CSV file in order
+     */
+    class CsvHandler {
+    public:
+        virtual ~CsvHandler() = default;
+
+        /**
+         * @brief Called for every non-empty record, the header included
+         * @param fields Field contents; valid only for the duration of the call
+         * @return false to abort parsing
+         */
+        virtual bool OnRecord(const std::vector<std::string_view>& fields) = 0;
+    };
+
+    /**
+     * @class CsvReader
+     * @brief Incremental CSV tokenizer driving a CsvHandler
+     */
+    class CsvReader {
+    public:
+        /**
+         * @param bufferSize Initial buffer size; grows for records longer than this
+         */
+        explicit CsvReader(size_t bufferSize = 1 << 20);
+
+        /**
+         * @brief Parse a whole file
+         * @return false on I/O error, malformed input or handler abort (see GetError())
+         */
+        bool ParseFile(const std::string& path, CsvHandler& handler);
+
+        void SetDelimiter(char delimiter) { m_Delimiter = delimiter; }
+
+        /**
+         * @brief Report bytes read to a progress object and stop when it is cancelled
+         */
+        void SetProgress(Progress* progress) { m_Progress = progress; }
+
+        const std::string& GetError() const { return m_Error; }
+        uint64_t GetLine() const { return m_Line; }   ///< Line the current record starts on (1-based)
+
+    private:
+        std::vector<char> m_Buffer;
+        size_t m_Begin;               ///< Start of the unparsed bytes in m_Buffer
+        size_t m_End;                 ///< End of the valid bytes in m_Buffer
+        std::FILE* m_File;
+        uint64_t m_Consumed;          ///< Bytes read from the file so far
+        uint64_t m_Line;
+        char m_Delimiter;
+        Progress* m_Progress;         ///< Optional progress sink (not owned)
+        std::vector<std::string_view> m_Fields;
+        std::string m_Error;
+
+        bool Refill();
+        size_t FindRecordEnd(size_t from, bool atEnd) const;
+        bool SplitRecord(char* begin, char* end);
+    };
+
+}
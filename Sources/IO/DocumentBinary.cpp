@@ -0,0 +1,302 @@
+/**
+ * DocumentBinary.cpp
+ * Implementation of the binary tree loader and writer
+ */
+
+#include "DocumentBinary.h"
+#include "BinaryFormat.h"
+#include "BinaryTreeView.h"
+#include "DocumentCsv.h"
+#include "DocumentJson.h"
+#include "../Data/Traversal.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace IO {
+
+    namespace {
+
+        uint64_t AlignSection(uint64_t offset) {
+            return (offset + 7) & ~uint64_t(7);
+        }
+
+        /// Bytes written between progress reports
+        constexpr size_t ProgressChunk = 1 << 20;
+
+        constexpr const char* ImportOnlyError = "Rule tables can only be imported; save as .json or .dtb";
+
+        /**
+         * @brief Writes sections sequentially, padding up to each section offset
+         */
+        class SectionWriter {
+        public:
+            SectionWriter(std::FILE* file, Progress* progress) : m_File(file), m_Progress(progress), m_Offset(0), m_Failed(false) {}
+
+            void Seek(uint64_t offset) {
+                static const char zeros[8] = {};
+                while (m_Offset < offset) Write(zeros, std::min<uint64_t>(offset - m_Offset, sizeof(zeros)));
+            }
+
+            void Write(const void* data, size_t size) {
+                if (!m_Progress) {
+                    if (size > 0 && std::fwrite(data, 1, size, m_File) != size) m_Failed = true;
+                    m_Offset += size;
+                    return;
+                }
+
+                // Large sections go out in chunks so that progress keeps moving
+                const char* bytes = static_cast<const char*>(data);
+                while (size > 0 && !m_Failed) {
+                    size_t chunk = std::min(size, ProgressChunk);
+                    if (std::fwrite(bytes, 1, chunk, m_File) != chunk || !m_Progress->Report(m_Offset + chunk)) m_Failed = true;
+                    bytes += chunk;
+                    size -= chunk;
+                    m_Offset += chunk;
+                }
+            }
+
+            bool Failed() const { return m_Failed; }
+
+        private:
+            std::FILE* m_File;
+            Progress* m_Progress;
+            uint64_t m_Offset;
+            bool m_Failed;
+        };
+
+        /**
+         * @brief In-memory form of a binary file, built from a document or snapshot
+         */
+        class BinaryImage {
+        public:
+            BinaryImage() : m_StringOffsets{ 0, 0 } {
+                m_Pool.emplace(std::string_view(), 0);
+            }
+
+            /// Append a record (fields other than the child range filled by the caller)
+            BinaryNode& AddNode(float x, float y) {
+                BinaryNode& record = m_Records.emplace_back();
+                record.FirstChild = static_cast<uint32_t>(m_Children.size());
+                m_X.push_back(x);
+                m_Y.push_back(y);
+                return record;
+            }
+
+            void AddChild(uint32_t record, std::string_view edgeLabel) {
+                m_Children.push_back(record);
+                m_EdgeLabels.push_back(AddString(edgeLabel));
+            }
+
+            /// Pool index of a string; each distinct string is stored once
+            uint32_t AddString(std::string_view text) {
+                auto [it, inserted] = m_Pool.emplace(text, static_cast<uint32_t>(m_StringOffsets.size() - 1));
+                if (inserted) {
+                    m_StringData.append(text);
+                    m_StringOffsets.push_back(static_cast<uint32_t>(m_StringData.size()));
+                }
+                return it->second;
+            }
+
+            std::vector<BinaryNode>& GetRecords() { return m_Records; }
+
+            bool Write(std::FILE* file, Progress* progress = nullptr) const {
+                uint32_t nodeCount = static_cast<uint32_t>(m_Records.size());
+                BinaryHeader header = {};
+                std::memcpy(header.Magic, BinaryMagic, sizeof(BinaryMagic));
+                header.Version = BinaryVersion;
+                header.NodeCount = nodeCount;
+                header.ChildCount = static_cast<uint32_t>(m_Children.size());
+                header.StringCount = static_cast<uint32_t>(m_StringOffsets.size() - 1);
+                header.NodesOffset = AlignSection(sizeof(BinaryHeader));
+                header.ChildrenOffset = AlignSection(header.NodesOffset + uint64_t(nodeCount) * sizeof(BinaryNode));
+                header.EdgeLabelsOffset = AlignSection(header.ChildrenOffset + m_Children.size() * sizeof(uint32_t));
+                header.StringOffsetsOffset = AlignSection(header.EdgeLabelsOffset + m_EdgeLabels.size() * sizeof(uint32_t));
+                header.StringDataOffset = AlignSection(header.StringOffsetsOffset + m_StringOffsets.size() * sizeof(uint32_t));
+                header.StringDataSize = m_StringData.size();
+                header.LayoutOffset = AlignSection(header.StringDataOffset + m_StringData.size());
+
+                if (progress) progress->SetTotal(header.LayoutOffset + (m_X.size() + m_Y.size()) * sizeof(float));
+                SectionWriter writer(file, progress);
+                writer.Write(&header, sizeof(header));
+                writer.Seek(header.NodesOffset);
+                writer.Write(m_Records.data(), m_Records.size() * sizeof(BinaryNode));
+                writer.Seek(header.ChildrenOffset);
+                writer.Write(m_Children.data(), m_Children.size() * sizeof(uint32_t));
+                writer.Seek(header.EdgeLabelsOffset);
+                writer.Write(m_EdgeLabels.data(), m_EdgeLabels.size() * sizeof(uint32_t));
+                writer.Seek(header.StringOffsetsOffset);
+                writer.Write(m_StringOffsets.data(), m_StringOffsets.size() * sizeof(uint32_t));
+                writer.Seek(header.StringDataOffset);
+                writer.Write(m_StringData.data(), m_StringData.size());
+                writer.Seek(header.LayoutOffset);
+                writer.Write(m_X.data(), m_X.size() * sizeof(float));
+                writer.Write(m_Y.data(), m_Y.size() * sizeof(float));
+                return !writer.Failed();
+            }
+
+        private:
+            std::vector<BinaryNode> m_Records;
+            std::vector<uint32_t> m_Children;
+            std::vector<uint32_t> m_EdgeLabels;
+            std::vector<uint32_t> m_StringOffsets;
+            std::string m_StringData;
+            std::unordered_map<std::string_view, uint32_t> m_Pool;
+            std::vector<float> m_X, m_Y;
+        };
+
+        void FillRecord(BinaryNode& record, Data::NodeId id, uint32_t label, uint32_t childCount, uint32_t subtreeSize,
+                        Data::NodeType type, Data::ShapeType shape, Data::Color color) {
+            record.Id = id;
+            record.Label = label;
+            record.ChildCount = childCount;
+            record.SubtreeSize = subtreeSize;
+            record.Type = static_cast<uint8_t>(type);
+            record.Shape = static_cast<uint8_t>(shape);
+            record.R = color.R;
+            record.G = color.G;
+            record.B = color.B;
+        }
+
+        void BuildImage(const Data::Document& document, BinaryImage& image) {
+            const Data::NodeStore& nodes = document.GetNodes();
+            Data::NodeId root = document.GetRoot();
+
+            // Pre-order record index of every node by id
+            std::vector<uint32_t> recordOf(nodes.GetCapacity(), 0);
+            uint32_t nodeCount = 0;
+            Data::PreOrder(nodes, root, [&](Data::NodeId id, uint32_t) { recordOf[id] = nodeCount++; });
+            image.GetRecords().reserve(nodeCount);
+
+            Data::PreOrder(nodes, root, [&](Data::NodeId id, uint32_t) {
+                BinaryNode& record = image.AddNode(nodes.GetX(id), nodes.GetY(id));
+                uint32_t childCount = nodes.GetChildCount(id);
+                FillRecord(record, id, image.AddString(nodes.GetLabel(id)), childCount, 1, nodes.GetType(id), nodes.GetShape(id), nodes.GetColor(id));
+                for (uint32_t slot = 0; slot < childCount; ++slot) image.AddChild(recordOf[nodes.GetChild(id, slot)], nodes.GetEdgeLabel(id, slot));
+            });
+
+            // Subtree sizes: children follow their parent, so a reverse sweep sees them first
+            std::vector<BinaryNode>& records = image.GetRecords();
+            for (uint32_t i = nodeCount; i-- > 1;) {
+                records[recordOf[nodes.GetParent(records[i].Id)]].SubtreeSize += records[i].SubtreeSize;
+            }
+        }
+
+        void BuildImage(const Data::Snapshot& snapshot, BinaryImage& image) {
+            image.GetRecords().reserve(snapshot.GetNodeCount());
+            // Snapshots keep offsets from the parent; the positions of the current path, by depth
+            std::vector<std::pair<double, double>> path;
+            Data::PreOrder(Data::SnapshotAccess{}, snapshot.GetRoot(), [&](const Data::SnapshotNode* node, uint32_t depth) {
+                path.resize(depth + 1);
+                path[depth] = depth > 0 ? std::make_pair(path[depth - 1].first + node->X, path[depth - 1].second + node->Y)
+                                        : std::make_pair(node->X, node->Y);
+
+                // Pre-order: the first child follows its parent, each later one follows its elder sibling's subtree
+                uint32_t index = static_cast<uint32_t>(image.GetRecords().size());
+                BinaryNode& record = image.AddNode(float(path[depth].first), float(path[depth].second));
+                FillRecord(record, node->Id, image.AddString(node->Label), static_cast<uint32_t>(node->Children.size()),
+                           node->SubtreeSize, node->Type, node->Shape, node->Color);
+                uint32_t child = index + 1;
+                for (const Data::SnapshotEdge& edge : node->Children) {
+                    image.AddChild(child, edge.Label);
+                    child += edge.Target->SubtreeSize;
+                }
+            });
+        }
+
+        template<typename Source>
+        bool SaveImage(const std::string& path, const Source& source, std::string& error, Progress* progress) {
+            BinaryImage image;
+            BuildImage(source, image);
+            if (progress && progress->IsCancelled()) {
+                error = "Cancelled";
+                return false;
+            }
+            std::FILE* file = std::fopen(path.c_str(), "wb");
+            if (!file) {
+                error = "Cannot create " + path;
+                return false;
+            }
+            bool ok = image.Write(file, progress);
+            if (std::fclose(file) != 0) ok = false;
+            if (!ok && progress && progress->IsCancelled()) {
+                // Nothing half-written is left behind
+                std::remove(path.c_str());
+                error = "Cancelled";
+            } else if (!ok) {
+                error = "Write failed";
+            }
+            return ok;
+        }
+
+    }
+
+    bool SaveBinary(const std::string& path, const Data::Document& document, std::string& error) {
+        if (!document.GetNodes().IsAlive(document.GetRoot())) {
+            error = "Document has no root node";
+            return false;
+        }
+        return SaveImage(path, document, error, nullptr);
+    }
+
+    bool SaveBinary(const std::string& path, const Data::Snapshot& snapshot, std::string& error, Progress* progress) {
+        if (!snapshot.GetRoot()) {
+            error = "Snapshot is empty";
+            return false;
+        }
+        return SaveImage(path, snapshot, error, progress);
+    }
+
+    bool WriteBinary(std::FILE* file, const Data::Snapshot& snapshot) {
+        if (!snapshot.GetRoot()) return false;
+        BinaryImage image;
+        BuildImage(snapshot, image);
+        return image.Write(file);
+    }
+
+    bool LoadBinary(const std::string& path, Data::Document& document, std::string& error) {
+        BinaryTreeView view;
+        if (!view.Open(path, error)) {
+            document.Clear();
+            return false;
+        }
+        return view.Materialize(document, error);
+    }
+
+    bool IsBinaryPath(const std::string& path) {
+        return path.size() >= 4 && path.compare(path.size() - 4, 4, ".dtb") == 0;
+    }
+
+    bool LoadDocument(const std::string& path, Data::Document& document, std::string& error, Progress* progress) {
+        if (IsBinaryPath(path)) return LoadBinary(path, document, error);
+        if (IsCsvPath(path)) return ImportCsv(path, document, error, progress);
+        return LoadJson(path, document, error, progress);
+    }
+
+    bool SaveDocument(const std::string& path, const Data::Document& document, std::string& error) {
+        if (IsCsvPath(path)) {
+            error = ImportOnlyError;
+            return false;
+        }
+        return IsBinaryPath(path) ? SaveBinary(path, document, error) : SaveJson(path, document, error);
+    }
+
+    bool SaveDocument(const std::string& path, const Data::Snapshot& snapshot, std::string& error, Progress* progress) {
+        if (IsCsvPath(path)) {
+            error = ImportOnlyError;
+            return false;
+        }
+        return IsBinaryPath(path) ? SaveBinary(path, snapshot, error, progress) : SaveJson(path, snapshot, error, progress);
+    }
+
+    bool ConvertFile(const std::string& input, const std::string& output, std::string& error) {
+        Data::Document document;
+        if (!LoadDocument(input, document, error)) return false;
+        return SaveDocument(output, document, error);
+    }
+
+}
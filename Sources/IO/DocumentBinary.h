@@ -0,0 +1,80 @@
+/**
+ * DocumentBinary.h
+ * Loading and saving documents in the compact binary format (.dtb)
+ *
+ * See BinaryFormat.h for the file layout. Saving writes the tree in
+ * pre-order with a deduplicated string pool; loading maps the file and
+ * materializes it in one linear pass. For browsing without building a
+ * document at all, open a BinaryTreeView instead.
+ */
+
+#pragma once
+
+#include "Progress.h"
+#include "../Data/Document.h"
+#include "../Data/Snapshot.h"
+#include <cstdio>
+#include <string>
+
+namespace IO {
+
+    /**
+     * @brief Write a document's tree to a binary file
+     * @param path File to create or overwrite
+     * @param document Document to write
+     * @param error Receives a description of the problem on failure
+     */
+    bool SaveBinary(const std::string& path, const Data::Document& document, std::string& error);
+
+    /**
+     * @brief Write a snapshot to a binary file (safe on any thread)
+     * @param progress Optional; receives bytes written and can cancel the save
+     */
+    bool SaveBinary(const std::string& path, const Data::Snapshot& snapshot, std::string& error, Progress* progress = nullptr);
+
+    /**
+     * @brief Write a snapshot as a binary image at the current file position
+     * @return false if the snapshot is empty or a write failed
+     *
+     * Section offsets are relative to the start of the image, which must be
+     * 8-byte aligned for the image to be read in place (see BinaryTreeView::Attach).
+     */
+    bool WriteBinary(std::FILE* file, const Data::Snapshot& snapshot);
+
+    /**
+     * @brief Replace a document's contents with a tree read from a binary file
+     * @return true on success; on failure the document is left empty
+     */
+    bool LoadBinary(const std::string& path, Data::Document& document, std::string& error);
+
+    /**
+     * @brief True if a path names a binary tree file (by its .dtb extension)
+     */
+    bool IsBinaryPath(const std::string& path);
+
+    /**
+     * @brief Load a document from JSON, binary or a CSV rule table, chosen by extension
+     * @param progress Optional; JSON and CSV loads report bytes read and can be cancelled
+     */
+    bool LoadDocument(const std::string& path, Data::Document& document, std::string& error, Progress* progress = nullptr);
+
+    /**
+     * @brief Save a document as JSON or binary, chosen by extension
+     *
+     * CSV rule tables are import-only; saving to a .csv path fails.
+     */
+    bool SaveDocument(const std::string& path, const Data::Document& document, std::string& error);
+
+    /**
+     * @brief Save a snapshot as JSON or binary, chosen by extension (safe on any thread)
+     */
+    bool SaveDocument(const std::string& path, const Data::Snapshot& snapshot, std::string& error, Progress* progress = nullptr);
+
+    /**
+     * @brief Convert between DecisionTree.json and .dtb files, or import a .csv rule table
+     * @param input Source file (format chosen by extension)
+     * @param output Destination file (format chosen by extension)
+     */
+    bool ConvertFile(const std::string& input, const std::string& output, std::string& error);
+
+}
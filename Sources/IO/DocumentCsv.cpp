@@ -0,0 +1,260 @@
+/**
+ * DocumentCsv.cpp
+ * Implementation of the CSV rule table importer
+ */
+
+#include "DocumentCsv.h"
+#include "CsvReader.h"
+#include <chrono>
+#include <vector>
+
+namespace IO {
+
+    namespace {
+
+        constexpr float LeafSpacing = 160.0f;
+        constexpr float LevelSpacing = 150.0f;
+        constexpr float RootY = 100.0f;
+
+        std::string_view Trim(std::string_view text) {
+            size_t begin = 0, end = text.size();
+            while (begin < end && (text[begin] == ' ' || text[begin] == '\t')) ++begin;
+            while (end > begin && (text[end - 1] == ' ' || text[end - 1] == '\t')) --end;
+            return text.substr(begin, end - begin);
+        }
+
+        /**
+         * @brief Child lookup by (parent, edge label), open addressing in one flat array
+         *
+         * Every row probes it once per condition column, so lookups must not
+         * chase per-node allocations the way std::unordered_map does.
+         */
+        class BranchIndex {
+        public:
+            BranchIndex() : m_Slots(1024, Slot{ EmptyKey, 0 }), m_Count(0) {}
+
+            /**
+             * @brief Find the child under key, or insert 'child' there
+             * @return The existing child, or 'child' if it was inserted
+             */
+            uint32_t FindOrInsert(uint64_t key, uint32_t child) {
+                if ((m_Count + 1) * 2 > m_Slots.size()) Grow();
+                size_t mask = m_Slots.size() - 1;
+                for (size_t i = Hash(key) & mask;; i = (i + 1) & mask) {
+                    Slot& slot = m_Slots[i];
+                    if (slot.Key == key) return slot.Child;
+                    if (slot.Key == EmptyKey) {
+                        slot = { key, child };
+                        ++m_Count;
+                        return child;
+                    }
+                }
+            }
+
+        private:
+            static constexpr uint64_t EmptyKey = ~uint64_t(0);
+
+            struct Slot {
+                uint64_t Key;
+                uint32_t Child;
+            };
+
+            std::vector<Slot> m_Slots;   ///< Power-of-two size, at most half full
+            size_t m_Count;
+
+            static size_t Hash(uint64_t key) {
+                return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 32);
+            }
+
+            void Grow() {
+                std::vector<Slot> old(m_Slots.size() * 2, Slot{ EmptyKey, 0 });
+                old.swap(m_Slots);
+                size_t mask = m_Slots.size() - 1;
+                for (const Slot& slot : old) {
+                    if (slot.Key == EmptyKey) continue;
+                    size_t i = Hash(slot.Key) & mask;
+                    while (m_Slots[i].Key != EmptyKey) i = (i + 1) & mask;
+                    m_Slots[i] = slot;
+                }
+            }
+        };
+
+        /**
+         * @brief Merges rule rows into a flat prefix tree
+         *
+         * Entries are appended in order of first appearance, so a parent
+         * always precedes its children and siblings keep the table's order.
+         * Every entry holds one reference to its edge and node labels in the
+         * document's string table until the nodes are built.
+         */
+        class RuleTableHandler : public CsvHandler {
+        public:
+            struct Entry {
+                uint32_t Parent;
+                Data::StringId Edge;
+                Data::StringId Label;
+                Data::NodeType Type;
+                uint32_t ChildCount;
+            };
+
+            RuleTableHandler(Data::StringTable& strings, CsvImportStats& stats)
+                : m_Strings(strings), m_Stats(stats) {}
+
+            ~RuleTableHandler() override {
+                for (Data::StringId id : m_Headers) m_Strings.Release(id);
+                for (const Entry& entry : m_Entries) {
+                    m_Strings.Release(entry.Edge);
+                    m_Strings.Release(entry.Label);
+                }
+            }
+
+            const std::string& GetError() const { return m_Error; }
+            const std::vector<Entry>& GetEntries() const { return m_Entries; }
+
+            bool OnRecord(const std::vector<std::string_view>& fields) override {
+                if (m_Headers.empty()) return ReadHeader(fields);
+                if (fields.size() != m_Headers.size()) {
+                    m_Error = "Expected " + std::to_string(m_Headers.size()) + " fields, found " + std::to_string(fields.size());
+                    return false;
+                }
+                ++m_Stats.Rows;
+
+                // Walk down the conditions, adding the branches this rule is the first to use
+                size_t conditions = fields.size() - 1;
+                uint32_t node = 0;
+                for (size_t column = 0; column < conditions; ++column) {
+                    std::string_view cell = Trim(fields[column]);
+                    Data::StringId edge = m_Strings.Intern(cell.empty() ? std::string_view("*") : cell);
+                    uint32_t child = static_cast<uint32_t>(m_Entries.size());
+                    uint32_t found = m_Branches.FindOrInsert((static_cast<uint64_t>(node) << 32) | edge, child);
+                    if (found != child) {
+                        m_Strings.Release(edge);
+                        node = found;
+                        if (column + 1 == conditions) return CheckOutcome(node, Trim(fields[conditions]));
+                        continue;
+                    }
+
+                    if (column + 1 < conditions) {
+                        m_Strings.Retain(m_Headers[column + 1]);
+                        m_Entries.push_back({ node, edge, m_Headers[column + 1], Data::NodeType::Condition, 0 });
+                    } else {
+                        m_Entries.push_back({ node, edge, m_Strings.Intern(Trim(fields[conditions])), Data::NodeType::Action, 0 });
+                    }
+                    ++m_Entries[node].ChildCount;
+                    node = child;
+                }
+                return true;
+            }
+
+        private:
+            Data::StringTable& m_Strings;
+            CsvImportStats& m_Stats;
+            std::vector<Data::StringId> m_Headers;                ///< Column names, referenced
+            std::vector<Entry> m_Entries;                         ///< Entry 0 is the root
+            BranchIndex m_Branches;                               ///< (parent entry << 32 | edge label) to child entry
+            std::string m_Error;
+
+            bool ReadHeader(const std::vector<std::string_view>& fields) {
+                if (fields.size() < 2) {
+                    m_Error = "A rule table needs at least one condition column and an outcome column";
+                    return false;
+                }
+                for (std::string_view field : fields) m_Headers.push_back(m_Strings.Intern(Trim(field)));
+                m_Strings.Retain(m_Headers[0]);
+                m_Entries.push_back({ 0, m_Strings.Intern(""), m_Headers[0], Data::NodeType::Condition, 0 });
+                return true;
+            }
+
+            bool CheckOutcome(uint32_t leaf, std::string_view outcome) {
+                Data::StringId label = m_Strings.Intern(outcome);
+                if (label == m_Entries[leaf].Label) ++m_Stats.DuplicateRules;
+                else ++m_Stats.ConflictingRules;
+                m_Strings.Release(label);
+                return true;
+            }
+        };
+
+        /**
+         * @brief Place every leaf in its own column and center parents over their leaves
+         * @param entries Prefix tree, parents before children
+         * @param ids Node created for each entry
+         */
+        void LayOut(Data::NodeStore& nodes, const std::vector<RuleTableHandler::Entry>& entries, const std::vector<Data::NodeId>& ids) {
+            size_t count = entries.size();
+
+            // Leaves under each entry, summed from the last entry back to the root
+            std::vector<uint32_t> leaves(count, 0);
+            for (size_t i = count; i-- > 0;) {
+                if (entries[i].ChildCount == 0) leaves[i] = 1;
+                if (i > 0) leaves[entries[i].Parent] += leaves[i];
+            }
+
+            // First leaf column and depth of each entry; a child starts where
+            // its parent's previous child ended, tracked in 'next'
+            std::vector<uint32_t> first(count, 0), next(count, 0), depth(count, 0);
+            for (size_t i = 0; i < count; ++i) {
+                if (i > 0) {
+                    uint32_t parent = entries[i].Parent;
+                    first[i] = next[parent];
+                    next[parent] += leaves[i];
+                    depth[i] = depth[parent] + 1;
+                }
+                next[i] = first[i];
+                float x = (first[i] + (leaves[i] - 1) * 0.5f) * LeafSpacing;
+                nodes.SetPosition(ids[i], x, RootY + depth[i] * LevelSpacing);
+            }
+        }
+
+    }
+
+    bool ImportCsv(const std::string& path, Data::Document& document, std::string& error, Progress* progress, CsvImportStats* stats) {
+        auto start = std::chrono::steady_clock::now();
+        document.Clear();
+
+        Data::NodeStore& nodes = document.GetNodes();
+        CsvImportStats localStats;
+        CsvImportStats& result = stats ? *stats : localStats;
+        result = CsvImportStats();
+
+        RuleTableHandler handler(nodes.GetStrings(), result);
+        CsvReader reader;
+        reader.SetProgress(progress);
+        if (!reader.ParseFile(path, handler)) {
+            if (progress && progress->IsCancelled()) error = "Cancelled";
+            else if (!handler.GetError().empty()) error = handler.GetError() + " on line " + std::to_string(reader.GetLine());
+            else error = reader.GetError();
+            return false;
+        }
+        const std::vector<RuleTableHandler::Entry>& entries = handler.GetEntries();
+        if (entries.empty()) {
+            error = "Rule table has no header row";
+            return false;
+        }
+
+        // One pass over the prefix tree: every node and child range sized exactly
+        nodes.Reserve(entries.size());
+        std::vector<Data::NodeId> ids(entries.size());
+        for (size_t i = 0; i < entries.size(); ++i) {
+            const RuleTableHandler::Entry& entry = entries[i];
+            Data::NodeId id = nodes.Create("", entry.Type);
+            nodes.SetLabelId(id, entry.Label);
+            if (entry.ChildCount > 0) nodes.ReserveChildren(id, entry.ChildCount);
+            if (i > 0) {
+                Data::NodeId parent = ids[entry.Parent];
+                nodes.InsertChildWithLabelId(parent, id, nodes.GetChildCount(parent), entry.Edge);
+            }
+            ids[i] = id;
+        }
+        document.SetRoot(ids[0]);
+        LayOut(nodes, entries, ids);
+
+        result.Nodes = static_cast<uint32_t>(entries.size());
+        result.Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return true;
+    }
+
+    bool IsCsvPath(const std::string& path) {
+        return path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0;
+    }
+
+}
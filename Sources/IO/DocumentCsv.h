@@ -0,0 +1,68 @@
+/**
+ * DocumentCsv.h
+ * Building decision trees from CSV rule tables
+ *
+ * Format: a header row naming the condition columns followed by one outcome
+ * column, then one rule per row:
+ *
+ *   Weather,Wind,Decision
+ *   Sunny,Weak,Play
+ *   Sunny,Strong,Stay home
+ *   Rain,,Stay home
+ *
+ * The root is a Condition labeled with the first header. Each cell is the
+ * label of the edge leading to the next column's Condition, and the last
+ * condition cell leads to an Action labeled with the row's outcome. Rows
+ * sharing a prefix of condition values share those branches, so the table
+ * above becomes one "Sunny" branch with two children. An empty cell is the
+ * edge "*" (any value). Surrounding spaces are trimmed from every cell.
+ *
+ * A row repeating an earlier row's conditions adds nothing: it is counted
+ * as a duplicate if its outcome matches and as a conflict otherwise (the
+ * first outcome is kept).
+ */
+
+#pragma once
+
+#include "Progress.h"
+#include "../Data/Document.h"
+#include <cstdint>
+#include <string>
+
+namespace IO {
+
+    /**
+     * @brief What a CSV import did
+     */
+    struct CsvImportStats {
+        uint64_t Rows = 0;               ///< Rules read, the header excluded
+        uint32_t Nodes = 0;              ///< Nodes in the built tree
+        uint64_t DuplicateRules = 0;     ///< Rows repeating an earlier rule
+        uint64_t ConflictingRules = 0;   ///< Rows whose conditions match an earlier rule with another outcome
+        double Seconds = 0.0;            ///< Wall time of the whole import
+
+        double GetRowsPerSecond() const { return Seconds > 0.0 ? Rows / Seconds : 0.0; }
+    };
+
+    /**
+     * @brief Replace a document's contents with the tree described by a rule table
+     * @param path CSV file to read
+     * @param document Document to fill (cleared first)
+     * @param error Receives a description of the problem on failure
+     * @param progress Optional; receives bytes read and can cancel the import
+     * @param stats Optional; receives row and node counts and timing
+     * @return true on success; on failure the document is left empty
+     *
+     * Rows are merged into a flat prefix tree as they stream in; the nodes
+     * are then created in one pass with exactly sized storage and laid out
+     * with every leaf in its own column.
+     */
+    bool ImportCsv(const std::string& path, Data::Document& document, std::string& error,
+                   Progress* progress = nullptr, CsvImportStats* stats = nullptr);
+
+    /**
+     * @brief True if a path names a CSV rule table (by its .csv extension)
+     */
+    bool IsCsvPath(const std::string& path);
+
+}
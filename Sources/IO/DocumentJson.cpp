@@ -0,0 +1,441 @@
+/**
+ * DocumentJson.cpp
+ * Implementation of the DecisionTree.json loader and writer
+ */
+
+#include "DocumentJson.h"
+#include "JsonReader.h"
+#include "JsonWriter.h"
+#include "../Data/Traversal.h"
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+namespace IO {
+
+    namespace {
+
+        constexpr int FormatVersion = 1;
+        constexpr double MaxReserveHint = 1 << 24;   ///< Size hints above this are not trusted
+
+        enum class Key : uint8_t {
+            None, Unknown, Format, Version, NodeCount, Root,
+            Label, Type, Shape, Color, X, Y, ChildCount, Children, Edge
+        };
+
+        Key LookupKey(std::string_view key) {
+            // Short keys, few candidates: a length switch avoids hashing
+            switch (key.size()) {
+                case 1:
+                    if (key == "x") return Key::X;
+                    if (key == "y") return Key::Y;
+                    break;
+                case 4:
+                    if (key == "type") return Key::Type;
+                    if (key == "edge") return Key::Edge;
+                    if (key == "root") return Key::Root;
+                    break;
+                case 5:
+                    if (key == "label") return Key::Label;
+                    if (key == "shape") return Key::Shape;
+                    if (key == "color") return Key::Color;
+                    break;
+                case 6:
+                    if (key == "format") return Key::Format;
+                    break;
+                case 7:
+                    if (key == "version") return Key::Version;
+                    break;
+                case 8:
+                    if (key == "children") return Key::Children;
+                    break;
+                case 9:
+                    if (key == "nodeCount") return Key::NodeCount;
+                    break;
+                case 10:
+                    if (key == "childCount") return Key::ChildCount;
+                    break;
+            }
+            return Key::Unknown;
+        }
+
+        /**
+         * @brief Builds document nodes directly from the JSON token stream
+         */
+        class DocumentHandler : public JsonHandler {
+        public:
+            explicit DocumentHandler(Data::Document& document)
+                : m_Document(document), m_Nodes(document.GetNodes()), m_Key(Key::None) {}
+
+            const std::string& GetError() const { return m_Error; }
+
+            bool OnBeginObject() override {
+                Data::NodeId parent = Data::InvalidNode;
+                if (m_Stack.empty()) {
+                    m_Stack.push_back({ Context::Top });
+                    return true;
+                }
+
+                Frame& top = m_Stack.back();
+                if (top.Kind == Context::Top && m_Key == Key::Root) {
+                    if (m_Document.GetRoot() != Data::InvalidNode) return Fail("Duplicate \"root\"");
+                } else if (top.Kind == Context::Children) {
+                    parent = top.Node;
+                } else {
+                    m_Stack.push_back({ Context::Skip });
+                    return true;
+                }
+
+                Data::NodeId node = m_Nodes.Create("", Data::NodeType::Action);
+                if (parent == Data::InvalidNode) m_Document.SetRoot(node);
+                else m_Nodes.AddChild(parent, node);
+
+                Frame frame = { Context::Node };
+                frame.Node = node;
+                m_Stack.push_back(frame);
+                m_Key = Key::None;
+                return true;
+            }
+
+            bool OnEndObject() override {
+                Frame frame = m_Stack.back();
+                m_Stack.pop_back();
+                if (frame.Kind != Context::Node) return true;
+
+                // Fill in whatever style the file did not specify
+                if (!frame.HasShape || !frame.HasColor) {
+                    Data::ShapeType shape;
+                    Data::Color color;
+                    Data::GetDefaultStyle(m_Nodes.GetType(frame.Node), shape, color.R, color.G, color.B);
+                    if (!frame.HasShape) m_Nodes.SetShape(frame.Node, shape);
+                    if (!frame.HasColor) m_Nodes.SetColor(frame.Node, color);
+                }
+                return true;
+            }
+
+            bool OnBeginArray() override {
+                Frame frame = { Context::Skip };
+                if (!m_Stack.empty() && m_Stack.back().Kind == Context::Node) {
+                    if (m_Key == Key::Children) frame.Kind = Context::Children;
+                    else if (m_Key == Key::Color) frame.Kind = Context::Color;
+                    frame.Node = m_Stack.back().Node;
+                }
+                m_Stack.push_back(frame);
+                return true;
+            }
+
+            bool OnEndArray() override {
+                Frame frame = m_Stack.back();
+                m_Stack.pop_back();
+                if (frame.Kind == Context::Color) {
+                    m_Nodes.SetColor(frame.Node, frame.Color);
+                    m_Stack.back().HasColor = true;
+                }
+                return true;
+            }
+
+            bool OnKey(std::string_view key) override {
+                Context context = m_Stack.back().Kind;
+                m_Key = (context == Context::Top || context == Context::Node) ? LookupKey(key) : Key::Unknown;
+                return true;
+            }
+
+            bool OnString(std::string_view value) override {
+                if (m_Stack.empty()) return Fail("Expected a JSON object");
+                Frame& top = m_Stack.back();
+                if (top.Kind == Context::Top) {
+                    if (m_Key == Key::Format && value != "DecisionTree") return Fail("Not a DecisionTree document");
+                    return true;
+                }
+                if (top.Kind != Context::Node) return true;
+
+                Data::NodeId node = top.Node;
+                switch (m_Key) {
+                    case Key::Label:
+                        m_Nodes.SetLabel(node, value);
+                        break;
+                    case Key::Edge: {
+                        Data::NodeId parent = m_Nodes.GetParent(node);
+                        if (parent != Data::InvalidNode) m_Nodes.SetEdgeLabel(parent, m_Nodes.GetSlot(node), value);
+                        break;
+                    }
+                    case Key::Type: {
+                        Data::NodeType type;
+                        if (!ParseTypeName(value, type)) return Fail("Unknown node type");
+                        m_Nodes.SetType(node, type);
+                        break;
+                    }
+                    case Key::Shape: {
+                        Data::ShapeType shape;
+                        if (!ParseShapeName(value, shape)) return Fail("Unknown node shape");
+                        m_Nodes.SetShape(node, shape);
+                        top.HasShape = true;
+                        break;
+                    }
+                    default:
+                        break;
+                }
+                return true;
+            }
+
+            bool OnNumber(double value) override {
+                if (m_Stack.empty()) return Fail("Expected a JSON object");
+                Frame& top = m_Stack.back();
+                switch (top.Kind) {
+                    case Context::Top:
+                        if (m_Key == Key::Version && value > FormatVersion) return Fail("Unsupported format version");
+                        if (m_Key == Key::NodeCount && value > 0 && value <= MaxReserveHint) m_Nodes.Reserve(static_cast<size_t>(value));
+                        break;
+                    case Context::Node:
+                        if (m_Key == Key::X) m_Nodes.SetPosition(top.Node, static_cast<float>(value), m_Nodes.GetY(top.Node));
+                        else if (m_Key == Key::Y) m_Nodes.SetPosition(top.Node, m_Nodes.GetX(top.Node), static_cast<float>(value));
+                        else if (m_Key == Key::ChildCount && value > 0 && value <= MaxReserveHint) m_Nodes.ReserveChildren(top.Node, static_cast<uint32_t>(value));
+                        break;
+                    case Context::Color: {
+                        uint8_t component = static_cast<uint8_t>(std::clamp(value, 0.0, 255.0));
+                        if (top.ColorIndex == 0) top.Color.R = component;
+                        else if (top.ColorIndex == 1) top.Color.G = component;
+                        else if (top.ColorIndex == 2) top.Color.B = component;
+                        ++top.ColorIndex;
+                        break;
+                    }
+                    default:
+                        break;
+                }
+                return true;
+            }
+
+        private:
+            enum class Context : uint8_t { Top, Node, Children, Color, Skip };
+
+            struct Frame {
+                Context Kind;
+                Data::NodeId Node = Data::InvalidNode;
+                bool HasShape = false;
+                bool HasColor = false;
+                uint8_t ColorIndex = 0;
+                Data::Color Color = { 0, 0, 0 };
+            };
+
+            Data::Document& m_Document;
+            Data::NodeStore& m_Nodes;
+            std::vector<Frame> m_Stack;
+            Key m_Key;
+            std::string m_Error;
+
+            bool Fail(const char* message) {
+                m_Error = message;
+                return false;
+            }
+        };
+
+        /// Node fields for WriteTree(), read from a document's store
+        struct StoreSource {
+            using Node = Data::NodeId;
+            static constexpr Data::NodeId Null = Data::InvalidNode;
+            const Data::NodeStore& Nodes;
+
+            uint32_t ChildCount(Node node) const { return Nodes.GetChildCount(node); }
+            Node Child(Node node, uint32_t slot) const { return Nodes.GetChild(node, slot); }
+            std::string_view EdgeLabel(Node node, uint32_t slot) const { return Nodes.GetEdgeLabel(node, slot); }
+            std::string_view Label(Node node) const { return Nodes.GetLabel(node); }
+            Data::NodeType Type(Node node) const { return Nodes.GetType(node); }
+            Data::ShapeType Shape(Node node) const { return Nodes.GetShape(node); }
+            Data::Color Color(Node node) const { return Nodes.GetColor(node); }
+            double X(Node node, double /*parentX*/) const { return Nodes.GetX(node); }
+            double Y(Node node, double /*parentY*/) const { return Nodes.GetY(node); }
+        };
+
+        /// Node fields for WriteTree(), read from a snapshot (safe on any thread)
+        struct SnapshotSource {
+            using Node = const Data::SnapshotNode*;
+            static constexpr const Data::SnapshotNode* Null = nullptr;
+
+            uint32_t ChildCount(Node node) const { return static_cast<uint32_t>(node->Children.size()); }
+            Node Child(Node node, uint32_t slot) const { return node->Children[slot].Target; }
+            std::string_view EdgeLabel(Node node, uint32_t slot) const { return node->Children[slot].Label; }
+            std::string_view Label(Node node) const { return node->Label; }
+            Data::NodeType Type(Node node) const { return node->Type; }
+            Data::ShapeType Shape(Node node) const { return node->Shape; }
+            Data::Color Color(Node node) const { return node->Color; }
+            double X(Node node, double parentX) const { return parentX + node->X; }   // Snapshots keep offsets from the parent
+            double Y(Node node, double parentY) const { return parentY + node->Y; }
+        };
+
+        /// Nodes written between progress reports
+        constexpr uint32_t ProgressInterval = 4096;
+
+        template<typename Source>
+        bool WriteTree(const std::string& path, const Source& source, typename Source::Node root, uint32_t nodeCount,
+                       Progress* progress, std::string& error) {
+            JsonWriter writer;
+            if (!writer.Open(path)) {
+                error = writer.GetError();
+                return false;
+            }
+            if (progress) progress->SetTotal(nodeCount);
+
+            writer.BeginObject();
+            writer.Key("format");
+            writer.String("DecisionTree");
+            writer.Key("version");
+            writer.Integer(FormatVersion);
+            writer.Key("nodeCount");
+            writer.Integer(nodeCount);
+
+            // Writes a node's fields and opens its child list; closed when the
+            // node is popped from the stack below
+            auto openNode = [&](typename Source::Node node, const std::string_view* edge, double x, double y) {
+                writer.BeginObject();
+                if (edge) {
+                    writer.Key("edge");
+                    writer.String(*edge);
+                }
+                writer.Key("label");
+                writer.String(source.Label(node));
+                writer.Key("type");
+                writer.String(GetTypeName(source.Type(node)));
+                writer.Key("shape");
+                writer.String(GetShapeName(source.Shape(node)));
+                Data::Color color = source.Color(node);
+                writer.Key("color");
+                writer.BeginArray();
+                writer.Integer(color.R);
+                writer.Integer(color.G);
+                writer.Integer(color.B);
+                writer.EndArray();
+                writer.Key("x");
+                writer.Number(float(x));
+                writer.Key("y");
+                writer.Number(float(y));
+                if (source.ChildCount(node) > 0) {
+                    writer.Key("childCount");
+                    writer.Integer(source.ChildCount(node));
+                    writer.Key("children");
+                    writer.BeginArray();
+                }
+            };
+
+            bool cancelled = false;
+            if (root != Source::Null) {
+                struct Frame {
+                    typename Source::Node Node;
+                    uint32_t NextChild;
+                    double X, Y;
+                };
+                std::vector<Frame> stack;
+                uint32_t written = 1;
+                writer.Key("root");
+                double rootX = source.X(root, 0.0), rootY = source.Y(root, 0.0);
+                openNode(root, nullptr, rootX, rootY);
+                stack.push_back({ root, 0, rootX, rootY });
+                while (!stack.empty()) {
+                    Frame& top = stack.back();
+                    if (top.NextChild < source.ChildCount(top.Node)) {
+                        uint32_t slot = top.NextChild++;
+                        std::string_view edge = source.EdgeLabel(top.Node, slot);
+                        typename Source::Node child = source.Child(top.Node, slot);
+                        double x = source.X(child, top.X), y = source.Y(child, top.Y);
+                        openNode(child, &edge, x, y);
+                        stack.push_back({ child, 0, x, y });
+                        if (progress && ++written % ProgressInterval == 0 && !progress->Report(written)) {
+                            cancelled = true;
+                            break;
+                        }
+                        continue;
+                    }
+                    if (source.ChildCount(top.Node) > 0) writer.EndArray();
+                    writer.EndObject();
+                    stack.pop_back();
+                }
+            }
+
+            writer.EndObject();
+            writer.NewLine();
+            bool closed = writer.Close();
+            if (cancelled) {
+                // Nothing half-written is left behind
+                std::remove(path.c_str());
+                error = "Cancelled";
+                return false;
+            }
+            if (!closed) {
+                error = writer.GetError();
+                return false;
+            }
+            if (progress) progress->Report(nodeCount);
+            return true;
+        }
+
+    }
+
+    bool LoadJson(const std::string& path, Data::Document& document, std::string& error, Progress* progress) {
+        document.Clear();
+
+        DocumentHandler handler(document);
+        JsonReader reader;
+        reader.SetProgress(progress);
+        if (!reader.ParseFile(path, handler)) {
+            if (progress && progress->IsCancelled()) error = "Cancelled";
+            else error = handler.GetError().empty() ? reader.GetError() : handler.GetError() + " at byte " + std::to_string(reader.GetBytesRead());
+            document.Clear();
+            return false;
+        }
+        if (document.GetRoot() == Data::InvalidNode) {
+            error = "Document has no \"root\" node";
+            return false;
+        }
+        return true;
+    }
+
+    bool SaveJson(const std::string& path, const Data::Document& document, std::string& error, Progress* progress) {
+        const Data::NodeStore& nodes = document.GetNodes();
+        Data::NodeId root = document.GetRoot();
+        uint32_t nodeCount = 0;
+        if (nodes.IsAlive(root)) Data::PreOrder(nodes, root, [&](Data::NodeId, uint32_t) { ++nodeCount; });
+        return WriteTree(path, StoreSource{ nodes }, nodes.IsAlive(root) ? root : Data::InvalidNode, nodeCount, progress, error);
+    }
+
+    bool SaveJson(const std::string& path, const Data::Snapshot& snapshot, std::string& error, Progress* progress) {
+        return WriteTree(path, SnapshotSource{}, snapshot.GetRoot(), snapshot.GetNodeCount(), progress, error);
+    }
+
+    const char* GetTypeName(Data::NodeType type) {
+        switch (type) {
+            case Data::NodeType::Start: return "Start";
+            case Data::NodeType::Action: return "Action";
+            case Data::NodeType::Condition: return "Condition";
+            case Data::NodeType::End: return "End";
+        }
+        return "Action";
+    }
+
+    const char* GetShapeName(Data::ShapeType shape) {
+        switch (shape) {
+            case Data::ShapeType::Circle: return "Circle";
+            case Data::ShapeType::Rectangle: return "Rectangle";
+            case Data::ShapeType::Diamond: return "Diamond";
+            case Data::ShapeType::Capsule: return "Capsule";
+        }
+        return "Rectangle";
+    }
+
+    bool ParseTypeName(std::string_view name, Data::NodeType& type) {
+        if (name == "Start") type = Data::NodeType::Start;
+        else if (name == "Action") type = Data::NodeType::Action;
+        else if (name == "Condition") type = Data::NodeType::Condition;
+        else if (name == "End") type = Data::NodeType::End;
+        else return false;
+        return true;
+    }
+
+    bool ParseShapeName(std::string_view name, Data::ShapeType& shape) {
+        if (name == "Circle") shape = Data::ShapeType::Circle;
+        else if (name == "Rectangle") shape = Data::ShapeType::Rectangle;
+        else if (name == "Diamond") shape = Data::ShapeType::Diamond;
+        else if (name == "Capsule") shape = Data::ShapeType::Capsule;
+        else return false;
+        return true;
+    }
+
+}
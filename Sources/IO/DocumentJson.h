@@ -0,0 +1,60 @@
+/**
+ * DocumentJson.h
+ * Loading and saving documents in the DecisionTree.json format
+ *
+ * Format (version 1):
+ *   { "format": "DecisionTree", "version": 1, "nodeCount": N,
+ *     "root": { "label": "...", "type": "Condition", "shape": "Diamond",
+ *               "color": [r, g, b], "x": 0, "y": 0, "childCount": 2,
+ *               "children": [ { "edge": "Yes", "label": ... }, ... ] } }
+ *
+ * Children carry the label of the edge leading to them in "edge". Only
+ * "label" is required; a missing type defaults to Action and a missing
+ * shape or color to the type's default style. "nodeCount" and "childCount"
+ * are optional hints that let the loader size its storage exactly.
+ */
+
+#pragma once
+
+#include "Progress.h"
+#include "../Data/Document.h"
+#include "../Data/Snapshot.h"
+#include <string>
+
+namespace IO {
+
+    /**
+     * @brief Replace a document's contents with a tree read from a JSON file
+     * @param path File to read
+     * @param document Document to fill (cleared first)
+     * @param error Receives a description of the problem on failure
+     * @param progress Optional; receives bytes read and can cancel the load
+     * @return true on success; on failure the document is left empty
+     *
+     * Nodes are created directly from the token stream; the file is never
+     * held in memory as a whole.
+     */
+    bool LoadJson(const std::string& path, Data::Document& document, std::string& error, Progress* progress = nullptr);
+
+    /**
+     * @brief Write a document's tree to a JSON file
+     * @param path File to create or overwrite
+     * @param document Document to write
+     * @param error Receives a description of the problem on failure
+     * @param progress Optional; receives nodes written and can cancel the save
+     *
+     * A cancelled save removes the partly written file.
+     */
+    bool SaveJson(const std::string& path, const Data::Document& document, std::string& error, Progress* progress = nullptr);
+
+    /**
+     * @brief Write a snapshot to a JSON file (safe on any thread)
+     */
+    bool SaveJson(const std::string& path, const Data::Snapshot& snapshot, std::string& error, Progress* progress = nullptr);
+
+    const char* GetTypeName(Data::NodeType type);
+    const char* GetShapeName(Data::ShapeType shape);
+    bool ParseTypeName(std::string_view name, Data::NodeType& type);
+    bool ParseShapeName(std::string_view name, Data::ShapeType& shape);
+
+}
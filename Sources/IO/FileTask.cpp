@@ -0,0 +1,87 @@
+/**
+ * FileTask.cpp
+ * Implementation of the FileTask class
+ */
+
+#include "FileTask.h"
+#include "DocumentBinary.h"
+#include "DocumentCsv.h"
+#include "DocumentJson.h"
+#include "Journal.h"
+#include <cstdio>
+#include <filesystem>
+
+namespace IO {
+
+    FileTask::FileTask(Work work) : m_Succeeded(false), m_Finished(false) {
+        m_Thread = std::thread([this, work = std::move(work)]() {
+            m_Succeeded = work(m_Progress, m_Error);
+            if (!m_Succeeded && m_Error.empty()) m_Error = "Failed";
+            m_Finished.store(true, std::memory_order_release);
+        });
+    }
+
+    FileTask::~FileTask() {
+        Cancel();
+        Wait();
+    }
+
+    void FileTask::Wait() {
+        if (m_Thread.joinable()) m_Thread.join();
+    }
+
+    std::unique_ptr<FileTask> FileTask::Load(const std::string& path) {
+        auto document = std::make_unique<Data::Document>();
+        Data::Document* target = document.get();
+        auto task = std::make_unique<FileTask>([path, target](Progress& progress, std::string& error) {
+            if (!LoadDocument(path, *target, error, &progress)) return false;
+            // Built here rather than by the journal's first checkpoint on the editing thread
+            target->TakeSnapshot();
+            return true;
+        });
+        // The worker only uses the document itself, never this pointer
+        task->m_Document = std::move(document);
+        return task;
+    }
+
+    std::unique_ptr<FileTask> FileTask::Recover(const std::string& journalPath) {
+        auto document = std::make_unique<Data::Document>();
+        Data::Document* target = document.get();
+        auto replayed = std::make_shared<uint32_t>(0);
+        auto task = std::make_unique<FileTask>([journalPath, target, replayed](Progress& progress, std::string& error) {
+            if (!Journal::Recover(journalPath, *target, error, replayed.get())) return false;
+            // Replay cannot be interrupted; a cancelled recovery is only discarded
+            if (progress.IsCancelled()) {
+                error = "Cancelled";
+                return false;
+            }
+            target->TakeSnapshot();
+            return true;
+        });
+        task->m_Document = std::move(document);
+        task->m_RecordsReplayed = std::move(replayed);
+        return task;
+    }
+
+    std::unique_ptr<FileTask> FileTask::Save(const std::string& path, Data::Snapshot snapshot) {
+        return std::make_unique<FileTask>([path, snapshot = std::move(snapshot)](Progress& progress, std::string& error) {
+            if (IsCsvPath(path)) {
+                error = "Rule tables can only be imported; save as .json or .dtb";
+                return false;
+            }
+            // The format follows the target name, not the temporary one
+            std::string temporary = path + ".tmp";
+            bool ok = IsBinaryPath(path) ? SaveBinary(temporary, snapshot, error, &progress)
+                                         : SaveJson(temporary, snapshot, error, &progress);
+            if (ok) {
+                std::error_code renameError;
+                std::filesystem::rename(temporary, path, renameError);
+                if (!renameError) return true;
+                error = "Cannot replace " + path + ": " + renameError.message();
+            }
+            std::remove(temporary.c_str());
+            return false;
+        });
+    }
+
+}
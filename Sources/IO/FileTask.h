@@ -0,0 +1,91 @@
+/**
+ * FileTask.h
+ * Document loading and saving on a background thread
+ *
+ * A FileTask runs one load or save on its own thread while the editor keeps
+ * drawing. The editing thread polls IsFinished() once per frame, reads the
+ * progress for display and may cancel. Saves write a snapshot, so editing
+ * can continue during the save, and go through a temporary file that only
+ * replaces the target once complete: a failed or cancelled save leaves the
+ * previous file untouched. A loaded document is built on the worker and
+ * handed over by pointer, never copied, along with its first snapshot, so
+ * that the editing thread can start a journal on it in O(1).
+ */
+
+#pragma once
+
+#include "Progress.h"
+#include "../Data/Document.h"
+#include "../Data/Snapshot.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace IO {
+
+    /**
+     * @class FileTask
+     * @brief A load or save running on a worker thread
+     *
+     * Results (Succeeded(), GetError(), TakeDocument()) may only be read
+     * once IsFinished() has returned true. Destroying an unfinished task
+     * cancels it and waits for the worker.
+     */
+    class FileTask {
+    public:
+        using Work = std::function<bool(Progress& progress, std::string& error)>;
+
+        /**
+         * @brief Run arbitrary file work on a new thread
+         * @param work Called on the worker; reports through the progress and
+         *        should return false with error "Cancelled" once it is cancelled
+         */
+        explicit FileTask(Work work);
+        ~FileTask();
+
+        FileTask(const FileTask&) = delete;
+        FileTask& operator=(const FileTask&) = delete;
+
+        /**
+         * @brief Load a JSON, binary or CSV rule table file (by extension) into a new document
+         */
+        static std::unique_ptr<FileTask> Load(const std::string& path);
+
+        /**
+         * @brief Rebuild a document from the checkpoint and records of a journal
+         */
+        static std::unique_ptr<FileTask> Recover(const std::string& journalPath);
+
+        /**
+         * @brief Save a snapshot as JSON or binary (by extension of path)
+         */
+        static std::unique_ptr<FileTask> Save(const std::string& path, Data::Snapshot snapshot);
+
+        bool IsFinished() const { return m_Finished.load(std::memory_order_acquire); }
+        void Wait();
+        void Cancel() { m_Progress.Cancel(); }
+        bool WasCancelled() const { return m_Progress.IsCancelled(); }
+
+        float GetProgress() const { return m_Progress.GetFraction(); }   ///< Negative while the total is unknown
+        bool Succeeded() const { return m_Succeeded; }
+        const std::string& GetError() const { return m_Error; }
+
+        /**
+         * @brief Take the document read by a finished Load() task
+         */
+        std::unique_ptr<Data::Document> TakeDocument() { return std::move(m_Document); }
+        uint32_t GetRecordsReplayed() const { return m_RecordsReplayed ? *m_RecordsReplayed : 0; }   ///< Records a finished Recover() task applied
+
+    private:
+        Progress m_Progress;
+        std::unique_ptr<Data::Document> m_Document;   ///< Filled by Load() and Recover() tasks
+        std::shared_ptr<uint32_t> m_RecordsReplayed;   ///< Filled by Recover() tasks
+        bool m_Succeeded;
+        std::string m_Error;
+        std::atomic<bool> m_Finished;
+        std::thread m_Thread;
+    };
+
+}
@@ -0,0 +1,454 @@
+/**
+ * Journal.cpp
+ * Implementation of the Journal class
+ */
+
+#include "Journal.h"
+#include "BinaryFormat.h"
+#include "BinaryTreeView.h"
+#include "DocumentBinary.h"
+#include "MappedFile.h"
+#include "../Data/Traversal.h"
+#include "../Data/TreeLayout.h"
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace IO {
+
+    namespace {
+
+        constexpr char JournalMagic[8] = { 'D', 'T', 'J', 'O', 'U', 'R', 'N', 'L' };
+        constexpr uint32_t JournalVersion = 1;
+        constexpr size_t RecordHeaderSize = 8;                     ///< Payload size and checksum
+        constexpr size_t FlushBytes = 256 * 1024;                  ///< Wake the writer early past this much
+        constexpr std::chrono::milliseconds FlushInterval{ 100 };  ///< Longest a record waits in memory
+
+        struct JournalHeader {
+            char Magic[8];
+            uint32_t Version;
+            uint32_t Reserved;
+            uint64_t CheckpointSize;   ///< Bytes of the checkpoint image (0: empty tree)
+        };
+        static_assert(sizeof(JournalHeader) % 8 == 0, "The checkpoint image must start 8-byte aligned");
+
+        enum RecordType : uint8_t {
+            RecordCreate = 1,
+            RecordDelete = 2,
+            RecordMove = 3,
+            RecordRelabel = 4,
+            RecordLayout = 5,      ///< Replayed by laying the subtree out again
+            RecordPlacement = 6    ///< Position of every node of a subtree, in pre-order
+        };
+
+        uint32_t Checksum(const uint8_t* data, size_t size) {
+            // FNV-1a: enough to tell a torn write from a complete record
+            uint32_t hash = 2166136261u;
+            for (size_t i = 0; i < size; ++i) {
+                hash ^= data[i];
+                hash *= 16777619u;
+            }
+            return hash;
+        }
+
+        uint64_t AlignRecords(uint64_t offset) {
+            return (offset + 7) & ~uint64_t(7);
+        }
+
+        bool SyncFile(std::FILE* file) {
+            if (std::fflush(file) != 0) return false;
+#ifdef _WIN32
+            return _commit(_fileno(file)) == 0;
+#else
+            return fsync(fileno(file)) == 0;
+#endif
+        }
+
+        /**
+         * @brief Bounds-checked reader over one record payload
+         */
+        struct RecordReader {
+            const uint8_t* Pos;
+            const uint8_t* End;
+
+            template<typename T>
+            bool Get(T& value) {
+                if (size_t(End - Pos) < sizeof(T)) return false;
+                std::memcpy(&value, Pos, sizeof(T));
+                Pos += sizeof(T);
+                return true;
+            }
+
+            bool GetString(std::string_view& text) {
+                uint32_t length;
+                if (!Get(length) || size_t(End - Pos) < length) return false;
+                text = std::string_view(reinterpret_cast<const char*>(Pos), length);
+                Pos += length;
+                return true;
+            }
+        };
+
+        /// Apply one record; false if it does not fit the document (it is skipped)
+        bool ApplyRecord(RecordReader reader, Data::Document& document, Data::TreeLayout& layout) {
+            Data::NodeStore& nodes = document.GetNodes();
+            uint8_t type;
+            Data::NodeId id;
+            if (!reader.Get(type) || !reader.Get(id)) return false;
+
+            switch (type) {
+                case RecordCreate: {
+                    Data::NodeId parent;
+                    uint32_t slot;
+                    uint8_t nodeType, shape;
+                    Data::Color color;
+                    float x, y;
+                    std::string_view edge, label;
+                    if (!reader.Get(parent) || !reader.Get(slot) || !reader.Get(nodeType) || !reader.Get(shape)
+                        || !reader.Get(color.R) || !reader.Get(color.G) || !reader.Get(color.B)
+                        || !reader.Get(x) || !reader.Get(y) || !reader.GetString(edge) || !reader.GetString(label)) {
+                        return false;
+                    }
+                    bool isRoot = parent == Data::InvalidNode;
+                    if (isRoot ? document.GetRoot() != Data::InvalidNode : !nodes.IsLive(parent)) return false;
+                    if (nodes.CreateWithId(id, label, Data::NodeType(nodeType & 3)) == Data::InvalidNode) return false;
+                    nodes.SetShape(id, Data::ShapeType(shape & 3));
+                    nodes.SetColor(id, color);
+                    nodes.SetPosition(id, x, y);
+                    if (isRoot) document.SetRoot(id);
+                    else nodes.InsertChild(parent, id, slot, edge);
+                    return true;
+                }
+                case RecordDelete:
+                    if (!nodes.IsLive(id) || id == document.GetRoot()) return false;
+                    return document.DeleteSubtree(id);
+                case RecordMove: {
+                    float dx, dy;
+                    if (!reader.Get(dx) || !reader.Get(dy) || !nodes.IsLive(id)) return false;
+                    document.MoveSubtree(id, dx, dy);
+                    return true;
+                }
+                case RecordRelabel: {
+                    std::string_view label;
+                    if (!reader.GetString(label) || !nodes.IsLive(id)) return false;
+                    nodes.SetLabel(id, label);
+                    return true;
+                }
+                case RecordLayout: {
+                    float x, y;
+                    if (!reader.Get(x) || !reader.Get(y) || !nodes.IsLive(id)) return false;
+                    layout.Apply(id, x, y);
+                    return true;
+                }
+                case RecordPlacement: {
+                    if (!nodes.IsLive(id)) return false;
+                    Data::PreOrder(nodes, id, [&](Data::NodeId node, uint32_t) {
+                        float x, y;
+                        if (reader.Get(x) && reader.Get(y)) nodes.SetPosition(node, x, y);
+                    });
+                    return true;
+                }
+            }
+            return false;
+        }
+
+    }
+
+    Journal::Journal()
+        : m_HasCheckpoint(false), m_CheckpointAt(0), m_Stopping(false), m_RecordCount(0), m_BytesSinceCheckpoint(0),
+          m_CompactionBytes(DefaultCompactionBytes), m_File(nullptr) {
+    }
+
+    Journal::~Journal() {
+        Stop(false);
+    }
+
+    void Journal::Start(const std::string& path, const Data::Snapshot& base) {
+        Stop(false);
+        m_Path = path;
+        m_Pending.clear();
+        m_Checkpoint = base;
+        m_HasCheckpoint = true;
+        m_CheckpointAt = 0;
+        m_Stopping = false;
+        m_RecordCount = 0;
+        m_BytesSinceCheckpoint = 0;
+        m_LastCheckpoint = std::chrono::steady_clock::now();
+        m_Thread = std::thread(&Journal::Run, this);
+    }
+
+    void Journal::Stop(bool removeFile) {
+        if (!m_Thread.joinable()) return;
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Stopping = true;
+        }
+        m_Wake.notify_one();
+        m_Thread.join();
+
+        if (removeFile) {
+            std::error_code ignored;
+            std::filesystem::remove(m_Path, ignored);
+        }
+    }
+
+    void Journal::AppendCreate(const Data::NodeStore& nodes, Data::NodeId node) {
+        Data::NodeId parent = nodes.GetParent(node);
+        uint32_t slot = nodes.GetSlot(node);
+        Data::Color color = nodes.GetColor(node);
+        BeginRecord(RecordCreate);
+        Put(node);
+        Put(parent);
+        Put(slot);
+        Put(static_cast<uint8_t>(nodes.GetType(node)));
+        Put(static_cast<uint8_t>(nodes.GetShape(node)));
+        Put(color.R);
+        Put(color.G);
+        Put(color.B);
+        Put(nodes.GetX(node));
+        Put(nodes.GetY(node));
+        PutString(parent != Data::InvalidNode ? nodes.GetEdgeLabel(parent, slot) : std::string_view());
+        PutString(nodes.GetLabel(node));
+        EndRecord();
+    }
+
+    void Journal::AppendSubtree(const Data::NodeStore& nodes, Data::NodeId root) {
+        // Parents first and children in slot order, so each record finds its parent on replay
+        Data::PreOrder(nodes, root, [&](Data::NodeId id, uint32_t) { AppendCreate(nodes, id); });
+    }
+
+    void Journal::AppendDelete(Data::NodeId node) {
+        BeginRecord(RecordDelete);
+        Put(node);
+        EndRecord();
+    }
+
+    void Journal::AppendMove(Data::NodeId node, float dx, float dy) {
+        BeginRecord(RecordMove);
+        Put(node);
+        Put(dx);
+        Put(dy);
+        EndRecord();
+    }
+
+    void Journal::AppendRelabel(Data::NodeId node, std::string_view label) {
+        BeginRecord(RecordRelabel);
+        Put(node);
+        PutString(label);
+        EndRecord();
+    }
+
+    void Journal::AppendLayout(Data::NodeId root, float x, float y) {
+        BeginRecord(RecordLayout);
+        Put(root);
+        Put(x);
+        Put(y);
+        EndRecord();
+    }
+
+    void Journal::AppendPlacement(const Data::NodeStore& nodes, Data::NodeId root) {
+        BeginRecord(RecordPlacement);
+        Put(root);
+        Data::PreOrder(nodes, root, [&](Data::NodeId id, uint32_t) {
+            Put(nodes.GetX(id));
+            Put(nodes.GetY(id));
+        });
+        EndRecord();
+    }
+
+    bool Journal::WantsCompaction() const {
+        if (!IsActive() || m_BytesSinceCheckpoint == 0) return false;
+        return m_BytesSinceCheckpoint >= m_CompactionBytes
+            || std::chrono::steady_clock::now() - m_LastCheckpoint >= CompactionInterval;
+    }
+
+    void Journal::Compact(const Data::Snapshot& current) {
+        if (!IsActive()) return;
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Checkpoint = current;
+            m_HasCheckpoint = true;
+            m_CheckpointAt = m_Pending.size();
+        }
+        m_Wake.notify_one();
+        m_BytesSinceCheckpoint = 0;
+        m_LastCheckpoint = std::chrono::steady_clock::now();
+    }
+
+    bool Journal::Recover(const std::string& path, Data::Document& document, std::string& error, uint32_t* replayed) {
+        document.Clear();
+        if (replayed) *replayed = 0;
+
+        MappedFile file;
+        if (!file.Open(path)) {
+            error = "Cannot open " + path;
+            return false;
+        }
+        const uint8_t* data = file.GetData();
+        uint64_t size = file.GetSize();
+        JournalHeader header;
+        if (size < sizeof(JournalHeader)) {
+            error = "Journal is truncated";
+            return false;
+        }
+        std::memcpy(&header, data, sizeof(header));
+        if (std::memcmp(header.Magic, JournalMagic, sizeof(JournalMagic)) != 0 || header.Version > JournalVersion) {
+            error = "Not a journal file";
+            return false;
+        }
+        if (header.CheckpointSize > size - sizeof(JournalHeader)) {
+            error = "Journal checkpoint is truncated";
+            return false;
+        }
+
+        if (header.CheckpointSize > 0) {
+            BinaryTreeView checkpoint;
+            if (!checkpoint.Attach(data + sizeof(JournalHeader), header.CheckpointSize, error)
+                || !checkpoint.Materialize(document, error)) {
+                error = "Journal checkpoint: " + error;
+                return false;
+            }
+        }
+
+        // Layout moves are not logged: the editor lays out the edited paths
+        // after each edit, so replay does the same from the checkpoint's
+        // layout, and the subtrees beside those paths move once at the end
+        Data::TreeLayout layout(document.GetNodes());
+        layout.Update();
+
+        // Records up to the first torn or corrupt one
+        uint64_t offset = AlignRecords(sizeof(JournalHeader) + header.CheckpointSize);
+        uint32_t applied = 0;
+        while (offset <= size && size - offset >= RecordHeaderSize) {
+            uint32_t payloadSize, checksum;
+            std::memcpy(&payloadSize, data + offset, sizeof(uint32_t));
+            std::memcpy(&checksum, data + offset + sizeof(uint32_t), sizeof(uint32_t));
+            const uint8_t* payload = data + offset + RecordHeaderSize;
+            if (payloadSize > size - offset - RecordHeaderSize || Checksum(payload, payloadSize) != checksum) break;
+            if (ApplyRecord({ payload, payload + payloadSize }, document, layout)) {
+                layout.Update();
+                ++applied;
+            }
+            offset += RecordHeaderSize + payloadSize;
+        }
+        layout.Resolve();
+        if (replayed) *replayed = applied;
+        return true;
+    }
+
+    void Journal::Run() {
+        std::vector<uint8_t> batch;
+        while (true) {
+            Data::Snapshot checkpoint;
+            bool hasCheckpoint = false;
+            size_t checkpointAt = 0;
+            bool stopping;
+            {
+                std::unique_lock<std::mutex> lock(m_Mutex);
+                m_Wake.wait_for(lock, FlushInterval, [&] { return m_Stopping || m_HasCheckpoint || m_Pending.size() >= FlushBytes; });
+                batch.swap(m_Pending);
+                if (m_HasCheckpoint) {
+                    checkpoint = std::move(m_Checkpoint);
+                    m_Checkpoint = Data::Snapshot();
+                    checkpointAt = m_CheckpointAt;
+                    hasCheckpoint = true;
+                    m_HasCheckpoint = false;
+                }
+                stopping = m_Stopping;
+            }
+
+            // Records queued before the checkpoint are part of it; keep them if it could not be written
+            size_t first = 0;
+            if (hasCheckpoint && WriteCheckpoint(checkpoint)) first = checkpointAt;
+            checkpoint = Data::Snapshot();   // Release the version on this thread, not while holding the lock
+
+            if (m_File && first < batch.size()) {
+                if (std::fwrite(batch.data() + first, 1, batch.size() - first, m_File) != batch.size() - first || std::fflush(m_File) != 0) {
+                    std::cerr << "Journal write failed: " << m_Path << std::endl;
+                }
+            }
+            batch.clear();
+            if (stopping) break;
+        }
+
+        if (m_File) {
+            std::fclose(m_File);
+            m_File = nullptr;
+        }
+    }
+
+    bool Journal::WriteCheckpoint(const Data::Snapshot& snapshot) {
+        // Written beside the journal and renamed over it, so a crash leaves one or the other intact
+        std::string temporary = m_Path + ".tmp";
+        std::FILE* file = std::fopen(temporary.c_str(), "wb");
+        if (!file) {
+            std::cerr << "Cannot create journal checkpoint " << temporary << std::endl;
+            return false;
+        }
+
+        JournalHeader header = {};
+        std::memcpy(header.Magic, JournalMagic, sizeof(JournalMagic));
+        header.Version = JournalVersion;
+        bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+        if (ok && snapshot.GetRoot()) ok = WriteBinary(file, snapshot);
+        if (ok) {
+            long end = std::ftell(file);
+            header.CheckpointSize = end > 0 ? uint64_t(end) - sizeof(header) : 0;
+            static const char zeros[8] = {};
+            size_t padding = size_t(AlignRecords(uint64_t(end)) - uint64_t(end));
+            ok = end > 0 && std::fwrite(zeros, 1, padding, file) == padding
+                && std::fseek(file, 0, SEEK_SET) == 0 && std::fwrite(&header, sizeof(header), 1, file) == 1
+                && SyncFile(file);
+        }
+        if (std::fclose(file) != 0) ok = false;
+
+        std::error_code renameError;
+        if (ok) std::filesystem::rename(temporary, m_Path, renameError);
+        if (!ok || renameError) {
+            std::cerr << "Journal checkpoint failed: " << m_Path << std::endl;
+            std::error_code ignored;
+            std::filesystem::remove(temporary, ignored);
+            return false;
+        }
+
+        // Continue appending to the new file
+        if (m_File) std::fclose(m_File);
+        m_File = std::fopen(m_Path.c_str(), "ab");
+        if (!m_File) std::cerr << "Cannot reopen journal " << m_Path << std::endl;
+        return true;
+    }
+
+    void Journal::BeginRecord(uint8_t type) {
+        m_Record.assign(RecordHeaderSize, 0);
+        Put(type);
+    }
+
+    void Journal::PutString(std::string_view text) {
+        Put(static_cast<uint32_t>(text.size()));
+        m_Record.insert(m_Record.end(), text.begin(), text.end());
+    }
+
+    void Journal::EndRecord() {
+        if (!IsActive()) return;
+        uint32_t payloadSize = static_cast<uint32_t>(m_Record.size() - RecordHeaderSize);
+        uint32_t checksum = Checksum(m_Record.data() + RecordHeaderSize, payloadSize);
+        std::memcpy(m_Record.data(), &payloadSize, sizeof(uint32_t));
+        std::memcpy(m_Record.data() + sizeof(uint32_t), &checksum, sizeof(uint32_t));
+
+        bool wake;
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Pending.insert(m_Pending.end(), m_Record.begin(), m_Record.end());
+            wake = m_Pending.size() >= FlushBytes;
+        }
+        if (wake) m_Wake.notify_one();
+        ++m_RecordCount;
+        m_BytesSinceCheckpoint += m_Record.size();
+    }
+
+}
@@ -0,0 +1,152 @@
+/**
+ * Journal.h
+ * Append-only autosave journal with crash recovery
+ *
+ * A journal file holds a checkpoint of the whole tree (a binary image, see
+ * BinaryFormat.h) followed by one compact record per edit made since. Edits
+ * are queued in memory and written by a background thread, so recording an
+ * edit never touches the disk on the calling thread. Once enough records
+ * have accumulated, Compact() replaces the file with a fresh checkpoint.
+ * Checkpoints are handed over as snapshots, which the document keeps up to
+ * date as it is edited, so neither Start() nor Compact() copies the tree on
+ * the calling thread once its first snapshot exists (FileTask builds it
+ * with the document).
+ *
+ * File layout:
+ *   JournalHeader, checkpoint image (CheckpointSize bytes), padding to 8,
+ *   then records: uint32 payload size, uint32 checksum, payload.
+ *
+ * Replay stops at the first truncated or corrupt record, so a crash in the
+ * middle of a write loses at most the records of the last batch.
+ *
+ * Positions set by the editor's layout after an edit are not logged. Replay
+ * lays out the edited paths after each record as the editor did, so a
+ * recovered tree ends up where it was drawn. A whole layout is one record
+ * that replay lays out again; undoing it logs every position it restores.
+ */
+
+#pragma once
+
+#include "../Data/Document.h"
+#include "../Data/Snapshot.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace IO {
+
+    /**
+     * @class Journal
+     * @brief Background-flushed log of document edits
+     *
+     * Append and Compact calls come from the editing thread; file I/O
+     * happens on the journal's own thread. Records use NodeIds, which are
+     * preserved by the checkpoint, so they replay against the same ids.
+     */
+    class Journal {
+    public:
+        static constexpr uint64_t DefaultCompactionBytes = 4 * 1024 * 1024;   ///< Journal size that triggers a checkpoint
+        static constexpr std::chrono::seconds CompactionInterval{ 60 };        ///< Checkpoint at least this often while editing
+
+        Journal();
+        ~Journal();
+
+        Journal(const Journal&) = delete;
+        Journal& operator=(const Journal&) = delete;
+
+        /**
+         * @brief Start journaling into a file, replacing any existing one
+         * @param path Journal file
+         * @param base Current tree; written as the first checkpoint
+         */
+        void Start(const std::string& path, const Data::Snapshot& base);
+
+        /**
+         * @brief Write pending records and stop the background thread
+         * @param removeFile Delete the journal (the document was saved)
+         */
+        void Stop(bool removeFile);
+
+        bool IsActive() const { return m_Thread.joinable(); }
+        const std::string& GetPath() const { return m_Path; }
+
+        /// Journal file used for a document file
+        static std::string GetPathFor(const std::string& documentPath) { return documentPath + ".journal"; }
+
+        // Edit records (called after the edit has been applied to the store)
+        void AppendCreate(const Data::NodeStore& nodes, Data::NodeId node);
+        void AppendSubtree(const Data::NodeStore& nodes, Data::NodeId root);   ///< Create records for a whole subtree
+        void AppendDelete(Data::NodeId node);
+        void AppendMove(Data::NodeId node, float dx, float dy);
+        void AppendRelabel(Data::NodeId node, std::string_view label);
+        void AppendLayout(Data::NodeId root, float x, float y);                 ///< Whole layout of a subtree, root at (x, y)
+        void AppendPlacement(const Data::NodeStore& nodes, Data::NodeId root);  ///< Current position of every node of a subtree
+
+        uint64_t GetRecordCount() const { return m_RecordCount; }   ///< Records appended since Start()
+
+        /**
+         * @brief Whether enough has been logged since the last checkpoint to compact
+         */
+        bool WantsCompaction() const;
+
+        /**
+         * @brief Replace the journal with a checkpoint of the current tree
+         * @param current Snapshot taken after the most recent appended edit
+         *
+         * Queued records are dropped (the checkpoint already contains them);
+         * the snapshot is written on the background thread.
+         */
+        void Compact(const Data::Snapshot& current);
+
+        void SetCompactionThreshold(uint64_t bytes) { m_CompactionBytes = bytes; }
+
+        /**
+         * @brief Rebuild a document from a journal file
+         * @param path Journal file
+         * @param document Document to fill (cleared first)
+         * @param error Receives a description of the problem on failure
+         * @param replayed Receives the number of records applied over the checkpoint
+         */
+        static bool Recover(const std::string& path, Data::Document& document, std::string& error, uint32_t* replayed = nullptr);
+
+    private:
+        // Shared with the background thread (guarded by m_Mutex)
+        std::mutex m_Mutex;
+        std::condition_variable m_Wake;
+        std::vector<uint8_t> m_Pending;     ///< Encoded records not yet handed to the thread
+        Data::Snapshot m_Checkpoint;        ///< Checkpoint to write before the pending records
+        bool m_HasCheckpoint;
+        size_t m_CheckpointAt;              ///< Bytes of m_Pending queued before the checkpoint
+        bool m_Stopping;
+
+        // Editing thread only
+        std::thread m_Thread;
+        std::string m_Path;
+        std::vector<uint8_t> m_Record;      ///< Scratch buffer for encoding one record
+        uint64_t m_RecordCount;
+        uint64_t m_BytesSinceCheckpoint;
+        uint64_t m_CompactionBytes;
+        std::chrono::steady_clock::time_point m_LastCheckpoint;
+
+        // Background thread only
+        std::FILE* m_File;
+
+        void Run();
+        bool WriteCheckpoint(const Data::Snapshot& snapshot);
+        void BeginRecord(uint8_t type);
+        void PutString(std::string_view text);
+        void EndRecord();
+        template<typename T>
+        void Put(T value) {
+            const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+            m_Record.insert(m_Record.end(), bytes, bytes + sizeof(T));
+        }
+    };
+
+}
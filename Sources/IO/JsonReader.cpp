@@ -0,0 +1,290 @@
+/**
+ * JsonReader.cpp
+ * Implementation of the JsonReader class
+ */
+
+#include "JsonReader.h"
+#include <cstdlib>
+#include <cstring>
+
+namespace IO {
+
+    JsonReader::JsonReader(size_t bufferSize)
+        : m_Buffer(bufferSize), m_Pos(m_Buffer.data()), m_End(m_Buffer.data()), m_File(nullptr), m_Consumed(0), m_Progress(nullptr) {
+    }
+
+    bool JsonReader::ParseFile(const std::string& path, JsonHandler& handler) {
+        std::FILE* file = std::fopen(path.c_str(), "rb");
+        if (!file) {
+            m_Error = "Cannot open " + path;
+            return false;
+        }
+        if (m_Progress && std::fseek(file, 0, SEEK_END) == 0) {
+            long size = std::ftell(file);
+            if (size > 0) m_Progress->SetTotal(static_cast<uint64_t>(size));
+            std::fseek(file, 0, SEEK_SET);
+        }
+        bool ok = Parse(file, handler);
+        std::fclose(file);
+        return ok;
+    }
+
+    bool JsonReader::Parse(std::FILE* file, JsonHandler& handler) {
+        m_File = file;
+        m_Pos = m_End = m_Buffer.data();
+        m_Consumed = 0;
+        m_Error.clear();
+
+        enum class State { Value, ValueOrEnd, Key, KeyOrEnd, AfterValue };
+        std::vector<char> stack;   // '{' or '[' per open container
+        State state = State::Value;
+
+        while (true) {
+            int c = SkipWhitespace();
+
+            if (state == State::AfterValue) {
+                if (stack.empty()) {
+                    if (c != -1) return Fail("Unexpected data after the top-level value");
+                    return true;
+                }
+                ++m_Pos;
+                if (c == ',') {
+                    state = stack.back() == '{' ? State::Key : State::Value;
+                } else if (c == '}' && stack.back() == '{') {
+                    stack.pop_back();
+                    if (!handler.OnEndObject()) return Fail("Aborted");
+                } else if (c == ']' && stack.back() == '[') {
+                    stack.pop_back();
+                    if (!handler.OnEndArray()) return Fail("Aborted");
+                } else {
+                    return Fail("Expected ',' or a closing bracket");
+                }
+                continue;
+            }
+
+            if (c == -1) return Fail("Unexpected end of input");
+
+            if (state == State::Key || state == State::KeyOrEnd) {
+                ++m_Pos;
+                if (c == '}' && state == State::KeyOrEnd) {
+                    stack.pop_back();
+                    if (!handler.OnEndObject()) return Fail("Aborted");
+                    state = State::AfterValue;
+                    continue;
+                }
+                if (c != '"') return Fail("Expected an object key");
+                std::string_view key;
+                if (!ReadString(key)) return false;
+                if (!handler.OnKey(key)) return Fail("Aborted");
+                if (SkipWhitespace() != ':') return Fail("Expected ':' after an object key");
+                ++m_Pos;
+                state = State::Value;
+                continue;
+            }
+
+            // State::Value or State::ValueOrEnd
+            if (c == ']' && state == State::ValueOrEnd) {
+                ++m_Pos;
+                stack.pop_back();
+                if (!handler.OnEndArray()) return Fail("Aborted");
+                state = State::AfterValue;
+                continue;
+            }
+
+            bool ok = true;
+            state = State::AfterValue;
+            switch (c) {
+                case '{':
+                    ++m_Pos;
+                    stack.push_back('{');
+                    ok = handler.OnBeginObject();
+                    state = State::KeyOrEnd;
+                    break;
+                case '[':
+                    ++m_Pos;
+                    stack.push_back('[');
+                    ok = handler.OnBeginArray();
+                    state = State::ValueOrEnd;
+                    break;
+                case '"': {
+                    ++m_Pos;
+                    std::string_view text;
+                    if (!ReadString(text)) return false;
+                    ok = handler.OnString(text);
+                    break;
+                }
+                case 't':
+                    if (!ReadLiteral("true")) return false;
+                    ok = handler.OnBool(true);
+                    break;
+                case 'f':
+                    if (!ReadLiteral("false")) return false;
+                    ok = handler.OnBool(false);
+                    break;
+                case 'n':
+                    if (!ReadLiteral("null")) return false;
+                    ok = handler.OnNull();
+                    break;
+                default: {
+                    double number;
+                    if (!ReadNumber(number)) return false;
+                    ok = handler.OnNumber(number);
+                    break;
+                }
+            }
+            if (!ok) return Fail("Aborted");
+        }
+    }
+
+    bool JsonReader::Refill() {
+        if (!m_File) return false;
+        m_Consumed += static_cast<uint64_t>(m_End - m_Buffer.data());
+        if (m_Progress && !m_Progress->Report(m_Consumed)) {
+            m_File = nullptr;   // Cancelled: report end of input from here on
+            return false;
+        }
+        size_t count = std::fread(m_Buffer.data(), 1, m_Buffer.size(), m_File);
+        m_Pos = m_Buffer.data();
+        m_End = m_Buffer.data() + count;
+        return count > 0;
+    }
+
+    int JsonReader::Peek() {
+        if (m_Pos == m_End && !Refill()) return -1;
+        return static_cast<unsigned char>(*m_Pos);
+    }
+
+    int JsonReader::Get() {
+        int c = Peek();
+        if (c != -1) ++m_Pos;
+        return c;
+    }
+
+    int JsonReader::SkipWhitespace() {
+        while (true) {
+            int c = Peek();
+            if (c != ' ' && c != '\n' && c != '\r' && c != '\t') return c;
+            ++m_Pos;
+        }
+    }
+
+    bool JsonReader::ReadString(std::string_view& out) {
+        // Fast path: the whole string is in the buffer and has no escapes
+        const char* p = m_Pos;
+        while (p < m_End && *p != '"' && *p != '\\' && static_cast<unsigned char>(*p) >= 0x20) ++p;
+        if (p < m_End && *p == '"') {
+            out = std::string_view(m_Pos, static_cast<size_t>(p - m_Pos));
+            m_Pos = p + 1;
+            return true;
+        }
+
+        // Slow path: accumulate into the scratch string across refills
+        m_Scratch.assign(m_Pos, p);
+        m_Pos = p;
+        while (true) {
+            int c = Get();
+            if (c == -1) return Fail("Unterminated string");
+            if (c == '"') break;
+            if (c == '\\') {
+                if (!ReadEscape()) return false;
+            } else if (c < 0x20) {
+                return Fail("Control character in string");
+            } else {
+                m_Scratch.push_back(static_cast<char>(c));
+            }
+        }
+        out = m_Scratch;
+        return true;
+    }
+
+    bool JsonReader::ReadEscape() {
+        auto readHex = [&](uint32_t& value) {
+            value = 0;
+            for (int i = 0; i < 4; ++i) {
+                int c = Get();
+                value <<= 4;
+                if (c >= '0' && c <= '9') value |= uint32_t(c - '0');
+                else if (c >= 'a' && c <= 'f') value |= uint32_t(c - 'a' + 10);
+                else if (c >= 'A' && c <= 'F') value |= uint32_t(c - 'A' + 10);
+                else return false;
+            }
+            return true;
+        };
+
+        int c = Get();
+        switch (c) {
+            case '"': m_Scratch.push_back('"'); return true;
+            case '\\': m_Scratch.push_back('\\'); return true;
+            case '/': m_Scratch.push_back('/'); return true;
+            case 'b': m_Scratch.push_back('\b'); return true;
+            case 'f': m_Scratch.push_back('\f'); return true;
+            case 'n': m_Scratch.push_back('\n'); return true;
+            case 'r': m_Scratch.push_back('\r'); return true;
+            case 't': m_Scratch.push_back('\t'); return true;
+            case 'u': break;
+            default: return Fail("Invalid escape sequence");
+        }
+
+        uint32_t code;
+        if (!readHex(code)) return Fail("Invalid \\u escape");
+        if (code >= 0xD800 && code <= 0xDBFF) {
+            // High surrogate: must be followed by an escaped low surrogate
+            uint32_t low;
+            if (Get() != '\\' || Get() != 'u' || !readHex(low) || low < 0xDC00 || low > 0xDFFF) {
+                return Fail("Invalid surrogate pair");
+            }
+            code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+        }
+
+        // Encode as UTF-8
+        if (code < 0x80) {
+            m_Scratch.push_back(static_cast<char>(code));
+        } else if (code < 0x800) {
+            m_Scratch.push_back(static_cast<char>(0xC0 | (code >> 6)));
+            m_Scratch.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        } else if (code < 0x10000) {
+            m_Scratch.push_back(static_cast<char>(0xE0 | (code >> 12)));
+            m_Scratch.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+            m_Scratch.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        } else {
+            m_Scratch.push_back(static_cast<char>(0xF0 | (code >> 18)));
+            m_Scratch.push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+            m_Scratch.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+            m_Scratch.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        }
+        return true;
+    }
+
+    bool JsonReader::ReadNumber(double& out) {
+        char text[64];
+        size_t length = 0;
+        while (true) {
+            int c = Peek();
+            bool numeric = (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+            if (!numeric) break;
+            if (length == sizeof(text) - 1) return Fail("Number too long");
+            text[length++] = static_cast<char>(c);
+            ++m_Pos;
+        }
+        text[length] = '\0';
+
+        if (length == 0) return Fail("Expected a value");
+        char* end = nullptr;
+        out = std::strtod(text, &end);
+        if (end != text + length) return Fail("Invalid number");
+        return true;
+    }
+
+    bool JsonReader::ReadLiteral(const char* literal) {
+        for (const char* p = literal; *p; ++p) {
+            if (Get() != *p) return Fail("Invalid literal");
+        }
+        return true;
+    }
+
+    bool JsonReader::Fail(const char* message) {
+        m_Error = std::string(message) + " at byte " + std::to_string(GetBytesRead());
+        return false;
+    }
+
+}
@@ -0,0 +1,99 @@
+/**
+ * JsonReader.h
+ * Streaming (SAX-style) JSON parser
+ *
+ * Reads JSON from a file through a fixed-size buffer and reports every
+ * token to a handler as it is parsed, so no document object model is ever
+ * built. Nesting is tracked with an explicit stack and arbitrarily deep
+ * input cannot overflow the call stack.
+ */
+
+#pragma once
+
+#include "Progress.h"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace IO {
+
+    /**
+     * @class JsonHandler
+     * @brief Receives the tokens of a JSON text in document order
+     *
+     * Every callback returns false to abort parsing. String views are only
+     * valid for the duration of the call.
+     */
+    class JsonHandler {
+    public:
+        virtual ~JsonHandler() = default;
+
+        virtual bool OnNull() { return true; }
+        virtual bool OnBool(bool) { return true; }
+        virtual bool OnNumber(double) { return true; }
+        virtual bool OnString(std::string_view) { return true; }
+        virtual bool OnKey(std::string_view) { return true; }
+        virtual bool OnBeginObject() { return true; }
+        virtual bool OnEndObject() { return true; }
+        virtual bool OnBeginArray() { return true; }
+        virtual bool OnEndArray() { return true; }
+    };
+
+    /**
+     * @class JsonReader
+     * @brief Incremental JSON tokenizer driving a JsonHandler
+     */
+    class JsonReader {
+    public:
+        /**
+         * @param bufferSize Bytes read from the file at a time
+         */
+        explicit JsonReader(size_t bufferSize = 1 << 20);
+
+        /**
+         * @brief Parse a whole file
+         * @param path File to read
+         * @param handler Receiver of the parsed tokens
+         * @return false on I/O error, malformed input or handler abort (see GetError())
+         */
+        bool ParseFile(const std::string& path, JsonHandler& handler);
+
+        /**
+         * @brief Parse from an already open stream until the end of the JSON text
+         */
+        bool Parse(std::FILE* file, JsonHandler& handler);
+
+        /**
+         * @brief Report bytes read to a progress object and stop when it is cancelled
+         *
+         * ParseFile() sets the total to the file size. Checked once per buffer refill.
+         */
+        void SetProgress(Progress* progress) { m_Progress = progress; }
+
+        const std::string& GetError() const { return m_Error; }
+        uint64_t GetBytesRead() const { return m_Consumed + static_cast<uint64_t>(m_Pos - m_Buffer.data()); } ///< Input consumed so far
+
+    private:
+        std::vector<char> m_Buffer;
+        const char* m_Pos;
+        const char* m_End;
+        std::FILE* m_File;
+        uint64_t m_Consumed;          ///< Bytes in buffers that were fully consumed
+        std::string m_Scratch;        ///< Holds strings that span buffers or contain escapes
+        std::string m_Error;
+        Progress* m_Progress;         ///< Optional progress sink (not owned)
+
+        bool Refill();
+        int Peek();
+        int Get();
+        int SkipWhitespace();
+        bool ReadString(std::string_view& out);
+        bool ReadEscape();
+        bool ReadNumber(double& out);
+        bool ReadLiteral(const char* literal);
+        bool Fail(const char* message);
+    };
+
+}
@@ -0,0 +1,172 @@
+/**
+ * JsonWriter.cpp
+ * Implementation of the JsonWriter class
+ */
+
+#include "JsonWriter.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+
+namespace IO {
+
+    JsonWriter::JsonWriter(size_t bufferSize)
+        : m_Buffer(bufferSize), m_Used(0), m_Flushed(0), m_File(nullptr), m_AfterKey(false) {
+    }
+
+    JsonWriter::~JsonWriter() {
+        if (m_File) Close();
+    }
+
+    bool JsonWriter::Open(const std::string& path) {
+        m_File = std::fopen(path.c_str(), "wb");
+        m_Used = 0;
+        m_Flushed = 0;
+        m_First.clear();
+        m_AfterKey = false;
+        m_Error.clear();
+        if (!m_File) m_Error = "Cannot create " + path;
+        return m_File != nullptr;
+    }
+
+    bool JsonWriter::Close() {
+        if (!m_File) return false;
+        Flush();
+        if (std::fclose(m_File) != 0 && m_Error.empty()) m_Error = "Write failed";
+        m_File = nullptr;
+        return m_Error.empty();
+    }
+
+    void JsonWriter::BeginObject() {
+        Separator();
+        Put('{');
+        m_First.push_back(true);
+    }
+
+    void JsonWriter::EndObject() {
+        m_First.pop_back();
+        Put('}');
+    }
+
+    void JsonWriter::BeginArray() {
+        Separator();
+        Put('[');
+        m_First.push_back(true);
+    }
+
+    void JsonWriter::EndArray() {
+        m_First.pop_back();
+        Put(']');
+    }
+
+    void JsonWriter::Key(std::string_view key) {
+        Separator();
+        PutEscaped(key);
+        Put(':');
+        m_AfterKey = true;
+    }
+
+    void JsonWriter::String(std::string_view value) {
+        Separator();
+        PutEscaped(value);
+    }
+
+    void JsonWriter::Number(double value) {
+        Separator();
+        if (!std::isfinite(value)) {
+            Put("null");
+            return;
+        }
+        // Shortest text that reads back as the same value
+        char text[32];
+        char* end = std::to_chars(text, text + sizeof(text), value).ptr;
+        Put(std::string_view(text, static_cast<size_t>(end - text)));
+    }
+
+    void JsonWriter::Number(float value) {
+        Separator();
+        if (!std::isfinite(value)) {
+            Put("null");
+            return;
+        }
+        char text[32];
+        char* end = std::to_chars(text, text + sizeof(text), value).ptr;
+        Put(std::string_view(text, static_cast<size_t>(end - text)));
+    }
+
+    void JsonWriter::Integer(int64_t value) {
+        Separator();
+        char text[24];
+        char* end = std::to_chars(text, text + sizeof(text), value).ptr;
+        Put(std::string_view(text, static_cast<size_t>(end - text)));
+    }
+
+    void JsonWriter::Bool(bool value) {
+        Separator();
+        Put(value ? "true" : "false");
+    }
+
+    void JsonWriter::Null() {
+        Separator();
+        Put("null");
+    }
+
+    void JsonWriter::Separator() {
+        if (m_AfterKey) {
+            m_AfterKey = false;
+            return;
+        }
+        if (m_First.empty()) return;
+        if (m_First.back()) m_First.back() = false;
+        else Put(',');
+    }
+
+    void JsonWriter::Flush() {
+        if (m_Used == 0) return;
+        if (m_File && std::fwrite(m_Buffer.data(), 1, m_Used, m_File) != m_Used && m_Error.empty()) {
+            m_Error = "Write failed";
+        }
+        m_Flushed += m_Used;
+        m_Used = 0;
+    }
+
+    void JsonWriter::Put(std::string_view text) {
+        while (!text.empty()) {
+            if (m_Used == m_Buffer.size()) Flush();
+            size_t count = std::min(text.size(), m_Buffer.size() - m_Used);
+            std::memcpy(m_Buffer.data() + m_Used, text.data(), count);
+            m_Used += count;
+            text.remove_prefix(count);
+        }
+    }
+
+    void JsonWriter::PutEscaped(std::string_view text) {
+        static const char hex[] = "0123456789abcdef";
+        Put('"');
+        size_t start = 0;
+        for (size_t i = 0; i < text.size(); ++i) {
+            unsigned char c = static_cast<unsigned char>(text[i]);
+            if (c >= 0x20 && c != '"' && c != '\\') continue;
+
+            // Copy the plain run, then the escape
+            Put(text.substr(start, i - start));
+            start = i + 1;
+            switch (c) {
+                case '"': Put("\\\""); break;
+                case '\\': Put("\\\\"); break;
+                case '\n': Put("\\n"); break;
+                case '\r': Put("\\r"); break;
+                case '\t': Put("\\t"); break;
+                default: {
+                    char escape[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF] };
+                    Put(std::string_view(escape, sizeof(escape)));
+                    break;
+                }
+            }
+        }
+        Put(text.substr(start));
+        Put('"');
+    }
+
+}
@@ -0,0 +1,85 @@
+/**
+ * JsonWriter.h
+ * Streaming JSON writer
+ *
+ * Emits JSON tokens into a fixed-size buffer that is flushed to the file
+ * whenever it fills up, so arbitrarily large documents are written without
+ * ever being held in memory as one string.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace IO {
+
+    /**
+     * @class JsonWriter
+     * @brief Buffered writer that inserts separators automatically
+     *
+     * Calls must form valid JSON: inside objects every value is preceded
+     * by Key(). Write errors are sticky and reported by Close().
+     */
+    class JsonWriter {
+    public:
+        explicit JsonWriter(size_t bufferSize = 1 << 20);
+        ~JsonWriter();
+
+        JsonWriter(const JsonWriter&) = delete;
+        JsonWriter& operator=(const JsonWriter&) = delete;
+
+        /**
+         * @brief Create (or truncate) the output file
+         */
+        bool Open(const std::string& path);
+
+        /**
+         * @brief Flush buffered output and close the file
+         * @return false if any write failed
+         */
+        bool Close();
+
+        void BeginObject();
+        void EndObject();
+        void BeginArray();
+        void EndArray();
+        void Key(std::string_view key);
+        void String(std::string_view value);
+        void Number(double value);
+        void Number(float value);     ///< Shortest form that round-trips as a float
+        void Integer(int64_t value);
+        void Bool(bool value);
+        void Null();
+
+        /**
+         * @brief Start a new line (between values, for readability)
+         */
+        void NewLine() { Put('\n'); }
+
+        uint64_t GetBytesWritten() const { return m_Flushed + m_Used; }
+        const std::string& GetError() const { return m_Error; }
+
+    private:
+        std::vector<char> m_Buffer;
+        size_t m_Used;
+        uint64_t m_Flushed;
+        std::FILE* m_File;
+        std::vector<bool> m_First;    ///< Per open container: no value written yet
+        bool m_AfterKey;              ///< Next value follows a key (no separator)
+        std::string m_Error;
+
+        void Separator();
+        void Flush();
+        void Put(char c) {
+            if (m_Used == m_Buffer.size()) Flush();
+            m_Buffer[m_Used++] = c;
+        }
+        void Put(std::string_view text);
+        void PutEscaped(std::string_view text);
+    };
+
+}
@@ -0,0 +1,52 @@
+/**
+ * MappedFile.h
+ * Read-only memory-mapped file
+ *
+ * Maps a whole file into the address space so that its contents can be
+ * used in place. Pages are loaded by the OS on first access, so opening
+ * even a very large file costs almost nothing up front.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace IO {
+
+    /**
+     * @class MappedFile
+     * @brief RAII wrapper around a read-only file mapping (POSIX or Win32)
+     */
+    class MappedFile {
+    public:
+        MappedFile();
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        /**
+         * @brief Map a file, replacing any previous mapping
+         * @return false if the file cannot be opened or mapped
+         */
+        bool Open(const std::string& path);
+        void Close();
+
+        const uint8_t* GetData() const { return m_Data; }
+        size_t GetSize() const { return m_Size; }
+        bool IsOpen() const { return m_Data != nullptr; }
+
+    private:
+        const uint8_t* m_Data;
+        size_t m_Size;
+#ifdef _WIN32
+        void* m_File;
+        void* m_Mapping;
+#else
+        int m_File;
+#endif
+    };
+
+}
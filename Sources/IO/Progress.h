@@ -0,0 +1,56 @@
+/**
+ * Progress.h
+ * Progress reporting and cancellation for long-running file operations
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace IO {
+
+    /**
+     * @class Progress
+     * @brief Shared between a worker doing I/O and the thread displaying it
+     *
+     * The worker sets the total once and reports work done as it goes; the
+     * UI thread reads the fraction and may request cancellation, which the
+     * worker notices at its next report. Units are up to the operation
+     * (bytes read, nodes written). A total of 0 means the amount is unknown.
+     */
+    class Progress {
+    public:
+        Progress() : m_Done(0), m_Total(0), m_Cancelled(false) {}
+
+        void SetTotal(uint64_t total) { m_Total.store(total, std::memory_order_relaxed); }
+
+        /**
+         * @brief Report work done so far
+         * @return false if the operation should stop because it was cancelled
+         */
+        bool Report(uint64_t done) {
+            m_Done.store(done, std::memory_order_relaxed);
+            return !IsCancelled();
+        }
+
+        /**
+         * @brief Fraction of the work done, or a negative value if the total is unknown
+         */
+        float GetFraction() const {
+            uint64_t total = m_Total.load(std::memory_order_relaxed);
+            if (total == 0) return -1.0f;
+            uint64_t done = m_Done.load(std::memory_order_relaxed);
+            return done >= total ? 1.0f : float(double(done) / double(total));
+        }
+
+        void Cancel() { m_Cancelled.store(true, std::memory_order_relaxed); }
+        bool IsCancelled() const { return m_Cancelled.load(std::memory_order_relaxed); }
+
+    private:
+        std::atomic<uint64_t> m_Done;
+        std::atomic<uint64_t> m_Total;
+        std::atomic<bool> m_Cancelled;
+    };
+
+}
@@ -0,0 +1,356 @@
+/**
+ * SubtreePager.cpp
+ * Implementation of the SubtreePager class
+ */
+
+#include "SubtreePager.h"
+#include <algorithm>
+#include <deque>
+#include <unordered_set>
+
+namespace IO {
+
+    namespace {
+
+        /// Subtrees this small get their stats computed inline instead of queued
+        constexpr uint32_t InlineStatsLimit = 256;
+
+    }
+
+    SubtreePager::SubtreePager(Data::Document& document)
+        : m_Document(document), m_LoadedCount(0), m_Budget(DefaultMemoryBudget), m_Clock(1), m_Applying(false), m_Stopping(false) {
+        m_Document.GetNodes().AddObserver(this);
+    }
+
+    SubtreePager::~SubtreePager() {
+        Stop();
+        m_Document.GetNodes().RemoveObserver(this);
+    }
+
+    bool SubtreePager::Open(const std::string& path, std::string& error) {
+        Stop();
+        m_View.Close();
+        m_Document.Clear();
+        m_StatsCache.clear();
+        if (!m_View.Open(path, error)) return false;
+
+        // The root and the first levels below it are loaded right away
+        Data::NodeId root = LoadRecord(0, None, 0.0f, 0.0f);
+        m_Document.SetRoot(root);
+        Apply(BuildPlan(0, root, ExpandNodeLimit), true);
+
+        m_Stopping = false;
+        m_Thread = std::thread(&SubtreePager::Run, this);
+        return true;
+    }
+
+    const Placeholder* SubtreePager::GetPlaceholder(Data::NodeId node) const {
+        auto it = m_Placeholders.find(node);
+        return it != m_Placeholders.end() ? &it->second : nullptr;
+    }
+
+    bool SubtreePager::Expand(Data::NodeId node) {
+        auto it = m_Placeholders.find(node);
+        if (it == m_Placeholders.end() || !m_Document.GetNodes().IsLive(node)) return false;
+        if (it->second.Loading) return true;
+        it->second.Loading = true;
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Requests.push_back({ it->second.Record, node, {}, 0.0f });
+        }
+        m_Wake.notify_one();
+        return true;
+    }
+
+    bool SubtreePager::Load(Data::NodeId node) {
+        auto it = m_Placeholders.find(node);
+        if (it == m_Placeholders.end()) return false;
+        // A background plan for the same node is dropped when it arrives
+        Apply(BuildPlan(it->second.Record, node, ExpandNodeLimit), false);
+        return true;
+    }
+
+    bool SubtreePager::Collapse(Data::NodeId node) {
+        if (node >= m_Info.size()) return false;
+        uint32_t expansion = m_Info[node].Expands;
+        if (expansion == None || expansion == 0 || m_Expansions[expansion].Pinned) return false;
+        if (!m_Document.GetNodes().IsLive(node)) return false;
+        Evict(expansion);
+        return true;
+    }
+
+    void SubtreePager::Touch(Data::NodeId node) {
+        if (!m_Document.GetNodes().IsAlive(node) || node >= m_Info.size()) return;
+        for (uint32_t e = m_Info[node].Expansion; e != None; e = m_Expansions[e].Parent) {
+            m_Expansions[e].LastUsed = m_Clock;
+        }
+    }
+
+    void SubtreePager::Update() {
+        std::vector<LoadPlan> plans;
+        std::vector<std::pair<uint32_t, SubtreeStats>> stats;
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            plans.swap(m_Plans);
+            stats.swap(m_Stats);
+        }
+
+        if (!stats.empty()) {
+            for (const auto& [record, value] : stats) m_StatsCache[record] = value;
+            for (auto& [node, placeholder] : m_Placeholders) {
+                if (placeholder.Stats.Ready) continue;
+                auto it = m_StatsCache.find(placeholder.Record);
+                if (it != m_StatsCache.end()) placeholder.Stats = it->second;
+            }
+        }
+
+        for (const LoadPlan& plan : plans) {
+            // The placeholder may have been deleted, loaded or collapsed meanwhile
+            auto it = m_Placeholders.find(plan.Node);
+            if (it == m_Placeholders.end() || it->second.Record != plan.Record || !it->second.Loading) continue;
+            if (!m_Document.GetNodes().IsLive(plan.Node)) {
+                it->second.Loading = false;
+                continue;
+            }
+            Apply(plan, false);
+        }
+
+        EnforceBudget();
+        ++m_Clock;
+    }
+
+    void SubtreePager::LoadAll() {
+        // Without a node limit every plan loads its whole subtree, so each
+        // remaining placeholder is visited once
+        while (!m_Placeholders.empty()) {
+            auto it = m_Placeholders.begin();
+            Apply(BuildPlan(it->second.Record, it->first, None), true);
+        }
+    }
+
+    void SubtreePager::OnNodeChanged(Data::NodeId id) {
+        if (m_Applying || id >= m_Info.size()) return;
+        uint32_t expansion = m_Info[id].Expansion;
+        if (expansion != None) Pin(expansion);
+    }
+
+    void SubtreePager::OnNodeDestroyed(Data::NodeId id) {
+        m_Placeholders.erase(id);
+        if (id >= m_Info.size()) return;
+        NodeInfo& info = m_Info[id];
+        if (info.Record != None) --m_LoadedCount;
+        if (info.Expands != None) m_Expansions[info.Expands].Alive = false;
+        info = NodeInfo();
+    }
+
+    void SubtreePager::OnStoreCleared() {
+        m_Placeholders.clear();
+        m_Info.clear();
+        m_Expansions.clear();
+        m_LoadedCount = 0;
+    }
+
+    void SubtreePager::Run() {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        while (true) {
+            m_Wake.wait(lock, [this] { return m_Stopping || !m_Requests.empty() || !m_StatsRequests.empty(); });
+            if (m_Stopping) return;
+
+            std::vector<LoadPlan> requests;
+            std::vector<uint32_t> statsRequests;
+            requests.swap(m_Requests);
+            statsRequests.swap(m_StatsRequests);
+            lock.unlock();
+
+            // Expansions first: they are what the user is waiting for
+            std::vector<LoadPlan> plans;
+            for (const LoadPlan& request : requests) plans.push_back(BuildPlan(request.Record, request.Node, ExpandNodeLimit));
+            lock.lock();
+            for (LoadPlan& plan : plans) m_Plans.push_back(std::move(plan));
+            lock.unlock();
+
+            std::vector<std::pair<uint32_t, SubtreeStats>> stats;
+            for (uint32_t record : statsRequests) stats.emplace_back(record, ComputeStats(record));
+            lock.lock();
+            m_Stats.insert(m_Stats.end(), stats.begin(), stats.end());
+        }
+    }
+
+    void SubtreePager::Stop() {
+        if (m_Thread.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                m_Stopping = true;
+            }
+            m_Wake.notify_one();
+            m_Thread.join();
+        }
+        m_Requests.clear();
+        m_StatsRequests.clear();
+        m_Plans.clear();
+        m_Stats.clear();
+    }
+
+    SubtreePager::LoadPlan SubtreePager::BuildPlan(uint32_t record, Data::NodeId node, uint32_t nodeLimit) const {
+        // Breadth-first, so that a limited expansion shows whole levels. The
+        // expanded record always gets all of its children
+        LoadPlan plan{ record, node, {}, 0.0f };
+        uint32_t count = m_View.GetNodeCount();
+        uint32_t loaded = 0;
+        std::deque<uint32_t> queue{ record };
+        while (!queue.empty()) {
+            uint32_t current = queue.front();
+            queue.pop_front();
+            uint32_t children = m_View.GetChildCount(current);
+            if (children == 0) continue;
+            if (current != record && uint64_t(loaded) + children > nodeLimit) continue;
+
+            plan.Expanded.push_back(current);
+            loaded += children;
+            for (uint32_t slot = 0; slot < children; ++slot) {
+                // Pre-order places children after their parent, which also rules out cycles
+                uint32_t child = m_View.GetChild(current, slot);
+                if (child <= current || child >= count) continue;
+                queue.push_back(child);
+
+                // Read what Apply() will read, so that it finds the pages resident
+                plan.Checksum += float(m_View.GetLabel(child).size() + m_View.GetEdgeLabel(current, slot).size());
+                plan.Checksum += m_View.GetX(child) + m_View.GetY(child);
+            }
+        }
+        return plan;
+    }
+
+    SubtreeStats SubtreePager::ComputeStats(uint32_t record) const {
+        // The subtree is the pre-order range after the record; a stack of
+        // range ends gives each record's depth without following child lists
+        SubtreeStats stats;
+        uint32_t count = m_View.GetNodeCount();
+        uint32_t end = uint32_t(std::min<uint64_t>(uint64_t(record) + m_View.GetNode(record).SubtreeSize, count));
+        std::vector<uint32_t> open{ end };
+        for (uint32_t i = record + 1; i < end; ++i) {
+            while (open.size() > 1 && open.back() <= i) open.pop_back();
+            const BinaryNode& node = m_View.GetNode(i);
+            ++stats.Nodes;
+            if (node.ChildCount == 0) ++stats.Leaves;
+            stats.Depth = std::max(stats.Depth, uint32_t(open.size()));
+            if (node.SubtreeSize > 1) open.push_back(uint32_t(std::min<uint64_t>(uint64_t(i) + node.SubtreeSize, end)));
+        }
+        stats.Ready = true;
+        return stats;
+    }
+
+    void SubtreePager::Apply(const LoadPlan& plan, bool pinned) {
+        Data::NodeStore& nodes = m_Document.GetNodes();
+        Data::NodeId root = plan.Node;
+        m_Placeholders.erase(root);
+
+        uint32_t expansion = static_cast<uint32_t>(m_Expansions.size());
+        m_Expansions.push_back({ root, InfoOf(root).Expansion, m_Clock, pinned, true });
+        InfoOf(root).Expands = expansion;
+
+        // New nodes keep their offset to the placeholder, wherever it was moved,
+        // and are stashed along with it if it was deleted
+        float dx = nodes.GetX(root) - m_View.GetX(plan.Record);
+        float dy = nodes.GetY(root) - m_View.GetY(plan.Record);
+        bool stashed = !nodes.IsLive(root);
+
+        m_Applying = true;
+        std::unordered_map<uint32_t, Data::NodeId> loaded{ { plan.Record, root } };
+        std::unordered_set<uint32_t> expanded(plan.Expanded.begin(), plan.Expanded.end());
+        std::vector<std::pair<Data::NodeId, uint32_t>> frontier;
+        for (uint32_t record : plan.Expanded) {
+            auto parent = loaded.find(record);
+            if (parent == loaded.end()) continue;
+            uint32_t children = m_View.GetChildCount(record);
+            nodes.ReserveChildren(parent->second, nodes.GetChildCount(parent->second) + children);
+            for (uint32_t slot = 0; slot < children; ++slot) {
+                uint32_t child = m_View.GetChild(record, slot);
+                if (child <= record || child >= m_View.GetNodeCount()) continue;
+                Data::NodeId id = LoadRecord(child, expansion, dx, dy);
+                nodes.AddChild(parent->second, id, m_View.GetEdgeLabel(record, slot));
+                if (stashed) nodes.SetStashed(id, true);
+                loaded.emplace(child, id);
+                if (!expanded.count(child) && m_View.GetChildCount(child) > 0) frontier.emplace_back(id, child);
+            }
+        }
+        m_Applying = false;
+
+        for (const auto& [node, record] : frontier) AddPlaceholder(node, record);
+    }
+
+    Data::NodeId SubtreePager::LoadRecord(uint32_t record, uint32_t expansion, float dx, float dy) {
+        Data::NodeStore& nodes = m_Document.GetNodes();
+        const BinaryNode& source = m_View.GetNode(record);
+        Data::NodeId id = nodes.Create(m_View.GetLabel(record), Data::NodeType(source.Type & 3));
+        nodes.SetShape(id, Data::ShapeType(source.Shape & 3));
+        nodes.SetColor(id, { source.R, source.G, source.B });
+        nodes.SetPosition(id, m_View.GetX(record) + dx, m_View.GetY(record) + dy);
+
+        NodeInfo& info = InfoOf(id);
+        info.Record = record;
+        info.Expansion = expansion;
+        ++m_LoadedCount;
+        return id;
+    }
+
+    void SubtreePager::AddPlaceholder(Data::NodeId node, uint32_t record) {
+        Placeholder placeholder{ record, {}, false };
+        auto cached = m_StatsCache.find(record);
+        if (cached != m_StatsCache.end()) {
+            placeholder.Stats = cached->second;
+        } else if (m_View.GetNode(record).SubtreeSize <= InlineStatsLimit) {
+            placeholder.Stats = m_StatsCache[record] = ComputeStats(record);
+        } else {
+            // The descendant count is in the record; the rest is computed in the background
+            placeholder.Stats.Nodes = m_View.GetNode(record).SubtreeSize - 1;
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_StatsRequests.push_back(record);
+        }
+        m_Placeholders[node] = placeholder;
+        if (!placeholder.Stats.Ready) m_Wake.notify_one();
+    }
+
+    void SubtreePager::Evict(uint32_t expansion) {
+        Data::NodeStore& nodes = m_Document.GetNodes();
+        Data::NodeId root = m_Expansions[expansion].Root;
+
+        // Deleting the children also ends every expansion below this one
+        m_Applying = true;
+        while (nodes.GetChildCount(root) > 0) m_Document.DeleteSubtree(nodes.GetChild(root, nodes.GetChildCount(root) - 1));
+        m_Applying = false;
+
+        m_Expansions[expansion].Alive = false;
+        InfoOf(root).Expands = None;
+        AddPlaceholder(root, InfoOf(root).Record);
+    }
+
+    void SubtreePager::EnforceBudget() {
+        // Least recently used first; parents are touched along with their
+        // children, so inner expansions go before the ones containing them.
+        // Nodes touched this frame (hovered, selected) are never evicted
+        const Data::NodeStore& nodes = m_Document.GetNodes();
+        while (GetMemoryUsage() > m_Budget) {
+            uint32_t victim = None;
+            for (uint32_t e = 1; e < m_Expansions.size(); ++e) {
+                const Expansion& candidate = m_Expansions[e];
+                if (!candidate.Alive || candidate.Pinned || candidate.LastUsed == m_Clock || !nodes.IsLive(candidate.Root)) continue;
+                if (victim == None || candidate.LastUsed < m_Expansions[victim].LastUsed) victim = e;
+            }
+            if (victim == None) break;
+            Evict(victim);
+        }
+    }
+
+    void SubtreePager::Pin(uint32_t expansion) {
+        for (uint32_t e = expansion; e != None && !m_Expansions[e].Pinned; e = m_Expansions[e].Parent) {
+            m_Expansions[e].Pinned = true;
+        }
+    }
+
+    SubtreePager::NodeInfo& SubtreePager::InfoOf(Data::NodeId node) {
+        if (node >= m_Info.size()) m_Info.resize(m_Document.GetNodes().GetCapacity());
+        return m_Info[node];
+    }
+
+}
@@ -0,0 +1,186 @@
+/**
+ * SubtreePager.h
+ * On-demand loading of collapsed subtrees from a binary tree file
+ *
+ * In lazy mode only the top of a tree is loaded into the document. Every
+ * node whose children are still on disk is a placeholder: a regular node
+ * standing for its whole subtree, which in the file is the contiguous
+ * pre-order record range that follows it. Expanding a placeholder loads
+ * its subtree level by level on a background thread, down to a node limit,
+ * below which deeper subtrees become placeholders in turn. Expansions that
+ * have not been used recently are collapsed again when the loaded nodes
+ * exceed a memory budget, unless something inside them has been edited.
+ */
+
+#pragma once
+
+#include "BinaryTreeView.h"
+#include "../Data/Document.h"
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace IO {
+
+    /**
+     * @struct SubtreeStats
+     * @brief Aggregate figures shown for an unloaded subtree
+     */
+    struct SubtreeStats {
+        uint32_t Nodes = 0;     ///< Descendants on disk (known immediately)
+        uint32_t Leaves = 0;    ///< Descendants without children
+        uint32_t Depth = 0;     ///< Levels below the placeholder
+        bool Ready = false;     ///< Leaves and Depth have been computed
+    };
+
+    /**
+     * @struct Placeholder
+     * @brief A loaded node whose descendants are still on disk
+     */
+    struct Placeholder {
+        uint32_t Record;        ///< Node table index of the node in the file
+        SubtreeStats Stats;
+        bool Loading = false;   ///< Expansion requested, not applied yet
+    };
+
+    /**
+     * @class SubtreePager
+     * @brief Loads and evicts subtrees of a mapped .dtb file in a document
+     *
+     * All public methods are called from the editing thread. Loaded nodes
+     * get fresh NodeIds (saved ids can be sparse, and restoring them would
+     * allocate slots for the whole file). Edits to loaded nodes pin the
+     * expansion they belong to, and its ancestors, so that eviction never
+     * discards changes or nodes the undo history refers to.
+     */
+    class SubtreePager : public Data::NodeObserver {
+    public:
+        static constexpr size_t DefaultMemoryBudget = 64 * 1024 * 1024;   ///< 64 MB of loaded nodes
+        static constexpr uint32_t ExpandNodeLimit = 4096;                  ///< Nodes loaded by one expansion
+
+        explicit SubtreePager(Data::Document& document);
+        ~SubtreePager() override;
+
+        SubtreePager(const SubtreePager&) = delete;
+        SubtreePager& operator=(const SubtreePager&) = delete;
+
+        /**
+         * @brief Map a .dtb file and load the top of its tree into the document
+         * @param error Receives a description of the problem on failure
+         */
+        bool Open(const std::string& path, std::string& error);
+
+        const Placeholder* GetPlaceholder(Data::NodeId node) const;
+        const std::unordered_map<Data::NodeId, Placeholder>& GetPlaceholders() const { return m_Placeholders; }
+
+        /**
+         * @brief Start loading a placeholder's subtree in the background
+         * @return false if the node is not a placeholder
+         */
+        bool Expand(Data::NodeId node);
+
+        /**
+         * @brief Load a placeholder's subtree right away (e.g. before adding a child to it)
+         * @return false if the node is not a placeholder
+         */
+        bool Load(Data::NodeId node);
+
+        /**
+         * @brief Unload the subtree loaded by expanding a node
+         * @return false if the node was not expanded from disk or its subtree is pinned
+         */
+        bool Collapse(Data::NodeId node);
+
+        /**
+         * @brief Mark the expansion containing a node as recently used
+         */
+        void Touch(Data::NodeId node);
+
+        /**
+         * @brief Apply finished background work and enforce the memory budget
+         *
+         * Call once per frame. Nodes may be created and destroyed.
+         */
+        void Update();
+
+        /**
+         * @brief Synchronously load every remaining subtree (e.g. before saving)
+         */
+        void LoadAll();
+
+        void SetMemoryBudget(size_t bytes) { m_Budget = bytes; }
+        size_t GetMemoryBudget() const { return m_Budget; }
+        size_t GetMemoryUsage() const { return size_t(m_LoadedCount) * Data::NodeStore::BytesPerNode; }
+        uint32_t GetLoadedCount() const { return m_LoadedCount; }   ///< Nodes currently loaded from the file
+        uint32_t GetFileNodeCount() const { return m_View.GetNodeCount(); }
+
+        void OnNodeChanged(Data::NodeId id) override;
+        void OnNodeDestroyed(Data::NodeId id) override;
+        void OnStoreCleared() override;
+
+    private:
+        static constexpr uint32_t None = 0xFFFFFFFFu;
+
+        /// Records to load for one expansion, computed on the background thread
+        struct LoadPlan {
+            uint32_t Record;                  ///< Record that was expanded
+            Data::NodeId Node;                ///< Its placeholder node
+            std::vector<uint32_t> Expanded;   ///< Records whose children are loaded, parents first
+            float Checksum;                   ///< Sum of the values read to page the records in
+        };
+
+        /// A subtree loaded by one expansion
+        struct Expansion {
+            Data::NodeId Root;
+            uint32_t Parent;          ///< Expansion owning Root
+            uint64_t LastUsed;
+            bool Pinned;
+            bool Alive;
+        };
+
+        /// Per NodeId: where a loaded node came from
+        struct NodeInfo {
+            uint32_t Record = None;
+            uint32_t Expansion = None;   ///< Expansion that loaded the node
+            uint32_t Expands = None;     ///< Expansion rooted at the node
+        };
+
+        Data::Document& m_Document;
+        BinaryTreeView m_View;
+        std::unordered_map<Data::NodeId, Placeholder> m_Placeholders;
+        std::unordered_map<uint32_t, SubtreeStats> m_StatsCache;   ///< Computed stats by record
+        std::vector<NodeInfo> m_Info;
+        std::vector<Expansion> m_Expansions;
+        uint32_t m_LoadedCount;
+        size_t m_Budget;
+        uint64_t m_Clock;
+        bool m_Applying;              ///< Store changes are the pager's own
+
+        // Background thread and its queues (guarded by m_Mutex)
+        std::thread m_Thread;
+        std::mutex m_Mutex;
+        std::condition_variable m_Wake;
+        std::vector<LoadPlan> m_Requests;
+        std::vector<uint32_t> m_StatsRequests;
+        std::vector<LoadPlan> m_Plans;
+        std::vector<std::pair<uint32_t, SubtreeStats>> m_Stats;
+        bool m_Stopping;
+
+        void Run();
+        void Stop();
+        LoadPlan BuildPlan(uint32_t record, Data::NodeId node, uint32_t nodeLimit) const;
+        SubtreeStats ComputeStats(uint32_t record) const;
+        void Apply(const LoadPlan& plan, bool pinned);
+        Data::NodeId LoadRecord(uint32_t record, uint32_t expansion, float dx, float dy);
+        void AddPlaceholder(Data::NodeId node, uint32_t record);
+        void Evict(uint32_t expansion);
+        void EnforceBudget();
+        void Pin(uint32_t expansion);
+        NodeInfo& InfoOf(Data::NodeId node);
+    };
+
+}
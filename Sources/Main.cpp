@@ -7,13 +7,90 @@
  */
 
 #include <iostream>
+#include <cstdlib>
+#include <filesystem>
+#include "Bench/Benchmarks.h"
 #include "Core/Window.h"
 #include "Graphics/Renderer.h"
 #include "Core/Input.h"
 #include "Editor/Editor.h"
 #include "Editor/Layout.h"
+#include "Eval/CodeGen.h"
+#include "Eval/Compiler.h"
+#include "Eval/Scoring.h"
+#include "IO/DocumentBinary.h"
+#include "IO/DocumentCsv.h"
+#include "IO/Journal.h"
 
 int main(int argc, char* argv[]) {
+    // Headless benchmark modes exit before any window is created
+    int benchResult = Bench::Run(argc, argv);
+    if (benchResult >= 0) {
+        return benchResult;
+    }
+
+    // Format conversion: --convert <input> <output>, formats chosen by extension (.h exports C++)
+    if (argc == 4 && std::string(argv[1]) == "--convert") {
+        std::string error;
+        if (IO::IsCsvPath(argv[2])) {
+            // Rule table import reports what it built
+            Data::Document document;
+            IO::CsvImportStats stats;
+            if (!IO::ImportCsv(argv[2], document, error, nullptr, &stats) || !IO::SaveDocument(argv[3], document, error)) {
+                std::cerr << "Conversion failed: " << error << std::endl;
+                return 1;
+            }
+            std::cout << stats.Rows << " rules -> " << stats.Nodes << " nodes in " << stats.Seconds * 1000.0 << " ms ("
+                      << static_cast<uint64_t>(stats.GetRowsPerSecond()) << " rows/s)";
+            if (stats.DuplicateRules) std::cout << ", " << stats.DuplicateRules << " duplicate";
+            if (stats.ConflictingRules) std::cout << ", " << stats.ConflictingRules << " conflicting (first outcome kept)";
+            std::cout << std::endl;
+            return 0;
+        }
+        if (Eval::IsCppPath(argv[3])) {
+            Data::Document document;
+            Eval::CodeGenOptions options;
+            options.SourceName = std::filesystem::path(argv[2]).filename().string();
+            if (!IO::LoadDocument(argv[2], document, error) || !Eval::ExportCpp(argv[3], document.TakeSnapshot(), error, options)) {
+                std::cerr << "Conversion failed: " << error << std::endl;
+                return 1;
+            }
+            return 0;
+        }
+        if (!IO::ConvertFile(argv[2], argv[3], error)) {
+            std::cerr << "Conversion failed: " << error << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    // Batch scoring: --score <tree> <records> <outcomes> [threads]
+    if ((argc == 5 || argc == 6) && std::string(argv[1]) == "--score") {
+        std::string error;
+        Data::Document document;
+        if (!IO::LoadDocument(argv[2], document, error)) {
+            std::cerr << "Cannot load tree: " << error << std::endl;
+            return 1;
+        }
+        Eval::Compiler compiler;
+        Eval::Program program;
+        if (!compiler.Compile(document, program)) {
+            const Eval::Diagnostic& first = compiler.GetDiagnostics().front();
+            std::cerr << "Cannot compile tree: \"" << first.Label << "\": " << first.Message << std::endl;
+            return 1;
+        }
+        Eval::ScoreOptions options;
+        if (argc == 6) options.Threads = static_cast<uint32_t>(std::strtoul(argv[5], nullptr, 10));
+        Eval::ScoreStats stats;
+        if (!Eval::ScoreFile(program, argv[3], argv[4], error, options, &stats)) {
+            std::cerr << "Scoring failed: " << error << std::endl;
+            return 1;
+        }
+        std::cout << stats.Records << " records on " << stats.Threads << " threads in " << stats.Seconds << " s ("
+                  << static_cast<uint64_t>(stats.GetRecordsPerSecond()) << " records/s)" << std::endl;
+        return 0;
+    }
+
     // Initialize window and  graphics
     Core::Window window("Larry - Decision Tree Editor", 1280, 720);
     if (!window.Initialize()) {
@@ -25,11 +102,26 @@ int main(int argc, char* argv[]) {
     
     // Create editor and layout (UI + Editor composition)
     Editor::Editor editor;
+    std::string documentPath = argc > 1 ? argv[1] : "DecisionTree.json";
+    bool opened = false;
+    if (std::filesystem::exists(documentPath) || std::filesystem::exists(IO::Journal::GetPathFor(documentPath))) {
+        opened = editor.OpenAsync(documentPath); // Keeps the demo tree if the file cannot be read
+    }
+    if (!opened) {
+        editor.StartJournal();
+    }
     Editor::Layout layout(&editor, 1280, 720, window.GetNativeWindow());
 
     // Main game loop
     bool quit = false;
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+    Uint64 lastCounter = SDL_GetPerformanceCounter();
     while (!quit) {
+        // Animations advance by the time the last frame actually took
+        Uint64 counter = SDL_GetPerformanceCounter();
+        float deltaTime = static_cast<float>(double(counter - lastCounter) / double(frequency));
+        lastCounter = counter;
+
         // PHASE 1: Input - Capture previous frame state before processing events
         Core::Input::Update();
 
@@ -47,8 +139,8 @@ int main(int argc, char* argv[]) {
 
         // PHASE 3: Update - Update UI and editor logic
         // UI gets priority; if it captures input, editor won't process it
-        bool uiHandled = layout.Update(0.016f); 
-        editor.Update(0.016f, uiHandled);
+        bool uiHandled = layout.Update(deltaTime);
+        editor.Update(deltaTime, uiHandled);
 
         // PHASE 4: Render - Clear, draw, and present
         window.Clear(30, 30, 30, 255); // Dark gray background
@@ -0,0 +1,83 @@
+/**
+ * ListView.h
+ * Titled list of clickable text rows
+ */
+
+#pragma once
+
+#include "Widget.h"
+#include <algorithm>
+#include <functional>
+
+namespace UI {
+
+    /**
+     * @class ListView
+     * @brief Rows of colored text under a title; clicking a row reports its index
+     *
+     * Rows that do not fit the widget's height are not drawn; text too wide
+     * for it is cut short.
+     */
+    class ListView : public Widget {
+    public:
+        static constexpr float RowH = 16.0f;
+        static constexpr float TextScale = 0.8f;
+
+        /// One row of text
+        struct Item {
+            std::string Text;
+            uint8_t R = 255, G = 255, B = 255;
+        };
+
+        /**
+         * @param onSelect Callback invoked with the index of a clicked row
+         */
+        ListView(float x, float y, float w, float h, const std::string& title, std::function<void(size_t)> onSelect)
+            : Widget(x, y, w, h), m_Title(title), m_OnSelect(onSelect), m_Hovered(-1) {}
+
+        void SetTitle(const std::string& title) { m_Title = title; }
+        void SetItems(std::vector<Item> items) { m_Items = std::move(items); }
+        const std::vector<Item>& GetItems() const { return m_Items; }
+
+        bool Update(float deltaTime) override {
+            float mx = Core::Input::GetMouseX();
+            float my = Core::Input::GetMouseY();
+            m_Hovered = -1;
+            if (mx < X || mx > X + W || my < Y || my > Y + H) return false;
+
+            // The first row sits below the title
+            float row = (my - Y - RowH) / RowH;
+            if (row >= 0.0f && size_t(row) < std::min(m_Items.size(), GetVisibleRows())) m_Hovered = int(row);
+            if (m_Hovered >= 0 && Core::Input::IsMouseButtonPressed(1) && m_OnSelect) m_OnSelect(size_t(m_Hovered));
+            return true;
+        }
+
+        void Draw(Graphics::Renderer& renderer) override {
+            renderer.SetColor(255, 255, 255, 255);
+            renderer.DrawText(X, Y, m_Title);
+
+            size_t maxChars = size_t(W / (8.0f * TextScale));
+            size_t rows = std::min(m_Items.size(), GetVisibleRows());
+            for (size_t i = 0; i < rows; ++i) {
+                const Item& item = m_Items[i];
+                float y = Y + RowH * float(i + 1);
+                if (int(i) == m_Hovered) {
+                    renderer.SetColor(100, 100, 200, 255);
+                    renderer.DrawRect(X - 2.0f, y - 2.0f, W + 4.0f, RowH);
+                }
+                renderer.SetColor(item.R, item.G, item.B, 255);
+                if (item.Text.size() <= maxChars) renderer.DrawText(X, y, item.Text, TextScale);
+                else renderer.DrawText(X, y, item.Text.substr(0, maxChars > 3 ? maxChars - 3 : 0) + "...", TextScale);
+            }
+        }
+
+    private:
+        size_t GetVisibleRows() const { return H > RowH ? size_t((H - RowH) / RowH) : 0; }
+
+        std::string m_Title;
+        std::vector<Item> m_Items;
+        std::function<void(size_t)> m_OnSelect;
+        int m_Hovered;   ///< Row under the mouse, or -1
+    };
+
+}
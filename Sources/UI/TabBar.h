@@ -9,6 +9,8 @@
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <cmath>
+#include <functional>
 
 namespace UI {
 
@@ -17,22 +19,59 @@ namespace UI {
      * @brief Tab bar with drag-to-reorder and add functionality
      * 
      * Displays horizontal tabs that can be clicked to switch between,
-     * dragged to reorder, and added with the "+" button.
+     * dragged to reorder, and added with the "+" button. While a file
+     * operation runs, the active tab shows its status, a progress bar and
+     * a cancel button.
      */
     class TabBar : public Widget {
     public:
-        TabBar(float x, float y, float w, float h) : Widget(x, y, w, h), m_ActiveTab(0), m_IsDragging(false), m_DragIndex(-1) {
+        TabBar(float x, float y, float w, float h) : Widget(x, y, w, h), m_ActiveTab(0), m_IsDragging(false), m_DragIndex(-1), m_Busy(false), m_Progress(-1.0f), m_Phase(0.0f) {
             // Initialize with default tabs
             m_Tabs.push_back("DecisionTree.json");
             m_Tabs.push_back("Settings.json"); 
         }
 
+        /**
+         * @brief Set the title of the active tab (e.g. the open file's name)
+         */
+        void SetActiveTitle(const std::string& title) {
+            if (m_ActiveTab < (int)m_Tabs.size() && m_Tabs[m_ActiveTab] != title) m_Tabs[m_ActiveTab] = title;
+        }
+
+        /**
+         * @brief Show a running operation on the active tab
+         * @param status Short text shown instead of the title
+         * @param fraction Progress in [0, 1], or negative if unknown
+         */
+        void SetProgress(const std::string& status, float fraction) {
+            m_Busy = true;
+            m_Status = status;
+            m_Progress = fraction;
+        }
+
+        void ClearProgress() { m_Busy = false; }
+
+        /**
+         * @brief Called when the cancel button of a running operation is clicked
+         */
+        void SetOnCancel(std::function<void()> onCancel) { m_OnCancel = std::move(onCancel); }
+
         bool Update(float deltaTime) override {
             float mx = Core::Input::GetMouseX();
             float my = Core::Input::GetMouseY();
             float tabW = 150.0f;
             bool handled = false;
 
+            // Cancel button at the right end of the active tab
+            if (m_Busy) {
+                m_Phase += deltaTime;
+                float cancelX = X + m_ActiveTab * tabW + tabW - 20;
+                if (Core::Input::IsMouseButtonPressed(1) && mx >= cancelX && mx <= cancelX + 16 && my >= Y + 8 && my <= Y + 24) {
+                    if (m_OnCancel) m_OnCancel();
+                    return true;
+                }
+            }
+
             // Handle "Add Tab" button click
             float addBtnX = X + m_Tabs.size() * tabW + 5;
             if (my >= Y && my <= Y + H && mx >= addBtnX && mx <= addBtnX + 20) {
@@ -109,7 +148,11 @@ namespace UI {
                 }
                 
                 renderer.SetColor(220, 220, 220, 255);
-                renderer.DrawText(tx + 10, Y + 12, m_Tabs[i]);
+                if (i == m_ActiveTab && m_Busy) {
+                    DrawProgress(renderer, tx, tabW);
+                } else {
+                    renderer.DrawText(tx + 10, Y + 12, m_Tabs[i]);
+                }
             }
 
             // Draw Add Button
@@ -125,6 +168,30 @@ namespace UI {
         int m_ActiveTab;
         bool m_IsDragging;
         int m_DragIndex;
+
+        // Running file operation on the active tab
+        bool m_Busy;
+        std::string m_Status;
+        float m_Progress;                  ///< Negative while the total is unknown
+        float m_Phase;                     ///< Animates the bar of an unknown total
+        std::function<void()> m_OnCancel;
+
+        void DrawProgress(Graphics::Renderer& renderer, float tx, float tabW) {
+            renderer.DrawText(tx + 10, Y + 12, m_Status);
+            renderer.SetColor(200, 200, 200, 255);
+            renderer.DrawText(tx + tabW - 16, Y + 12, "x");
+
+            // Bar along the bottom edge; a sliding segment if the total is unknown
+            float barY = Y + H - 4;
+            renderer.SetColor(0, 122, 204, 255);
+            if (m_Progress >= 0.0f) {
+                renderer.FillRect(tx, barY, tabW * std::min(m_Progress, 1.0f), 3);
+            } else {
+                float segment = tabW / 4;
+                float offset = (m_Phase * 120.0f) - std::floor(m_Phase * 120.0f / (tabW - segment)) * (tabW - segment);
+                renderer.FillRect(tx + offset, barY, segment, 3);
+            }
+        }
     };
 
 }
@@ -12,9 +12,9 @@ COMPILER="${2:-clang++}"
 # Mode par défaut release, ou passé en troisième argument
 MODE="${3:-release}"
 if [ "$MODE" = "debug" ]; then
-    CFLAGS="-g -O0 -std=c++20"
+    CFLAGS="-g -O0 -std=c++20 -pthread"
 else
-    CFLAGS="-O2 -std=c++20"
+    CFLAGS="-O2 -std=c++20 -pthread"
     MODE="release"
 fi
 